@@ -159,12 +159,16 @@ TRISTATE ASObject::isLess(ASObject* r)
 
 int variables_map::getNextEnumerable(unsigned int start) const
 {
-	if(start>=Variables.size())
+	//Inline traits are declared, so they are never enumerable
+	unsigned int declaredCount=declaredVars.size();
+	if(start<declaredCount)
+		start=declaredCount;
+	if(start>=size())
 		return -1;
 
 	const_var_iterator it=Variables.begin();
 
-	unsigned int i=0;
+	unsigned int i=declaredCount;
 	while (i < start)
 	{
 		++i;
@@ -404,10 +408,8 @@ _R<ASObject> ASObject::call_toString()
 	return _MR(ret.toObject(getSystemState()));
 }
 
-tiny_string ASObject::call_toJSON(bool& ok,std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter)
+bool ASObject::call_toJSON(std::string& res,std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter)
 {
-	tiny_string res;
-	ok = false;
 	multiname toJSONName(NULL);
 	toJSONName.name_type=multiname::NAME_STRING;
 	toJSONName.name_s_id=getSystemState()->getUniqueStringId("toJSON");
@@ -415,23 +417,23 @@ tiny_string ASObject::call_toJSON(bool& ok,std::vector<ASObject *> &path, asAtom
 	toJSONName.ns.emplace_back(getSystemState(),BUILTIN_STRINGS::STRING_AS3NS,NAMESPACE);
 	toJSONName.isAttribute = false;
 	if (!ASObject::hasPropertyByMultiname(toJSONName, true, true))
-		return res;
+		return false;
 
 	asAtom o=getVariableByMultiname(toJSONName,SKIP_IMPL);
 	if (o.type != T_FUNCTION)
-		return res;
+		return false;
 	asAtom v=asAtom::fromObject(this);
 	asAtom ret=o.callFunction(v,NULL,0,false);
 	if (ret.type == T_STRING)
 	{
+		tiny_string s = ret.toString();
 		res += "\"";
-		res += ret.toString();
+		res.append(s.raw_buf(),s.numBytes());
 		res += "\"";
 	}
 	else 
-		res = ret.toObject(getSystemState())->toJSON(path,replacer,spaces,filter);
-	ok = true;
-	return res;
+		ret.toObject(getSystemState())->appendJSON(res,path,replacer,spaces,filter);
+	return true;
 }
 
 bool ASObject::isPrimitive() const
@@ -446,12 +448,86 @@ bool ASObject::isConstructed() const
 {
 	return traitsInitialized && constructIndicator;
 }
-variables_map::variables_map(MemoryAccount *m)
+Mutex variables_shape::shapeMutex;
+variables_shape variables_shape::emptyShape;
+
+variables_shape::variables_shape():parent(NULL),nameId(0),slot_id(0),count(0),expectedCount(0),indexReady(true)
+{
+}
+
+variables_shape::variables_shape(variables_shape* p, uint32_t _nameId, uint32_t _slot_id):
+	parent(p),nameId(_nameId),slot_id(_slot_id),count(p->count+1),expectedCount(p->count+1),indexReady(false)
+{
+}
+
+variables_shape::~variables_shape()
+{
+	for(auto it=transitions.begin();it!=transitions.end();++it)
+		delete it->second;
+}
+
+variables_shape* variables_shape::addTrait(uint32_t _nameId, const nsNameAndKind& ns, uint32_t _slot_id)
+{
+	Locker l(shapeMutex);
+	transitionKey key(_nameId,ns.nsId,_slot_id);
+	auto it=transitions.find(key);
+	if(it!=transitions.end())
+		return it->second;
+	variables_shape* ret=new variables_shape(this,_nameId,_slot_id);
+	transitions.insert(make_pair(key,ret));
+	for(variables_shape* cur=this;cur && cur->expectedCount<ret->count;cur=cur->parent)
+		cur->expectedCount=ret->count;
+	return ret;
+}
+
+void variables_shape::buildIndex()
+{
+	Locker l(shapeMutex);
+	if(indexReady)
+		return;
+	names.resize(count);
+	for(variables_shape* cur=this;cur->parent;cur=cur->parent)
+	{
+		uint32_t pos=cur->count-1;
+		names[pos]=cur->nameId;
+		index.insert(make_pair(cur->nameId,pos));
+		if(cur->slot_id)
+		{
+			if(cur->slot_id>slots.size())
+				slots.resize(cur->slot_id,UINT32_MAX);
+			//The last definition of a slot wins
+			if(slots[cur->slot_id-1]==UINT32_MAX)
+				slots[cur->slot_id-1]=pos;
+		}
+	}
+	indexReady=true;
+}
+
+variables_map::variables_map(MemoryAccount *m):shape(NULL)
 {
 }
 
 variable* variables_map::findObjVar(uint32_t nameId, const nsNameAndKind& ns, TRAIT_KIND createKind, uint32_t traitKinds)
 {
+	if(shape)
+	{
+		shape->ensureIndex();
+		auto range=shape->index.equal_range(nameId);
+		for(auto it=range.first;it!=range.second;++it)
+		{
+			variable& v=declaredVars[it->second];
+			if(v.ns == ns)
+			{
+				if(!(v.kind & traitKinds))
+				{
+					assert(createKind==NO_CREATE_TRAIT);
+					return NULL;
+				}
+				return &v;
+			}
+		}
+	}
+
 	var_iterator ret=Variables.find(nameId);
 	while(ret!=Variables.end() && ret->first==nameId)
 	{
@@ -539,6 +615,8 @@ void ASObject::setDeclaredMethodByQName(uint32_t nameId, const nsNameAndKind& ns
 	{
 		assert(this->is<Class_base>());
 		obj=this->as<Class_base>()->borrowedVariables.findObjVar(nameId,ns,DECLARED_TRAIT, DECLARED_TRAIT);
+		//The lookups cached by the interpreter may resolve to the new trait now
+		inline_cache::invalidateAll();
 		if (!this->is<Class_inherit>())
 			o->setConstant();
 	}
@@ -606,6 +684,8 @@ void ASObject::setDeclaredMethodAtomByQName(uint32_t nameId, const nsNameAndKind
 	{
 		assert(this->is<Class_base>());
 		obj=this->as<Class_base>()->borrowedVariables.findObjVar(nameId,ns,DECLARED_TRAIT, DECLARED_TRAIT);
+		//The lookups cached by the interpreter may resolve to the new trait now
+		inline_cache::invalidateAll();
 		if (!this->is<Class_inherit>())
 			o->setConstant();
 	}
@@ -902,6 +982,18 @@ variable* variables_map::findObjVar(SystemState* sys,const multiname& mname, TRA
 	uint32_t name=mname.normalizedNameId(sys);
 	assert(!mname.ns.empty());
 
+	if(shape)
+	{
+		int32_t pos=findDeclaredPos(name,mname,false);
+		if(pos>=0)
+		{
+			if(declaredVars[pos].kind & traitKinds)
+				return &declaredVars[pos];
+			else
+				return NULL;
+		}
+	}
+
 	var_iterator ret=Variables.find(name);
 	auto nsIt=mname.ns.begin();
 
@@ -999,6 +1091,16 @@ void variables_map::initializeVar(const multiname& mname, asAtom& obj, multiname
 	assert(traitKind==DECLARED_TRAIT || traitKind==CONSTANT_TRAIT || traitKind == INSTANCE_TRAIT);
 
 	uint32_t name=mname.normalizedNameId(mainObj->getSystemState());
+	//Classes and script globals are unique, there is nothing to share with them
+	if(traitKind!=INSTANCE_TRAIT && !mainObj->is<Class_base>() && !mainObj->is<Global>())
+	{
+		variables_shape* next=(shape ? shape : &variables_shape::emptyShape)->addTrait(name,mname.ns[0],slot_id);
+		if(declaredVars.size()==declaredVars.capacity())
+			declaredVars.reserve(max(next->expectedCount,uint32_t(declaredVars.size()*2)));
+		declaredVars.emplace_back(traitKind, value, typemname, type,mname.ns[0],isenumerable);
+		shape=next;
+		return;
+	}
 	Variables.insert(Variables.cbegin(),make_pair(name, variable(traitKind, value, typemname, type,mname.ns[0],isenumerable)));
 	if (slot_id)
 		initSlot(slot_id,name, mname.ns[0]);
@@ -1256,10 +1358,16 @@ asAtom ASObject::getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTI
 			throwError<TypeError>(kCallOfNonFunctionError,name.normalizedNameUnresolved(getSystemState()));
 	}
 
+	LOG_CALL("Getting variable " << name);
+	return getVariableValue(obj);
+}
+
+asAtom ASObject::getVariableValue(variable* obj)
+{
 	if(obj->getter.type != T_INVALID)
 	{
 		//Call the getter
-		LOG_CALL("Calling the getter for " << name);
+		LOG_CALL("Calling the getter");
 		ASObject* target=NULL;
 		if (!obj->getter.isBound())
 			target=this;
@@ -1276,12 +1384,12 @@ asAtom ASObject::getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTI
 		{
 			if (obj->var.isBound())
 			{
-				LOG_CALL("function " << name << " is already bound to "<<obj->var.toDebugString() );
+				LOG_CALL("function is already bound to "<<obj->var.toDebugString() );
 				return obj->var;
 			}
 			else
 			{
-				LOG_CALL("Attaching this " << this->toDebugString() << " to function " << name);
+				LOG_CALL("Attaching this " << this->toDebugString() << " to function");
 				return asAtom::fromFunction(obj->var.getObject(),this);
 			}
 		}
@@ -1289,6 +1397,78 @@ asAtom ASObject::getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTI
 	}
 }
 
+bool ASObject::fillInlineCache(const multiname& name, bool forSetting, inline_cache_entry& entry)
+{
+	//Classes flagged with overridesPropertyAccess resolve some names on their own
+	if(classdef==NULL || classdef->overridesPropertyAccess || subtype==SUBTYPE_OBJECTCONSTRUCTOR)
+		return false;
+	entry.cls=classdef;
+	entry.shape=Variables.getShape();
+	entry.var=NULL;
+	entry.pos=0;
+	//Lookups for getting accept the empty and builtin namespaces as well, see findObjVar
+	int32_t pos=Variables.findDeclared(getSystemState(),name,!forSetting);
+	if(pos>=0)
+	{
+		if(forSetting && Variables.getDeclaredAt(pos)->kind==CONSTANT_TRAIT)
+			return false;
+		entry.pos=pos;
+		return true;
+	}
+	//Variables not stored inline may shadow the traits of the class
+	if(!Variables.Variables.empty())
+		return false;
+	variable* v;
+	if(forSetting)
+	{
+		v=classdef->findBorrowedSettable(name);
+		//Only setters are cached, assigning to other borrowed traits may throw
+		if(v==NULL || v->setter.type==T_INVALID)
+			return false;
+	}
+	else
+	{
+		//Traits found in the prototype chain are not cached
+		v=findGettableImpl(getSystemState(),classdef->borrowedVariables,name);
+		if(v==NULL)
+			return false;
+	}
+	entry.var=v;
+	return true;
+}
+
+const inline_cache_entry* ASObject::findInlineCache(inline_cache* ic)
+{
+	const inline_cache_entry* ret=ic->find(classdef,Variables.getShape());
+	if(ret && ret->var && !Variables.Variables.empty())
+		return NULL;
+	return ret;
+}
+
+asAtom ASObject::getVariableByInlineCache(const inline_cache_entry& entry)
+{
+	return getVariableValue(entry.var ? entry.var : Variables.getDeclaredAt(entry.pos));
+}
+
+bool ASObject::setVariableByInlineCache(const inline_cache_entry& entry, asAtom& o)
+{
+	if(entry.var)
+	{
+		LOG_CALL(_("Calling the setter"));
+		asAtom v=asAtom::fromObject(this);
+		asAtom ret=entry.var->setter.callFunction(v,&o,1,false);
+		assert_and_throw(ret.type == T_UNDEFINED);
+		LOG_CALL(_("End of setter"));
+		return true;
+	}
+	variable* obj=Variables.getDeclaredAt(entry.pos);
+	//Objects sharing a shape may still declare the same trait as a constant
+	if(obj->kind==CONSTANT_TRAIT)
+		return false;
+	obj->setVar(o,getSystemState());
+	return true;
+}
+
 asAtom ASObject::getVariableByMultiname(const tiny_string& name, std::list<tiny_string> namespaces)
 {
 	multiname varName(NULL);
@@ -1372,6 +1552,14 @@ void variables_map::check() const
 
 void variables_map::dumpVariables() const
 {
+	for(unsigned int i=0;i<declaredVars.size();i++)
+	{
+		shape->ensureIndex();
+		const variable& v=declaredVars[i];
+		LOG(LOG_INFO, (v.kind==CONSTANT_TRAIT ? "Constant (inline): " : "Declared (inline): ") << '[' << v.ns << "] "<<
+			getSys()->getStringFromUniqueId(shape->names[i]) << ' ' <<
+			v.var.type << ' ' << v.setter.type << ' ' << v.getter.type);
+	}
 	const_var_iterator it=Variables.cbegin();
 	for(;it!=Variables.cend();++it)
 	{
@@ -1406,6 +1594,15 @@ variables_map::~variables_map()
 
 void variables_map::destroyContents()
 {
+	for(auto it=declaredVars.begin();it!=declaredVars.end();++it)
+	{
+		ASATOM_DECREF(it->var);
+		ASATOM_DECREF(it->setter);
+		ASATOM_DECREF(it->getter);
+	}
+	//Keep the storage around, objects from the freelist are likely to get the same shape again
+	declaredVars.clear();
+	shape=NULL;
 	var_iterator it=Variables.begin();
 	while(it!=Variables.cend())
 	{
@@ -1488,6 +1685,9 @@ void variables_map::initSlot(unsigned int n, uint32_t nameId, const nsNameAndKin
 
 asAtom variables_map::getSlot(unsigned int n)
 {
+	variable* v=getDeclaredSlot(n);
+	if(v)
+		return v->var;
 	assert_and_throw(n > 0 && n<=slots_vars.size());
 	var_iterator it = Variables.find(slots_vars[n-1].nameId);
 	while(it!=Variables.end() && it->first == slots_vars[n-1].nameId)
@@ -1500,6 +1700,12 @@ asAtom variables_map::getSlot(unsigned int n)
 }
 void variables_map::setSlot(unsigned int n,asAtom o,SystemState* sys)
 {
+	variable* v=getDeclaredSlot(n);
+	if(v)
+	{
+		v->setVar(o,sys);
+		return;
+	}
 	validateSlotId(n);
 	var_iterator it = Variables.find(slots_vars[n-1].nameId);
 	while(it!=Variables.end() && it->first == slots_vars[n-1].nameId)
@@ -1515,6 +1721,12 @@ void variables_map::setSlot(unsigned int n,asAtom o,SystemState* sys)
 
 void variables_map::setSlotNoCoerce(unsigned int n, asAtom o)
 {
+	variable* v=getDeclaredSlot(n);
+	if(v)
+	{
+		v->setVarNoCoerce(o);
+		return;
+	}
 	validateSlotId(n);
 	var_iterator it = Variables.find(slots_vars[n-1].nameId);
 	while(it!=Variables.end() && it->first == slots_vars[n-1].nameId)
@@ -1545,6 +1757,9 @@ void variables_map::validateSlotId(unsigned int n) const
 variable* variables_map::getValueAt(unsigned int index)
 {
 	//TODO: CHECK behaviour on overridden methods
+	if(index<declaredVars.size())
+		return &declaredVars[index];
+	index-=declaredVars.size();
 	if(index<Variables.size())
 	{
 		var_iterator it=Variables.begin();
@@ -1583,6 +1798,12 @@ asAtom ASObject::getValueAt(int index)
 tiny_string variables_map::getNameAt(SystemState *sys, unsigned int index) const
 {
 	//TODO: CHECK behaviour on overridden methods
+	if(index<declaredVars.size())
+	{
+		shape->ensureIndex();
+		return sys->getStringFromUniqueId(shape->names[index]);
+	}
+	index-=declaredVars.size();
 	if(index<Variables.size())
 	{
 		const_var_iterator it=Variables.begin();
@@ -1598,21 +1819,65 @@ tiny_string variables_map::getNameAt(SystemState *sys, unsigned int index) const
 		throw RunTimeException("getNameAt out of bounds");
 }
 
+variable* variables_map::findFirstVar(uint32_t nameId)
+{
+	if(shape)
+	{
+		shape->ensureIndex();
+		auto it=shape->index.find(nameId);
+		if(it!=shape->index.end())
+			return &declaredVars[it->second];
+	}
+	var_iterator it=Variables.find(nameId);
+	if(it!=Variables.end())
+		return &it->second;
+	return NULL;
+}
+
+void variables_map::getDeclaredTraits(std::vector<std::pair<uint32_t,variable*>>& traits)
+{
+	for(unsigned int i=0;i<declaredVars.size();i++)
+	{
+		//Skip variable with a namespace, like protected ones
+		if(declaredVars[i].kind!=DECLARED_TRAIT || !declaredVars[i].ns.hasEmptyName())
+			continue;
+		shape->ensureIndex();
+		traits.push_back(make_pair(shape->names[i],&declaredVars[i]));
+	}
+	for(var_iterator it=Variables.begin();it!=Variables.end();++it)
+	{
+		if(it->second.kind!=DECLARED_TRAIT || !it->second.ns.hasEmptyName())
+			continue;
+		traits.push_back(make_pair(it->first,&it->second));
+	}
+}
+
+void variables_map::getNameIds(std::vector<uint32_t>& nameIds) const
+{
+	if(shape)
+	{
+		shape->ensureIndex();
+		nameIds.insert(nameIds.end(),shape->names.begin(),shape->names.end());
+	}
+	for(const_var_iterator it=Variables.cbegin();it!=Variables.cend();++it)
+		nameIds.push_back(it->first);
+}
+
 unsigned int ASObject::numVariables() const
 {
 	return varcount;
 }
 
-void ASObject::serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap)
+void ASObject::serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	Variables.serialize(out, stringMap, objMap, traitsMap);
 }
 
-void variables_map::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void variables_map::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	bool amf0 = out->getObjectEncoding() == ObjectEncoding::AMF0;
 	//Pairs of name, value
@@ -1627,15 +1892,28 @@ void variables_map::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& s
 			out->writeStringAMF0(out->getSystemState()->getStringFromUniqueId(it->first));
 		else
 			out->writeStringVR(stringMap,out->getSystemState()->getStringFromUniqueId(it->first));
-		it->second.var.toObject(out->getSystemState())->serialize(out, stringMap, objMap, traitsMap);
+		it->second.var.serialize(out, stringMap, objMap, traitsMap);
 	}
 	//The empty string closes the object
 	if (!amf0) out->writeStringVR(stringMap, "");
 }
 
-void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+tiny_string ASObject::getSerializationAlias(Class_base* type) const
+{
+	//Linear search for alias, only needed once per class
+	auto aliasIt=getSystemState()->aliasMap.begin();
+	const auto aliasEnd=getSystemState()->aliasMap.end();
+	for(;aliasIt!=aliasEnd;++aliasIt)
+	{
+		if(aliasIt->second==type)
+			return aliasIt->first;
+	}
+	return "";
+}
+
+void ASObject::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	bool amf0 = out->getObjectEncoding() == ObjectEncoding::AMF0;
 	if (amf0)
@@ -1663,25 +1941,11 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 	Class_base* type=getClass();
 	assert_and_throw(type);
 
-	//Check if an alias is registered
-	auto aliasIt=getSystemState()->aliasMap.begin();
-	const auto aliasEnd=getSystemState()->aliasMap.end();
-	//Linear search for alias
-	tiny_string alias;
-	for(;aliasIt!=aliasEnd;++aliasIt)
-	{
-		if(aliasIt->second==type)
-		{
-			alias=aliasIt->first;
-			break;
-		}
-	}
-	bool serializeTraits = alias.empty()==false;
-
 	if(type->isSubClass(InterfaceClass<IExternalizable>::getClass(getSystemState())))
 	{
+		tiny_string alias=getSerializationAlias(type);
 		//Custom serialization necessary
-		if(!serializeTraits)
+		if(alias.empty())
 			throwError<TypeError>(kInvalidParamError);
 		if (amf0)
 		{
@@ -1711,9 +1975,10 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 	//Add the object to the map
 	objMap.insert(make_pair(this, objMap.size()));
 
-	uint32_t traitsCount=0;
-	const variables_map::var_iterator beginIt = Variables.Variables.begin();
-	const variables_map::var_iterator endIt = Variables.Variables.end();
+	//Collect the public declared traits, both the inline ones and the ones in the map
+	std::vector<std::pair<uint32_t,variable*>> declaredTraits;
+	Variables.getDeclaredTraits(declaredTraits);
+	uint32_t traitsCount=declaredTraits.size();
 	//Check if the class traits has been already serialized to send it by reference
 	auto it2=traitsMap.find(type);
 
@@ -1724,18 +1989,10 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 		{
 			out->writeByte(amf0_reference_marker);
 			out->writeShort(it2->second);
-			for(variables_map::var_iterator varIt=beginIt; varIt != endIt; ++varIt)
+			for(auto varIt=declaredTraits.begin(); varIt != declaredTraits.end(); ++varIt)
 			{
-				if(varIt->second.kind==DECLARED_TRAIT)
-				{
-					if(!varIt->second.ns.hasEmptyName())
-					{
-						//Skip variable with a namespace, like protected ones
-						continue;
-					}
-					out->writeStringAMF0(getSystemState()->getStringFromUniqueId(varIt->first));
-					varIt->second.var.toObject(getSystemState())->serialize(out, stringMap, objMap, traitsMap);
-				}
+				out->writeStringAMF0(getSystemState()->getStringFromUniqueId(varIt->first));
+				varIt->second->var.serialize(out, stringMap, objMap, traitsMap);
 			}
 		}
 		if(!type->isSealed)
@@ -1750,46 +2007,14 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 	else
 	{
 		traitsMap.insert(make_pair(type, traitsMap.size()));
-		for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
-		{
-			if(varIt->second.kind==DECLARED_TRAIT)
-			{
-				if(!varIt->second.ns.hasEmptyName())
-				{
-					//Skip variable with a namespace, like protected ones
-					continue;
-				}
-				traitsCount++;
-			}
-		}
 		uint32_t dynamicFlag=(type->isSealed)?0:(1 << 3);
 		out->writeU29((traitsCount << 4) | dynamicFlag | 0x03);
-		out->writeStringVR(stringMap, alias);
-		for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
-		{
-			if(varIt->second.kind==DECLARED_TRAIT)
-			{
-				if(!varIt->second.ns.hasEmptyName())
-				{
-					//Skip variable with a namespace, like protected ones
-					continue;
-				}
-				out->writeStringVR(stringMap, getSystemState()->getStringFromUniqueId(varIt->first));
-			}
-		}
-	}
-	for(variables_map::var_iterator varIt=beginIt; varIt != endIt; ++varIt)
-	{
-		if(varIt->second.kind==DECLARED_TRAIT)
-		{
-			if(!varIt->second.ns.hasEmptyName())
-			{
-				//Skip variable with a namespace, like protected ones
-				continue;
-			}
-			varIt->second.var.toObject(getSystemState())->serialize(out, stringMap, objMap, traitsMap);
-		}
+		out->writeStringVR(stringMap, getSerializationAlias(type));
+		for(auto varIt=declaredTraits.begin(); varIt != declaredTraits.end(); ++varIt)
+			out->writeStringVR(stringMap, getSystemState()->getStringFromUniqueId(varIt->first));
 	}
+	for(auto varIt=declaredTraits.begin(); varIt != declaredTraits.end(); ++varIt)
+		varIt->second->var.serialize(out, stringMap, objMap, traitsMap);
 	if(!type->isSealed)
 		serializeDynamicProperties(out, stringMap, objMap, traitsMap);
 }
@@ -1835,60 +2060,91 @@ ASObject *ASObject::describeType() const
 
 tiny_string ASObject::toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter)
 {
-	bool ok;
-	tiny_string res = call_toJSON(ok,path,replacer,spaces,filter);
-	if (ok)
-		return res;
+	std::string res;
+	appendJSON(res,path,replacer,spaces,filter);
+	return tiny_string(res);
+}
 
-	tiny_string newline = (spaces.empty() ? "" : "\n");
-	if (this->isPrimitive())
+static inline void appendTinyString(std::string& res, const tiny_string& s)
+{
+	res.append(s.raw_buf(),s.numBytes());
+}
+
+static void appendQuotedJSONString(std::string& res, const tiny_string& s)
+{
+	res += '\"';
+	const char* p = s.raw_buf();
+	const char* end = p+s.numBytes();
+	while (p < end)
 	{
-		switch(this->type)
+		unsigned char c = *p;
+		if (c >= 0x80)
 		{
-			case T_STRING:
+			gunichar u = g_utf8_get_char(p);
+			const char* next = g_utf8_next_char(p);
+			if (u > 0xff)
 			{
-				res += "\"";
-				tiny_string sub = this->toString();
-				for (CharIterator it=sub.begin(); it!=sub.end(); it++)
+				char hexstr[16];
+				sprintf(hexstr,"\\u%04x",u);
+				res += hexstr;
+			}
+			else
+				res.append(p,next-p);
+			p = next;
+			continue;
+		}
+		switch (c)
+		{
+			case '\b':
+				res += "\\b";
+				break;
+			case '\f':
+				res += "\\f";
+				break;
+			case '\n':
+				res += "\\n";
+				break;
+			case '\r':
+				res += "\\r";
+				break;
+			case '\t':
+				res += "\\t";
+				break;
+			case '\"':
+				res += "\\\"";
+				break;
+			case '\\':
+				res += "\\\\";
+				break;
+			default:
+				if (c < 0x20)
 				{
-					switch (*it)
-					{
-						case '\b':
-							res += "\\b";
-							break;
-						case '\f':
-							res += "\\f";
-							break;
-						case '\n':
-							res += "\\n";
-							break;
-						case '\r':
-							res += "\\r";
-							break;
-						case '\t':
-							res += "\\t";
-							break;
-						case '\"':
-							res += "\\\"";
-							break;
-						case '\\':
-							res += "\\\\";
-							break;
-						default:
-							if (*it < 0x20 || *it > 0xff)
-							{
-								char hexstr[7];
-								sprintf(hexstr,"\\u%04x",*it);
-								res += hexstr;
-							}
-							else
-								res += *it;
-							break;
-					}
+					char hexstr[16];
+					sprintf(hexstr,"\\u%04x",c);
+					res += hexstr;
 				}
-				res += "\"";
+				else
+					res += (char)c;
+				break;
+		}
+		p++;
+	}
+	res += '\"';
+}
+
+void ASObject::appendJSON(std::string& res, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter)
+{
+	if (call_toJSON(res,path,replacer,spaces,filter))
+		return;
+
+	const char* newline = (spaces.empty() ? "" : "\n");
+	if (this->isPrimitive())
+	{
+		switch(this->type)
+		{
+			case T_STRING:
+				appendQuotedJSONString(res,this->toString());
 				break;
-			}
 			case T_UNDEFINED:
 				res += "null";
 				break;
@@ -1900,11 +2156,11 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, asAtom replacer, con
 				if (s == "Infinity" || s == "-Infinity" || s == "NaN")
 					res += "null";
 				else
-					res += s;
+					appendTinyString(res,s);
 				break;
 			}
 			default:
-				res += this->toString();
+				appendTinyString(res,this->toString());
 				break;
 		}
 	}
@@ -1914,22 +2170,17 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, asAtom replacer, con
 		
 		// 
 		std::vector<uint32_t> tmp;
-		variables_map::var_iterator beginIt = Variables.Variables.begin();
-		variables_map::var_iterator endIt = Variables.Variables.end();
-		variables_map::var_iterator varIt = beginIt;
-		while (varIt != endIt)
-		{
-			tmp.push_back(varIt->first);
-			varIt++;
-		}
+		Variables.getNameIds(tmp);
 		std::sort(tmp.begin(),tmp.end());
 		bool bfirst = true;
 		bool bObjectVars = true;
 		path.push_back(this);
+		tiny_string closingSpaces = spaces.substr_bytes(0,spaces.numBytes()/2);
 		auto tmpIt = tmp.begin();
 		while (tmpIt != tmp.end())
 		{
-			varIt = bObjectVars ? Variables.Variables.find(*tmpIt) : this->getClass()->borrowedVariables.Variables.find(*tmpIt);
+			uint32_t nameId = *tmpIt;
+			variable* var = bObjectVars ? Variables.findFirstVar(nameId) : this->getClass()->borrowedVariables.findFirstVar(nameId);
 			tmpIt++;
 			if (tmpIt == tmp.end() && bObjectVars)
 			{
@@ -1937,27 +2188,22 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, asAtom replacer, con
 				bObjectVars = false;
 				if (this->getClass())
 				{
-					variables_map::var_iterator varIt2 = this->getClass()->borrowedVariables.Variables.begin();
-					while (varIt2 != this->getClass()->borrowedVariables.Variables.end())
-					{
-						tmp.push_back(varIt2->first);
-						varIt2++;
-					}
+					this->getClass()->borrowedVariables.getNameIds(tmp);
 					std::sort(tmp.begin(),tmp.end());
 					tmpIt = tmp.begin();
 				}
 			}
-			if (varIt == endIt)
+			if (var == NULL)
 				continue;
-			if(varIt->second.ns.hasEmptyName() && (varIt->second.getter.type != T_INVALID || varIt->second.var.type!= T_INVALID))
+			if(var->ns.hasEmptyName() && (var->getter.type != T_INVALID || var->var.type!= T_INVALID))
 			{
-				ASObject* v = varIt->second.var.toObject(getSystemState());
-				if (varIt->second.getter.type != T_INVALID)
+				ASObject* v = var->var.toObject(getSystemState());
+				if (var->getter.type != T_INVALID)
 				{
 					asAtom t=asAtom::fromObject(this);
-					v=varIt->second.getter.callFunction(t,NULL,0,false).toObject(getSystemState());
+					v=var->getter.callFunction(t,NULL,0,false).toObject(getSystemState());
 				}
-				if(v->getObjectType() != T_UNDEFINED && varIt->second.isenumerable)
+				if(v->getObjectType() != T_UNDEFINED && var->isenumerable)
 				{
 					// check for cylic reference
 					if (v->getObjectType() != T_UNDEFINED &&
@@ -1970,48 +2216,52 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, asAtom replacer, con
 					{
 						if (!bfirst)
 							res += ",";
-						res += newline+spaces;
+						res += newline;
+						appendTinyString(res,spaces);
 						res += "\"";
-						res += getSystemState()->getStringFromUniqueId(varIt->first);
+						appendTinyString(res,getSystemState()->getStringFromUniqueId(nameId));
 						res += "\"";
 						res += ":";
 						if (!spaces.empty())
 							res += " ";
 						asAtom params[2];
 						
-						params[0] = asAtom::fromStringID(varIt->first);
+						params[0] = asAtom::fromStringID(nameId);
 						params[1] = asAtom::fromObject(v);
 						ASATOM_INCREF(params[1]);
 						asAtom funcret=replacer.callFunction(asAtom::nullAtom, params, 2,true);
 						if (funcret.type != T_INVALID)
-							res += funcret.toString();
+							appendTinyString(res,funcret.toString());
 						else
-							res += v->toJSON(path,replacer,spaces+spaces,filter);
+							v->appendJSON(res,path,replacer,spaces+spaces,filter);
 						bfirst = false;
 					}
-					else if (filter.empty() || filter.find(tiny_string(" ")+getSystemState()->getStringFromUniqueId(varIt->first)+" ") != tiny_string::npos)
+					else if (filter.empty() || filter.find(tiny_string(" ")+getSystemState()->getStringFromUniqueId(nameId)+" ") != tiny_string::npos)
 					{
 						if (!bfirst)
 							res += ",";
-						res += newline+spaces;
+						res += newline;
+						appendTinyString(res,spaces);
 						res += "\"";
-						res += getSystemState()->getStringFromUniqueId(varIt->first);
+						appendTinyString(res,getSystemState()->getStringFromUniqueId(nameId));
 						res += "\"";
 						res += ":";
 						if (!spaces.empty())
 							res += " ";
-						res += v->toJSON(path,replacer,spaces+spaces,filter);
+						v->appendJSON(res,path,replacer,spaces+spaces,filter);
 						bfirst = false;
 					}
 				}
 				if (!bfirst)
-					res += newline+spaces.substr_bytes(0,spaces.numBytes()/2);
+				{
+					res += newline;
+					appendTinyString(res,closingSpaces);
+				}
 			}
 		}
 		res += "}";
 		path.pop_back();
 	}
-	return res;
 }
 
 bool ASObject::hasprop_prototype()
@@ -2113,6 +2363,58 @@ ASObject *asAtom::toObject(SystemState *sys)
 	return objval;
 }
 
+void asAtom::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
+{
+	if (objval)
+	{
+		objval->serialize(out, stringMap, objMap, traitsMap);
+		return;
+	}
+	bool amf0 = out->getObjectEncoding() == ObjectEncoding::AMF0;
+	switch(type)
+	{
+		case T_INTEGER:
+		case T_UINTEGER:
+		case T_NUMBER:
+			//Same as Number::serialize, numbers are boxed as Number objects
+			out->writeByte(amf0 ? amf0_number_marker : double_marker);
+			out->serializeDouble(toNumber());
+			break;
+		case T_BOOLEAN:
+			if (amf0)
+			{
+				out->writeByte(amf0_boolean_marker);
+				out->writeByte(boolval ? 1:0);
+			}
+			else
+				out->writeByte(boolval ? true_marker : false_marker);
+			break;
+		case T_NULL:
+			out->writeByte(amf0 ? amf0_null_marker : null_marker);
+			break;
+		case T_UNDEFINED:
+			out->writeByte(amf0 ? amf0_undefined_marker : undefined_marker);
+			break;
+		case T_STRING:
+			if (amf0)
+			{
+				out->writeByte(amf0_string_marker);
+				out->writeStringAMF0(toString());
+			}
+			else
+			{
+				out->writeByte(string_marker);
+				out->writeStringVR(stringMap, toString());
+			}
+			break;
+		default:
+			toObject(out->getSystemState())->serialize(out, stringMap, objMap, traitsMap);
+			break;
+	}
+}
+
 asAtom asAtom::fromString(SystemState* sys, const tiny_string& s)
 {
 	asAtom a;
@@ -2491,14 +2793,14 @@ void asAtom::add(asAtom &v2, SystemState* sys)
 	}
 	else if(type== T_STRING || v2.type == T_STRING)
 	{
-		tiny_string a = toString();
-		tiny_string b = v2.toString();
-		LOG_CALL("add " << a << '+' << b);
+		//Don't convert here, toString may run user code that concatenate runs again
+		LOG_CALL("add " << toDebugString() << '+' << v2.toDebugString());
+		ASString* res = ASString::concatenate(sys,*this,v2);
 		decRef();
 		ASATOM_DECREF(v2);
 		type = T_STRING;
 		stringID = UINT32_MAX;
-		objval = abstract_s(sys,a + b);
+		objval = res;
 	}
 	else
 	{
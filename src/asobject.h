@@ -186,6 +186,7 @@ namespace lightspark
 class ASObject;
 class IFunction;
 template<class T> class Class;
+template<class T> class InterfaceClass;
 class Class_base;
 class ByteArray;
 class Loader;
@@ -193,6 +194,8 @@ class Type;
 class ABCContext;
 class SystemState;
 struct asfreelist;
+struct inline_cache;
+struct inline_cache_entry;
 
 extern SystemState* getSys();
 enum TRAIT_KIND { NO_CREATE_TRAIT=0, DECLARED_TRAIT=1, DYNAMIC_TRAIT=2, INSTANCE_TRAIT=5, CONSTANT_TRAIT=9 /* constants are also declared traits */ };
@@ -224,6 +227,10 @@ public:
 	asAtom(number_t val):numberval(val),objval(NULL),type(T_NUMBER) {}
 	asAtom(bool val):boolval(val),objval(NULL),type(T_BOOLEAN) {}
 	ASObject* toObject(SystemState* sys);
+	//Writes the value in AMF format, primitives are written without creating an object for them
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	// returns NULL if this atom is a primitive;
 	inline ASObject* getObject() const { return objval; }
 	static asAtom fromObject(ASObject* obj)
@@ -368,8 +375,114 @@ struct varName
 	}
 };
 
+/*
+ * A shape describes the layout of the declared traits that an object stores inline.
+ * Objects whose traits are initialized in the same order, like the instances of a
+ * class, walk the same transitions starting from the empty shape and end up sharing
+ * the same shape object. Shapes are never destroyed until the program exits.
+ */
+class variables_shape
+{
+friend class variables_map;
+private:
+	struct transitionKey
+	{
+		uint32_t nameId;
+		uint32_t nsId;
+		uint32_t slot_id;
+		transitionKey(uint32_t n, uint32_t ns, uint32_t s):nameId(n),nsId(ns),slot_id(s){}
+		inline bool operator<(const transitionKey& r) const
+		{
+			if(nameId!=r.nameId)
+				return nameId<r.nameId;
+			if(nsId!=r.nsId)
+				return nsId<r.nsId;
+			return slot_id<r.slot_id;
+		}
+	};
+	static Mutex shapeMutex;
+	static variables_shape emptyShape;
+	variables_shape* parent;
+	uint32_t nameId;
+	uint32_t slot_id;
+	//Number of traits described by this shape
+	uint32_t count;
+	//Largest count of the shapes derived from this one, used to size the inline storage
+	uint32_t expectedCount;
+	std::map<transitionKey,variables_shape*> transitions;
+	/*
+	 * The lookup tables are built on the first access, usually only the final
+	 * shape of an object is ever used for lookups
+	 */
+	ACQUIRE_RELEASE_FLAG(indexReady);
+	//Name -> position of the trait
+	std::unordered_multimap<uint32_t,uint32_t> index;
+	//Position -> name of the trait
+	std::vector<uint32_t> names;
+	//Slot id - 1 -> position of the trait, UINT32_MAX if the slot is not inline
+	std::vector<uint32_t> slots;
+	variables_shape(variables_shape* p, uint32_t _nameId, uint32_t _slot_id);
+	void buildIndex();
+	inline void ensureIndex()
+	{
+		if(!indexReady)
+			buildIndex();
+	}
+	/*
+	 * Returns the shape obtained by appending a trait to this one
+	 */
+	variables_shape* addTrait(uint32_t _nameId, const nsNameAndKind& ns, uint32_t _slot_id);
+public:
+	variables_shape();
+	~variables_shape();
+};
+
 class variables_map
 {
+private:
+	/*
+	 * Declared traits initialized from ABC code are stored inline, their
+	 * names and slots are described by the shared shape
+	 */
+	variables_shape* shape;
+	std::vector<variable> declaredVars;
+	/*
+	 * Returns the position of the first inline trait matching the name and one
+	 * of the namespaces of the multiname, or -1 if there is none.
+	 * If relaxedNS is true the empty and builtin namespaces flags of the multiname
+	 * are considered as well
+	 */
+	inline int32_t findDeclaredPos(uint32_t name, const multiname& mname, bool relaxedNS) const
+	{
+		shape->ensureIndex();
+		auto range=shape->index.equal_range(name);
+		for(auto it=range.first;it!=range.second;++it)
+		{
+			const nsNameAndKind& ns=declaredVars[it->second].ns;
+			if(mname.ns.empty())
+				return it->second;
+			if(relaxedNS && ((mname.hasEmptyNS && ns.hasEmptyName()) || (mname.hasBuiltinNS && ns.hasBuiltinName())))
+				return it->second;
+			for(auto nsIt=mname.ns.cbegin();nsIt!=mname.ns.cend();++nsIt)
+			{
+				if(ns==*nsIt)
+					return it->second;
+			}
+		}
+		return -1;
+	}
+	/*
+	 * Returns the inline trait for slot n, or NULL if the slot is not inline
+	 */
+	inline variable* getDeclaredSlot(unsigned int n)
+	{
+		if(!shape)
+			return NULL;
+		shape->ensureIndex();
+		if(n == 0 || n>shape->slots.size() || shape->slots[n-1]==UINT32_MAX)
+			return NULL;
+		return &declaredVars[shape->slots[n-1]];
+	}
 public:
 	//Names are represented by strings in the string and namespace pools
 	typedef std::unordered_multimap<uint32_t,variable> mapType;
@@ -397,6 +510,20 @@ public:
 		uint32_t name=mname.name_type == multiname::NAME_STRING ? mname.name_s_id : mname.normalizedNameId(sys);
 		assert(!mname.ns.empty());
 		
+		if(shape)
+		{
+			int32_t pos=findDeclaredPos(name,mname,true);
+			if(pos>=0)
+			{
+				const variable& v=declaredVars[pos];
+				if(!(v.kind & traitKinds))
+					return NULL;
+				if (nsRealId)
+					*nsRealId = v.ns.nsRealId;
+				return &v;
+			}
+		}
+
 		const_var_iterator ret=Variables.find(name);
 		auto nsIt=mname.ns.cbegin();
 		//Find the namespace
@@ -437,6 +564,20 @@ public:
 		uint32_t name=mname.name_type == multiname::NAME_STRING ? mname.name_s_id : mname.normalizedNameId(sys);
 		bool noNS = mname.ns.empty(); // no Namespace in multiname means we don't care about the namespace and take the first match
 
+		if(shape)
+		{
+			int32_t pos=findDeclaredPos(name,mname,true);
+			if(pos>=0)
+			{
+				variable& v=declaredVars[pos];
+				if(!(v.kind & traitKinds))
+					return NULL;
+				if (nsRealId)
+					*nsRealId = v.ns.nsRealId;
+				return &v;
+			}
+		}
+
 		var_iterator ret=Variables.find(name);
 		auto nsIt=mname.ns.cbegin();
 		//Find the namespace
@@ -484,18 +625,48 @@ public:
 	 */
 	void setSlotNoCoerce(unsigned int n, asAtom o);
 	void initSlot(unsigned int n, uint32_t nameId, const nsNameAndKind& ns);
+	/*
+	 * The inline declared traits come first in the positions used by
+	 * size, getNameAt, getValueAt and getNextEnumerable
+	 */
 	inline unsigned int size() const
 	{
-		return Variables.size();
+		return declaredVars.size()+Variables.size();
+	}
+	/*
+	 * Returns the first variable with the given name, ignoring the namespace
+	 */
+	variable* findFirstVar(uint32_t nameId);
+	void getNameIds(std::vector<uint32_t>& nameIds) const;
+	inline const variables_shape* getShape() const
+	{
+		return shape;
+	}
+	inline variable* getDeclaredAt(uint32_t pos)
+	{
+		return &declaredVars[pos];
+	}
+	/*
+	 * Returns the position of the inline trait found by findObjVar for mname, or -1
+	 */
+	inline int32_t findDeclared(SystemState* sys, const multiname& mname, bool relaxedNS) const
+	{
+		if(!shape)
+			return -1;
+		return findDeclaredPos(mname.normalizedNameId(sys),mname,relaxedNS);
 	}
+	/*
+	 * Returns the declared traits in the public namespace, used for serialization
+	 */
+	void getDeclaredTraits(std::vector<std::pair<uint32_t,variable*>>& traits);
 	tiny_string getNameAt(SystemState* sys,unsigned int i) const;
 	variable* getValueAt(unsigned int i);
 	int getNextEnumerable(unsigned int i) const;
 	~variables_map();
 	void check() const;
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	void dumpVariables() const;
 	void destroyContents();
 };
@@ -557,9 +728,11 @@ protected:
 	bool traitsInitialized:1;
 	bool constructIndicator:1;
 	bool constructorCallComplete:1; // indicates that the constructor including all super constructors has been called
-	void serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap);
+	//Returns the alias registered for the class, or the empty string
+	tiny_string getSerializationAlias(Class_base* type) const;
+	void serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	void setClass(Class_base* c);
 	static variable* findSettableImpl(SystemState* sys,variables_map& map, const multiname& name, bool* has_getter);
 	inline static const variable* findGettableImplConst(SystemState* sys, const variables_map& map, const multiname& name, uint32_t* nsRealId = NULL)
@@ -654,6 +827,26 @@ public:
 	 * It is used by getVariableByMultiname and by early binding code
 	 */
 	variable *findVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt, Class_base* cls, uint32_t* nsRealID = NULL);
+	/*
+	 * Returns the value of a variable of this object, calling the getter
+	 * or binding methods to this object like getVariableByMultiname does
+	 */
+	asAtom getVariableValue(variable* obj);
+	/*
+	 * Support for the inline caches of the interpreter.
+	 * fillInlineCache describes where name is found for this object. It returns
+	 * false if the lookup can't be cached, e.g. because the class overrides the lookup
+	 * of properties (see Class_base::overridesPropertyAccess) or the property comes
+	 * from the prototype chain.
+	 */
+	bool fillInlineCache(const multiname& name, bool forSetting, inline_cache_entry& entry);
+	const inline_cache_entry* findInlineCache(inline_cache* ic);
+	asAtom getVariableByInlineCache(const inline_cache_entry& entry);
+	/*
+	 * Returns false if the variable can't be set through the cache and the
+	 * full lookup must be used
+	 */
+	bool setVariableByInlineCache(const inline_cache_entry& entry, asAtom& o);
 	/*
 	 * Gets a variable of this object. It looks through all classes (beginning at cls),
 	 * then the prototype chain, and then instance variables.
@@ -760,7 +953,8 @@ public:
 	_R<ASObject> call_valueOf();
 	bool has_toString();
 	_R<ASObject> call_toString();
-	tiny_string call_toJSON(bool &ok, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces, const tiny_string &filter);
+	/* appends the result of the AS "toJSON" function to res, returns false if there is none */
+	bool call_toJSON(std::string& res, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces, const tiny_string &filter);
 
 	/* Helper function for calling getClass()->getQualifiedClassName() */
 	virtual tiny_string getClassName() const;
@@ -795,13 +989,16 @@ public:
 
 	  The various maps are used to implement reference type of the AMF3 spec
 	*/
-	virtual void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	virtual void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 
 	virtual ASObject *describeType() const;
 
-	virtual tiny_string toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter);
+	tiny_string toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter);
+	/* appends the JSON representation of this object to res,
+	 * so that nested values are written into a single buffer */
+	virtual void appendJSON(std::string& res, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter);
 	/* returns true if the current object is of type T */
 	template<class T> bool is() const { 
 		LOG(LOG_INFO,"dynamic cast:"<<this->getClassName());
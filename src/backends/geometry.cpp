@@ -19,6 +19,7 @@
 
 #include <fstream>
 #include <cmath>
+#include <limits>
 #include <algorithm>
 #include "swftypes.h"
 #include "logger.h"
@@ -30,6 +31,325 @@
 using namespace std;
 using namespace lightspark;
 
+void tokensVector::emplace_back(const GeomToken& t)
+{
+	uint32_t index=0;
+	switch(t.type)
+	{
+		case SET_FILL:
+		{
+			//Glyphs of a text all set the same solid fill, keep a single copy of it
+			const FILLSTYLE* last=fillStyles.empty()?NULL:&fillStyles.back();
+			if(last && last->FillStyleType==SOLID_FILL && t.fillStyle.FillStyleType==SOLID_FILL &&
+			   last->Color.Red==t.fillStyle.Color.Red && last->Color.Green==t.fillStyle.Color.Green &&
+			   last->Color.Blue==t.fillStyle.Color.Blue && last->Color.Alpha==t.fillStyle.Color.Alpha)
+				index=fillStyles.size()-1;
+			else
+			{
+				index=fillStyles.size();
+				fillStyles.push_back(t.fillStyle);
+			}
+			break;
+		}
+		case SET_STROKE:
+			index=lineStyles.size();
+			lineStyles.push_back(t.lineStyle);
+			break;
+		case FILL_TRANSFORM_TEXTURE:
+			index=textureTransforms.size();
+			textureTransforms.push_back(t.textureTransform);
+			break;
+		default:
+			break;
+	}
+	words.push_back((index<<8)|t.type);
+	switch(t.type)
+	{
+		case CURVE_CUBIC:
+			pushPoint(t.p1);
+			pushPoint(t.p2);
+			pushPoint(t.p3);
+			break;
+		case CURVE_QUADRATIC:
+			pushPoint(t.p1);
+			pushPoint(t.p2);
+			break;
+		case MOVE:
+		case STRAIGHT:
+			pushPoint(t.p1);
+			break;
+		default:
+			break;
+	}
+}
+
+void tokensVector::clear()
+{
+	words.clear();
+	fillStyles.clear();
+	lineStyles.clear();
+	textureTransforms.clear();
+}
+
+//Number of straight segments used to approximate cubic curves when hit testing
+#define CUBIC_HIT_SEGMENTS 16
+
+/*
+ * Count the crossings between the segment p0-p1 and the horizontal ray going from
+ * (x,y) towards positive x. An end point exactly at height y counts as above the ray,
+ * so that a ray through a vertex is only counted once.
+ */
+static inline uint32_t lineCrossings(number_t x, number_t y, const Vector2f& p0, const Vector2f& p1)
+{
+	if((p0.y>y)==(p1.y>y))
+		return 0;
+	number_t cx=p0.x+(y-p0.y)*(p1.x-p0.x)/(p1.y-p0.y);
+	return (x<cx)?1:0;
+}
+
+static inline number_t quadraticAt(number_t a, number_t c, number_t b, number_t t)
+{
+	number_t s=1-t;
+	return s*s*a+2*s*t*c+t*t*b;
+}
+
+static uint32_t quadraticCrossings(number_t x, number_t y, const Vector2f& p0, const Vector2f& c, const Vector2f& p1)
+{
+	//y(t)=a*t^2+b*t+cc is split at its extreme, so that each piece crosses y at most once
+	number_t a=p0.y-2*c.y+p1.y;
+	number_t b=2*(c.y-p0.y);
+	number_t cc=p0.y-y;
+	number_t ts[3];
+	int n=0;
+	ts[n++]=0;
+	if(a!=0)
+	{
+		number_t t=-b/(2*a);
+		if(t>0 && t<1)
+			ts[n++]=t;
+	}
+	ts[n++]=1;
+
+	uint32_t ret=0;
+	for(int i=0;i<n-1;i++)
+	{
+		number_t ya=quadraticAt(p0.y,c.y,p1.y,ts[i]);
+		number_t yb=quadraticAt(p0.y,c.y,p1.y,ts[i+1]);
+		if((ya>y)==(yb>y))
+			continue;
+		number_t t;
+		if(fabs(a)<1e-9)
+			t=-cc/b;
+		else
+		{
+			//Numerically stable roots, keep the one that falls in this piece
+			number_t d=sqrt(dmax(b*b-4*a*cc,0));
+			number_t q=-0.5*(b+copysign(d,b));
+			number_t r1=q/a;
+			number_t r2=(q!=0)?(cc/q):r1;
+			number_t mid=(ts[i]+ts[i+1])/2;
+			t=(fabs(r1-mid)<=fabs(r2-mid))?r1:r2;
+		}
+		t=dmax(ts[i],dmin(t,ts[i+1]));
+		if(x<quadraticAt(p0.x,c.x,p1.x,t))
+			ret++;
+	}
+	return ret;
+}
+
+static uint32_t cubicCrossings(number_t x, number_t y, const Vector2f& p0, const Vector2f& c1, const Vector2f& c2, const Vector2f& p1)
+{
+	uint32_t ret=0;
+	Vector2f prev=p0;
+	for(int i=1;i<=CUBIC_HIT_SEGMENTS;i++)
+	{
+		number_t t=number_t(i)/CUBIC_HIT_SEGMENTS;
+		number_t s=1-t;
+		Vector2f cur(s*s*s*p0.x+3*s*s*t*c1.x+3*s*t*t*c2.x+t*t*t*p1.x,
+			     s*s*s*p0.y+3*s*s*t*c1.y+3*s*t*t*c2.y+t*t*t*p1.y);
+		ret+=lineCrossings(x,y,prev,cur);
+		prev=cur;
+	}
+	return ret;
+}
+
+bool tokensVector::contains(number_t x, number_t y) const
+{
+	uint32_t crossings=0;
+	bool hasCurrent=false;
+	Vector2f start;
+	Vector2f cur;
+	for(uint32_t i=0;i<end();i=next(i))
+	{
+		GEOM_TOKEN_TYPE t=type(i);
+		if(t!=MOVE && t!=STRAIGHT && t!=CURVE_QUADRATIC && t!=CURVE_CUBIC)
+			continue;
+		Vector2f p=point(i,0);
+		if(t==MOVE || !hasCurrent)
+		{
+			//Close the previous subpath, as filling does
+			if(hasCurrent)
+				crossings+=lineCrossings(x,y,cur,start);
+			start=cur=p;
+			hasCurrent=true;
+			if(t==MOVE || t==STRAIGHT)
+				continue;
+		}
+		switch(t)
+		{
+			case STRAIGHT:
+				crossings+=lineCrossings(x,y,cur,p);
+				cur=p;
+				break;
+			case CURVE_QUADRATIC:
+			{
+				Vector2f end=point(i,1);
+				crossings+=quadraticCrossings(x,y,cur,p,end);
+				cur=end;
+				break;
+			}
+			case CURVE_CUBIC:
+			{
+				Vector2f end=point(i,2);
+				crossings+=cubicCrossings(x,y,cur,p,point(i,1),end);
+				cur=end;
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	if(hasCurrent)
+		crossings+=lineCrossings(x,y,cur,start);
+	return crossings%2;
+}
+
+void BoundsBox::merge(const BoundsBox& r)
+{
+	xmin=dmin(xmin,r.xmin);
+	xmax=dmax(xmax,r.xmax);
+	ymin=dmin(ymin,r.ymin);
+	ymax=dmax(ymax,r.ymax);
+}
+
+//Orders ids by the center of their box along one axis
+class BoxCenterLess
+{
+private:
+	const std::vector<BoundsBox>& boxes;
+	bool xAxis;
+public:
+	BoxCenterLess(const std::vector<BoundsBox>& b, bool x):boxes(b),xAxis(x){}
+	bool operator()(uint32_t a, uint32_t b) const
+	{
+		if(xAxis)
+			return boxes[a].xmin+boxes[a].xmax < boxes[b].xmin+boxes[b].xmax;
+		else
+			return boxes[a].ymin+boxes[a].ymax < boxes[b].ymin+boxes[b].ymax;
+	}
+};
+
+int32_t BoundsHierarchy::buildNode(vector<uint32_t>& ids, const vector<BoundsBox>& boxes,
+		uint32_t begin, uint32_t end, int32_t parent)
+{
+	int32_t index=nodes.size();
+	nodes.push_back(Node());
+	nodes[index].parent=parent;
+	if(end-begin==1)
+	{
+		uint32_t id=ids[begin];
+		nodes[index].box=boxes[id];
+		nodes[index].left=-1;
+		nodes[index].right=id;
+		leaves[id]=index;
+		return index;
+	}
+	//Split at the median of the longest axis of the box centers
+	BoundsBox centers(numeric_limits<double>::infinity(),-numeric_limits<double>::infinity(),
+			numeric_limits<double>::infinity(),-numeric_limits<double>::infinity());
+	for(uint32_t i=begin;i<end;i++)
+	{
+		const BoundsBox& b=boxes[ids[i]];
+		centers.merge(BoundsBox((b.xmin+b.xmax)/2,(b.xmin+b.xmax)/2,(b.ymin+b.ymax)/2,(b.ymin+b.ymax)/2));
+	}
+	bool xAxis=(centers.xmax-centers.xmin)>=(centers.ymax-centers.ymin);
+	uint32_t mid=begin+(end-begin)/2;
+	nth_element(ids.begin()+begin,ids.begin()+mid,ids.begin()+end,BoxCenterLess(boxes,xAxis));
+	//nodes may be reallocated by the recursive calls, so don't keep references
+	int32_t left=buildNode(ids,boxes,begin,mid,index);
+	int32_t right=buildNode(ids,boxes,mid,end,index);
+	nodes[index].left=left;
+	nodes[index].right=right;
+	nodes[index].box=nodes[left].box;
+	nodes[index].box.merge(nodes[right].box);
+	return index;
+}
+
+void BoundsHierarchy::build(const vector<BoundsBox>& boxes, const vector<bool>& hasBox)
+{
+	nodes.clear();
+	leaves.assign(boxes.size(),-1);
+	refitCount=0;
+	vector<uint32_t> ids;
+	for(uint32_t i=0;i<boxes.size();i++)
+	{
+		if(hasBox[i])
+			ids.push_back(i);
+	}
+	leafCount=ids.size();
+	if(ids.empty())
+		return;
+	nodes.reserve(2*ids.size()-1);
+	buildNode(ids,boxes,0,ids.size(),-1);
+}
+
+void BoundsHierarchy::clear()
+{
+	nodes.clear();
+	leaves.clear();
+	leafCount=0;
+	refitCount=0;
+}
+
+void BoundsHierarchy::refit(uint32_t id, const BoundsBox& box)
+{
+	assert(contains(id));
+	int32_t index=leaves[id];
+	nodes[index].box=box;
+	refitCount++;
+	//Update the ancestors until their box does not change anymore
+	for(index=nodes[index].parent;index!=-1;index=nodes[index].parent)
+	{
+		BoundsBox b=nodes[nodes[index].left].box;
+		b.merge(nodes[nodes[index].right].box);
+		if(b==nodes[index].box)
+			break;
+		nodes[index].box=b;
+	}
+}
+
+void BoundsHierarchy::query(number_t x, number_t y, vector<uint32_t>& out) const
+{
+	if(nodes.empty())
+		return;
+	//The root is always the first node
+	vector<int32_t> stack(1,0);
+	while(!stack.empty())
+	{
+		const Node& n=nodes[stack.back()];
+		stack.pop_back();
+		if(!n.box.contains(x,y))
+			continue;
+		if(n.left==-1)
+			out.push_back(n.right);
+		else
+		{
+			stack.push_back(n.left);
+			stack.push_back(n.right);
+		}
+	}
+}
+
 bool ShapesBuilder::isOutlineEmpty(const std::vector<ShapePathSegment>& outline)
 {
 	return outline.empty();
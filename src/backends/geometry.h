@@ -65,6 +65,10 @@ public:
 
 enum GEOM_TOKEN_TYPE { STRAIGHT=0, CURVE_QUADRATIC, MOVE, SET_FILL, SET_STROKE, CLEAR_FILL, CLEAR_STROKE, CURVE_CUBIC, FILL_KEEP_SOURCE, FILL_TRANSFORM_TEXTURE };
 
+/*
+ * A single drawing command. Tokens are only built in this form, tokensVector
+ * stores them packed.
+ */
 class GeomToken
 {
 public:
@@ -85,7 +89,70 @@ public:
 	GeomToken(GEOM_TOKEN_TYPE _t, const MATRIX _m):fillStyle(0xff),lineStyle(0xff),textureTransform(_m),type(_t),p1(0,0),p2(0,0),p3(0,0){}
 };
 
-typedef std::vector<GeomToken, reporter_allocator<GeomToken>> tokensVector;
+/*
+ * A packed stream of drawing commands.
+ * Each token is a word holding its type (low 8 bits) and, for SET_FILL,
+ * SET_STROKE and FILL_TRANSFORM_TEXTURE, an index in the matching style
+ * table (high 24 bits), followed by the x,y pairs of its points.
+ * A straight segment takes 12 bytes.
+ * Positions in the stream are word offsets: iterate with
+ * for(uint32_t i=0;i<tokens.end();i=tokens.next(i))
+ * Streams are refcounted so that a shape definition, all its instances and
+ * the renderers drawing them can share one; a shared stream must not be
+ * modified, see TokenContainer::getWritableTokens.
+ * Streams drawn by several objects (definition tags, Graphics.copyFrom) are
+ * flagged as shared, only those are worth keeping rasterized.
+ */
+class tokensVector: public RefCountable
+{
+private:
+	std::vector<int32_t, reporter_allocator<int32_t>> words;
+	std::vector<FILLSTYLE> fillStyles;
+	std::vector<LINESTYLE2> lineStyles;
+	std::vector<MATRIX> textureTransforms;
+	void pushPoint(const Vector2& p)
+	{
+		words.push_back(p.x);
+		words.push_back(p.y);
+	}
+public:
+	bool shared;
+	tokensVector(MemoryAccount* m, bool s=false):words(reporter_allocator<int32_t>(m)),shared(s){}
+	//Copies are owned by a single object, see TokenContainer::getWritableTokens
+	tokensVector(const tokensVector& r):RefCountable(),words(r.words),fillStyles(r.fillStyles),
+		lineStyles(r.lineStyles),textureTransforms(r.textureTransforms),shared(false){}
+	void emplace_back(const GeomToken& t);
+	void push_back(const GeomToken& t) { emplace_back(t); }
+	void clear();
+	bool empty() const { return words.empty(); }
+	uint32_t end() const { return words.size(); }
+	GEOM_TOKEN_TYPE type(uint32_t pos) const { return (GEOM_TOKEN_TYPE)(words[pos]&0xff); }
+	uint32_t next(uint32_t pos) const
+	{
+		switch(type(pos))
+		{
+			case MOVE:
+			case STRAIGHT:
+				return pos+3;
+			case CURVE_QUADRATIC:
+				return pos+5;
+			case CURVE_CUBIC:
+				return pos+7;
+			default:
+				return pos+1;
+		}
+	}
+	/* Point n (0 based) of the path token at pos */
+	Vector2 point(uint32_t pos, uint32_t n) const { return Vector2(words[pos+1+2*n],words[pos+2+2*n]); }
+	const FILLSTYLE& fillStyle(uint32_t pos) const { return fillStyles[((uint32_t)words[pos])>>8]; }
+	const LINESTYLE2& lineStyle(uint32_t pos) const { return lineStyles[((uint32_t)words[pos])>>8]; }
+	const MATRIX& textureTransform(uint32_t pos) const { return textureTransforms[((uint32_t)words[pos])>>8]; }
+	/*
+	 * Tests if the point (in token coordinates) is inside the area covered by all
+	 * the paths, using the even-odd rule. Subpaths are implicitly closed.
+	 */
+	bool contains(number_t x, number_t y) const;
+};
 
 enum SHAPE_PATH_SEGMENT_TYPE { PATH_START=0, PATH_STRAIGHT, PATH_CURVE_QUADRATIC };
 
@@ -124,6 +191,66 @@ public:
 	void clear();
 };
 
+/*
+ * An axis aligned box in floating point coordinates, bounds are inclusive
+ */
+class BoundsBox
+{
+public:
+	number_t xmin,xmax,ymin,ymax;
+	BoundsBox():xmin(0),xmax(0),ymin(0),ymax(0){}
+	BoundsBox(number_t _xmin, number_t _xmax, number_t _ymin, number_t _ymax):
+		xmin(_xmin),xmax(_xmax),ymin(_ymin),ymax(_ymax){}
+	bool contains(number_t x, number_t y) const { return xmin<=x && x<=xmax && ymin<=y && y<=ymax; }
+	void merge(const BoundsBox& r);
+	bool operator==(const BoundsBox& r) const
+	{
+		return xmin==r.xmin && xmax==r.xmax && ymin==r.ymin && ymax==r.ymax;
+	}
+};
+
+/*
+ * Bounding volume hierarchy used to find which boxes, out of a large set, contain a point.
+ * Boxes are identified by the index they had when the hierarchy was built, ids without a box
+ * are left out. Moving a box only updates the nodes on its path to the root, after too many
+ * updates the tree loses quality and the owner should build it again.
+ */
+class BoundsHierarchy
+{
+private:
+	class Node
+	{
+	public:
+		BoundsBox box;
+		int32_t parent;
+		//Children nodes, for leaves left is -1 and right is the id of the box
+		int32_t left;
+		int32_t right;
+	};
+	std::vector<Node> nodes;
+	//The leaf node of each id, -1 if the id has no box
+	std::vector<int32_t> leaves;
+	uint32_t leafCount;
+	uint32_t refitCount;
+	int32_t buildNode(std::vector<uint32_t>& ids, const std::vector<BoundsBox>& boxes,
+			uint32_t begin, uint32_t end, int32_t parent);
+public:
+	BoundsHierarchy():leafCount(0),refitCount(0){}
+	/*
+	 * Builds the tree from scratch
+	 * @param boxes The box of each id
+	 * @param hasBox Only ids for which this is true are inserted
+	 */
+	void build(const std::vector<BoundsBox>& boxes, const std::vector<bool>& hasBox);
+	void clear();
+	bool contains(uint32_t id) const { return id<leaves.size() && leaves[id]!=-1; }
+	/* Changes the box of an id that is already in the tree */
+	void refit(uint32_t id, const BoundsBox& box);
+	bool needsRebuild() const { return refitCount>leafCount; }
+	/* Appends to out the ids of all boxes containing the point, in no particular order */
+	void query(number_t x, number_t y, std::vector<uint32_t>& out) const;
+};
+
 std::ostream& operator<<(std::ostream& s, const Vector2& p);
 
 };
@@ -112,6 +112,12 @@ bool TextureChunk::resizeIfLargeEnough(uint32_t w, uint32_t h)
 	return false;
 }
 
+SharedTexture::~SharedTexture()
+{
+	if(tex.isValid())
+		getSys()->getRenderThread()->releaseTexture(tex);
+}
+
 CairoRenderer::CairoRenderer(const MATRIX& _m, int32_t _x, int32_t _y, int32_t _w, int32_t _h,
 		float _s, float _a, const std::vector<MaskData>& _ms)
 	: IDrawable(_w, _h, _x, _y, _a, _ms), scaleFactor(_s), matrix(_m)
@@ -203,8 +209,10 @@ cairo_pattern_t* CairoTokenRenderer::FILLSTYLEToCairo(const FILLSTYLE& style, do
 		case REPEATING_BITMAP:
 		case CLIPPED_BITMAP:
 		{
-			_NR<BitmapContainer> bm(style.bitmap);
-			if(bm.isNull())
+			//This runs concurrently in the thread pool: do not touch the
+			//reference count, the style copy already keeps the bitmap alive
+			const BitmapContainer* bm=style.bitmap.getPtr();
+			if(bm==NULL)
 				return NULL;
 
 			//Do an explicit cast, the data will not be modified
@@ -270,28 +278,28 @@ bool CairoTokenRenderer::cairoPathFromTokens(cairo_t* cr, const tokensVector& to
 		operation(instroke?stroke_cr:cr, ## args);
 
 	bool instroke = false;
-	for(uint32_t i=0;i<tokens.size();i++)
+	for(uint32_t i=0;i<tokens.end();i=tokens.next(i))
 	{
-		switch(tokens[i].type)
+		switch(tokens.type(i))
 		{
 			case MOVE:
-				PATH(cairo_move_to, tokens[i].p1.x, tokens[i].p1.y);
+				PATH(cairo_move_to, tokens.point(i,0).x, tokens.point(i,0).y);
 				break;
 			case STRAIGHT:
-				PATH(cairo_line_to, tokens[i].p1.x, tokens[i].p1.y);
+				PATH(cairo_line_to, tokens.point(i,0).x, tokens.point(i,0).y);
 				empty = false;
 				break;
 			case CURVE_QUADRATIC:
 				PATH(quadraticBezier,
-				   tokens[i].p1.x, tokens[i].p1.y,
-				   tokens[i].p2.x, tokens[i].p2.y);
+				   tokens.point(i,0).x, tokens.point(i,0).y,
+				   tokens.point(i,1).x, tokens.point(i,1).y);
 				empty = false;
 				break;
 			case CURVE_CUBIC:
 				PATH(cairo_curve_to,
-				   tokens[i].p1.x, tokens[i].p1.y,
-				   tokens[i].p2.x, tokens[i].p2.y,
-				   tokens[i].p3.x, tokens[i].p3.y);
+				   tokens.point(i,0).x, tokens.point(i,0).y,
+				   tokens.point(i,1).x, tokens.point(i,1).y,
+				   tokens.point(i,2).x, tokens.point(i,2).y);
 				empty = false;
 				break;
 			case SET_FILL:
@@ -303,7 +311,7 @@ bool CairoTokenRenderer::cairoPathFromTokens(cairo_t* cr, const tokensVector& to
 
 				cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
 
-				const FILLSTYLE& style = tokens[i].fillStyle;
+				const FILLSTYLE& style = tokens.fillStyle(i);
 				cairo_pattern_t* pattern = FILLSTYLEToCairo(style, scaleCorrection);
 				if(pattern)
 				{
@@ -322,7 +330,7 @@ bool CairoTokenRenderer::cairoPathFromTokens(cairo_t* cr, const tokensVector& to
 				instroke = true;
 				cairo_stroke(stroke_cr);
 
-				const LINESTYLE2& style = tokens[i].lineStyle;
+				const LINESTYLE2& style = tokens.lineStyle(i);
 
 				cairo_set_operator(stroke_cr, CAIRO_OPERATOR_OVER);
 				if (style.HasFillFlag)
@@ -374,7 +382,7 @@ bool CairoTokenRenderer::cairoPathFromTokens(cairo_t* cr, const tokensVector& to
 
 				cairo_fill(cr);
 
-				if(tokens[i].type==CLEAR_FILL)
+				if(tokens.type(i)==CLEAR_FILL)
 					// Clear source.
 					cairo_set_operator(cr, CAIRO_OPERATOR_DEST);
 				break;
@@ -398,7 +406,7 @@ bool CairoTokenRenderer::cairoPathFromTokens(cairo_t* cr, const tokensVector& to
 				pattern=cairo_get_source(cr);
 				cairo_pattern_get_matrix(pattern, &origmat);
 
-				cairo_pattern_set_matrix(pattern, &tokens[i].textureTransform);
+				cairo_pattern_set_matrix(pattern, &tokens.textureTransform(i));
 
 				cairo_fill(cr);
 
@@ -447,23 +455,44 @@ cairo_surface_t* CairoRenderer::allocateSurface(uint8_t*& buf)
 	return cairo_image_surface_create_for_data(buf, CAIRO_FORMAT_ARGB32, width, height, cairoWidthStride);
 }
 
+bool CairoTokenRenderer::getCacheKey(RasterCacheKey& key) const
+{
+	//The masks depend on other objects
+	if(!masks.empty())
+		return false;
+	//Streams built by Graphics or TextField usually belong to a single object and
+	//change often, caching them would only evict the entries of shared streams
+	if(!tokens->shared)
+		return false;
+	key.tokens=tokens;
+	key.scaling=scaleFactor;
+	key.width=width;
+	key.height=height;
+	key.xx=lrint(matrix.xx*RASTER_CACHE_MATRIX_STEPS);
+	key.yx=lrint(matrix.yx*RASTER_CACHE_MATRIX_STEPS);
+	key.xy=lrint(matrix.xy*RASTER_CACHE_MATRIX_STEPS);
+	key.yy=lrint(matrix.yy*RASTER_CACHE_MATRIX_STEPS);
+	key.x0=lrint((matrix.x0-xOffset)*RASTER_CACHE_SUBPIXEL_STEPS);
+	key.y0=lrint((matrix.y0-yOffset)*RASTER_CACHE_SUBPIXEL_STEPS);
+	return true;
+}
+
 void CairoTokenRenderer::executeDraw(cairo_t* cr)
 {
 	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
 	cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD);
 
-	cairoPathFromTokens(cr, tokens, scaleFactor, false);
+	cairoPathFromTokens(cr, *tokens, scaleFactor, false);
 }
 
-#ifdef HAVE_NEW_GLIBMM_THREAD_API
-StaticRecMutex CairoRenderer::cairoMutex;
-#else
-StaticRecMutex CairoRenderer::cairoMutex = GLIBMM_STATIC_REC_MUTEX_INIT;
-#endif
+IDrawable::~IDrawable()
+{
+	for(uint32_t i=0;i<masks.size();i++)
+		delete masks[i].m;
+}
 
 uint8_t* CairoRenderer::getPixelBuffer()
 {
-	RecMutex::Lock l(cairoMutex);
 	if(width==0 || height==0 || !Config::getConfig()->isRenderingEnabled())
 		return NULL;
 
@@ -572,35 +601,13 @@ uint8_t* CairoRenderer::getPixelBuffer()
 	return ret;
 }
 
-bool CairoTokenRenderer::hitTest(const tokensVector& tokens, float scaleFactor, number_t x, number_t y)
-{
-	cairo_surface_t* cairoSurface=cairo_image_surface_create_for_data(NULL, CAIRO_FORMAT_ARGB32, 0, 0, 0);
-	cairo_t *cr=cairo_create(cairoSurface);
-	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
-	cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD);
-
-	bool empty=cairoPathFromTokens(cr, tokens, scaleFactor, true);
-	bool ret=false;
-	if(!empty)
-	{
-		/* reset the matrix so x and y are not scaled
-		 * by the current cairo transformation
-		 */
-		cairo_identity_matrix(cr);
-		ret=cairo_in_fill(cr, x, y);
-	}
-	cairo_destroy(cr);
-	cairo_surface_destroy(cairoSurface);
-	return ret;
-}
-
 void CairoTokenRenderer::applyCairoMask(cairo_t* cr,int32_t xOffset,int32_t yOffset) const
 {
 	cairo_matrix_t tmp=matrix;
 	tmp.x0-=xOffset;
 	tmp.y0-=yOffset;
 	cairo_set_matrix(cr, &tmp);
-	cairoPathFromTokens(cr, tokens, scaleFactor, true);
+	cairoPathFromTokens(cr, *tokens, scaleFactor, true);
 	cairo_clip(cr);
 }
 
@@ -865,20 +872,41 @@ void CairoPangoRenderer::applyCairoMask(cairo_t* cr, int32_t xOffset, int32_t yO
 	assert(false);
 }
 
-AsyncDrawJob::AsyncDrawJob(IDrawable* d, _R<DisplayObject> o):drawable(d),owner(o),surfaceBytes(NULL),uploadNeeded(false)
+AsyncDrawJob::AsyncDrawJob(IDrawable* d, _R<DisplayObject> o):drawable(d),owner(o),surfaceBytes(NULL),uploadNeeded(false),cacheable(false)
 {
+	owner->getSystemState()->getRenderThread()->drawJobQueued();
 }
 
 AsyncDrawJob::~AsyncDrawJob()
 {
 	delete drawable;
 	delete[] surfaceBytes;
+	owner->getSystemState()->getRenderThread()->drawJobDone();
 }
 
 void AsyncDrawJob::execute()
 {
 	if (!owner->hasChanged)
 		return;
+	RenderThread* rt=getSys()->getRenderThread();
+	//Only share drawables that are not clipped by the borders of the window.
+	//Retained surfaces are never shared, they are kept by their owner anyway
+	cacheable=!owner->isRetainedSurfaceActive() && drawable->getCacheKey(cacheKey) &&
+		drawable->getXOffset()>=0 && drawable->getYOffset()>=0 &&
+		drawable->getXOffset()+drawable->getWidth()<=(int32_t)rt->windowWidth &&
+		drawable->getYOffset()+drawable->getHeight()<=(int32_t)rt->windowHeight &&
+		rt->rasterCache.fits(drawable->getWidth(),drawable->getHeight());
+	if(cacheable)
+	{
+		cachedTexture=rt->rasterCache.lookup(cacheKey);
+		if(!cachedTexture.isNull())
+		{
+			//The pixels are already in a texture, skip cairo and the upload
+			uploadNeeded=true;
+			owner->hasChanged=false;
+			return;
+		}
+	}
 	surfaceBytes=drawable->getPixelBuffer();
 	if(surfaceBytes)
 		uploadNeeded=true;
@@ -919,12 +947,29 @@ const TextureChunk& AsyncDrawJob::getTexture()
 	CachedSurface& surface=owner->cachedSurface;
 	uint32_t width=drawable->getWidth();
 	uint32_t height=drawable->getHeight();
+	RenderThread* rt=getSys()->getRenderThread();
+	//The first drawable with these pixels gives its texture to the cache
+	if(cacheable && cachedTexture.isNull())
+		cachedTexture=rt->rasterCache.insert(cacheKey, rt->allocateTexture(width, height,false));
+	if(!surface.shared.isNull())
+	{
+		//The texture belongs to the cache, forget it without releasing it
+		surface.tex.makeEmpty();
+		surface.shared.reset();
+	}
+	if(!cachedTexture.isNull())
+	{
+		surface.tex=cachedTexture->tex;
+		surface.shared=cachedTexture;
+	}
 	//Verify that the texture is large enough
-	if(!surface.tex.resizeIfLargeEnough(width, height))
-		surface.tex=getSys()->getRenderThread()->allocateTexture(width, height,false);
+	else if(!surface.tex.resizeIfLargeEnough(width, height))
+		surface.tex=rt->allocateTexture(width, height,false);
 	surface.xOffset=drawable->getXOffset();
 	surface.yOffset=drawable->getYOffset();
 	surface.alpha=drawable->getAlpha();
+	//A retained surface may have been moved while it was being rasterized
+	owner->applyRetainedSurfacePosition(surface);
 	return surface.tex;
 }
 
@@ -933,6 +978,28 @@ void AsyncDrawJob::uploadFence()
 	delete this;
 }
 
+RetainedSurfaceMoveJob::RetainedSurfaceMoveJob(_R<DisplayObject> o):owner(o)
+{
+}
+
+RetainedSurfaceMoveJob::~RetainedSurfaceMoveJob()
+{
+}
+
+const TextureChunk& RetainedSurfaceMoveJob::getTexture()
+{
+	/* This is called in the render thread,
+	 * so we need no locking for surface */
+	CachedSurface& surface=owner->cachedSurface;
+	owner->applyRetainedSurfacePosition(surface);
+	return surface.tex;
+}
+
+void RetainedSurfaceMoveJob::uploadFence()
+{
+	delete this;
+}
+
 void SoftwareInvalidateQueue::addToInvalidateQueue(_R<DisplayObject> d)
 {
 	queue.emplace_back(d);
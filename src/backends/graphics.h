@@ -65,16 +65,57 @@ public:
 	uint32_t height;
 };
 
+/*
+ * A texture used by the CachedSurfaces of several objects drawn with the
+ * same pixels, see RasterCache. It is released when the last user goes away.
+ */
+class SharedTexture: public RefCountable
+{
+public:
+	TextureChunk tex;
+	SharedTexture(const TextureChunk& t):tex(t){}
+	~SharedTexture();
+};
+
 class CachedSurface
 {
 public:
 	CachedSurface():xOffset(0),yOffset(0),alpha(1.0){}
 	TextureChunk tex;
+	/* When set, tex is a copy of shared->tex and must not be resized nor released */
+	_NR<SharedTexture> shared;
 	int32_t xOffset;
 	int32_t yOffset;
 	float alpha;
 };
 
+/* Subtrees cached as bitmap larger than this are only retained for the visible area */
+#define RETAINED_SURFACE_MAX_SIZE 2048
+
+/*
+ * Bookkeeping for the retained surface of a subtree cached as bitmap.
+ * The pixels live in the CachedSurface of the root of the subtree, this
+ * records how they were produced and where they must be shown
+ */
+class RetainedSurface
+{
+public:
+	RetainedSurface():rasterX(0),rasterY(0),xOffset(0),yOffset(0),alpha(1.0),active(false),valid(false){}
+	/* The concatenated matrix used to rasterize the subtree */
+	MATRIX matrix;
+	/* The position of the surface when it was rasterized */
+	int32_t rasterX;
+	int32_t rasterY;
+	/* The current position of the surface, it changes when the subtree is only translated */
+	int32_t xOffset;
+	int32_t yOffset;
+	float alpha;
+	/* Set while the subtree is drawn from the retained surface */
+	bool active;
+	/* Cleared when the contents of the subtree change and it must be rasterized again */
+	bool valid;
+};
+
 class ITextureUploadable
 {
 protected:
@@ -86,6 +127,11 @@ public:
 	*/
 	virtual void upload(uint8_t* data, uint32_t w, uint32_t h) const=0;
 	virtual const TextureChunk& getTexture()=0;
+	/*
+		False if the texture returned by getTexture already holds the right pixels,
+		in that case upload is not called
+	*/
+	virtual bool needsUpload() const { return true; }
 	/*
 		Signal the completion of the upload to the texture
 		NOTE: fence may be called on shutdown even if the upload has not happen, so be ready for this event
@@ -93,6 +139,47 @@ public:
 	virtual void uploadFence()=0;
 };
 
+/* The linear part of the matrix is quantized to 1/RASTER_CACHE_MATRIX_STEPS */
+#define RASTER_CACHE_MATRIX_STEPS 1024
+/* The position of the origin is quantized to 1/RASTER_CACHE_SUBPIXEL_STEPS pixels */
+#define RASTER_CACHE_SUBPIXEL_STEPS 8
+
+/*
+ * Identifies the pixels produced by a drawable: the tokens being drawn plus the
+ * quantized transformation. Instances of a shape placed at different positions
+ * but with the same scale and rotation have the same key.
+ */
+class RasterCacheKey
+{
+public:
+	/* Keeps the tokens alive, so their address can't be reused while the key exists */
+	_NR<tokensVector> tokens;
+	float scaling;
+	int32_t width;
+	int32_t height;
+	int32_t xx;
+	int32_t yx;
+	int32_t xy;
+	int32_t yy;
+	/* The position of the origin relative to the top left corner of the drawable */
+	int32_t x0;
+	int32_t y0;
+	RasterCacheKey():scaling(0),width(0),height(0),xx(0),yx(0),xy(0),yy(0),x0(0),y0(0){}
+	bool operator==(const RasterCacheKey& r) const
+	{
+		return tokens.getPtr()==r.tokens.getPtr() && scaling==r.scaling && width==r.width && height==r.height &&
+			xx==r.xx && yx==r.yx && xy==r.xy && yy==r.yy && x0==r.x0 && y0==r.y0;
+	}
+	size_t hash() const
+	{
+		size_t h=(size_t)tokens.getPtr();
+		const int32_t fields[]={width,height,xx,yx,xy,yy,x0,y0};
+		for(uint32_t i=0;i<sizeof(fields)/sizeof(int32_t);i++)
+			h=h*31+fields[i];
+		return h;
+	}
+};
+
 class IDrawable
 {
 public:
@@ -105,7 +192,8 @@ public:
 	};
 protected:
 	/*
-	 * The masks to be applied
+	 * The masks to be applied. The mask drawables are owned by this instance,
+	 * so that no state is shared between concurrently executing render jobs
 	 */
 	std::vector<MaskData> masks;
 	int32_t width;
@@ -122,11 +210,12 @@ protected:
 public:
 	IDrawable(int32_t w, int32_t h, int32_t x, int32_t y, float a, const std::vector<MaskData>& m):
 		masks(m),width(w),height(h),xOffset(x),yOffset(y),alpha(a){}
-	virtual ~IDrawable(){}
+	virtual ~IDrawable();
 	/*
 	 * This method returns a raster buffer of the image
 	 * The various implementation are responsible for applying the
-	 * masks
+	 * masks. It is called from the thread pool and may run concurrently
+	 * with other drawables, so it must only touch per-instance state
 	 */
 	virtual uint8_t* getPixelBuffer()=0;
 	/*
@@ -134,6 +223,12 @@ public:
 	 * another object
 	 */
 	virtual void applyCairoMask(cairo_t* cr, int32_t offsetX, int32_t offsetY) const = 0;
+	/*
+	 * Fills the key identifying the pixels of this drawable, so that they can be
+	 * shared with other drawables through the RasterCache. Returns false if the
+	 * pixels can't be shared. Must be called before getPixelBuffer.
+	 */
+	virtual bool getCacheKey(RasterCacheKey& key) const { return false; }
 	int32_t getWidth() const { return width; }
 	int32_t getHeight() const { return height; }
 	int32_t getXOffset() const { return xOffset; }
@@ -152,6 +247,11 @@ private:
 	_R<DisplayObject> owner;
 	uint8_t* surfaceBytes;
 	bool uploadNeeded;
+	/* Set if the pixels may be shared through the RasterCache */
+	bool cacheable;
+	RasterCacheKey cacheKey;
+	/* The shared texture holding the pixels, if any */
+	_NR<SharedTexture> cachedTexture;
 public:
 	/*
 	 * @param o The DisplayObject that is being rendered. It is a reference to
@@ -165,16 +265,40 @@ public:
 	void execute();
 	void threadAbort();
 	void jobFence();
+	THREAD_JOB_PRIORITY getPriority() const { return JOB_PRIORITY_RENDER; }
 	//ITextureUploadable interface
 	void upload(uint8_t* data, uint32_t w, uint32_t h) const;
 	void sizeNeeded(uint32_t& w, uint32_t& h) const;
 	const TextureChunk& getTexture();
+	bool needsUpload() const { return surfaceBytes!=NULL; }
+	void uploadFence();
+};
+
+/*
+ * Moves the retained surface of a subtree cached as bitmap to its current
+ * position. The pixels are already in the texture, so nothing is rasterized
+ * nor uploaded
+ */
+class RetainedSurfaceMoveJob: public ITextureUploadable
+{
+private:
+	_R<DisplayObject> owner;
+public:
+	RetainedSurfaceMoveJob(_R<DisplayObject> o);
+	~RetainedSurfaceMoveJob();
+	//ITextureUploadable interface
+	void sizeNeeded(uint32_t& w, uint32_t& h) const { w=0; h=0; }
+	void upload(uint8_t* data, uint32_t w, uint32_t h) const {}
+	const TextureChunk& getTexture();
+	bool needsUpload() const { return false; }
 	void uploadFence();
 };
 
 /**
 	The base class for render jobs based on cairo
-	Stores an internal copy of the data to be rendered
+	Stores an internal copy of the data to be rendered.
+	Every job creates its own surface and cairo context, so several
+	CairoRenderers can be rasterized in parallel by the thread pool
 */
 class CairoRenderer: public IDrawable
 {
@@ -188,14 +312,6 @@ protected:
 	  The whole transformation matrix that is applied to the rendered object
 	*/
 	MATRIX matrix;
-	/*
-	 * There are reports (http://lists.freedesktop.org/archives/cairo/2011-September/022247.html)
-	 * that cairo is not threadsafe, and I have encountered some spurious crashes, too.
-	 * So we use a global lock for all cairo calls until this issue is sorted out.
-	 * TODO: CairoRenderes are enqueued as IThreadJobs, therefore this mutex
-	 *       will serialize the thread pool when all thread pool workers are executing CairoRenderers!
-	 */
-	static StaticRecMutex cairoMutex;
 	static void cairoClean(cairo_t* cr);
 	cairo_surface_t* allocateSurface(uint8_t*& buf);
 	virtual void executeDraw(cairo_t* cr)=0;
@@ -224,39 +340,31 @@ private:
 	static bool cairoPathFromTokens(cairo_t* cr, const tokensVector &tokens, double scaleCorrection, bool skipFill);
 	static void quadraticBezier(cairo_t* cr, double control_x, double control_y, double end_x, double end_y);
 	/*
-	   The tokens to be drawn
+	   The tokens to be drawn, shared with their owner
 	*/
-	const tokensVector tokens;
+	const _R<tokensVector> tokens;
 	/*
 	 * This is run by CairoRenderer::execute()
 	 */
 	void executeDraw(cairo_t* cr);
 	void applyCairoMask(cairo_t* cr, int32_t offsetX, int32_t offsetY) const;
+	bool getCacheKey(RasterCacheKey& key) const;
 public:
 	/*
 	   CairoTokenRenderer constructor
 
 	   @param _o Owner of the surface _t. See comments on 'owner' member.
 	   @param _t GL surface where the final drawing will be uploaded
-	   @param _g The tokens to be drawn. This is copied internally.
+	   @param _g The tokens to be drawn. They must not be modified while shared.
 	   @param _m The whole transformation matrix
 	   @param _s The scale factor to be applied in both the x and y axis
 	   @param _a The alpha factor to be applied
 	   @param _ms The masks that must be applied
 	*/
-	CairoTokenRenderer(const tokensVector& _g, const MATRIX& _m,
+	CairoTokenRenderer(_R<tokensVector> _g, const MATRIX& _m,
 			int32_t _x, int32_t _y, int32_t _w, int32_t _h,
 		    float _s, float _a, const std::vector<MaskData>& _ms)
 		: CairoRenderer(_m,_x,_y,_w,_h,_s,_a,_ms),tokens(_g){}
-	/*
-	   Hit testing helper. Uses cairo to find if a point in inside the shape
-
-	   @param tokens The tokens of the shape being tested
-	   @param scaleFactor The scale factor to be applied
-	   @param x The X in local coordinates
-	   @param y The Y in local coordinates
-	*/
-	static bool hitTest(const tokensVector& tokens, float scaleFactor, number_t x, number_t y);
 };
 
 class TextData
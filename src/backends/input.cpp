@@ -135,6 +135,14 @@ bool InputThread::worker(SDL_Event *event)
 
 _NR<InteractiveObject> InputThread::getMouseTarget(uint32_t x, uint32_t y, DisplayObject::HIT_TYPE type)
 {
+	//Read the generation before testing, so that changes happening meanwhile are not missed
+	int32_t generation=m_sys->getHitTestGeneration();
+	{
+		SpinlockLocker l(hitCacheSpinlock);
+		const HitCacheEntry& e=hitCache[type];
+		if(e.valid && e.x==x && e.y==y && e.generation==generation)
+			return e.target;
+	}
 	_NR<InteractiveObject> selected = NullRef;
 	try
 	{
@@ -153,6 +161,15 @@ _NR<InteractiveObject> InputThread::getMouseTarget(uint32_t x, uint32_t y, Displ
 	}
 	assert(selected); /* atleast we hit the stage */
 	assert_and_throw(selected->getClass()->isSubClass(Class<InteractiveObject>::getClass(m_sys)));
+	{
+		SpinlockLocker l(hitCacheSpinlock);
+		HitCacheEntry& e=hitCache[type];
+		e.target=selected;
+		e.x=x;
+		e.y=y;
+		e.generation=generation;
+		e.valid=true;
+	}
 	return selected;
 }
 
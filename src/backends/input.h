@@ -64,6 +64,22 @@ private:
 		MATRIX m;
 		MaskData(DisplayObject* _d, const MATRIX& _m):d(_d),m(_m){}
 	};
+	/*
+	 * The last mouse target found for each hit type. It is valid as long as the
+	 * hit test generation of the SystemState does not change
+	 */
+	class HitCacheEntry
+	{
+	public:
+		_NR<InteractiveObject> target;
+		uint32_t x;
+		uint32_t y;
+		int32_t generation;
+		bool valid;
+		HitCacheEntry():x(0),y(0),generation(0),valid(false){}
+	};
+	HitCacheEntry hitCache[DisplayObject::DOUBLE_CLICK+1];
+	Spinlock hitCacheSpinlock;
 	_NR<InteractiveObject> getMouseTarget(uint32_t x, uint32_t y, DisplayObject::HIT_TYPE type);
 	void handleMouseDown(uint32_t x, uint32_t y, SDL_Keymod buttonState,bool pressed);
 	void handleMouseDoubleClick(uint32_t x, uint32_t y, SDL_Keymod buttonState,bool pressed);
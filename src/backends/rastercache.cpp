@@ -0,0 +1,84 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "backends/rastercache.h"
+
+using namespace lightspark;
+using namespace std;
+
+uint32_t RasterCache::textureBytes(uint32_t w, uint32_t h)
+{
+	//Textures are allocated in blocks of CHUNKSIZExCHUNKSIZE pixels
+	const uint32_t blocksW=(w+CHUNKSIZE-1)/CHUNKSIZE;
+	const uint32_t blocksH=(h+CHUNKSIZE-1)/CHUNKSIZE;
+	return blocksW*blocksH*CHUNKSIZE*CHUNKSIZE*4;
+}
+
+void RasterCache::evict(unordered_map<RasterCacheKey, Entry, KeyHash>::iterator it)
+{
+	usedBytes-=it->second.bytes;
+	lru.erase(it->second.lruPos);
+	//The texture is released when the last object using it is drawn again
+	entries.erase(it);
+}
+
+_NR<SharedTexture> RasterCache::lookup(const RasterCacheKey& key)
+{
+	Locker l(mutex);
+	auto it=entries.find(key);
+	if(it==entries.end())
+	{
+		misses++;
+		return NullRef;
+	}
+	hits++;
+	lru.splice(lru.begin(), lru, it->second.lruPos);
+	return it->second.texture;
+}
+
+_NR<SharedTexture> RasterCache::insert(const RasterCacheKey& key, const TextureChunk& tex)
+{
+	if(!tex.isValid())
+		return NullRef;
+	_R<SharedTexture> ret=_MR(new SharedTexture(tex));
+	uint32_t bytes=textureBytes(tex.width, tex.height);
+
+	Locker l(mutex);
+	//Several drawables with the same pixels may have missed at the same time
+	auto it=entries.find(key);
+	if(it!=entries.end())
+		evict(it);
+	while(!lru.empty() && usedBytes+bytes>maxBytes)
+	{
+		evict(entries.find(lru.back()));
+		evictions++;
+	}
+	lru.push_front(key);
+	entries.insert(make_pair(key, Entry(ret, lru.begin(), bytes)));
+	usedBytes+=bytes;
+	return ret;
+}
+
+void RasterCache::clear()
+{
+	Locker l(mutex);
+	entries.clear();
+	lru.clear();
+	usedBytes=0;
+}
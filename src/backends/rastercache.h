@@ -0,0 +1,91 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef BACKENDS_RASTERCACHE_H
+#define BACKENDS_RASTERCACHE_H 1
+
+#include "compat.h"
+#include <list>
+#include <unordered_map>
+#include "threading.h"
+#include "backends/graphics.h"
+
+namespace lightspark
+{
+
+//Texture memory held by the cache, evicted textures live on until no object shows them
+#define RASTER_CACHE_MAX_BYTES (32*1024*1024)
+//Drawables larger than 1/RASTER_CACHE_MAX_ENTRY_FRACTION of the cache are not cached
+#define RASTER_CACHE_MAX_ENTRY_FRACTION 8
+
+/*
+ * Textures holding the rasterized pixels of drawables, shared by all the
+ * objects drawn with the same RasterCacheKey. Particles, tiles and bullets
+ * placed from the same DefineShape with the same scale and rotation are only
+ * rasterized and uploaded once. The least recently used textures are evicted
+ * when the memory budget is exceeded.
+ * lookup may be called from any thread, insert only from the render thread.
+ */
+class RasterCache
+{
+private:
+	class Entry
+	{
+	public:
+		_R<SharedTexture> texture;
+		std::list<RasterCacheKey>::iterator lruPos;
+		uint32_t bytes;
+		Entry(_R<SharedTexture> t, std::list<RasterCacheKey>::iterator p, uint32_t b):texture(t),lruPos(p),bytes(b){}
+	};
+	struct KeyHash
+	{
+		size_t operator()(const RasterCacheKey& k) const { return k.hash(); }
+	};
+	Mutex mutex;
+	std::unordered_map<RasterCacheKey, Entry, KeyHash> entries;
+	//Most recently used first
+	std::list<RasterCacheKey> lru;
+	uint64_t usedBytes;
+	uint64_t maxBytes;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	static uint32_t textureBytes(uint32_t w, uint32_t h);
+	void evict(std::unordered_map<RasterCacheKey, Entry, KeyHash>::iterator it);
+public:
+	RasterCache(uint64_t m=RASTER_CACHE_MAX_BYTES):usedBytes(0),maxBytes(m),hits(0),misses(0),evictions(0){}
+	/* Whether a drawable of the given size may be cached at all */
+	bool fits(uint32_t w, uint32_t h) const { return textureBytes(w,h)<=maxBytes/RASTER_CACHE_MAX_ENTRY_FRACTION; }
+	/* Returns the texture holding the pixels for key, or NullRef */
+	_NR<SharedTexture> lookup(const RasterCacheKey& key);
+	/*
+	 * Adds a texture for key, evicting old entries as needed.
+	 * Returns NullRef if tex is not valid.
+	 */
+	_NR<SharedTexture> insert(const RasterCacheKey& key, const TextureChunk& tex);
+	void clear();
+	//Counters for tuning
+	uint64_t getHits() const { return hits; }
+	uint64_t getMisses() const { return misses; }
+	uint64_t getEvictions() const { return evictions; }
+	uint64_t getUsedBytes() const { return usedBytes; }
+};
+
+};
+#endif /* BACKENDS_RASTERCACHE_H */
@@ -22,6 +22,8 @@
 #include "backends/rendering.h"
 #include "compat.h"
 #include <sstream>
+#include <fstream>
+#include <iomanip>
 
 #ifdef _WIN32
 #   define WIN32_LEAN_AND_MEAN
@@ -65,6 +67,8 @@ RenderThread::RenderThread(SystemState* s):GLRenderContext(),
 	prevUploadJob(NULL),
 	renderNeeded(false),uploadNeeded(false),resizeNeeded(false),newTextureNeeded(false),event(0),newWidth(0),newHeight(0),scaleX(1),scaleY(1),
 	offsetX(0),offsetY(0),tempBufferAcquired(false),frameCount(0),secsCount(0),initialized(0),
+	headless(false),headlessFrame(NULL),headlessContext(NULL),frameOutput(false),frameOutputWidth(0),
+	frameOutputZeroPad(false),frameOutputCount(0),frameRequested(false),frameRendered(0),pendingDrawJobs(0),
 	cairoTextureContext(NULL)
 {
 	LOG(LOG_INFO,_("RenderThread this=") << this);
@@ -80,6 +84,7 @@ void RenderThread::start(EngineData* data)
 {
 	status=STARTED;
 	engineData=data;
+	headless=data->headless;
 #ifdef HAVE_NEW_GLIBMM_THREAD_API
 	t = Thread::create(sigc::mem_fun(this,&RenderThread::worker));
 #else
@@ -104,7 +109,15 @@ void RenderThread::handleNewTexture()
 	Locker l(mutexLargeTexture);
 	for(uint32_t i=0;i<largeTextures.size();i++)
 	{
-		if(largeTextures[i].id==(uint32_t)-1)
+		if(largeTextures[i].id!=(uint32_t)-1)
+			continue;
+		if(headless)
+		{
+			largeTextures[i].id=i;
+			headlessTextures.resize(largeTextures.size(),NULL);
+			headlessTextures[i]=cairo_image_surface_create(CAIRO_FORMAT_ARGB32, largeTextureSize, largeTextureSize);
+		}
+		else
 			largeTextures[i].id=allocateNewGLTexture();
 	}
 	newTextureNeeded=false;
@@ -127,6 +140,13 @@ void RenderThread::handleUpload()
 {
 	ITextureUploadable* u=getUploadJob();
 	assert(u);
+	if(!u->needsUpload())
+	{
+		//The pixels are already in the texture
+		u->getTexture();
+		u->uploadFence();
+		return;
+	}
 	uint32_t w,h;
 	u->sizeNeeded(w,h);
 	engineData->resizePixelBuffers(w,h);
@@ -159,6 +179,11 @@ void RenderThread::init()
 	windowWidth=engineData->width;
 	windowHeight=engineData->height;
 
+	if(headless)
+	{
+		headlessInit();
+		return;
+	}
 	engineData->InitOpenGL();
 	commonGLInit(windowWidth, windowHeight);
 	commonGLResize();
@@ -180,7 +205,8 @@ void RenderThread::worker()
 		ThreadProfile* profile=m_sys->allocateProfiler(RGB(200,0,0));
 		profile->setTag("Render");
 
-		engineData->exec_glEnable_GL_TEXTURE_2D();
+		if(!headless)
+			engineData->exec_glEnable_GL_TEXTURE_2D();
 
 		Chronometer chronometer;
 		while(1)
@@ -202,6 +228,8 @@ void RenderThread::worker()
 	/* cleanup */
 	//Keep addUploadJob from enqueueing
 	status=TERMINATED;
+	//Nothing will be rendered anymore, release a renderFrame that may be waiting
+	frameRendered.signal();
 	//Fence existing jobs
 	Locker l(mutexUploadJobs);
 	if(prevUploadJob)
@@ -227,8 +255,14 @@ bool RenderThread::doRender(ThreadProfile* profile,Chronometer* chronometer)
 		newHeight=0;
 		//End of order critical part
 		LOG(LOG_INFO,_("Window resized to ") << windowWidth << 'x' << windowHeight);
-		commonGLResize();
+		if(headless)
+			headlessResize();
+		else
+			commonGLResize();
 		m_sys->resizeCompleted();
+		//A frame requested by renderFrame must still be rendered
+		if(ACQUIRE_READ(frameRequested))
+			event.signal();
 		if (profile && chronometer)
 			profile->accountTime(chronometer->checkpoint());
 		return true;
@@ -241,12 +275,34 @@ bool RenderThread::doRender(ThreadProfile* profile,Chronometer* chronometer)
 
 	if(uploadNeeded)
 	{
-		handleUpload();
+		if(headless)
+			headlessUpload();
+		else
+			handleUpload();
+		//A frame requested by renderFrame must still be rendered
+		if(ACQUIRE_READ(frameRequested))
+			event.signal();
 		if (profile && chronometer)
 			profile->accountTime(chronometer->checkpoint());
 		return true;
 	}
 
+	if(headless)
+	{
+		//The error is already logged, there is no window to show it in
+		if(!m_sys->isOnError())
+			headlessRendering();
+		if (profile && chronometer)
+			profile->accountTime(chronometer->checkpoint());
+		renderNeeded=false;
+		if(ACQUIRE_READ(frameRequested))
+		{
+			RELEASE_WRITE(frameRequested,false);
+			frameRendered.signal();
+		}
+		return true;
+	}
+
 	if(m_sys->isOnError())
 	{
 		renderErrorPage(this, m_sys->standalone);
@@ -266,9 +322,18 @@ bool RenderThread::doRender(ThreadProfile* profile,Chronometer* chronometer)
 }
 void RenderThread::deinit()
 {
-	engineData->exec_glDisable_GL_TEXTURE_2D();
-	commonGLDeinit();
-	engineData->DeinitOpenGL();
+	rasterCache.clear();
+	if(headless)
+		headlessDeinit();
+	else
+	{
+		engineData->exec_glDisable_GL_TEXTURE_2D();
+		commonGLDeinit();
+		engineData->DeinitOpenGL();
+	}
+	//Textures still used by objects are released after this point
+	Locker l(mutexLargeTexture);
+	largeTextures.clear();
 }
 
 bool RenderThread::loadShaderPrograms()
@@ -639,6 +704,8 @@ void RenderThread::draw(bool force)
 	{
 		time_s=time_d;
 		LOG(LOG_INFO,_("FPS: ") << dec << frameCount<<" "<<getVm(m_sys)->getEventQueueSize());
+		LOG(LOG_INFO,"Raster cache: " << rasterCache.getHits() << " hits " << rasterCache.getMisses() << " misses "
+			<< rasterCache.getEvictions() << " evictions " << rasterCache.getUsedBytes()/1024 << " KB");
 		frameCount=0;
 		secsCount++;
 	}
@@ -661,6 +728,9 @@ void RenderThread::releaseTexture(const TextureChunk& chunk)
 	uint32_t blocksH=(chunk.height+CHUNKSIZE-1)/CHUNKSIZE;
 	uint32_t numberOfBlocks=blocksW*blocksH;
 	Locker l(mutexLargeTexture);
+	//The textures are already gone after deinit
+	if(chunk.texId>=largeTextures.size())
+		return;
 	LargeTexture& tex=largeTextures[chunk.texId];
 	for(uint32_t i=0;i<numberOfBlocks;i++)
 	{
@@ -840,6 +910,11 @@ void RenderThread::loadChunkBGRA(const TextureChunk& chunk, uint32_t w, uint32_t
 	//Fast bailout if the TextureChunk is not valid
 	if(chunk.chunks==NULL)
 		return;
+	if(headless)
+	{
+		headlessLoadChunkBGRA(chunk, w, h, data);
+		return;
+	}
 	engineData->exec_glBindTexture_GL_TEXTURE_2D(largeTextures[chunk.texId].id);
 	//TODO: Detect continuos
 	//The size is ok if doesn't grow over the allocated size
@@ -866,3 +941,254 @@ void RenderThread::loadChunkBGRA(const TextureChunk& chunk, uint32_t w, uint32_t
 	engineData->exec_glPixelStorei_GL_UNPACK_SKIP_ROWS(0);
 	engineData->exec_glPixelStorei_GL_UNPACK_ROW_LENGTH(0);
 }
+
+void RenderThread::renderTextured(const TextureChunk& chunk, int32_t x, int32_t y, uint32_t w, uint32_t h,
+			float alpha, COLOR_MODE colorMode)
+{
+	if(!headless)
+	{
+		GLRenderContext::renderTextured(chunk, x, y, w, h, alpha, colorMode);
+		return;
+	}
+	if(colorMode==YUV_MODE)
+	{
+		LOG(LOG_NOT_IMPLEMENTED,"YUV textures are not supported in headless mode");
+		return;
+	}
+	headlessRenderTextured(chunk, x, y, w, h, alpha);
+}
+
+void RenderThread::headlessInit()
+{
+	//Same size as the largest texture used by the OpenGL backend
+	largeTextureSize=1024;
+	headlessResize();
+}
+
+void RenderThread::headlessDeinit()
+{
+	for(uint32_t i=0;i<headlessTextures.size();i++)
+	{
+		if(headlessTextures[i])
+			cairo_surface_destroy(headlessTextures[i]);
+	}
+	headlessTextures.clear();
+	for(uint32_t i=0;i<largeTextures.size();i++)
+		delete[] largeTextures[i].bitmap;
+	if(headlessFrame)
+		cairo_surface_destroy(headlessFrame);
+	headlessFrame=NULL;
+}
+
+void RenderThread::headlessResize()
+{
+	m_sys->stageCoordinateMapping(windowWidth, windowHeight, offsetX, offsetY, scaleX, scaleY);
+	if(headlessFrame)
+		cairo_surface_destroy(headlessFrame);
+	headlessFrame=cairo_image_surface_create(CAIRO_FORMAT_ARGB32, windowWidth, windowHeight);
+}
+
+void RenderThread::headlessUpload()
+{
+	ITextureUploadable* u=getUploadJob();
+	assert(u);
+	if(!u->needsUpload())
+	{
+		//The pixels are already in the texture
+		u->getTexture();
+		u->uploadFence();
+		return;
+	}
+	uint32_t w,h;
+	u->sizeNeeded(w,h);
+	//There is no need to pipeline the uploads, the data is copied synchronously
+	headlessUploadBuffer.resize(w*h*4);
+	u->upload(&headlessUploadBuffer[0], w, h);
+	const TextureChunk& tex=u->getTexture();
+	//Getting the texture may have added a new large texture
+	if(newTextureNeeded)
+		handleNewTexture();
+	loadChunkBGRA(tex, w, h, &headlessUploadBuffer[0]);
+	u->uploadFence();
+}
+
+void RenderThread::headlessLoadChunkBGRA(const TextureChunk& chunk, uint32_t w, uint32_t h, uint8_t* data)
+{
+	cairo_surface_t* page=headlessTextures[chunk.texId];
+	cairo_surface_flush(page);
+	uint8_t* pageData=cairo_image_surface_get_data(page);
+	const int pageStride=cairo_image_surface_get_stride(page);
+	const uint32_t numberOfChunks=chunk.getNumberOfChunks();
+	const uint32_t blocksPerSide=largeTextureSize/CHUNKSIZE;
+	const uint32_t blocksW=(w+CHUNKSIZE-1)/CHUNKSIZE;
+	for(uint32_t i=0;i<numberOfChunks;i++)
+	{
+		uint32_t curX=(i%blocksW)*CHUNKSIZE;
+		uint32_t curY=(i/blocksW)*CHUNKSIZE;
+		uint32_t sizeX=min(int(w-curX),CHUNKSIZE);
+		uint32_t sizeY=min(int(h-curY),CHUNKSIZE);
+		const uint32_t blockX=((chunk.chunks[i]%blocksPerSide)*CHUNKSIZE);
+		const uint32_t blockY=((chunk.chunks[i]/blocksPerSide)*CHUNKSIZE);
+		for(uint32_t j=0;j<sizeY;j++)
+			memcpy(pageData+(blockY+j)*pageStride+blockX*4, data+((curY+j)*w+curX)*4, sizeX*4);
+	}
+	cairo_surface_mark_dirty(page);
+}
+
+void RenderThread::headlessRenderTextured(const TextureChunk& chunk, int32_t x, int32_t y, uint32_t w, uint32_t h, float alpha)
+{
+	if(chunk.chunks==NULL || headlessContext==NULL)
+		return;
+	cairo_t* cr=headlessContext;
+	cairo_surface_t* page=headlessTextures[chunk.texId];
+	cairo_save(cr);
+	//Same transformation as the projection set up in commonGLResize,
+	//followed by the current modelview matrix
+	cairo_identity_matrix(cr);
+	cairo_translate(cr, offsetX, offsetY);
+	cairo_scale(cr, scaleX, scaleY);
+	cairo_matrix_t modelview;
+	cairo_matrix_init(&modelview, lsMVPMatrix[0], lsMVPMatrix[1], lsMVPMatrix[4], lsMVPMatrix[5],
+			lsMVPMatrix[12], lsMVPMatrix[13]);
+	cairo_transform(cr, &modelview);
+
+	const uint32_t blocksPerSide=largeTextureSize/CHUNKSIZE;
+	uint32_t startX, startY, endX, endY;
+	uint32_t curChunk=0;
+	//Chunks are mapped on the destination exactly like GLRenderContext::renderTextured does
+	for(uint32_t i=0;i<chunk.height;i+=CHUNKSIZE)
+	{
+		startY=h*i/chunk.height;
+		endY=min(h*(i+CHUNKSIZE)/chunk.height,h);
+		startY = (y<0)?startY:y+startY;
+		endY = (y<0)?endY:y+endY;
+		for(uint32_t j=0;j<chunk.width;j+=CHUNKSIZE)
+		{
+			startX=w*j/chunk.width;
+			endX=min(w*(j+CHUNKSIZE)/chunk.width,w);
+			startX = (x<0)?startX:x+startX;
+			endX = (x<0)?endX:x+endX;
+			const uint32_t curChunkId=chunk.chunks[curChunk];
+			const uint32_t blockX=((curChunkId%blocksPerSide)*CHUNKSIZE);
+			const uint32_t blockY=((curChunkId/blocksPerSide)*CHUNKSIZE);
+			const uint32_t availX=min(int(chunk.width-j),CHUNKSIZE);
+			const uint32_t availY=min(int(chunk.height-i),CHUNKSIZE);
+			curChunk++;
+			if(endX==startX || endY==startY)
+				continue;
+
+			cairo_save(cr);
+			cairo_rectangle(cr, startX, startY, endX-startX, endY-startY);
+			cairo_clip(cr);
+			cairo_translate(cr, startX, startY);
+			cairo_scale(cr, double(endX-startX)/availX, double(endY-startY)/availY);
+			cairo_set_source_surface(cr, page, -double(blockX), -double(blockY));
+			cairo_paint_with_alpha(cr, alpha);
+			cairo_restore(cr);
+		}
+	}
+	cairo_restore(cr);
+}
+
+void RenderThread::headlessRendering()
+{
+	Locker l(mutexRendering);
+	headlessContext=cairo_create(headlessFrame);
+	RGB bg=m_sys->mainClip->getBackground();
+	cairo_set_source_rgb(headlessContext, bg.Red/255.0, bg.Green/255.0, bg.Blue/255.0);
+	cairo_paint(headlessContext);
+	lsglLoadIdentity();
+
+	m_sys->mainClip->getStage()->Render(*this);
+
+	cairo_destroy(headlessContext);
+	headlessContext=NULL;
+	cairo_surface_flush(headlessFrame);
+	//Unthrottled movies are only dumped by renderFrame, once per frame
+	if(frameOutput && (!m_sys->unthrottled || ACQUIRE_READ(frameRequested)))
+		writeFrame();
+}
+
+void RenderThread::renderFrame()
+{
+	if(status!=STARTED)
+		return;
+	RELEASE_WRITE(frameRequested,true);
+	event.signal();
+	frameRendered.wait();
+}
+
+bool RenderThread::setFrameOutput(const std::string& pattern)
+{
+	//The pattern comes from the user, so it is never used as a printf format
+	std::string prefix;
+	std::string suffix;
+	std::string* cur=&prefix;
+	uint32_t width=0;
+	bool zeroPad=false;
+	bool found=false;
+	for(size_t i=0;i<pattern.size();i++)
+	{
+		if(pattern[i]!='%')
+		{
+			cur->push_back(pattern[i]);
+			continue;
+		}
+		i++;
+		if(i<pattern.size() && pattern[i]=='%')
+		{
+			cur->push_back('%');
+			continue;
+		}
+		if(found)
+			return false;
+		if(i<pattern.size() && pattern[i]=='0')
+		{
+			zeroPad=true;
+			i++;
+		}
+		for(;i<pattern.size() && pattern[i]>='0' && pattern[i]<='9';i++)
+		{
+			width=width*10+(pattern[i]-'0');
+			if(width>32)
+				return false;
+		}
+		if(i==pattern.size() || (pattern[i]!='u' && pattern[i]!='d'))
+			return false;
+		found=true;
+		cur=&suffix;
+	}
+	if(!found)
+		return false;
+	frameOutputPrefix=prefix;
+	frameOutputSuffix=suffix;
+	frameOutputWidth=width;
+	frameOutputZeroPad=zeroPad;
+	frameOutput=true;
+	return true;
+}
+
+void RenderThread::writeFrame()
+{
+	ostringstream name;
+	name << frameOutputPrefix << setw(frameOutputWidth) << setfill(frameOutputZeroPad?'0':' ')
+		<< frameOutputCount++ << frameOutputSuffix;
+	const string fileName=name.str();
+	if(fileName.size()>4 && fileName.compare(fileName.size()-4, 4, ".png")==0)
+	{
+		cairo_status_t st=cairo_surface_write_to_png(headlessFrame, fileName.c_str());
+		if(st!=CAIRO_STATUS_SUCCESS)
+			LOG(LOG_ERROR,_("Could not write frame to ") << fileName << ": " << cairo_status_to_string(st));
+		return;
+	}
+	ofstream f(fileName, ios::out|ios::binary|ios::trunc);
+	if(!f)
+	{
+		LOG(LOG_ERROR,_("Could not write frame to ") << fileName);
+		return;
+	}
+	const int stride=cairo_image_surface_get_stride(headlessFrame);
+	const uint8_t* data=cairo_image_surface_get_data(headlessFrame);
+	for(uint32_t i=0;i<windowHeight;i++)
+		f.write((const char*)data+i*stride, windowWidth*4);
+}
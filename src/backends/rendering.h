@@ -21,6 +21,7 @@
 #define BACKENDS_RENDERING_H 1
 
 #include "backends/rendering_context.h"
+#include "backends/rastercache.h"
 #include "timer.h"
 #include <glibmm/timeval.h>
 #include <SDL2/SDL.h>
@@ -92,6 +93,36 @@ private:
 	Semaphore initialized;
 	Mutex mutexRendering;
 
+	/*
+		Headless mode: the large textures are kept in memory and the
+		display list is composited with cairo into headlessFrame
+	*/
+	bool headless;
+	std::vector<cairo_surface_t*> headlessTextures;
+	cairo_surface_t* headlessFrame;
+	cairo_t* headlessContext;
+	std::vector<uint8_t> headlessUploadBuffer;
+	//The frame output pattern split around its only conversion
+	bool frameOutput;
+	std::string frameOutputPrefix;
+	std::string frameOutputSuffix;
+	uint32_t frameOutputWidth;
+	bool frameOutputZeroPad;
+	uint32_t frameOutputCount;
+	void headlessInit();
+	void headlessDeinit();
+	void headlessResize();
+	void headlessUpload();
+	void headlessRendering();
+	void headlessLoadChunkBGRA(const TextureChunk& chunk, uint32_t w, uint32_t h, uint8_t* data);
+	void headlessRenderTextured(const TextureChunk& chunk, int32_t x, int32_t y, uint32_t w, uint32_t h, float alpha);
+	void writeFrame();
+	//Rendering requested by renderFrame, frameRendered is signaled once it is done
+	ACQUIRE_RELEASE_FLAG(frameRequested);
+	Semaphore frameRendered;
+	//AsyncDrawJobs that have not been uploaded yet
+	ATOMIC_INT32(pendingDrawJobs);
+
 public:
 	RenderThread(SystemState* s);
 	~RenderThread();
@@ -126,6 +157,39 @@ public:
 		Enqueue something to be uploaded to texture
 	*/
 	void addUploadJob(ITextureUploadable* u);
+	/**
+		Rasterized shapes shared between the objects drawing the same pixels
+	*/
+	RasterCache rasterCache;
+	/**
+		Headless mode only: save every rendered frame to the file obtained by replacing
+		the conversion in pattern with the frame number (i.e. "frame%05u.png"). Files
+		ending in .png are written as PNG, any other file gets the raw premultiplied
+		ARGB32 pixels. Returns false if pattern does not contain exactly one %u or %d
+		conversion, optionally with a width; %% stands for a literal %
+	*/
+	bool setFrameOutput(const std::string& pattern);
+	/**
+		Headless mode only: renders the stage, saves the frame if an output is set
+		and waits until that is done. When running unthrottled the frames are only
+		rendered this way, once per frame of the movie
+	*/
+	void renderFrame();
+	bool isHeadless() const { return headless; }
+	/**
+		Tracking of the AsyncDrawJobs, a frame is complete only when all its
+		drawings have been uploaded
+	*/
+	void drawJobQueued() { ATOMIC_INCREMENT(pendingDrawJobs); }
+	void drawJobDone() { ATOMIC_DECREMENT(pendingDrawJobs); }
+	bool hasPendingDrawJobs() const { return pendingDrawJobs!=0; }
+	/**
+		The current frame, only available in headless mode
+	*/
+	cairo_surface_t* getHeadlessFrame() const { return headlessFrame; }
+	//RenderContext interface
+	void renderTextured(const TextureChunk& chunk, int32_t x, int32_t y, uint32_t w, uint32_t h,
+			float alpha, COLOR_MODE colorMode);
 
 	void requestResize(uint32_t w, uint32_t h, bool force);
 	void waitForInitialization()
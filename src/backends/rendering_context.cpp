@@ -310,7 +310,7 @@ void CairoRenderContext::transformedBlit(const MATRIX& m, uint8_t* sourceBuf, ui
 void CairoRenderContext::renderTextured(const TextureChunk& chunk, int32_t x, int32_t y, uint32_t w, uint32_t h,
 			float alpha, COLOR_MODE colorMode)
 {
-	//TODO: support alpha, and colorMode
+	//TODO: support colorMode
 	uint8_t* buf=(uint8_t*)chunk.chunks;
 	cairo_surface_t* chunkSurface = getCairoSurfaceForData(buf, chunk.width, chunk.height);
 	cairo_pattern_t* chunkPattern = cairo_pattern_create_for_surface(chunkSurface);
@@ -324,7 +324,15 @@ void CairoRenderContext::renderTextured(const TextureChunk& chunk, int32_t x, in
 	cairo_set_source(cr, chunkPattern);
 	cairo_pattern_destroy(chunkPattern);
 	cairo_rectangle(cr, x, y, w, h);
-	cairo_fill(cr);
+	if(alpha<1.0)
+	{
+		cairo_save(cr);
+		cairo_clip(cr);
+		cairo_paint_with_alpha(cr, alpha);
+		cairo_restore(cr);
+	}
+	else
+		cairo_fill(cr);
 }
 
 const CachedSurface& CairoRenderContext::getCachedSurface(const DisplayObject* d) const
@@ -21,11 +21,26 @@
 #define BACKENDS_XML_SUPPORT_H 1
 
 #include "tiny_string.h"
+#include "smartrefs.h"
 #include <3rdparty/pugixml/src/pugixml.hpp>
 namespace lightspark
 {
 
 
+/*
+ * A parsed document. It is reference counted, so that it can outlive the
+ * object that parsed it while other objects still point into its tree.
+ */
+class XMLParsedDocument: public RefCountable
+{
+public:
+	pugi::xml_document doc;
+	// settings in effect when the document was parsed
+	bool ignoreWhitespace;
+	uint32_t defaultNamespace;
+	XMLParsedDocument():ignoreWhitespace(true),defaultNamespace(0) {}
+};
+
 /*
  * Base class for both XML and XMLNode
  */
@@ -33,7 +48,8 @@ class XMLBase
 {
 protected:
 	//The parser will destroy the document and all the childs on destruction
-	pugi::xml_document xmldoc;
+	//Every call to buildFromString creates a new document
+	_NR<XMLParsedDocument> xmldoc;
 	const pugi::xml_node buildFromString(const tiny_string& str,
 										unsigned int xmlparsemode,
 										const tiny_string& default_ns=tiny_string());
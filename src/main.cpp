@@ -19,8 +19,10 @@
 
 #include "version.h"
 #include "backends/security.h"
+#include "backends/rendering.h"
 #include "swf.h"
 #include "logger.h"
+#include "scripting/abc_codecache.h"
 #include "platforms/engineutils.h"
 #include "compat.h"
 #include <SDL2/SDL.h>
@@ -41,6 +43,14 @@ public:
 	}
 	SDL_Window* createWidget(uint32_t w, uint32_t h)
 	{
+		if(headless)
+		{
+			//The window is only used to receive events, nothing is drawn on it
+			SDL_Window* window = SDL_CreateWindow("Lightspark",SDL_WINDOWPOS_UNDEFINED,SDL_WINDOWPOS_UNDEFINED,w,h,SDL_WINDOW_HIDDEN);
+			if (window == 0)
+				LOG(LOG_ERROR,"createWidget failed:"<<SDL_GetError());
+			return window;
+		}
 		SDL_Window* window = SDL_CreateWindow("Lightspark",SDL_WINDOWPOS_UNDEFINED,SDL_WINDOWPOS_UNDEFINED,w,h,SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
 		if (window == 0)
 		{
@@ -126,6 +136,13 @@ int main(int argc, char* argv[])
 	bool useInterpreter=true;
 	bool useFastInterpreter=false;
 	bool useJit=false;
+	int32_t optHitThreshold=-1;
+	int32_t jitHitThreshold=-1;
+	bool useCodeCache=true;
+	bool printStartupTime=false;
+	bool headless=false;
+	bool unthrottled=false;
+	char* frameOutputPattern=NULL;
 	SystemState::ERROR_TYPE exitOnError=SystemState::ERROR_PARSING;
 	LOG_LEVEL log_level=LOG_INFO;
 	SystemState::FLASH_MODE flashMode=SystemState::FLASH;
@@ -165,6 +182,43 @@ int main(int argc, char* argv[])
 			useFastInterpreter=true;
 		else if(strcmp(argv[i],"-j")==0 || strcmp(argv[i],"--enable-jit")==0)
 			useJit=true;
+		else if(strcmp(argv[i],"-t")==0 || strcmp(argv[i],"--tiered")==0)
+		{
+			useFastInterpreter=true;
+			useJit=true;
+		}
+		else if(strcmp(argv[i],"--opt-threshold")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				fileName=NULL;
+				break;
+			}
+			optHitThreshold=max(0, atoi(argv[i]));
+		}
+		else if(strcmp(argv[i],"--jit-threshold")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				fileName=NULL;
+				break;
+			}
+			jitHitThreshold=max(0, atoi(argv[i]));
+		}
+		else if(strcmp(argv[i],"--disable-code-cache")==0)
+			useCodeCache=false;
+		else if(strcmp(argv[i],"--code-cache-info")==0)
+		{
+			CodeCache::printInfo(cout);
+			exit(0);
+		}
+		else if(strcmp(argv[i],"--purge-code-cache")==0)
+		{
+			CodeCache::purge();
+			exit(0);
+		}
 		else if(strcmp(argv[i],"-l")==0 || strcmp(argv[i],"--log-level")==0)
 		{
 			i++;
@@ -223,6 +277,23 @@ int main(int argc, char* argv[])
 		{
 			exit(0);
 		}
+		else if(strcmp(argv[i],"--print-startup-time")==0)
+			printStartupTime=true;
+		else if(strcmp(argv[i],"--headless")==0)
+			headless=true;
+		else if(strcmp(argv[i],"--unthrottled")==0)
+			unthrottled=true;
+		else if(strcmp(argv[i],"--dump-frames")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				fileName=NULL;
+				break;
+			}
+
+			frameOutputPattern=argv[i];
+		}
 		else if(strcmp(argv[i],"--exit-on-error")==0)
 		{
 			exitOnError = SystemState::ERROR_ANY;
@@ -253,8 +324,11 @@ int main(int argc, char* argv[])
 	{
 		LOG(LOG_ERROR, "Usage: " << argv[0] << " [--url|-u http://loader.url/file.swf]" <<
 			" [--disable-interpreter|-ni] [--enable-fast-interpreter|-fi] [--enable-jit|-j]" <<
+			" [--tiered|-t] [--opt-threshold calls] [--jit-threshold calls]" <<
+			" [--disable-code-cache] [--code-cache-info] [--purge-code-cache]" <<
 			" [--log-level|-l 0-4] [--parameters-file|-p params-file] [--security-sandbox|-s sandbox]" <<
-			" [--exit-on-error] [--HTTP-cookies cookie] [--air] [--avmplus]" <<
+			" [--exit-on-error] [--HTTP-cookies cookie] [--air] [--avmplus] [--print-startup-time]" <<
+			" [--headless] [--dump-frames frame-pattern] [--unthrottled]" <<
 #ifdef PROFILING_SUPPORT
 			" [--profiling-output|-o profiling-file]" <<
 #endif
@@ -276,6 +350,15 @@ int main(int argc, char* argv[])
 	f.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
 	cout.exceptions( ios::failbit | ios::badbit);
 	cerr.exceptions( ios::failbit | ios::badbit);
+	if(frameOutputPattern && !headless)
+	{
+		LOG(LOG_ERROR,_("Dumping frames is only supported in headless mode"));
+		exit(1);
+	}
+	//No display is needed when running headless
+	if(headless)
+		SDL_setenv("SDL_VIDEODRIVER","dummy",0);
+
 	SystemState::staticInit();
 	if (!EngineData::startSDLMain())
 	{
@@ -328,6 +411,12 @@ int main(int argc, char* argv[])
 	sys->useInterpreter=useInterpreter;
 	sys->useFastInterpreter=useFastInterpreter;
 	sys->useJit=useJit;
+	if(optHitThreshold>=0)
+		sys->optHitThreshold=optHitThreshold;
+	if(jitHitThreshold>=0)
+		sys->jitHitThreshold=jitHitThreshold;
+	sys->useCodeCache=useCodeCache;
+	sys->unthrottled=unthrottled;
 	sys->exitOnError=exitOnError;
 	if(paramsFileName)
 		sys->parseParametersFromFile(paramsFileName);
@@ -338,7 +427,14 @@ int main(int argc, char* argv[])
 	if(HTTPcookie)
 		sys->setCookies(HTTPcookie);
 
-	sys->setParamsAndEngine(new StandaloneEngineData(), true);
+	StandaloneEngineData* engineData=new StandaloneEngineData();
+	engineData->headless=headless;
+	if(frameOutputPattern && !sys->getRenderThread()->setFrameOutput(frameOutputPattern))
+	{
+		LOG(LOG_ERROR,_("The frame pattern must contain exactly one %u or %d conversion"));
+		exit(1);
+	}
+	sys->setParamsAndEngine(engineData, true);
 
 	sys->securityManager->setSandboxType(sandboxType);
 	if(sandboxType == SecurityManager::REMOTE)
@@ -359,6 +455,11 @@ int main(int argc, char* argv[])
 	 * SystemState::setShutdownFlag.
 	 */
 	sys->destroy();
+	if(printStartupTime)
+	{
+		cout << "Builtin classes registered in " << sys->builtinsInitTime << " us" << endl;
+		cout << "First ABC block executed after " << sys->firstScriptTime << " ms" << endl;
+	}
 	bool isonerror = sys->exitOnError==SystemState::ERROR_ANY && sys->isOnError();
 	SDL_Event event;
 	SDL_zero(event);
@@ -60,11 +60,8 @@ asAtom Amf3Deserializer::parseDouble() const
 	} tmp;
 	uint8_t* tmpPtr=reinterpret_cast<uint8_t*>(&tmp.dummy);
 
-	for(uint32_t i=0;i<8;i++)
-	{
-		if(!input->readByte(tmpPtr[i]))
-			throw ParseException("Not enough data to parse double");
-	}
+	if(!input->readRawBytes(tmpPtr,8))
+		throw ParseException("Not enough data to parse double");
 	tmp.dummy=GINT64_FROM_BE(tmp.dummy);
 	return asAtom(tmp.val);
 }
@@ -78,11 +75,8 @@ asAtom Amf3Deserializer::parseDate() const
 	} tmp;
 	uint8_t* tmpPtr=reinterpret_cast<uint8_t*>(&tmp.dummy);
 
-	for(uint32_t i=0;i<8;i++)
-	{
-		if(!input->readByte(tmpPtr[i]))
-			throw ParseException("Not enough data to parse date");
-	}
+	if(!input->readRawBytes(tmpPtr,8))
+		throw ParseException("Not enough data to parse date");
 	tmp.dummy=GINT64_FROM_BE(tmp.dummy);
 	Date* dt = Class<Date>::getInstanceS(input->getSystemState());
 	dt->MakeDateFromMilliseconds((int64_t)tmp.val);
@@ -104,17 +98,12 @@ tiny_string Amf3Deserializer::parseStringVR(std::vector<tiny_string>& stringMap)
 	}
 
 	uint32_t strLen=strRef>>1;
-	string retStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		retStr.push_back(c);
-	}
+	tiny_string retStr;
+	if(!input->readRawString(retStr,strLen))
+		throw ParseException("Not enough data to parse string");
 	//Add string to the map, if it's not the empty one
-	if(retStr.size())
-		stringMap.emplace_back(retStr);
+	if(strLen)
+		stringMap.push_back(retStr);
 	return retStr;
 }
 
@@ -141,6 +130,8 @@ asAtom Amf3Deserializer::parseArray(std::vector<tiny_string>& stringMap,
 	objMap.push_back(asAtom::fromObject(ret));
 
 	int32_t denseCount = arrayRef >> 1;
+	//Every element takes at least one byte
+	ret->reserve(min((uint32_t)denseCount,input->getAvailableBytes()));
 
 	//Read name, value pairs
 	while(1)
@@ -223,6 +214,8 @@ asAtom Amf3Deserializer::parseVector(uint8_t marker, std::vector<tiny_string>& s
 
 	
 	int32_t count = vectorRef >> 1;
+	//Every element takes at least one byte
+	ret->reserve(min((uint32_t)count,input->getAvailableBytes()));
 
 	for(int32_t i=0;i<count;i++)
 	{
@@ -335,14 +328,13 @@ asAtom Amf3Deserializer::parseByteArray(std::vector<tiny_string>& stringMap,
 	objMap.push_back(asAtom::fromObject(ret));
 
 	
-	int32_t count = bytearrayRef >> 1;
-
-	for(int32_t i=0;i<count;i++)
+	uint32_t count = bytearrayRef >> 1;
+	if (input->getAvailableBytes() < count)
+		throw ParseException("Not enough data to parse AMF3 bytearray");
+	if (count)
 	{
-		uint8_t b;
-		if (!input->readByte(b))
-			throw ParseException("Not enough data to parse AMF3 bytearray");
-		ret->writeByte(b);
+		input->readRawBytes(ret->getBuffer(count,true),count);
+		ret->setPosition(count);
 	}
 	return asAtom::fromObject(ret);
 }
@@ -390,50 +382,55 @@ asAtom Amf3Deserializer::parseObject(std::vector<tiny_string>& stringMap,
 		return ret;
 	}
 
-	TraitsRef traits(NULL);
+	//The traits are referenced by index, traitsMap may grow while parsing the values
+	uint32_t traitsIndex;
 	if((objRef&0x02)==0)
 	{
-		uint32_t traitsRef=objRef>>2;
-		if(traitsMap.size() <= traitsRef)
+		traitsIndex=objRef>>2;
+		if(traitsMap.size() <= traitsIndex)
 			throw ParseException("Invalid traits reference in AMF3 data");
-		traits=traitsMap[traitsRef];
 	}
 	else
 	{
+		TraitsRef traits(NULL);
 		traits.dynamic = objRef&0x08;
 		uint32_t traitsCount=objRef>>4;
 		const tiny_string& className=parseStringVR(stringMap);
-		//Add the type to the traitsMap
+		traits.traitsNameIds.reserve(min(traitsCount,input->getAvailableBytes()));
 		for(uint32_t i=0;i<traitsCount;i++)
-			traits.traitsNames.emplace_back(parseStringVR(stringMap));
+			traits.traitsNameIds.push_back(input->getSystemState()->getUniqueStringId(parseStringVR(stringMap)));
 
 		const auto it=input->getSystemState()->aliasMap.find(className);
 		if(it!=input->getSystemState()->aliasMap.end())
 			traits.type=it->second.getPtr();
-		traitsMap.emplace_back(traits);
+		//Add the type to the traitsMap
+		traitsIndex=traitsMap.size();
+		traitsMap.push_back(traits);
 	}
+	Class_base* type=traitsMap[traitsIndex].type;
+	bool dynamic=traitsMap[traitsIndex].dynamic;
+	uint32_t traitsCount=traitsMap[traitsIndex].traitsNameIds.size();
 
-	asAtom ret=(traits.type)?traits.type->getInstance(true, NULL, 0):
+	asAtom ret=(type)?type->getInstance(true, NULL, 0):
 		asAtom::fromObject(Class<ASObject>::getInstanceS(input->getSystemState()));
 	//Add object to the map
 	objMap.push_back(ret);
 
-	for(uint32_t i=0;i<traits.traitsNames.size();i++)
+	multiname name(NULL);
+	name.name_type=multiname::NAME_STRING;
+	name.ns.push_back(nsNameAndKind(input->getSystemState(),"",NAMESPACE));
+	name.isAttribute=false;
+	for(uint32_t i=0;i<traitsCount;i++)
 	{
 		asAtom value=parseValue(stringMap, objMap, traitsMap);
 		ASATOM_INCREF(value);
 
-		multiname name(NULL);
-		name.name_type=multiname::NAME_STRING;
-		name.name_s_id=input->getSystemState()->getUniqueStringId(traits.traitsNames[i]);
-		name.ns.push_back(nsNameAndKind(input->getSystemState(),"",NAMESPACE));
-		name.isAttribute=false;
-			
-		ret.getObject()->setVariableByMultiname(name,value,ASObject::CONST_ALLOWED,traits.type);
+		name.name_s_id=traitsMap[traitsIndex].traitsNameIds[i];
+		ret.getObject()->setVariableByMultiname(name,value,ASObject::CONST_ALLOWED,type);
 	}
 
 	//Read dynamic name, value pairs
-	while(traits.dynamic)
+	while(dynamic)
 	{
 		const tiny_string& varName=parseStringVR(stringMap);
 		if(varName=="")
@@ -462,14 +459,9 @@ asAtom Amf3Deserializer::parseXML(std::vector<asAtom>& objMap, bool legacyXML) c
 	}
 
 	uint32_t strLen=xmlRef>>1;
-	string xmlStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		xmlStr.push_back(c);
-	}
+	tiny_string xmlStr;
+	if(!input->readRawString(xmlStr,strLen))
+		throw ParseException("Not enough data to parse string");
 
 	ASObject *xmlObj;
 	if(legacyXML)
@@ -581,14 +573,9 @@ tiny_string Amf3Deserializer::parseStringAMF0() const
 	if(!input->readShort(strLen))
 		throw ParseException("Not enough data to parse integer");
 	
-	string retStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		retStr.push_back(c);
-	}
+	tiny_string retStr;
+	if(!input->readRawString(retStr,strLen))
+		throw ParseException("Not enough data to parse string");
 	return retStr;
 }
 asAtom Amf3Deserializer::parseECMAArrayAMF0(std::vector<tiny_string>& stringMap,
@@ -82,7 +82,8 @@ class TraitsRef
 {
 public:
 	Class_base* type;
-	std::vector<tiny_string> traitsNames;
+	//Interned once, they are used by every object sharing the traits
+	std::vector<uint32_t> traitsNameIds;
 	bool dynamic;
 	TraitsRef(Class_base* t):type(t),dynamic(false){}
 };
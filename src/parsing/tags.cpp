@@ -283,6 +283,11 @@ void RemoveObject2Tag::execute(DisplayObjectContainer* parent) const
 	parent->deleteLegacyChildAt(Depth);
 }
 
+void RemoveObject2Tag::addToSnapshot(FrameSnapshot& snapshot) const
+{
+	snapshot.depths.erase(Depth);
+}
+
 SetBackgroundColorTag::SetBackgroundColorTag(RECORDHEADER h, std::istream& in):ControlTag(h)
 {
 	in >> BackgroundColor;
@@ -937,7 +942,7 @@ ASObject* BitmapTag::instance(Class_base* c) const
 }
 
 DefineTextTag::DefineTextTag(RECORDHEADER h, istream& in, RootMovieClip* root,int v):DictionaryTag(h,root),
-	tokens(reporter_allocator<GeomToken>(loadedFrom->getSystemState()->tagsMemory)),version(v)
+	tokens(_MR(new tokensVector(loadedFrom->getSystemState()->tagsMemory,true))),version(v)
 {
 	in >> CharacterId >> TextBounds >> TextMatrix >> GlyphBits >> AdvanceBits;
 	assert(v==1 || v==2);
@@ -961,7 +966,7 @@ ASObject* DefineTextTag::instance(Class_base* c) const
 	/* we cannot call computeCached in the constructor
 	 * because loadedFrom is not available there for dictionary lookups
 	 */
-	if(tokens.empty())
+	if(tokens->empty())
 		computeCached();
 
 	if(c==NULL)
@@ -973,7 +978,7 @@ ASObject* DefineTextTag::instance(Class_base* c) const
 
 void DefineTextTag::computeCached() const
 {
-	if(!tokens.empty())
+	if(!tokens->empty())
 		return;
 
 	const FontTag* curFont = NULL;
@@ -1040,23 +1045,23 @@ void DefineTextTag::computeCached() const
 			//Apply glyphMatrix first, then scaledTextMatrix
 			glyphMatrix = scaledTextMatrix.multiplyMatrix(glyphMatrix);
 
-			TokenContainer::FromShaperecordListToShapeVector(sr,tokens,fillStyles,glyphMatrix);
+			TokenContainer::FromShaperecordListToShapeVector(sr,*tokens,fillStyles,glyphMatrix);
 			curPos.x += ge.GlyphAdvance;
 		}
 	}
 }
 
 DefineShapeTag::DefineShapeTag(RECORDHEADER h,int v,RootMovieClip* root):DictionaryTag(h,root),Shapes(v),
-	tokens(reporter_allocator<GeomToken>(root->getSystemState()->tagsMemory))
+	tokens(_MR(new tokensVector(root->getSystemState()->tagsMemory,true)))
 {
 }
 
 DefineShapeTag::DefineShapeTag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DictionaryTag(h,root),Shapes(1),
-	tokens(reporter_allocator<GeomToken>(root->getSystemState()->tagsMemory))
+	tokens(_MR(new tokensVector(root->getSystemState()->tagsMemory,true)))
 {
 	LOG(LOG_TRACE,_("DefineShapeTag"));
 	in >> ShapeId >> ShapeBounds >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles,MATRIX(),Shapes.LineStyles.LineStyles2);
+	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,*tokens,Shapes.FillStyles.FillStyles,MATRIX(),Shapes.LineStyles.LineStyles2);
 }
 
 ASObject *DefineShapeTag::instance(Class_base *c) const
@@ -1071,14 +1076,14 @@ DefineShape2Tag::DefineShape2Tag(RECORDHEADER h, std::istream& in,RootMovieClip*
 {
 	LOG(LOG_TRACE,_("DefineShape2Tag"));
 	in >> ShapeId >> ShapeBounds >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles,MATRIX(),Shapes.LineStyles.LineStyles2);
+	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,*tokens,Shapes.FillStyles.FillStyles,MATRIX(),Shapes.LineStyles.LineStyles2);
 }
 
 DefineShape3Tag::DefineShape3Tag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DefineShape2Tag(h,3,root)
 {
 	LOG(LOG_TRACE,"DefineShape3Tag");
 	in >> ShapeId >> ShapeBounds >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles,MATRIX(),Shapes.LineStyles.LineStyles2);
+	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,*tokens,Shapes.FillStyles.FillStyles,MATRIX(),Shapes.LineStyles.LineStyles2);
 }
 
 DefineShape4Tag::DefineShape4Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):DefineShape3Tag(h,4,root)
@@ -1091,7 +1096,7 @@ DefineShape4Tag::DefineShape4Tag(RECORDHEADER h, std::istream& in, RootMovieClip
 	UsesNonScalingStrokes=UB(1,bs);
 	UsesScalingStrokes=UB(1,bs);
 	in >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles,MATRIX(),Shapes.LineStyles.LineStyles2);
+	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,*tokens,Shapes.FillStyles.FillStyles,MATRIX(),Shapes.LineStyles.LineStyles2);
 }
 
 DefineMorphShapeTag::DefineMorphShapeTag(RECORDHEADER h, std::istream& in, RootMovieClip* root):DictionaryTag(h, root),
@@ -1333,6 +1338,29 @@ void PlaceObject2Tag::execute(DisplayObjectContainer* parent) const
 	}
 }
 
+void PlaceObject2Tag::addToSnapshot(FrameSnapshot& snapshot) const
+{
+	auto it=snapshot.depths.find(Depth);
+	if(PlaceFlagHasCharacter)
+	{
+		//Same checks as execute, an invalid tag must not replace the object
+		if(placedTag==NULL)
+			return;
+		if(it!=snapshot.depths.end())
+		{
+			if(!PlaceFlagMove)
+				return;
+			snapshot.depths.erase(it);
+		}
+		snapshot.depths.insert(std::make_pair((uint32_t)Depth,FrameSnapshot::Entry(this)));
+	}
+	else if(PlaceFlagMove && it!=snapshot.depths.end())
+	{
+		it->second.matrix=Matrix;
+		it->second.moved=true;
+	}
+}
+
 PlaceObject2Tag::PlaceObject2Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):DisplayListTag(h),placedTag(NULL)
 {
 	LOG(LOG_TRACE,_("PlaceObject2"));
@@ -65,6 +65,8 @@ public:
 	DisplayListTag(RECORDHEADER h):Tag(h){}
 	virtual TAGTYPE getType() const{ return DISPLAY_LIST_TAG; }
 	virtual void execute(DisplayObjectContainer* parent) const=0;
+	//Records the effect of execute without creating any object
+	virtual void addToSnapshot(FrameSnapshot& snapshot) const=0;
 };
 
 class DictionaryTag: public Tag
@@ -115,8 +117,8 @@ protected:
 	UI16_SWF ShapeId;
 	RECT ShapeBounds;
 	SHAPEWITHSTYLE Shapes;
-	/* tokens are computed from Shapes */
-	tokensVector tokens;
+	/* tokens are computed from Shapes and shared by all the instances */
+	_R<tokensVector> tokens;
 	DefineShapeTag(RECORDHEADER h,int v,RootMovieClip* root);
 public:
 	DefineShapeTag(RECORDHEADER h,std::istream& in, RootMovieClip* root);
@@ -288,6 +290,7 @@ private:
 public:
 	RemoveObject2Tag(RECORDHEADER h, std::istream& in);
 	void execute(DisplayObjectContainer* parent) const;
+	void addToSnapshot(FrameSnapshot& snapshot) const;
 };
 
 class PlaceObject2Tag: public DisplayListTag
@@ -315,6 +318,7 @@ public:
 	STRING Name;
 	PlaceObject2Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root);
 	void execute(DisplayObjectContainer* parent) const;
+	void addToSnapshot(FrameSnapshot& snapshot) const;
 };
 
 class PlaceObject3Tag: public PlaceObject2Tag
@@ -513,7 +517,8 @@ private:
 	UI8 GlyphBits;
 	UI8 AdvanceBits;
 	std::vector < TEXTRECORD > TextRecords;
-	mutable tokensVector tokens;
+	/* computed on the first instance and shared by all of them */
+	_R<tokensVector> tokens;
 	void computeCached() const;
 public:
 	int version;
@@ -66,6 +66,8 @@ public:
 	uint32_t origwidth;
 	uint32_t origheight;
 	bool needrenderthread;
+	/* Composite the frames in memory instead of using OpenGL */
+	bool headless;
 	EngineData();
 	virtual ~EngineData();
 	virtual bool isSizable() const = 0;
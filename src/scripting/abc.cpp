@@ -129,6 +129,7 @@
 #include "scripting/class.h"
 #include "exceptions.h"
 #include "scripting/abc.h"
+#include "scripting/abc_codecache.h"
 
 using namespace std;
 using namespace lightspark;
@@ -146,22 +147,50 @@ bool lightspark::isVmThread()
 #endif
 }
 
-DoABCTag::DoABCTag(RECORDHEADER h, std::istream& in):ControlTag(h)
+/*
+ * Reads the ABC block and parses it. When the code cache is enabled the
+ * raw data is also hashed to find the cached methods of this block.
+ */
+static ABCContext* parseABCBlock(RootMovieClip* root, std::istream& in, uint32_t len)
 {
-	int dest=in.tellg();
-	dest+=h.getLength();
-	LOG(LOG_CALLS,_("DoABCTag"));
-
-	RootMovieClip* root=getParseThread()->getRootMovie();
+	SystemState* sys=root->getSystemState();
 	root->incRef();
-	context=new ABCContext(_MR(root), in, getVm(root->getSystemState()));
+	if(!sys->useCodeCache || !sys->useFastInterpreter)
+	{
+		int dest=in.tellg();
+		dest+=len;
+		ABCContext* context=new ABCContext(_MR(root), in, getVm(sys));
+		int pos=in.tellg();
+		if(dest!=pos)
+		{
+			LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << dest-in.tellg());
+			throw ParseException("Not complete ABC data");
+		}
+		return context;
+	}
 
-	int pos=in.tellg();
-	if(dest!=pos)
+	std::string data(len,'\0');
+	in.read(&data[0],len);
+	if(in.fail())
+		throw ParseException("Not complete ABC data");
+	std::istringstream abc(data);
+	ABCContext* context=new ABCContext(_MR(root), abc, getVm(sys));
+	uint32_t pos=abc.tellg();
+	if(len!=pos)
 	{
-		LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << dest-in.tellg());
+		LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << len-pos);
 		throw ParseException("Not complete ABC data");
 	}
+	context->codeCacheKey=CodeCache::computeKey(data.data(),data.size());
+	return context;
+}
+
+DoABCTag::DoABCTag(RECORDHEADER h, std::istream& in):ControlTag(h)
+{
+	LOG(LOG_CALLS,_("DoABCTag"));
+
+	RootMovieClip* root=getParseThread()->getRootMovie();
+	context=parseABCBlock(root, in, h.getLength());
 }
 
 void DoABCTag::execute(RootMovieClip* root) const
@@ -179,15 +208,8 @@ DoABCDefineTag::DoABCDefineTag(RECORDHEADER h, std::istream& in):ControlTag(h)
 	LOG(LOG_CALLS,_("DoABCDefineTag Name: ") << Name);
 
 	RootMovieClip* root=getParseThread()->getRootMovie();
-	root->incRef();
-	context=new ABCContext(_MR(root), in, getVm(root->getSystemState()));
-
 	int pos=in.tellg();
-	if(dest!=pos)
-	{
-		LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << dest-in.tellg());
-		throw ParseException("Not complete ABC data");
-	}
+	context=parseABCBlock(root, in, dest-pos);
 }
 
 void DoABCDefineTag::execute(RootMovieClip* root) const
@@ -289,130 +311,130 @@ void ABCVm::registerClasses()
 	builtin->registerBuiltin("unescape","",_MR(Class<IFunction>::getFunction(m_sys,unescape,1)));
 	builtin->registerBuiltin("toString","",_MR(Class<IFunction>::getFunction(m_sys,ASObject::_toString)));
 
-	builtin->registerBuiltin("AccessibilityProperties","flash.accessibility",Class<AccessibilityProperties>::getRef(m_sys));
-	builtin->registerBuiltin("AccessibilityImplementation","flash.accessibility",Class<AccessibilityImplementation>::getRef(m_sys));
-	builtin->registerBuiltin("Accessibility","flash.accessibility",Class<Accessibility>::getRef(m_sys));
+	builtin->registerBuiltinClass<AccessibilityProperties>("AccessibilityProperties","flash.accessibility");
+	builtin->registerBuiltinClass<AccessibilityImplementation>("AccessibilityImplementation","flash.accessibility");
+	builtin->registerBuiltinClass<Accessibility>("Accessibility","flash.accessibility");
 
-	builtin->registerBuiltin("Mutex","flash.concurrent",Class<ASMutex>::getRef(m_sys));
-	builtin->registerBuiltin("Condition","flash.concurrent",Class<ASCondition>::getRef(m_sys));
+	builtin->registerBuiltinClass<ASMutex>("Mutex","flash.concurrent");
+	builtin->registerBuiltinClass<ASCondition>("Condition","flash.concurrent");
 
 	builtin->registerBuiltin("generateRandomBytes","flash.crypto",_MR(Class<IFunction>::getFunction(m_sys,generateRandomBytes)));
 
-	builtin->registerBuiltin("MovieClip","flash.display",Class<MovieClip>::getRef(m_sys));
-	builtin->registerBuiltin("DisplayObject","flash.display",Class<DisplayObject>::getRef(m_sys));
-	builtin->registerBuiltin("Loader","flash.display",Class<Loader>::getRef(m_sys));
-	builtin->registerBuiltin("LoaderInfo","flash.display",Class<LoaderInfo>::getRef(m_sys));
-	builtin->registerBuiltin("SimpleButton","flash.display",Class<SimpleButton>::getRef(m_sys));
-	builtin->registerBuiltin("InteractiveObject","flash.display",Class<InteractiveObject>::getRef(m_sys));
-	builtin->registerBuiltin("DisplayObjectContainer","flash.display",Class<DisplayObjectContainer>::getRef(m_sys));
-	builtin->registerBuiltin("Sprite","flash.display",Class<Sprite>::getRef(m_sys));
-	builtin->registerBuiltin("Shape","flash.display",Class<Shape>::getRef(m_sys));
-	builtin->registerBuiltin("Stage","flash.display",Class<Stage>::getRef(m_sys));
-	builtin->registerBuiltin("Graphics","flash.display",Class<Graphics>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsBitmapFill","flash.display",Class<GraphicsBitmapFill>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsEndFill","flash.display",Class<GraphicsEndFill>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsGradientFill","flash.display",Class<GraphicsGradientFill>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsPath","flash.display",Class<GraphicsPath>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsPathCommand","flash.display",Class<GraphicsPathCommand>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsPathWinding","flash.display",Class<GraphicsPathWinding>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsShaderFill","flash.display",Class<GraphicsShaderFill>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsSolidFill","flash.display",Class<GraphicsSolidFill>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsStroke","flash.display",Class<GraphicsStroke>::getRef(m_sys));
-	builtin->registerBuiltin("GraphicsTrianglePath","flash.display",Class<GraphicsTrianglePath>::getRef(m_sys));
-	builtin->registerBuiltin("IGraphicsData","flash.display",InterfaceClass<IGraphicsData>::getRef(m_sys));
-	builtin->registerBuiltin("IGraphicsFill","flash.display",InterfaceClass<IGraphicsFill>::getRef(m_sys));
-	builtin->registerBuiltin("IGraphicsPath","flash.display",InterfaceClass<IGraphicsPath>::getRef(m_sys));
-	builtin->registerBuiltin("IGraphicsStroke","flash.display",InterfaceClass<IGraphicsStroke>::getRef(m_sys));
-	builtin->registerBuiltin("GradientType","flash.display",Class<GradientType>::getRef(m_sys));
-	builtin->registerBuiltin("BlendMode","flash.display",Class<BlendMode>::getRef(m_sys));
-	builtin->registerBuiltin("LineScaleMode","flash.display",Class<LineScaleMode>::getRef(m_sys));
-	builtin->registerBuiltin("StageScaleMode","flash.display",Class<StageScaleMode>::getRef(m_sys));
-	builtin->registerBuiltin("StageAlign","flash.display",Class<StageAlign>::getRef(m_sys));
-	builtin->registerBuiltin("StageQuality","flash.display",Class<StageQuality>::getRef(m_sys));
-	builtin->registerBuiltin("StageDisplayState","flash.display",Class<StageDisplayState>::getRef(m_sys));
-	builtin->registerBuiltin("BitmapData","flash.display",Class<BitmapData>::getRef(m_sys));
-	builtin->registerBuiltin("Bitmap","flash.display",Class<Bitmap>::getRef(m_sys));
-	builtin->registerBuiltin("IBitmapDrawable","flash.display",InterfaceClass<IBitmapDrawable>::getRef(m_sys));
-	builtin->registerBuiltin("MorphShape","flash.display",Class<MorphShape>::getRef(m_sys));
-	builtin->registerBuiltin("SpreadMethod","flash.display",Class<SpreadMethod>::getRef(m_sys));
-	builtin->registerBuiltin("InterpolationMethod","flash.display",Class<InterpolationMethod>::getRef(m_sys));
-	builtin->registerBuiltin("FrameLabel","flash.display",Class<FrameLabel>::getRef(m_sys));
-	builtin->registerBuiltin("Scene","flash.display",Class<Scene>::getRef(m_sys));
-	builtin->registerBuiltin("AVM1Movie","flash.display",Class<AVM1Movie>::getRef(m_sys));
-	builtin->registerBuiltin("Shader","flash.display",Class<Shader>::getRef(m_sys));
-	builtin->registerBuiltin("BitmapDataChannel","flash.display",Class<BitmapDataChannel>::getRef(m_sys));
-	builtin->registerBuiltin("PixelSnapping","flash.display",Class<PixelSnapping>::getRef(m_sys));
-
-	builtin->registerBuiltin("BitmapFilter","flash.filters",Class<BitmapFilter>::getRef(m_sys));
-	builtin->registerBuiltin("BitmapFilterQuality","flash.filters",Class<BitmapFilterQuality>::getRef(m_sys));
-	builtin->registerBuiltin("DropShadowFilter","flash.filters",Class<DropShadowFilter>::getRef(m_sys));
-	builtin->registerBuiltin("GlowFilter","flash.filters",Class<GlowFilter>::getRef(m_sys));
-	builtin->registerBuiltin("GradientGlowFilter","flash.filters",Class<GradientGlowFilter>::getRef(m_sys));
-	builtin->registerBuiltin("BevelFilter","flash.filters",Class<BevelFilter>::getRef(m_sys));
-	builtin->registerBuiltin("ColorMatrixFilter","flash.filters",Class<ColorMatrixFilter>::getRef(m_sys));
-	builtin->registerBuiltin("BlurFilter","flash.filters",Class<BlurFilter>::getRef(m_sys));
-	builtin->registerBuiltin("ConvolutionFilter","flash.filters",Class<ConvolutionFilter>::getRef(m_sys));
-	builtin->registerBuiltin("DisplacementMapFilter","flash.filters",Class<DisplacementMapFilter>::getRef(m_sys));
-	builtin->registerBuiltin("GradientBevelFilter","flash.filters",Class<GradientBevelFilter>::getRef(m_sys));
-	builtin->registerBuiltin("ShaderFilter","flash.filters",Class<ShaderFilter>::getRef(m_sys));
-
-	builtin->registerBuiltin("AntiAliasType","flash.text",Class<AntiAliasType>::getRef(m_sys));
-	builtin->registerBuiltin("Font","flash.text",Class<ASFont>::getRef(m_sys));
-	builtin->registerBuiltin("FontStyle","flash.text",Class<FontStyle>::getRef(m_sys));
-	builtin->registerBuiltin("FontType","flash.text",Class<FontType>::getRef(m_sys));
-	builtin->registerBuiltin("GridFitType","flash.text",Class<GridFitType>::getRef(m_sys));
-	builtin->registerBuiltin("StyleSheet","flash.text",Class<StyleSheet>::getRef(m_sys));
-	builtin->registerBuiltin("TextColorType","flash.text",Class<TextColorType>::getRef(m_sys));
-	builtin->registerBuiltin("TextDisplayMode","flash.text",Class<TextDisplayMode>::getRef(m_sys));
-	builtin->registerBuiltin("TextField","flash.text",Class<TextField>::getRef(m_sys));
-	builtin->registerBuiltin("TextFieldType","flash.text",Class<TextFieldType>::getRef(m_sys));
-	builtin->registerBuiltin("TextFieldAutoSize","flash.text",Class<TextFieldAutoSize>::getRef(m_sys));
-	builtin->registerBuiltin("TextFormat","flash.text",Class<TextFormat>::getRef(m_sys));
-	builtin->registerBuiltin("TextFormatAlign","flash.text",Class<TextFormatAlign>::getRef(m_sys));
-	builtin->registerBuiltin("TextLineMetrics","flash.text",Class<TextLineMetrics>::getRef(m_sys));
-	builtin->registerBuiltin("TextInteractionMode","flash.text",Class<TextInteractionMode>::getRef(m_sys));
-	builtin->registerBuiltin("StaticText","flash.text",Class<StaticText>::getRef(m_sys));
-
-	builtin->registerBuiltin("BreakOpportunity","flash.text.engine",Class<BreakOpportunity>::getRef(m_sys));
-	builtin->registerBuiltin("CFFHinting","flash.text.engine",Class<CFFHinting>::getRef(m_sys));
-	builtin->registerBuiltin("ContentElement","flash.text.engine",Class<ContentElement>::getRef(m_sys));
-	builtin->registerBuiltin("DigitCase","flash.text.engine",Class<DigitCase>::getRef(m_sys));
-	builtin->registerBuiltin("DigitWidth","flash.text.engine",Class<DigitWidth>::getRef(m_sys));
-	builtin->registerBuiltin("EastAsianJustifier","flash.text.engine",Class<EastAsianJustifier>::getRef(m_sys));
-	builtin->registerBuiltin("ElementFormat","flash.text.engine",Class<ElementFormat>::getRef(m_sys));
-	builtin->registerBuiltin("FontDescription","flash.text.engine",Class<FontDescription>::getRef(m_sys));
-	builtin->registerBuiltin("FontMetrics","flash.text.engine",Class<FontMetrics>::getRef(m_sys));
-	builtin->registerBuiltin("FontLookup","flash.text.engine",Class<FontLookup>::getRef(m_sys));
-	builtin->registerBuiltin("FontPosture","flash.text.engine",Class<FontPosture>::getRef(m_sys));
-	builtin->registerBuiltin("FontWeight","flash.text.engine",Class<FontWeight>::getRef(m_sys));
-	builtin->registerBuiltin("GroupElement","flash.text.engine",Class<GroupElement>::getRef(m_sys));
-	builtin->registerBuiltin("JustificationStyle","flash.text.engine",Class<JustificationStyle>::getRef(m_sys));
-	builtin->registerBuiltin("Kerning","flash.text.engine",Class<Kerning>::getRef(m_sys));
-	builtin->registerBuiltin("LigatureLevel","flash.text.engine",Class<LigatureLevel>::getRef(m_sys));
-	builtin->registerBuiltin("LineJustification","flash.text.engine",Class<LineJustification>::getRef(m_sys));
-	builtin->registerBuiltin("RenderingMode","flash.text.engine",Class<RenderingMode>::getRef(m_sys));
-	builtin->registerBuiltin("SpaceJustifier","flash.text.engine",Class<SpaceJustifier>::getRef(m_sys));
-	builtin->registerBuiltin("TabAlignment","flash.text.engine",Class<TabAlignment>::getRef(m_sys));
-	builtin->registerBuiltin("TabStop","flash.text.engine",Class<TabStop>::getRef(m_sys));
-	builtin->registerBuiltin("TextBaseline","flash.text.engine",Class<TextBaseline>::getRef(m_sys));
-	builtin->registerBuiltin("TextBlock","flash.text.engine",Class<TextBlock>::getRef(m_sys));
-	builtin->registerBuiltin("TextElement","flash.text.engine",Class<TextElement>::getRef(m_sys));
-	builtin->registerBuiltin("TextLine","flash.text.engine",Class<TextLine>::getRef(m_sys));
-	builtin->registerBuiltin("TextLineValidity","flash.text.engine",Class<TextLineValidity>::getRef(m_sys));
-	builtin->registerBuiltin("TextRotation","flash.text.engine",Class<TextRotation>::getRef(m_sys));
-	builtin->registerBuiltin("TextJustifier","flash.text.engine",Class<TextJustifier>::getRef(m_sys));
-
-	builtin->registerBuiltin("XMLDocument","flash.xml",Class<XMLDocument>::getRef(m_sys));
-	builtin->registerBuiltin("XMLNode","flash.xml",Class<XMLNode>::getRef(m_sys));
-
-	builtin->registerBuiltin("ExternalInterface","flash.external",Class<ExternalInterface>::getRef(m_sys));
-
-	builtin->registerBuiltin("Endian","flash.utils",Class<Endian>::getRef(m_sys));
-	builtin->registerBuiltin("ByteArray","flash.utils",Class<ByteArray>::getRef(m_sys));
-	builtin->registerBuiltin("CompressionAlgorithm","flash.utils",Class<CompressionAlgorithm>::getRef(m_sys));
-	builtin->registerBuiltin("Dictionary","flash.utils",Class<Dictionary>::getRef(m_sys));
-	builtin->registerBuiltin("Proxy","flash.utils",Class<Proxy>::getRef(m_sys));
-	builtin->registerBuiltin("Timer","flash.utils",Class<Timer>::getRef(m_sys));
+	builtin->registerBuiltinClass<MovieClip>("MovieClip","flash.display");
+	builtin->registerBuiltinClass<DisplayObject>("DisplayObject","flash.display");
+	builtin->registerBuiltinClass<Loader>("Loader","flash.display");
+	builtin->registerBuiltinClass<LoaderInfo>("LoaderInfo","flash.display");
+	builtin->registerBuiltinClass<SimpleButton>("SimpleButton","flash.display");
+	builtin->registerBuiltinClass<InteractiveObject>("InteractiveObject","flash.display");
+	builtin->registerBuiltinClass<DisplayObjectContainer>("DisplayObjectContainer","flash.display");
+	builtin->registerBuiltinClass<Sprite>("Sprite","flash.display");
+	builtin->registerBuiltinClass<Shape>("Shape","flash.display");
+	builtin->registerBuiltinClass<Stage>("Stage","flash.display");
+	builtin->registerBuiltinClass<Graphics>("Graphics","flash.display");
+	builtin->registerBuiltinClass<GraphicsBitmapFill>("GraphicsBitmapFill","flash.display");
+	builtin->registerBuiltinClass<GraphicsEndFill>("GraphicsEndFill","flash.display");
+	builtin->registerBuiltinClass<GraphicsGradientFill>("GraphicsGradientFill","flash.display");
+	builtin->registerBuiltinClass<GraphicsPath>("GraphicsPath","flash.display");
+	builtin->registerBuiltinClass<GraphicsPathCommand>("GraphicsPathCommand","flash.display");
+	builtin->registerBuiltinClass<GraphicsPathWinding>("GraphicsPathWinding","flash.display");
+	builtin->registerBuiltinClass<GraphicsShaderFill>("GraphicsShaderFill","flash.display");
+	builtin->registerBuiltinClass<GraphicsSolidFill>("GraphicsSolidFill","flash.display");
+	builtin->registerBuiltinClass<GraphicsStroke>("GraphicsStroke","flash.display");
+	builtin->registerBuiltinClass<GraphicsTrianglePath>("GraphicsTrianglePath","flash.display");
+	builtin->registerBuiltinInterface<IGraphicsData>("IGraphicsData","flash.display");
+	builtin->registerBuiltinInterface<IGraphicsFill>("IGraphicsFill","flash.display");
+	builtin->registerBuiltinInterface<IGraphicsPath>("IGraphicsPath","flash.display");
+	builtin->registerBuiltinInterface<IGraphicsStroke>("IGraphicsStroke","flash.display");
+	builtin->registerBuiltinClass<GradientType>("GradientType","flash.display");
+	builtin->registerBuiltinClass<BlendMode>("BlendMode","flash.display");
+	builtin->registerBuiltinClass<LineScaleMode>("LineScaleMode","flash.display");
+	builtin->registerBuiltinClass<StageScaleMode>("StageScaleMode","flash.display");
+	builtin->registerBuiltinClass<StageAlign>("StageAlign","flash.display");
+	builtin->registerBuiltinClass<StageQuality>("StageQuality","flash.display");
+	builtin->registerBuiltinClass<StageDisplayState>("StageDisplayState","flash.display");
+	builtin->registerBuiltinClass<BitmapData>("BitmapData","flash.display");
+	builtin->registerBuiltinClass<Bitmap>("Bitmap","flash.display");
+	builtin->registerBuiltinInterface<IBitmapDrawable>("IBitmapDrawable","flash.display");
+	builtin->registerBuiltinClass<MorphShape>("MorphShape","flash.display");
+	builtin->registerBuiltinClass<SpreadMethod>("SpreadMethod","flash.display");
+	builtin->registerBuiltinClass<InterpolationMethod>("InterpolationMethod","flash.display");
+	builtin->registerBuiltinClass<FrameLabel>("FrameLabel","flash.display");
+	builtin->registerBuiltinClass<Scene>("Scene","flash.display");
+	builtin->registerBuiltinClass<AVM1Movie>("AVM1Movie","flash.display");
+	builtin->registerBuiltinClass<Shader>("Shader","flash.display");
+	builtin->registerBuiltinClass<BitmapDataChannel>("BitmapDataChannel","flash.display");
+	builtin->registerBuiltinClass<PixelSnapping>("PixelSnapping","flash.display");
+
+	builtin->registerBuiltinClass<BitmapFilter>("BitmapFilter","flash.filters");
+	builtin->registerBuiltinClass<BitmapFilterQuality>("BitmapFilterQuality","flash.filters");
+	builtin->registerBuiltinClass<DropShadowFilter>("DropShadowFilter","flash.filters");
+	builtin->registerBuiltinClass<GlowFilter>("GlowFilter","flash.filters");
+	builtin->registerBuiltinClass<GradientGlowFilter>("GradientGlowFilter","flash.filters");
+	builtin->registerBuiltinClass<BevelFilter>("BevelFilter","flash.filters");
+	builtin->registerBuiltinClass<ColorMatrixFilter>("ColorMatrixFilter","flash.filters");
+	builtin->registerBuiltinClass<BlurFilter>("BlurFilter","flash.filters");
+	builtin->registerBuiltinClass<ConvolutionFilter>("ConvolutionFilter","flash.filters");
+	builtin->registerBuiltinClass<DisplacementMapFilter>("DisplacementMapFilter","flash.filters");
+	builtin->registerBuiltinClass<GradientBevelFilter>("GradientBevelFilter","flash.filters");
+	builtin->registerBuiltinClass<ShaderFilter>("ShaderFilter","flash.filters");
+
+	builtin->registerBuiltinClass<AntiAliasType>("AntiAliasType","flash.text");
+	builtin->registerBuiltinClass<ASFont>("Font","flash.text");
+	builtin->registerBuiltinClass<FontStyle>("FontStyle","flash.text");
+	builtin->registerBuiltinClass<FontType>("FontType","flash.text");
+	builtin->registerBuiltinClass<GridFitType>("GridFitType","flash.text");
+	builtin->registerBuiltinClass<StyleSheet>("StyleSheet","flash.text");
+	builtin->registerBuiltinClass<TextColorType>("TextColorType","flash.text");
+	builtin->registerBuiltinClass<TextDisplayMode>("TextDisplayMode","flash.text");
+	builtin->registerBuiltinClass<TextField>("TextField","flash.text");
+	builtin->registerBuiltinClass<TextFieldType>("TextFieldType","flash.text");
+	builtin->registerBuiltinClass<TextFieldAutoSize>("TextFieldAutoSize","flash.text");
+	builtin->registerBuiltinClass<TextFormat>("TextFormat","flash.text");
+	builtin->registerBuiltinClass<TextFormatAlign>("TextFormatAlign","flash.text");
+	builtin->registerBuiltinClass<TextLineMetrics>("TextLineMetrics","flash.text");
+	builtin->registerBuiltinClass<TextInteractionMode>("TextInteractionMode","flash.text");
+	builtin->registerBuiltinClass<StaticText>("StaticText","flash.text");
+
+	builtin->registerBuiltinClass<BreakOpportunity>("BreakOpportunity","flash.text.engine");
+	builtin->registerBuiltinClass<CFFHinting>("CFFHinting","flash.text.engine");
+	builtin->registerBuiltinClass<ContentElement>("ContentElement","flash.text.engine");
+	builtin->registerBuiltinClass<DigitCase>("DigitCase","flash.text.engine");
+	builtin->registerBuiltinClass<DigitWidth>("DigitWidth","flash.text.engine");
+	builtin->registerBuiltinClass<EastAsianJustifier>("EastAsianJustifier","flash.text.engine");
+	builtin->registerBuiltinClass<ElementFormat>("ElementFormat","flash.text.engine");
+	builtin->registerBuiltinClass<FontDescription>("FontDescription","flash.text.engine");
+	builtin->registerBuiltinClass<FontMetrics>("FontMetrics","flash.text.engine");
+	builtin->registerBuiltinClass<FontLookup>("FontLookup","flash.text.engine");
+	builtin->registerBuiltinClass<FontPosture>("FontPosture","flash.text.engine");
+	builtin->registerBuiltinClass<FontWeight>("FontWeight","flash.text.engine");
+	builtin->registerBuiltinClass<GroupElement>("GroupElement","flash.text.engine");
+	builtin->registerBuiltinClass<JustificationStyle>("JustificationStyle","flash.text.engine");
+	builtin->registerBuiltinClass<Kerning>("Kerning","flash.text.engine");
+	builtin->registerBuiltinClass<LigatureLevel>("LigatureLevel","flash.text.engine");
+	builtin->registerBuiltinClass<LineJustification>("LineJustification","flash.text.engine");
+	builtin->registerBuiltinClass<RenderingMode>("RenderingMode","flash.text.engine");
+	builtin->registerBuiltinClass<SpaceJustifier>("SpaceJustifier","flash.text.engine");
+	builtin->registerBuiltinClass<TabAlignment>("TabAlignment","flash.text.engine");
+	builtin->registerBuiltinClass<TabStop>("TabStop","flash.text.engine");
+	builtin->registerBuiltinClass<TextBaseline>("TextBaseline","flash.text.engine");
+	builtin->registerBuiltinClass<TextBlock>("TextBlock","flash.text.engine");
+	builtin->registerBuiltinClass<TextElement>("TextElement","flash.text.engine");
+	builtin->registerBuiltinClass<TextLine>("TextLine","flash.text.engine");
+	builtin->registerBuiltinClass<TextLineValidity>("TextLineValidity","flash.text.engine");
+	builtin->registerBuiltinClass<TextRotation>("TextRotation","flash.text.engine");
+	builtin->registerBuiltinClass<TextJustifier>("TextJustifier","flash.text.engine");
+
+	builtin->registerBuiltinClass<XMLDocument>("XMLDocument","flash.xml");
+	builtin->registerBuiltinClass<XMLNode>("XMLNode","flash.xml");
+
+	builtin->registerBuiltinClass<ExternalInterface>("ExternalInterface","flash.external");
+
+	builtin->registerBuiltinClass<Endian>("Endian","flash.utils");
+	builtin->registerBuiltinClass<ByteArray>("ByteArray","flash.utils");
+	builtin->registerBuiltinClass<CompressionAlgorithm>("CompressionAlgorithm","flash.utils");
+	builtin->registerBuiltinClass<Dictionary>("Dictionary","flash.utils");
+	builtin->registerBuiltinClass<Proxy>("Proxy","flash.utils");
+	builtin->registerBuiltinClass<Timer>("Timer","flash.utils");
 	builtin->registerBuiltin("getQualifiedClassName","flash.utils",_MR(Class<IFunction>::getFunction(m_sys,getQualifiedClassName)));
 	builtin->registerBuiltin("getQualifiedSuperclassName","flash.utils",_MR(Class<IFunction>::getFunction(m_sys,getQualifiedSuperclassName)));
 	builtin->registerBuiltin("getDefinitionByName","flash.utils",_MR(Class<IFunction>::getFunction(m_sys,getDefinitionByName)));
@@ -424,128 +446,128 @@ void ABCVm::registerClasses()
 	builtin->registerBuiltin("describeType","flash.utils",_MR(Class<IFunction>::getFunction(m_sys,describeType)));
 	builtin->registerBuiltin("escapeMultiByte","flash.utils",_MR(Class<IFunction>::getFunction(m_sys,escapeMultiByte)));
 	builtin->registerBuiltin("unescapeMultiByte","flash.utils",_MR(Class<IFunction>::getFunction(m_sys,unescapeMultiByte)));
-	builtin->registerBuiltin("IExternalizable","flash.utils",InterfaceClass<IExternalizable>::getRef(m_sys));
-	builtin->registerBuiltin("IDataInput","flash.utils",InterfaceClass<IDataInput>::getRef(m_sys));
-	builtin->registerBuiltin("IDataOutput","flash.utils",InterfaceClass<IDataOutput>::getRef(m_sys));
-
-	builtin->registerBuiltin("ColorTransform","flash.geom",Class<ColorTransform>::getRef(m_sys));
-	builtin->registerBuiltin("Rectangle","flash.geom",Class<Rectangle>::getRef(m_sys));
-	builtin->registerBuiltin("Matrix","flash.geom",Class<Matrix>::getRef(m_sys));
-	builtin->registerBuiltin("Transform","flash.geom",Class<Transform>::getRef(m_sys));
-	builtin->registerBuiltin("Point","flash.geom",Class<Point>::getRef(m_sys));
-	builtin->registerBuiltin("Vector3D","flash.geom",Class<Vector3D>::getRef(m_sys));
-	builtin->registerBuiltin("Matrix3D","flash.geom",Class<Matrix3D>::getRef(m_sys));
-	builtin->registerBuiltin("PerspectiveProjection","flash.geom",Class<PerspectiveProjection>::getRef(m_sys));
-
-	builtin->registerBuiltin("EventDispatcher","flash.events",Class<EventDispatcher>::getRef(m_sys));
-	builtin->registerBuiltin("Event","flash.events",Class<Event>::getRef(m_sys));
-	builtin->registerBuiltin("EventPhase","flash.events",Class<EventPhase>::getRef(m_sys));
-	builtin->registerBuiltin("MouseEvent","flash.events",Class<MouseEvent>::getRef(m_sys));
-	builtin->registerBuiltin("ProgressEvent","flash.events",Class<ProgressEvent>::getRef(m_sys));
-	builtin->registerBuiltin("TimerEvent","flash.events",Class<TimerEvent>::getRef(m_sys));
-	builtin->registerBuiltin("IOErrorEvent","flash.events",Class<IOErrorEvent>::getRef(m_sys));
-	builtin->registerBuiltin("ErrorEvent","flash.events",Class<ErrorEvent>::getRef(m_sys));
-	builtin->registerBuiltin("SecurityErrorEvent","flash.events",Class<SecurityErrorEvent>::getRef(m_sys));
-	builtin->registerBuiltin("AsyncErrorEvent","flash.events",Class<AsyncErrorEvent>::getRef(m_sys));
-	builtin->registerBuiltin("FullScreenEvent","flash.events",Class<FullScreenEvent>::getRef(m_sys));
-	builtin->registerBuiltin("TextEvent","flash.events",Class<TextEvent>::getRef(m_sys));
-	builtin->registerBuiltin("IEventDispatcher","flash.events",InterfaceClass<IEventDispatcher>::getRef(m_sys));
-	builtin->registerBuiltin("FocusEvent","flash.events",Class<FocusEvent>::getRef(m_sys));
-	builtin->registerBuiltin("NetStatusEvent","flash.events",Class<NetStatusEvent>::getRef(m_sys));
-	builtin->registerBuiltin("HTTPStatusEvent","flash.events",Class<HTTPStatusEvent>::getRef(m_sys));
-	builtin->registerBuiltin("KeyboardEvent","flash.events",Class<KeyboardEvent>::getRef(m_sys));
-	builtin->registerBuiltin("StatusEvent","flash.events",Class<StatusEvent>::getRef(m_sys));
-	builtin->registerBuiltin("DataEvent","flash.events",Class<DataEvent>::getRef(m_sys));
-	builtin->registerBuiltin("DRMErrorEvent","flash.events",Class<DRMErrorEvent>::getRef(m_sys));
-	builtin->registerBuiltin("DRMStatusEvent","flash.events",Class<DRMStatusEvent>::getRef(m_sys));
-	builtin->registerBuiltin("StageVideoEvent","flash.events",Class<StageVideoEvent>::getRef(m_sys));
-	builtin->registerBuiltin("StageVideoAvailabilityEvent","flash.events",Class<StageVideoAvailabilityEvent>::getRef(m_sys));
-	builtin->registerBuiltin("TouchEvent","flash.events",Class<TouchEvent>::getRef(m_sys));
-	builtin->registerBuiltin("GestureEvent","flash.events",Class<GestureEvent>::getRef(m_sys));
-	builtin->registerBuiltin("PressAndTapGestureEvent","flash.events",Class<PressAndTapGestureEvent>::getRef(m_sys));
-	builtin->registerBuiltin("TransformGestureEvent","flash.events",Class<TransformGestureEvent>::getRef(m_sys));
-	builtin->registerBuiltin("ContextMenuEvent","flash.events",Class<ContextMenuEvent>::getRef(m_sys));
-	builtin->registerBuiltin("UncaughtErrorEvent","flash.events",Class<UncaughtErrorEvent>::getRef(m_sys));
-	builtin->registerBuiltin("UncaughtErrorEvents","flash.events",Class<UncaughtErrorEvents>::getRef(m_sys));
-	builtin->registerBuiltin("VideoEvent","flash.events",Class<VideoEvent>::getRef(m_sys));
+	builtin->registerBuiltinInterface<IExternalizable>("IExternalizable","flash.utils");
+	builtin->registerBuiltinInterface<IDataInput>("IDataInput","flash.utils");
+	builtin->registerBuiltinInterface<IDataOutput>("IDataOutput","flash.utils");
+
+	builtin->registerBuiltinClass<ColorTransform>("ColorTransform","flash.geom");
+	builtin->registerBuiltinClass<Rectangle>("Rectangle","flash.geom");
+	builtin->registerBuiltinClass<Matrix>("Matrix","flash.geom");
+	builtin->registerBuiltinClass<Transform>("Transform","flash.geom");
+	builtin->registerBuiltinClass<Point>("Point","flash.geom");
+	builtin->registerBuiltinClass<Vector3D>("Vector3D","flash.geom");
+	builtin->registerBuiltinClass<Matrix3D>("Matrix3D","flash.geom");
+	builtin->registerBuiltinClass<PerspectiveProjection>("PerspectiveProjection","flash.geom");
+
+	builtin->registerBuiltinClass<EventDispatcher>("EventDispatcher","flash.events");
+	builtin->registerBuiltinClass<Event>("Event","flash.events");
+	builtin->registerBuiltinClass<EventPhase>("EventPhase","flash.events");
+	builtin->registerBuiltinClass<MouseEvent>("MouseEvent","flash.events");
+	builtin->registerBuiltinClass<ProgressEvent>("ProgressEvent","flash.events");
+	builtin->registerBuiltinClass<TimerEvent>("TimerEvent","flash.events");
+	builtin->registerBuiltinClass<IOErrorEvent>("IOErrorEvent","flash.events");
+	builtin->registerBuiltinClass<ErrorEvent>("ErrorEvent","flash.events");
+	builtin->registerBuiltinClass<SecurityErrorEvent>("SecurityErrorEvent","flash.events");
+	builtin->registerBuiltinClass<AsyncErrorEvent>("AsyncErrorEvent","flash.events");
+	builtin->registerBuiltinClass<FullScreenEvent>("FullScreenEvent","flash.events");
+	builtin->registerBuiltinClass<TextEvent>("TextEvent","flash.events");
+	builtin->registerBuiltinInterface<IEventDispatcher>("IEventDispatcher","flash.events");
+	builtin->registerBuiltinClass<FocusEvent>("FocusEvent","flash.events");
+	builtin->registerBuiltinClass<NetStatusEvent>("NetStatusEvent","flash.events");
+	builtin->registerBuiltinClass<HTTPStatusEvent>("HTTPStatusEvent","flash.events");
+	builtin->registerBuiltinClass<KeyboardEvent>("KeyboardEvent","flash.events");
+	builtin->registerBuiltinClass<StatusEvent>("StatusEvent","flash.events");
+	builtin->registerBuiltinClass<DataEvent>("DataEvent","flash.events");
+	builtin->registerBuiltinClass<DRMErrorEvent>("DRMErrorEvent","flash.events");
+	builtin->registerBuiltinClass<DRMStatusEvent>("DRMStatusEvent","flash.events");
+	builtin->registerBuiltinClass<StageVideoEvent>("StageVideoEvent","flash.events");
+	builtin->registerBuiltinClass<StageVideoAvailabilityEvent>("StageVideoAvailabilityEvent","flash.events");
+	builtin->registerBuiltinClass<TouchEvent>("TouchEvent","flash.events");
+	builtin->registerBuiltinClass<GestureEvent>("GestureEvent","flash.events");
+	builtin->registerBuiltinClass<PressAndTapGestureEvent>("PressAndTapGestureEvent","flash.events");
+	builtin->registerBuiltinClass<TransformGestureEvent>("TransformGestureEvent","flash.events");
+	builtin->registerBuiltinClass<ContextMenuEvent>("ContextMenuEvent","flash.events");
+	builtin->registerBuiltinClass<UncaughtErrorEvent>("UncaughtErrorEvent","flash.events");
+	builtin->registerBuiltinClass<UncaughtErrorEvents>("UncaughtErrorEvents","flash.events");
+	builtin->registerBuiltinClass<VideoEvent>("VideoEvent","flash.events");
 
 	builtin->registerBuiltin("navigateToURL","flash.net",_MR(Class<IFunction>::getFunction(m_sys,navigateToURL)));
 	builtin->registerBuiltin("sendToURL","flash.net",_MR(Class<IFunction>::getFunction(m_sys,sendToURL)));
-	builtin->registerBuiltin("FileReference","flash.net",Class<FileReference>::getRef(m_sys));
-	builtin->registerBuiltin("LocalConnection","flash.net",Class<LocalConnection>::getRef(m_sys));
-	builtin->registerBuiltin("NetConnection","flash.net",Class<NetConnection>::getRef(m_sys));
-	builtin->registerBuiltin("NetGroup","flash.net",Class<NetGroup>::getRef(m_sys));
-	builtin->registerBuiltin("NetStream","flash.net",Class<NetStream>::getRef(m_sys));
-	builtin->registerBuiltin("NetStreamAppendBytesAction","flash.net",Class<NetStreamAppendBytesAction>::getRef(m_sys));
-	builtin->registerBuiltin("NetStreamInfo","flash.net",Class<NetStreamInfo>::getRef(m_sys));
-	builtin->registerBuiltin("NetStreamPlayOptions","flash.net",Class<NetStreamPlayOptions>::getRef(m_sys));
-	builtin->registerBuiltin("NetStreamPlayTransitions","flash.net",Class<NetStreamPlayTransitions>::getRef(m_sys));
-	builtin->registerBuiltin("URLLoader","flash.net",Class<URLLoader>::getRef(m_sys));
-	builtin->registerBuiltin("URLStream","flash.net",Class<URLStream>::getRef(m_sys));
-	builtin->registerBuiltin("URLLoaderDataFormat","flash.net",Class<URLLoaderDataFormat>::getRef(m_sys));
-	builtin->registerBuiltin("URLRequest","flash.net",Class<URLRequest>::getRef(m_sys));
-	builtin->registerBuiltin("URLRequestHeader","flash.net",Class<URLRequestHeader>::getRef(m_sys));
-	builtin->registerBuiltin("URLRequestMethod","flash.net",Class<URLRequestMethod>::getRef(m_sys));
-	builtin->registerBuiltin("URLVariables","flash.net",Class<URLVariables>::getRef(m_sys));
-	builtin->registerBuiltin("SharedObject","flash.net",Class<SharedObject>::getRef(m_sys));
-	builtin->registerBuiltin("SharedObjectFlushStatus","flash.net",Class<SharedObjectFlushStatus>::getRef(m_sys));
-	builtin->registerBuiltin("ObjectEncoding","flash.net",Class<ObjectEncoding>::getRef(m_sys));
-	builtin->registerBuiltin("Socket","flash.net",Class<ASSocket>::getRef(m_sys));
-	builtin->registerBuiltin("Responder","flash.net",Class<Responder>::getRef(m_sys));
-	builtin->registerBuiltin("XMLSocket","flash.net",Class<XMLSocket>::getRef(m_sys));
+	builtin->registerBuiltinClass<FileReference>("FileReference","flash.net");
+	builtin->registerBuiltinClass<LocalConnection>("LocalConnection","flash.net");
+	builtin->registerBuiltinClass<NetConnection>("NetConnection","flash.net");
+	builtin->registerBuiltinClass<NetGroup>("NetGroup","flash.net");
+	builtin->registerBuiltinClass<NetStream>("NetStream","flash.net");
+	builtin->registerBuiltinClass<NetStreamAppendBytesAction>("NetStreamAppendBytesAction","flash.net");
+	builtin->registerBuiltinClass<NetStreamInfo>("NetStreamInfo","flash.net");
+	builtin->registerBuiltinClass<NetStreamPlayOptions>("NetStreamPlayOptions","flash.net");
+	builtin->registerBuiltinClass<NetStreamPlayTransitions>("NetStreamPlayTransitions","flash.net");
+	builtin->registerBuiltinClass<URLLoader>("URLLoader","flash.net");
+	builtin->registerBuiltinClass<URLStream>("URLStream","flash.net");
+	builtin->registerBuiltinClass<URLLoaderDataFormat>("URLLoaderDataFormat","flash.net");
+	builtin->registerBuiltinClass<URLRequest>("URLRequest","flash.net");
+	builtin->registerBuiltinClass<URLRequestHeader>("URLRequestHeader","flash.net");
+	builtin->registerBuiltinClass<URLRequestMethod>("URLRequestMethod","flash.net");
+	builtin->registerBuiltinClass<URLVariables>("URLVariables","flash.net");
+	builtin->registerBuiltinClass<SharedObject>("SharedObject","flash.net");
+	builtin->registerBuiltinClass<SharedObjectFlushStatus>("SharedObjectFlushStatus","flash.net");
+	builtin->registerBuiltinClass<ObjectEncoding>("ObjectEncoding","flash.net");
+	builtin->registerBuiltinClass<ASSocket>("Socket","flash.net");
+	builtin->registerBuiltinClass<Responder>("Responder","flash.net");
+	builtin->registerBuiltinClass<XMLSocket>("XMLSocket","flash.net");
 	builtin->registerBuiltin("registerClassAlias","flash.net",_MR(Class<IFunction>::getFunction(m_sys,registerClassAlias)));
 	builtin->registerBuiltin("getClassByAlias","flash.net",_MR(Class<IFunction>::getFunction(m_sys,getClassByAlias)));
 
-	builtin->registerBuiltin("DRMManager","flash.net.drm",Class<DRMManager>::getRef(m_sys));
+	builtin->registerBuiltinClass<DRMManager>("DRMManager","flash.net.drm");
 
 
 	builtin->registerBuiltin("fscommand","flash.system",_MR(Class<IFunction>::getFunction(m_sys,fscommand)));
-	builtin->registerBuiltin("Capabilities","flash.system",Class<Capabilities>::getRef(m_sys));
-	builtin->registerBuiltin("Security","flash.system",Class<Security>::getRef(m_sys));
-	builtin->registerBuiltin("ApplicationDomain","flash.system",Class<ApplicationDomain>::getRef(m_sys));
-	builtin->registerBuiltin("SecurityDomain","flash.system",Class<SecurityDomain>::getRef(m_sys));
-	builtin->registerBuiltin("LoaderContext","flash.system",Class<LoaderContext>::getRef(m_sys));
-	builtin->registerBuiltin("System","flash.system",Class<System>::getRef(m_sys));
-	builtin->registerBuiltin("Worker","flash.system",Class<ASWorker>::getRef(m_sys));
-	builtin->registerBuiltin("ImageDecodingPolicy","flash.system",Class<ImageDecodingPolicy>::getRef(m_sys));
+	builtin->registerBuiltinClass<Capabilities>("Capabilities","flash.system");
+	builtin->registerBuiltinClass<Security>("Security","flash.system");
+	builtin->registerBuiltinClass<ApplicationDomain>("ApplicationDomain","flash.system");
+	builtin->registerBuiltinClass<SecurityDomain>("SecurityDomain","flash.system");
+	builtin->registerBuiltinClass<LoaderContext>("LoaderContext","flash.system");
+	builtin->registerBuiltinClass<System>("System","flash.system");
+	builtin->registerBuiltinClass<ASWorker>("Worker","flash.system");
+	builtin->registerBuiltinClass<ImageDecodingPolicy>("ImageDecodingPolicy","flash.system");
 	
 
-	builtin->registerBuiltin("SoundTransform","flash.media",Class<SoundTransform>::getRef(m_sys));
-	builtin->registerBuiltin("Video","flash.media",Class<Video>::getRef(m_sys));
-	builtin->registerBuiltin("Sound","flash.media",Class<Sound>::getRef(m_sys));
-	builtin->registerBuiltin("SoundLoaderContext","flash.media",Class<SoundLoaderContext>::getRef(m_sys));
-	builtin->registerBuiltin("SoundChannel","flash.media",Class<SoundChannel>::getRef(m_sys));
-	builtin->registerBuiltin("SoundMixer","flash.media",Class<SoundMixer>::getRef(m_sys));
-	builtin->registerBuiltin("StageVideo","flash.media",Class<StageVideo>::getRef(m_sys));
-	builtin->registerBuiltin("StageVideoAvailability","flash.media",Class<StageVideoAvailability>::getRef(m_sys));
-	builtin->registerBuiltin("VideoStatus","flash.media",Class<VideoStatus>::getRef(m_sys));
-	builtin->registerBuiltin("Microphone","flash.media",Class<Microphone>::getRef(m_sys));
-
-	builtin->registerBuiltin("Keyboard","flash.ui",Class<Keyboard>::getRef(m_sys));
-	builtin->registerBuiltin("KeyboardType","flash.ui",Class<KeyboardType>::getRef(m_sys));
-	builtin->registerBuiltin("KeyLocation","flash.ui",Class<KeyLocation>::getRef(m_sys));
-	builtin->registerBuiltin("ContextMenu","flash.ui",Class<ContextMenu>::getRef(m_sys));
-	builtin->registerBuiltin("ContextMenuItem","flash.ui",Class<ContextMenuItem>::getRef(m_sys));
-	builtin->registerBuiltin("ContextMenuBuiltInItems","flash.ui",Class<ContextMenuBuiltInItems>::getRef(m_sys));
-	builtin->registerBuiltin("Mouse","flash.ui",Class<Mouse>::getRef(m_sys));
-	builtin->registerBuiltin("MouseCursor","flash.ui",Class<MouseCursor>::getRef(m_sys));
-	builtin->registerBuiltin("MouseCursorData","flash.ui",Class<MouseCursorData>::getRef(m_sys));
-	builtin->registerBuiltin("Multitouch","flash.ui",Class<Multitouch>::getRef(m_sys));
-	builtin->registerBuiltin("MultitouchInputMode","flash.ui",Class<MultitouchInputMode>::getRef(m_sys));
-
-	builtin->registerBuiltin("Accelerometer", "flash.sensors",Class<Accelerometer>::getRef(m_sys));
-
-	builtin->registerBuiltin("IOError","flash.errors",Class<IOError>::getRef(m_sys));
-	builtin->registerBuiltin("EOFError","flash.errors",Class<EOFError>::getRef(m_sys));
-	builtin->registerBuiltin("IllegalOperationError","flash.errors",Class<IllegalOperationError>::getRef(m_sys));
-	builtin->registerBuiltin("InvalidSWFError","flash.errors",Class<InvalidSWFError>::getRef(m_sys));
-	builtin->registerBuiltin("MemoryError","flash.errors",Class<MemoryError>::getRef(m_sys));
-	builtin->registerBuiltin("ScriptTimeoutError","flash.errors",Class<ScriptTimeoutError>::getRef(m_sys));
-	builtin->registerBuiltin("StackOverflowError","flash.errors",Class<StackOverflowError>::getRef(m_sys));
-
-	builtin->registerBuiltin("PrintJob","flash.printing",Class<PrintJob>::getRef(m_sys));
-	builtin->registerBuiltin("PrintJobOptions","flash.printing",Class<PrintJobOptions>::getRef(m_sys));
-	builtin->registerBuiltin("PrintJobOrientation","flash.printing",Class<PrintJobOrientation>::getRef(m_sys));
+	builtin->registerBuiltinClass<SoundTransform>("SoundTransform","flash.media");
+	builtin->registerBuiltinClass<Video>("Video","flash.media");
+	builtin->registerBuiltinClass<Sound>("Sound","flash.media");
+	builtin->registerBuiltinClass<SoundLoaderContext>("SoundLoaderContext","flash.media");
+	builtin->registerBuiltinClass<SoundChannel>("SoundChannel","flash.media");
+	builtin->registerBuiltinClass<SoundMixer>("SoundMixer","flash.media");
+	builtin->registerBuiltinClass<StageVideo>("StageVideo","flash.media");
+	builtin->registerBuiltinClass<StageVideoAvailability>("StageVideoAvailability","flash.media");
+	builtin->registerBuiltinClass<VideoStatus>("VideoStatus","flash.media");
+	builtin->registerBuiltinClass<Microphone>("Microphone","flash.media");
+
+	builtin->registerBuiltinClass<Keyboard>("Keyboard","flash.ui");
+	builtin->registerBuiltinClass<KeyboardType>("KeyboardType","flash.ui");
+	builtin->registerBuiltinClass<KeyLocation>("KeyLocation","flash.ui");
+	builtin->registerBuiltinClass<ContextMenu>("ContextMenu","flash.ui");
+	builtin->registerBuiltinClass<ContextMenuItem>("ContextMenuItem","flash.ui");
+	builtin->registerBuiltinClass<ContextMenuBuiltInItems>("ContextMenuBuiltInItems","flash.ui");
+	builtin->registerBuiltinClass<Mouse>("Mouse","flash.ui");
+	builtin->registerBuiltinClass<MouseCursor>("MouseCursor","flash.ui");
+	builtin->registerBuiltinClass<MouseCursorData>("MouseCursorData","flash.ui");
+	builtin->registerBuiltinClass<Multitouch>("Multitouch","flash.ui");
+	builtin->registerBuiltinClass<MultitouchInputMode>("MultitouchInputMode","flash.ui");
+
+	builtin->registerBuiltinClass<Accelerometer>("Accelerometer","flash.sensors");
+
+	builtin->registerBuiltinClass<IOError>("IOError","flash.errors");
+	builtin->registerBuiltinClass<EOFError>("EOFError","flash.errors");
+	builtin->registerBuiltinClass<IllegalOperationError>("IllegalOperationError","flash.errors");
+	builtin->registerBuiltinClass<InvalidSWFError>("InvalidSWFError","flash.errors");
+	builtin->registerBuiltinClass<MemoryError>("MemoryError","flash.errors");
+	builtin->registerBuiltinClass<ScriptTimeoutError>("ScriptTimeoutError","flash.errors");
+	builtin->registerBuiltinClass<StackOverflowError>("StackOverflowError","flash.errors");
+
+	builtin->registerBuiltinClass<PrintJob>("PrintJob","flash.printing");
+	builtin->registerBuiltinClass<PrintJobOptions>("PrintJobOptions","flash.printing");
+	builtin->registerBuiltinClass<PrintJobOrientation>("PrintJobOrientation","flash.printing");
 
 	builtin->registerBuiltin("isNaN","",_MR(Class<IFunction>::getFunction(m_sys,isNaN,1)));
 	builtin->registerBuiltin("isFinite","",_MR(Class<IFunction>::getFunction(m_sys,isFinite,1)));
@@ -554,15 +576,15 @@ void ABCVm::registerClasses()
 	//If needed add AIR definitions
 	if(m_sys->flashMode==SystemState::AIR)
 	{
-		builtin->registerBuiltin("NativeApplication","flash.desktop",Class<NativeApplication>::getRef(m_sys));
-		builtin->registerBuiltin("NativeDragManager","flash.desktop",Class<NativeDragManager>::getRef(m_sys));
+		builtin->registerBuiltinClass<NativeApplication>("NativeApplication","flash.desktop");
+		builtin->registerBuiltinClass<NativeDragManager>("NativeDragManager","flash.desktop");
 		
 
-		builtin->registerBuiltin("InvokeEvent","flash.events",Class<InvokeEvent>::getRef(m_sys));
-		builtin->registerBuiltin("NativeDragEvent","flash.events",Class<NativeDragEvent>::getRef(m_sys));
+		builtin->registerBuiltinClass<InvokeEvent>("InvokeEvent","flash.events");
+		builtin->registerBuiltinClass<NativeDragEvent>("NativeDragEvent","flash.events");
 
-		builtin->registerBuiltin("File","flash.filesystem",Class<ASFile>::getRef(m_sys));
-		builtin->registerBuiltin("FileStream","flash.filesystem",Class<FileStream>::getRef(m_sys));
+		builtin->registerBuiltinClass<ASFile>("File","flash.filesystem");
+		builtin->registerBuiltinClass<FileStream>("FileStream","flash.filesystem");
 	}
 
 	// if needed add AVMPLUS definitions
@@ -574,21 +596,21 @@ void ABCVm::registerClasses()
 		builtin->registerBuiltin("FLASH10_FLAGS","avmplus",_MR(abstract_ui(m_sys,0x7FF)));
 		builtin->registerBuiltin("describeType","avmplus",_MR(Class<IFunction>::getFunction(m_sys,describeType)));
 
-		builtin->registerBuiltin("System","avmplus",Class<avmplusSystem>::getRef(m_sys));
-		builtin->registerBuiltin("Domain","avmplus",Class<avmplusDomain>::getRef(m_sys));
-		builtin->registerBuiltin("File","avmplus",Class<avmplusFile>::getRef(m_sys));
-
-		builtin->registerBuiltin("AbstractBase","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("AbstractRestrictedBase","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("NativeBase","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("NativeBaseAS3","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("NativeSubclassOfAbstractBase","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("NativeSubclassOfAbstractRestrictedBase","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("NativeSubclassOfRestrictedBase","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("RestrictedBase","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("SubclassOfAbstractBase","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("SubclassOfAbstractRestrictedBase","avmshell",Class<ASObject>::getRef(m_sys));
-		builtin->registerBuiltin("SubclassOfRestrictedBase","avmshell",Class<ASObject>::getRef(m_sys));
+		builtin->registerBuiltinClass<avmplusSystem>("System","avmplus");
+		builtin->registerBuiltinClass<avmplusDomain>("Domain","avmplus");
+		builtin->registerBuiltinClass<avmplusFile>("File","avmplus");
+
+		builtin->registerBuiltinClass<ASObject>("AbstractBase","avmshell");
+		builtin->registerBuiltinClass<ASObject>("AbstractRestrictedBase","avmshell");
+		builtin->registerBuiltinClass<ASObject>("NativeBase","avmshell");
+		builtin->registerBuiltinClass<ASObject>("NativeBaseAS3","avmshell");
+		builtin->registerBuiltinClass<ASObject>("NativeSubclassOfAbstractBase","avmshell");
+		builtin->registerBuiltinClass<ASObject>("NativeSubclassOfAbstractRestrictedBase","avmshell");
+		builtin->registerBuiltinClass<ASObject>("NativeSubclassOfRestrictedBase","avmshell");
+		builtin->registerBuiltinClass<ASObject>("RestrictedBase","avmshell");
+		builtin->registerBuiltinClass<ASObject>("SubclassOfAbstractBase","avmshell");
+		builtin->registerBuiltinClass<ASObject>("SubclassOfAbstractRestrictedBase","avmshell");
+		builtin->registerBuiltinClass<ASObject>("SubclassOfRestrictedBase","avmshell");
 	}
 
 	Class_object::getRef(m_sys)->getClass(m_sys)->prototype = _MNR(new_objectPrototype(m_sys));
@@ -600,45 +622,91 @@ void ABCVm::registerClasses()
 void ABCVm::loadFloat(call_context *th)
 {
 	RUNTIME_STACK_POP_CREATE(th,arg1);
-	float addr=arg1.toNumber();
-	_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-	number_t ret=appDomain->readFromDomainMemory<float>(addr);
-	RUNTIME_STACK_PUSH(th,asAtom(ret));
+	uint32_t addr=arg1.toUInt();
 	ASATOM_DECREF(arg1);
+	number_t ret=getDomainMemoryDomain(th)->readFromDomainMemory<float>(addr);
+	RUNTIME_STACK_PUSH(th,asAtom(ret));
 }
 
 void ABCVm::loadDouble(call_context *th)
 {
 	RUNTIME_STACK_POP_CREATE(th,arg1);
-	double addr=arg1.toNumber();
-	_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-	number_t ret=appDomain->readFromDomainMemory<double>(addr);
-	RUNTIME_STACK_PUSH(th,asAtom(ret));
+	uint32_t addr=arg1.toUInt();
 	ASATOM_DECREF(arg1);
+	number_t ret=getDomainMemoryDomain(th)->readFromDomainMemory<double>(addr);
+	RUNTIME_STACK_PUSH(th,asAtom(ret));
 }
 
 void ABCVm::storeFloat(call_context *th)
 {
 	RUNTIME_STACK_POP_CREATE(th,arg1);
 	RUNTIME_STACK_POP_CREATE(th,arg2);
-	number_t addr=arg1.toNumber();
+	uint32_t addr=arg1.toUInt();
 	ASATOM_DECREF(arg1);
 	float val=(float)arg2.toNumber();
 	ASATOM_DECREF(arg2);
-	_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-	appDomain->writeToDomainMemory<float>(addr, val);
+	getDomainMemoryDomain(th)->writeToDomainMemory<float>(addr, val);
 }
 
 void ABCVm::storeDouble(call_context *th)
 {
 	RUNTIME_STACK_POP_CREATE(th,arg1);
 	RUNTIME_STACK_POP_CREATE(th,arg2);
-	number_t addr=arg1.toNumber();
+	uint32_t addr=arg1.toUInt();
 	ASATOM_DECREF(arg1);
 	double val=arg2.toNumber();
 	ASATOM_DECREF(arg2);
-	_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-	appDomain->writeToDomainMemory<double>(addr, val);
+	getDomainMemoryDomain(th)->writeToDomainMemory<double>(addr, val);
+}
+
+int32_t ABCVm::alchemyLoad8(call_context* th, uint32_t addr)
+{
+	return getDomainMemoryDomain(th)->readFromDomainMemory<uint8_t>(addr);
+}
+
+int32_t ABCVm::alchemyLoad16(call_context* th, uint32_t addr)
+{
+	return getDomainMemoryDomain(th)->readFromDomainMemory<uint16_t>(addr);
+}
+
+int32_t ABCVm::alchemyLoad32(call_context* th, uint32_t addr)
+{
+	return getDomainMemoryDomain(th)->readFromDomainMemory<int32_t>(addr);
+}
+
+number_t ABCVm::alchemyLoadFloat(call_context* th, uint32_t addr)
+{
+	return getDomainMemoryDomain(th)->readFromDomainMemory<float>(addr);
+}
+
+number_t ABCVm::alchemyLoadDouble(call_context* th, uint32_t addr)
+{
+	return getDomainMemoryDomain(th)->readFromDomainMemory<double>(addr);
+}
+
+void ABCVm::alchemyStore8(call_context* th, uint32_t addr, int32_t val)
+{
+	getDomainMemoryDomain(th)->writeToDomainMemory<uint8_t>(addr, val);
+}
+
+void ABCVm::alchemyStore16(call_context* th, uint32_t addr, int32_t val)
+{
+	getDomainMemoryDomain(th)->writeToDomainMemory<uint16_t>(addr, val);
+}
+
+void ABCVm::alchemyStore32(call_context* th, uint32_t addr, int32_t val)
+{
+	getDomainMemoryDomain(th)->writeToDomainMemory<uint32_t>(addr, val);
+}
+
+void ABCVm::alchemyStoreFloat(call_context* th, uint32_t addr, number_t val)
+{
+	getDomainMemoryDomain(th)->writeToDomainMemory<float>(addr, val);
+}
+
+void ABCVm::alchemyStoreDouble(call_context* th, uint32_t addr, number_t val)
+{
+	getDomainMemoryDomain(th)->writeToDomainMemory<double>(addr, val);
 }
 
 
@@ -787,6 +855,17 @@ multiname* ABCContext::s_getMultiname(ABCContext* th, asAtom& n, ASObject* n2, i
 	return th->getMultinameImpl(n,n2,midx);
 }
 
+void ABCContext::resolveStaticMultinames()
+{
+	asAtom unused;
+	for(unsigned int i=1;i<constant_pool.multiname_count;i++)
+	{
+		if(getMultinameRTData(i)==0)
+			getMultinameImpl(unused,NULL,i);
+	}
+	staticMultinamesResolved=true;
+}
+
 /*
  * Gets a multiname without accessing the runtime stack.
  * If getMultinameRTData(midx) return 1 then the object
@@ -1030,7 +1109,8 @@ ABCContext::ABCContext(_R<RootMovieClip> r, istream& in, ABCVm* vm):root(r),cons
 	instances(reporter_allocator<instance_info>(vm->vmDataMemory)),
 	classes(reporter_allocator<class_info>(vm->vmDataMemory)),
 	scripts(reporter_allocator<script_info>(vm->vmDataMemory)),
-	method_body(reporter_allocator<method_body_info>(vm->vmDataMemory))
+	method_body(reporter_allocator<method_body_info>(vm->vmDataMemory)),
+	staticMultinamesResolved(false)
 {
 	in >> minor >> major;
 	LOG(LOG_CALLS,_("ABCVm version ") << major << '.' << minor);
@@ -1143,6 +1223,7 @@ void ABCContext::dumpProfilingData(ostream& f) const
  */
 ABCVm::ABCVm(SystemState* s, MemoryAccount* m):m_sys(s),status(CREATED),shuttingdown(false),
 	events_queue(reporter_allocator<eventType>(m)),nextNamespaceBase(2),currentCallContext(NULL),
+	jitThread(NULL),jitShuttingDown(false),jitCompletedReady(false),
 	vmDataMemory(m),cur_recursion(0)
 {
 	limits.max_recursion = 256;
@@ -1160,6 +1241,103 @@ void ABCVm::start()
 #endif
 }
 
+void ABCVm::startJitThread()
+{
+	assert(jitThread==NULL);
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+	jitThread = Thread::create(sigc::bind(&jitWorker,this));
+#else
+	jitThread = Thread::create(sigc::bind(&jitWorker,this),true);
+#endif
+}
+
+void ABCVm::stopJitThread()
+{
+	if(jitThread==NULL)
+		return;
+	jitMutex.lock();
+	jitShuttingDown=true;
+	jitCond.signal();
+	jitMutex.unlock();
+	jitThread->join();
+	jitThread=NULL;
+}
+
+void ABCVm::jitWorker(ABCVm* th)
+{
+	setTLSSys(th->m_sys);
+	while(true)
+	{
+		th->jitMutex.lock();
+		while(th->jitQueue.empty() && !th->jitShuttingDown)
+			th->jitCond.wait(th->jitMutex);
+		if(th->jitShuttingDown)
+		{
+			th->jitMutex.unlock();
+			break;
+		}
+		method_info* mi=th->jitQueue.front();
+		th->jitQueue.pop_front();
+		th->jitMutex.unlock();
+
+		//The LLVM module, engine and pass manager are only used by this thread
+		try
+		{
+			mi->synt_method(th->m_sys);
+		}
+		catch(LightsparkException& e)
+		{
+			LOG(LOG_ERROR,"JIT compilation failed: " << e.cause);
+			mi->f=NULL;
+		}
+
+		th->jitMutex.lock();
+		th->jitCompleted.push_back(mi);
+		RELEASE_WRITE(th->jitCompletedReady,true);
+		th->jitMutex.unlock();
+	}
+}
+
+void ABCVm::requestJit(method_info* mi)
+{
+	assert(isVmThread());
+	if(mi->jitStatus!=method_info::JIT_NONE)
+		return;
+	/* Resolve on the VM thread everything the compiler would otherwise
+	 * lazily create while the VM is running */
+	if(!mi->context->staticMultinamesResolved)
+		mi->context->resolveStaticMultinames();
+	Class<Number>::getClass(m_sys);
+	Class<Integer>::getClass(m_sys);
+	Class<UInteger>::getClass(m_sys);
+	Class<Boolean>::getClass(m_sys);
+
+	mi->jitStatus=method_info::JIT_QUEUED;
+	Locker l(jitMutex);
+	jitQueue.push_back(mi);
+	jitCond.signal();
+}
+
+void ABCVm::collectJitResults()
+{
+	if(!ACQUIRE_READ(jitCompletedReady))
+		return;
+	Locker l(jitMutex);
+	while(!jitCompleted.empty())
+	{
+		method_info* mi=jitCompleted.front();
+		jitCompleted.pop_front();
+		if(mi->f)
+		{
+			mi->jitStatus=method_info::JIT_DONE;
+			mi->body->codeStatus=method_body_info::JITTED;
+		}
+		else
+			mi->jitStatus=method_info::JIT_FAILED;
+	}
+	RELEASE_WRITE(jitCompletedReady,false);
+}
+
 void ABCVm::shutdown()
 {
 	if(status==STARTED)
@@ -1406,6 +1584,8 @@ void ABCVm::handleEvent(std::pair<_NR<EventDispatcher>, _R<Event> > e)
 			case CONTEXT_INIT:
 			{
 				ABCContextInitEvent* ev=static_cast<ABCContextInitEvent*>(e.second.getPtr());
+				if(m_sys->firstScriptTime==0)
+					m_sys->firstScriptTime=compat_msectiming()-m_sys->startTime;
 				ev->context->exec(ev->lazy);
 				contexts.push_back(ev->context);
 				break;
@@ -1423,6 +1603,9 @@ void ABCVm::handleEvent(std::pair<_NR<EventDispatcher>, _R<Event> > e)
 				//AdvanceFrameEvent* ev=static_cast<AdvanceFrameEvent*>(e.second.getPtr());
 				LOG(LOG_CALLS,"ADVANCE_FRAME");
 				m_sys->mainClip->getStage()->advanceFrame();
+				//Queue the drawings of the frame before it is signaled as done,
+				//tick renders it as soon as they are uploaded
+				m_sys->flushInvalidationQueue();
 				//ev->done.signal(); // Won't this signal twice, wrt to the signal() below?
 				break;
 			}
@@ -1862,8 +2045,13 @@ void ABCVm::Run(ABCVm* th)
 		th->FPM->add(llvm::createDeadStoreEliminationPass());
 
 		th->registerFunctions();
+		//Without the interpreter every method is compiled before its first call
+		if(th->m_sys->useInterpreter)
+			th->startJitThread();
 	}
+	Chronometer startupChronometer;
 	th->registerClasses();
+	th->m_sys->builtinsInitTime=startupChronometer.checkpoint();
 
 	ThreadProfile* profile=th->m_sys->allocateProfiler(RGB(0,200,0));
 	profile->setTag("VM");
@@ -1910,6 +2098,7 @@ void ABCVm::Run(ABCVm* th)
 	}
 	if(th->m_sys->useJit)
 	{
+		th->stopJitThread();
 		th->ex->clearAllGlobalMappings();
 		delete th->module;
 	}
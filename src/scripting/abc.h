@@ -102,6 +102,12 @@ public:
 #endif
 
 	SyntheticFunction::synt_function f;
+	/*
+	 * Only accessed by the VM thread. While the status is JIT_QUEUED the
+	 * background compiler owns f and llvmf.
+	 */
+	enum JIT_STATUS { JIT_NONE=0, JIT_QUEUED, JIT_DONE, JIT_FAILED };
+	JIT_STATUS jitStatus;
 	ABCContext* context;
 	method_body_info* body;
 	SyntheticFunction::synt_function synt_method(SystemState* sys);
@@ -126,7 +132,7 @@ public:
 		profTime(0),
 		validProfName(false),
 #endif
-		f(NULL),context(NULL),body(NULL),returnType(NULL),hasExplicitTypes(false)
+		f(NULL),jitStatus(JIT_NONE),context(NULL),body(NULL),returnType(NULL),hasExplicitTypes(false)
 	{
 	}
 };
@@ -140,7 +146,7 @@ struct opcode_handler
 enum ARGS_TYPE { ARGS_OBJ_OBJ=0, ARGS_OBJ_INT, ARGS_OBJ, ARGS_INT, ARGS_OBJ_OBJ_INT, ARGS_NUMBER, ARGS_OBJ_NUMBER,
 	ARGS_BOOL, ARGS_INT_OBJ, ARGS_NONE, ARGS_NUMBER_OBJ, ARGS_INT_INT, ARGS_CONTEXT, ARGS_CONTEXT_INT, ARGS_CONTEXT_INT_INT,
 	ARGS_CONTEXT_INT_INT_INT, ARGS_CONTEXT_INT_INT_INT_BOOL, ARGS_CONTEXT_OBJ_OBJ_INT, ARGS_CONTEXT_OBJ, ARGS_CONTEXT_OBJ_OBJ,
-	ARGS_CONTEXT_OBJ_OBJ_OBJ, ARGS_OBJ_OBJ_OBJ_INT, ARGS_OBJ_OBJ_OBJ };
+	ARGS_CONTEXT_OBJ_OBJ_OBJ, ARGS_OBJ_OBJ_OBJ_INT, ARGS_OBJ_OBJ_OBJ, ARGS_CONTEXT_INT_NUMBER };
 
 struct typed_opcode_handler
 {
@@ -179,6 +185,11 @@ public:
 	std::vector<method_body_info, reporter_allocator<method_body_info>> method_body;
 	//Base for namespaces in this context
 	uint32_t namespaceBaseId;
+	//True when all the multinames without runtime data have been cached
+	bool staticMultinamesResolved;
+	//Identifies this ABC block in the persistent code cache, empty if it should not be cached
+	std::string codeCacheKey;
+	void resolveStaticMultinames();
 
 	std::vector<bool> hasRunScriptInit;
 	/**
@@ -262,15 +273,20 @@ private:
 	//If you change a definition here, update the opcode_table_* entry in abc_codesynth
 	static ASObject *hasNext(ASObject* obj, ASObject* cur_index); 
 	static bool hasNext2(call_context* th, int n, int m); 
+	static ApplicationDomain* getDomainMemoryDomain(call_context* th)
+	{
+		if(th->domainMemoryDomain==NULL)
+			th->domainMemoryDomain=getCurrentApplicationDomain(th).getPtr();
+		return th->domainMemoryDomain;
+	}
 	template<class T>
 	static void loadIntN(call_context* th)
 	{
 		RUNTIME_STACK_POP_CREATE(th,arg1);
 		uint32_t addr=arg1.toUInt();
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		T ret=appDomain->readFromDomainMemory<T>(addr);
-		RUNTIME_STACK_PUSH(th,asAtom(ret));
 		ASATOM_DECREF(arg1);
+		T ret=getDomainMemoryDomain(th)->readFromDomainMemory<T>(addr);
+		RUNTIME_STACK_PUSH(th,asAtom(ret));
 	}
 	template<class T>
 	static void storeIntN(call_context* th)
@@ -281,17 +297,31 @@ private:
 		ASATOM_DECREF(arg1);
 		int32_t val=arg2.toInt();
 		ASATOM_DECREF(arg2);
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		appDomain->writeToDomainMemory<T>(addr, val);
+		getDomainMemoryDomain(th)->writeToDomainMemory<T>(addr, val);
 	}
 	static void loadFloat(call_context* th);
 	static void loadDouble(call_context* th);
 	static void storeFloat(call_context* th);
 	static void storeDouble(call_context* th);
+	//Alchemy opcodes for the JIT, address and value are already converted
+	static int32_t alchemyLoad8(call_context* th, uint32_t addr);
+	static int32_t alchemyLoad16(call_context* th, uint32_t addr);
+	static int32_t alchemyLoad32(call_context* th, uint32_t addr);
+	static number_t alchemyLoadFloat(call_context* th, uint32_t addr);
+	static number_t alchemyLoadDouble(call_context* th, uint32_t addr);
+	static void alchemyStore8(call_context* th, uint32_t addr, int32_t val);
+	static void alchemyStore16(call_context* th, uint32_t addr, int32_t val);
+	static void alchemyStore32(call_context* th, uint32_t addr, int32_t val);
+	static void alchemyStoreFloat(call_context* th, uint32_t addr, number_t val);
+	static void alchemyStoreDouble(call_context* th, uint32_t addr, number_t val);
 
 	static void callStatic(call_context* th, int n, int m, method_info** called_mi, bool keepReturn);
 	static void callSuper(call_context* th, int n, int m, method_info** called_mi, bool keepReturn);
-	static void callProperty(call_context* th, int n, int m, method_info** called_mi, bool keepReturn);
+	static void callProperty(call_context* th, int n, int m, method_info** called_mi, bool keepReturn, method_body_info_cache* cachepos=NULL);
+	/*
+	 * Adds an entry for the lookup of name on obj to the inline cache of the instruction
+	 */
+	static void updateInlineCache(method_body_info_cache* cachepos, ASObject* obj, const multiname* name, bool forSetting);
 	static void callMethod(call_context* th, int n, int m);
 	static void callImpl(call_context* th, asAtom& f, asAtom &obj, asAtom *args, int m, bool keepReturn);
 	static void constructProp(call_context* th, int n, int m); 
@@ -464,6 +494,18 @@ private:
 	Mutex event_queue_mutex;
 	Cond sem_event_cond;
 
+	//Background compilation of hot methods
+	Thread* jitThread;
+	Mutex jitMutex;
+	Cond jitCond;
+	bool jitShuttingDown;
+	std::deque<method_info*> jitQueue;
+	std::deque<method_info*> jitCompleted;
+	ACQUIRE_RELEASE_FLAG(jitCompletedReady);
+	static void jitWorker(ABCVm* th);
+	void startJitThread();
+	void stopJitThread();
+
 	//Event handling
 	volatile bool shuttingdown;
 	typedef std::pair<_NR<EventDispatcher>,_R<Event>> eventType;
@@ -691,19 +733,32 @@ public:
 	static void preloadFunction(const SyntheticFunction* function);
 	static ASObject* executeFunctionFast(const SyntheticFunction* function, call_context* context, ASObject *caller);
 	static void optimizeFunction(SyntheticFunction* function);
+	/**
+		Queue the method for compilation on the background JIT thread
+	*/
+	void requestJit(method_info* mi);
+	/**
+		Publish the methods compiled by the background JIT thread.
+		Must be called from the VM thread
+	*/
+	void collectJitResults();
 	static void verifyBranch(std::set<uint32_t>& pendingBlock,std::map<uint32_t,BasicBlock>& basicBlocks,
 			int oldStart, int here, int offset, int code_len);
 	static void writeBranchAddress(std::map<uint32_t,BasicBlock>& basicBlocks, int here, int offset, std::ostream& out);
 	static void writeInt32(std::ostream& out, int32_t val);
 	static void writeDouble(std::ostream& out, double val);
-	static void writePtr(std::ostream& out, const void* val);
+	//hasPointers is set, since code referencing runtime objects can't be cached on disk
+	static void writePtr(std::ostream& out, const void* val, bool& hasPointers);
 
 	static InferenceData earlyBindGetLex(std::ostream& out, const SyntheticFunction* f,
-			const std::vector<InferenceData>& scopeStack, const multiname* name, uint32_t name_index);
+			const std::vector<InferenceData>& scopeStack, const multiname* name, uint32_t name_index,
+			bool& hasPointers);
 	static InferenceData earlyBindFindPropStrict(std::ostream& out, const SyntheticFunction* f,
-			const std::vector<InferenceData>& scopeStack, const multiname* name);
+			const std::vector<InferenceData>& scopeStack, const multiname* name, bool& hasPointers);
+	//hasPointers is set when the name is bound, the index depends on the scope and classes of this run
 	static EARLY_BIND_STATUS earlyBindForScopeStack(std::ostream& out, const SyntheticFunction* f,
-			const std::vector<InferenceData>& scopeStack, const multiname* name, InferenceData& inferredData);
+			const std::vector<InferenceData>& scopeStack, const multiname* name, InferenceData& inferredData,
+			bool& hasPointers);
 	static const Type* getLocalType(const SyntheticFunction* f, unsigned localIndex);
 
 	bool addEvent(_NR<EventDispatcher>,_R<Event> ) DLL_PUBLIC;
@@ -0,0 +1,207 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include <glib.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+#include "scripting/abc_codecache.h"
+#include "scripting/abctypes.h"
+#include "backends/config.h"
+#include "logger.h"
+#include "version.h"
+
+using namespace lightspark;
+using namespace std;
+using namespace boost::filesystem;
+
+//Bump this when the format of the optimized code changes
+#define CODE_CACHE_FORMAT 1
+static const char codeCacheMagic[4]={'L','S','O','C'};
+
+static string sha1(const char* data, size_t len)
+{
+	gchar* digest=g_compute_checksum_for_data(G_CHECKSUM_SHA1, (const guchar*)data, len);
+	string ret(digest);
+	g_free(digest);
+	return ret;
+}
+
+static void writeUInt32(ostream& out, uint32_t val)
+{
+	out.write((const char*)&val, 4);
+}
+
+static bool readUInt32(istream& in, uint32_t& val)
+{
+	in.read((char*)&val, 4);
+	return !in.fail();
+}
+
+string CodeCache::computeKey(const char* data, size_t len)
+{
+	string buf(VERSION);
+	buf.append(data, len);
+	return sha1(buf.data(), buf.size());
+}
+
+string CodeCache::getDirectory()
+{
+	return Config::getConfig()->getCacheDirectory() + "/code";
+}
+
+static path getEntryPath(const string& key, uint32_t methodIndex)
+{
+	ostringstream name;
+	name << methodIndex;
+	return path(CodeCache::getDirectory()) / key / name.str();
+}
+
+bool CodeCache::load(const string& key, uint32_t methodIndex, const string& originalCode,
+		     string& optimizedCode, vector<exception_info_abc>& exceptions)
+{
+	ifstream in(getEntryPath(key, methodIndex).string().c_str(), ios::in|ios::binary);
+	if(!in.is_open())
+		return false;
+
+	char magic[4];
+	in.read(magic, 4);
+	uint32_t format;
+	if(in.fail() || memcmp(magic, codeCacheMagic, 4)!=0 || !readUInt32(in, format) || format!=CODE_CACHE_FORMAT)
+		return false;
+	char originalHash[40];
+	in.read(originalHash, 40);
+	if(in.fail() || sha1(originalCode.data(), originalCode.size()).compare(0, 40, originalHash, 40)!=0)
+	{
+		LOG(LOG_INFO, "Stale code cache entry for method " << methodIndex);
+		return false;
+	}
+
+	uint32_t numExceptions;
+	if(!readUInt32(in, numExceptions))
+		return false;
+	vector<exception_info_abc> cachedExceptions(numExceptions);
+	for(uint32_t i=0;i<numExceptions;i++)
+	{
+		exception_info_abc& ei=cachedExceptions[i];
+		uint32_t excType, varName;
+		if(!readUInt32(in, ei.from) || !readUInt32(in, ei.to) || !readUInt32(in, ei.target) ||
+		   !readUInt32(in, excType) || !readUInt32(in, varName))
+			return false;
+		ei.exc_type=excType;
+		ei.var_name=varName;
+	}
+
+	uint32_t codeLen;
+	if(!readUInt32(in, codeLen))
+		return false;
+	string code(codeLen, '\0');
+	in.read(&code[0], codeLen);
+	if(in.fail())
+		return false;
+
+	optimizedCode.swap(code);
+	exceptions.swap(cachedExceptions);
+	return true;
+}
+
+void CodeCache::store(const string& key, uint32_t methodIndex, const string& originalCode,
+		      const string& optimizedCode, const vector<exception_info_abc>& exceptions)
+{
+	path entry=getEntryPath(key, methodIndex);
+	try
+	{
+		create_directories(entry.parent_path());
+	}
+	catch(const filesystem_error& e)
+	{
+		LOG(LOG_ERROR, "Could not create code cache directory " << entry.parent_path().string());
+		return;
+	}
+
+	//Write to a temporary file first, so that concurrent players never read partial entries
+	path tmp(entry.string()+".tmp");
+	{
+		ofstream out(tmp.string().c_str(), ios::out|ios::binary|ios::trunc);
+		if(!out.is_open())
+			return;
+		out.write(codeCacheMagic, 4);
+		writeUInt32(out, CODE_CACHE_FORMAT);
+		out.write(sha1(originalCode.data(), originalCode.size()).c_str(), 40);
+		writeUInt32(out, exceptions.size());
+		for(uint32_t i=0;i<exceptions.size();i++)
+		{
+			const exception_info_abc& ei=exceptions[i];
+			writeUInt32(out, ei.from);
+			writeUInt32(out, ei.to);
+			writeUInt32(out, ei.target);
+			writeUInt32(out, ei.exc_type);
+			writeUInt32(out, ei.var_name);
+		}
+		writeUInt32(out, optimizedCode.size());
+		out.write(optimizedCode.data(), optimizedCode.size());
+		if(out.fail())
+		{
+			out.close();
+			remove(tmp);
+			return;
+		}
+	}
+	boost::system::error_code ec;
+	rename(tmp, entry, ec);
+	if(ec)
+		remove(tmp, ec);
+}
+
+void CodeCache::printInfo(ostream& out)
+{
+	path dir(getDirectory());
+	uint32_t numBlocks=0;
+	uint32_t numMethods=0;
+	uintmax_t totalSize=0;
+	boost::system::error_code ec;
+	if(is_directory(dir, ec))
+	{
+		for(directory_iterator it(dir, ec);it!=directory_iterator();it.increment(ec))
+		{
+			if(ec || !is_directory(it->status()))
+				continue;
+			numBlocks++;
+			for(directory_iterator m(it->path(), ec);m!=directory_iterator();m.increment(ec))
+			{
+				if(ec || !is_regular_file(m->status()))
+					continue;
+				numMethods++;
+				totalSize+=file_size(m->path(), ec);
+			}
+		}
+	}
+	out << "Code cache: " << dir.string() << endl;
+	out << numBlocks << " ABC blocks, " << numMethods << " methods, " << totalSize << " bytes" << endl;
+}
+
+void CodeCache::purge()
+{
+	boost::system::error_code ec;
+	remove_all(path(getDirectory()), ec);
+	if(ec)
+		LOG(LOG_ERROR, "Could not purge the code cache: " << ec.message());
+}
@@ -0,0 +1,61 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef SCRIPTING_ABC_CODECACHE_H
+#define SCRIPTING_ABC_CODECACHE_H 1
+
+#include "compat.h"
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace lightspark
+{
+
+struct exception_info_abc;
+
+/*
+ * Persistent cache of the bytecode produced by ABCVm::optimizeFunction.
+ * Entries live in the "code" subdirectory of the configured cache directory,
+ * grouped by a hash of the ABC block contents and of the Lightspark version.
+ * Only code that does not embed pointers to runtime objects is stored, since
+ * those would not be valid in another process.
+ */
+class CodeCache
+{
+public:
+	/* Computes the key identifying an ABC block */
+	static std::string computeKey(const char* data, size_t len);
+	static std::string getDirectory();
+	/*
+	 * Loads the optimized code for the given method.
+	 * originalCode is used to detect stale entries.
+	 */
+	static bool load(const std::string& key, uint32_t methodIndex, const std::string& originalCode,
+			 std::string& optimizedCode, std::vector<exception_info_abc>& exceptions);
+	static void store(const std::string& key, uint32_t methodIndex, const std::string& originalCode,
+			  const std::string& optimizedCode, const std::vector<exception_info_abc>& exceptions);
+	/* Prints the number of cached ABC blocks and methods and the used space */
+	static void printInfo(std::ostream& out) DLL_PUBLIC;
+	static void purge() DLL_PUBLIC;
+};
+
+};
+
+#endif /* SCRIPTING_ABC_CODECACHE_H */
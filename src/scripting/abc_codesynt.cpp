@@ -117,6 +117,11 @@ void debug_i(int32_t i)
 	LOG(LOG_CALLS, _("debug_i ")<< i);
 }
 
+int32_t convertNumber_i(number_t d)
+{
+	return Number::toInt(d);
+}
+
 llvm::LLVMContext& ABCVm::llvm_context()
 {
 	static llvm::LLVMContext context;
@@ -154,6 +159,10 @@ typed_opcode_handler ABCVm::opcode_table_uint32_t[]={
 	{"getProperty_i",(void*)&ABCVm::getProperty_i,ARGS_OBJ_OBJ},
 	{"convert_i",(void*)&ABCVm::convert_i,ARGS_OBJ},
 	{"convert_u",(void*)&ABCVm::convert_u,ARGS_OBJ},
+	{"convertNumber_i",(void*)&convertNumber_i,ARGS_NUMBER},
+	{"alchemyLoad8",(void*)&ABCVm::alchemyLoad8,ARGS_CONTEXT_INT},
+	{"alchemyLoad16",(void*)&ABCVm::alchemyLoad16,ARGS_CONTEXT_INT},
+	{"alchemyLoad32",(void*)&ABCVm::alchemyLoad32,ARGS_CONTEXT_INT},
 };
 
 typed_opcode_handler ABCVm::opcode_table_number_t[]={
@@ -168,10 +177,17 @@ typed_opcode_handler ABCVm::opcode_table_number_t[]={
 	{"subtract_do",(void*)&ABCVm::subtract_do,ARGS_NUMBER_OBJ},
 	{"convert_d",(void*)&ABCVm::convert_d,ARGS_OBJ},
 	{"negate",(void*)&ABCVm::negate,ARGS_OBJ},
+	{"alchemyLoadFloat",(void*)&ABCVm::alchemyLoadFloat,ARGS_CONTEXT_INT},
+	{"alchemyLoadDouble",(void*)&ABCVm::alchemyLoadDouble,ARGS_CONTEXT_INT},
 };
 
 typed_opcode_handler ABCVm::opcode_table_void[]={
 	{"setSlot",(void*)&ABCVm::setSlot,ARGS_OBJ_OBJ_INT},
+	{"alchemyStore8",(void*)&ABCVm::alchemyStore8,ARGS_CONTEXT_INT_INT},
+	{"alchemyStore16",(void*)&ABCVm::alchemyStore16,ARGS_CONTEXT_INT_INT},
+	{"alchemyStore32",(void*)&ABCVm::alchemyStore32,ARGS_CONTEXT_INT_INT},
+	{"alchemyStoreFloat",(void*)&ABCVm::alchemyStoreFloat,ARGS_CONTEXT_INT_NUMBER},
+	{"alchemyStoreDouble",(void*)&ABCVm::alchemyStoreDouble,ARGS_CONTEXT_INT_NUMBER},
 	{"debug_d",(void*)&debug_d,ARGS_NUMBER},
 	{"debug_i",(void*)&debug_i,ARGS_INT},
 	{"label",(void*)&ABCVm::label,ARGS_NONE},
@@ -451,6 +467,11 @@ void ABCVm::register_table(LLVMTYPE ret_type,typed_opcode_handler* table, int ta
 	sig_context_int_int.push_back(int_type);
 	sig_context_int_int.push_back(int_type);
 
+	vector<LLVMTYPE> sig_context_int_number;
+	sig_context_int_number.push_back(context_type);
+	sig_context_int_number.push_back(int_type);
+	sig_context_int_number.push_back(number_type);
+
 	vector<LLVMTYPE> sig_context_int_int_int;
 	sig_context_int_int_int.push_back(context_type);
 	sig_context_int_int_int.push_back(int_type);
@@ -541,6 +562,9 @@ void ABCVm::register_table(LLVMTYPE ret_type,typed_opcode_handler* table, int ta
 			case ARGS_CONTEXT_INT_INT:
 				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_int), false);
 				break;
+			case ARGS_CONTEXT_INT_NUMBER:
+				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_number), false);
+				break;
 			case ARGS_CONTEXT_INT_INT_INT:
 				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_int_int), false);
 				break;
@@ -789,6 +813,47 @@ void method_info::consumeStackForRTMultiname(static_stack_types_vector& stack, i
 	}
 }
 
+/* Implements ECMA's ToInt32 algorithm, ToUint32 gives the same bit pattern */
+static llvm::Value* llvm_ToInt(llvm::ExecutionEngine* ex, llvm::IRBuilder<>& Builder, stack_entry& e)
+{
+	switch(e.second)
+	{
+	case STACK_INT:
+	case STACK_UINT:
+		return e.first;
+	case STACK_BOOLEAN:
+		return Builder.CreateZExt(e.first,int_type);
+	case STACK_NUMBER:
+	{
+		/* fptosi is undefined for values that do not fit the target type.
+		 * Below 2^63 the 64 bit conversion truncated to 32 bits wraps
+		 * modulo 2^32 as ToInt32 does, NaN, infinities and larger values
+		 * are left to the runtime */
+		llvm::Value* inRange=Builder.CreateAnd(
+				Builder.CreateFCmpOLT(e.first,llvm::ConstantFP::get(number_type,9223372036854775808.0)),
+				Builder.CreateFCmpOGT(e.first,llvm::ConstantFP::get(number_type,-9223372036854775808.0)));
+		llvm::Function* llvmf=Builder.GetInsertBlock()->getParent();
+		llvm::BasicBlock* fast=llvm::BasicBlock::Create(Builder.getContext(),"toIntFast", llvmf);
+		llvm::BasicBlock* slow=llvm::BasicBlock::Create(Builder.getContext(),"toIntSlow", llvmf);
+		llvm::BasicBlock* done=llvm::BasicBlock::Create(Builder.getContext(),"toIntDone", llvmf);
+		Builder.CreateCondBr(inRange,fast,slow);
+		Builder.SetInsertPoint(fast);
+		llvm::Value* fastValue=Builder.CreateTrunc(Builder.CreateFPToSI(e.first,Builder.getInt64Ty()),int_type);
+		Builder.CreateBr(done);
+		Builder.SetInsertPoint(slow);
+		llvm::Value* slowValue=Builder.CreateCall(ex->FindFunctionNamed("convertNumber_i"), e.first);
+		Builder.CreateBr(done);
+		Builder.SetInsertPoint(done);
+		llvm::PHINode* ret=Builder.CreatePHI(int_type,2);
+		ret->addIncoming(fastValue,fast);
+		ret->addIncoming(slowValue,slow);
+		return ret;
+	}
+	default:
+		return Builder.CreateCall(ex->FindFunctionNamed("convert_i"), e.first);
+	}
+}
+
 /* Implements ECMA's ToNumber algorith */
 static llvm::Value* llvm_ToNumber(llvm::ExecutionEngine* ex, llvm::IRBuilder<>& Builder, stack_entry& e)
 {
@@ -907,7 +972,7 @@ void method_info::doAnalysis(std::map<unsigned int,block_info>& blocks, BuilderW
 {
 	llvm::IRBuilder<>& Builder = builderWrapper.Builder;
 	bool stop;
-	stringstream code(body->code);
+	stringstream code(body->getABCCode());
 	for (unsigned int i=0;i<body->exceptions.size();i++)
 	{
 		exception_info_abc& exc=body->exceptions[i];
@@ -1278,6 +1343,33 @@ void method_info::doAnalysis(std::map<unsigned int,block_info>& blocks, BuilderW
 					cur_block->checkProactiveCasting(local_ip,STACK_BOOLEAN);
 					break;
 				}
+				case 0x35: //li8
+				case 0x36: //li16
+				case 0x37: //li32
+				{
+					popTypeFromStack(static_stack_types,local_ip);
+					static_stack_types.push_back(make_pair(local_ip,STACK_INT));
+					cur_block->checkProactiveCasting(local_ip,STACK_INT);
+					break;
+				}
+				case 0x38: //lf32
+				case 0x39: //lf64
+				{
+					popTypeFromStack(static_stack_types,local_ip);
+					static_stack_types.push_back(make_pair(local_ip,STACK_NUMBER));
+					cur_block->checkProactiveCasting(local_ip,STACK_NUMBER);
+					break;
+				}
+				case 0x3a: //si8
+				case 0x3b: //si16
+				case 0x3c: //si32
+				case 0x3d: //sf32
+				case 0x3e: //sf64
+				{
+					popTypeFromStack(static_stack_types,local_ip);
+					popTypeFromStack(static_stack_types,local_ip);
+					break;
+				}
 				case 0x40: //newfunction
 				{
 					u30 t;
@@ -2022,7 +2114,7 @@ SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 	doAnalysis(blocks,wrapper);
 
 	//Let's reset the stream
-	stringstream code(body->code);
+	stringstream code(body->getABCCode());
 	vector<stack_entry> static_locals(body->local_count,make_stack_entry(NULL,STACK_NONE));
 	block_info* cur_block=NULL;
 	static_stack.clear();
@@ -3202,6 +3294,151 @@ SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 				static_stack_push(static_stack,stack_entry(value,STACK_BOOLEAN));
 				break;
 			}
+			case 0x35:
+			{
+				//li8
+				LOG(LOG_TRACE, _("synt li8") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+#ifdef LLVM_37
+				value=Builder.CreateCall(ex->FindFunctionNamed("alchemyLoad8"), {context, addr});
+#else
+				value=Builder.CreateCall2(ex->FindFunctionNamed("alchemyLoad8"), context, addr);
+#endif
+				static_stack_push(static_stack,stack_entry(value,STACK_INT));
+				break;
+			}
+			case 0x36:
+			{
+				//li16
+				LOG(LOG_TRACE, _("synt li16") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+#ifdef LLVM_37
+				value=Builder.CreateCall(ex->FindFunctionNamed("alchemyLoad16"), {context, addr});
+#else
+				value=Builder.CreateCall2(ex->FindFunctionNamed("alchemyLoad16"), context, addr);
+#endif
+				static_stack_push(static_stack,stack_entry(value,STACK_INT));
+				break;
+			}
+			case 0x37:
+			{
+				//li32
+				LOG(LOG_TRACE, _("synt li32") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+#ifdef LLVM_37
+				value=Builder.CreateCall(ex->FindFunctionNamed("alchemyLoad32"), {context, addr});
+#else
+				value=Builder.CreateCall2(ex->FindFunctionNamed("alchemyLoad32"), context, addr);
+#endif
+				static_stack_push(static_stack,stack_entry(value,STACK_INT));
+				break;
+			}
+			case 0x38:
+			{
+				//lf32
+				LOG(LOG_TRACE, _("synt lf32") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+#ifdef LLVM_37
+				value=Builder.CreateCall(ex->FindFunctionNamed("alchemyLoadFloat"), {context, addr});
+#else
+				value=Builder.CreateCall2(ex->FindFunctionNamed("alchemyLoadFloat"), context, addr);
+#endif
+				static_stack_push(static_stack,stack_entry(value,STACK_NUMBER));
+				break;
+			}
+			case 0x39:
+			{
+				//lf64
+				LOG(LOG_TRACE, _("synt lf64") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+#ifdef LLVM_37
+				value=Builder.CreateCall(ex->FindFunctionNamed("alchemyLoadDouble"), {context, addr});
+#else
+				value=Builder.CreateCall2(ex->FindFunctionNamed("alchemyLoadDouble"), context, addr);
+#endif
+				static_stack_push(static_stack,stack_entry(value,STACK_NUMBER));
+				break;
+			}
+			case 0x3a:
+			{
+				//si8
+				LOG(LOG_TRACE, _("synt si8") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				stack_entry v2=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+				llvm::Value* val=llvm_ToInt(ex,Builder,v2);
+#ifdef LLVM_37
+				Builder.CreateCall(ex->FindFunctionNamed("alchemyStore8"), {context, addr, val});
+#else
+				Builder.CreateCall3(ex->FindFunctionNamed("alchemyStore8"), context, addr, val);
+#endif
+				break;
+			}
+			case 0x3b:
+			{
+				//si16
+				LOG(LOG_TRACE, _("synt si16") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				stack_entry v2=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+				llvm::Value* val=llvm_ToInt(ex,Builder,v2);
+#ifdef LLVM_37
+				Builder.CreateCall(ex->FindFunctionNamed("alchemyStore16"), {context, addr, val});
+#else
+				Builder.CreateCall3(ex->FindFunctionNamed("alchemyStore16"), context, addr, val);
+#endif
+				break;
+			}
+			case 0x3c:
+			{
+				//si32
+				LOG(LOG_TRACE, _("synt si32") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				stack_entry v2=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+				llvm::Value* val=llvm_ToInt(ex,Builder,v2);
+#ifdef LLVM_37
+				Builder.CreateCall(ex->FindFunctionNamed("alchemyStore32"), {context, addr, val});
+#else
+				Builder.CreateCall3(ex->FindFunctionNamed("alchemyStore32"), context, addr, val);
+#endif
+				break;
+			}
+			case 0x3d:
+			{
+				//sf32
+				LOG(LOG_TRACE, _("synt sf32") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				stack_entry v2=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+				llvm::Value* val=llvm_ToNumber(ex,Builder,v2);
+#ifdef LLVM_37
+				Builder.CreateCall(ex->FindFunctionNamed("alchemyStoreFloat"), {context, addr, val});
+#else
+				Builder.CreateCall3(ex->FindFunctionNamed("alchemyStoreFloat"), context, addr, val);
+#endif
+				break;
+			}
+			case 0x3e:
+			{
+				//sf64
+				LOG(LOG_TRACE, _("synt sf64") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				stack_entry v2=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+				llvm::Value* val=llvm_ToNumber(ex,Builder,v2);
+#ifdef LLVM_37
+				Builder.CreateCall(ex->FindFunctionNamed("alchemyStoreDouble"), {context, addr, val});
+#else
+				Builder.CreateCall3(ex->FindFunctionNamed("alchemyStoreDouble"), context, addr, val);
+#endif
+				break;
+			}
 			case 0x40:
 			{
 				//newfunction
@@ -3830,7 +4067,7 @@ SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 				LOG(LOG_TRACE, _("synt convert_i") );
 				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
 				if(v1.second==STACK_NUMBER)
-					value=Builder.CreateFPToSI(v1.first,int_type);
+					value=llvm_ToInt(ex,Builder,v1);
 				else if(v1.second==STACK_INT) //Nothing to do
 					value=v1.first;
 				else
@@ -4307,7 +4544,7 @@ SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 				}
 				else if(v1.second==STACK_INT && v2.second==STACK_NUMBER)
 				{
-					v2.first=Builder.CreateFPToSI(v2.first,int_type);
+					v2.first=llvm_ToInt(ex,Builder,v2);
 					value=Builder.CreateLShr(v2.first,v1.first); //Check for trucation of v1.first
 				}
 				else
@@ -4733,7 +4970,6 @@ SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 	getVm(sys)->FPM->run(*llvmf);
 	f=(SyntheticFunction::synt_function)getVm(sys)->ex->getPointerToFunction(llvmf);
 	//llvmf->dump(); //dump after optimization
-	body->codeStatus = method_body_info::JITTED;
 	return f;
 }
 
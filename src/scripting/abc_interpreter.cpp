@@ -29,6 +29,288 @@
 using namespace std;
 using namespace lightspark;
 
+//Labels as values are a GNU extension, also supported by clang
+#if defined(ENABLE_THREADED_DISPATCH) && defined(__GNUC__) && !defined(PROFILING_SUPPORT)
+#define ABC_THREADED_DISPATCH 1
+#endif
+
+/*
+ * The handler of each opcode, in opcode order. It is used to build both the table
+ * of handlers and the table of labels of the threaded dispatch loop
+ */
+#define ABC_OPCODE_HANDLERS(X) \
+	X(0x00,abc_invalidinstruction) \
+	X(0x01,abc_bkpt) \
+	X(0x02,abc_nop) \
+	X(0x03,abc_throw) \
+	X(0x04,abc_getSuper) \
+	X(0x05,abc_setSuper) \
+	X(0x06,abc_dxns) \
+	X(0x07,abc_dxnslate) \
+	X(0x08,abc_kill) \
+	X(0x09,abc_label) \
+	X(0x0a,abc_invalidinstruction) \
+	X(0x0b,abc_invalidinstruction) \
+	X(0x0c,abc_ifnlt) \
+	X(0x0d,abc_ifnle) \
+	X(0x0e,abc_ifngt) \
+	X(0x0f,abc_ifnge) \
+	\
+	X(0x10,abc_jump) \
+	X(0x11,abc_iftrue) \
+	X(0x12,abc_iffalse) \
+	X(0x13,abc_ifeq) \
+	X(0x14,abc_ifne) \
+	X(0x15,abc_iflt) \
+	X(0x16,abc_ifle) \
+	X(0x17,abc_ifgt) \
+	X(0x18,abc_ifge) \
+	X(0x19,abc_ifstricteq) \
+	X(0x1a,abc_ifstrictne) \
+	X(0x1b,abc_lookupswitch) \
+	X(0x1c,abc_pushwith) \
+	X(0x1d,abc_popscope) \
+	X(0x1e,abc_nextname) \
+	X(0x1f,abc_hasnext) \
+	\
+	X(0x20,abc_pushnull) \
+	X(0x21,abc_pushundefined) \
+	X(0x22,abc_invalidinstruction) \
+	X(0x23,abc_nextvalue) \
+	X(0x24,abc_pushbyte) \
+	X(0x25,abc_pushshort) \
+	X(0x26,abc_pushtrue) \
+	X(0x27,abc_pushfalse) \
+	X(0x28,abc_pushnan) \
+	X(0x29,abc_pop) \
+	X(0x2a,abc_dup) \
+	X(0x2b,abc_swap) \
+	X(0x2c,abc_pushstring) \
+	X(0x2d,abc_pushint) \
+	X(0x2e,abc_pushuint) \
+	X(0x2f,abc_pushdouble) \
+	\
+	X(0x30,abc_pushScope) \
+	X(0x31,abc_pushnamespace) \
+	X(0x32,abc_hasnext2) \
+	X(0x33,abc_invalidinstruction) \
+	X(0x34,abc_invalidinstruction) \
+	X(0x35,abc_li8) \
+	X(0x36,abc_li16) \
+	X(0x37,abc_li32) \
+	X(0x38,abc_lf32) \
+	X(0x39,abc_lf64) \
+	X(0x3a,abc_si8) \
+	X(0x3b,abc_si16) \
+	X(0x3c,abc_si32) \
+	X(0x3d,abc_sf32) \
+	X(0x3e,abc_sf64) \
+	X(0x3f,abc_invalidinstruction) \
+	\
+	X(0x40,abc_newfunction) \
+	X(0x41,abc_call) \
+	X(0x42,abc_construct) \
+	X(0x43,abc_callMethod) \
+	X(0x44,abc_callstatic) \
+	X(0x45,abc_callsuper) \
+	X(0x46,abc_callproperty) \
+	X(0x47,abc_returnvoid) \
+	X(0x48,abc_returnvalue) \
+	X(0x49,abc_constructsuper) \
+	X(0x4a,abc_constructprop) \
+	X(0x4b,abc_invalidinstruction) \
+	X(0x4c,abc_callproplex) \
+	X(0x4d,abc_invalidinstruction) \
+	X(0x4e,abc_callsupervoid) \
+	X(0x4f,abc_callpropvoid) \
+	\
+	X(0x50,abc_sxi1) \
+	X(0x51,abc_sxi8) \
+	X(0x52,abc_sxi16) \
+	X(0x53,abc_constructgenerictype) \
+	X(0x54,abc_invalidinstruction) \
+	X(0x55,abc_newobject) \
+	X(0x56,abc_newarray) \
+	X(0x57,abc_newactivation) \
+	X(0x58,abc_newclass) \
+	X(0x59,abc_getdescendants) \
+	X(0x5a,abc_newcatch) \
+	X(0x5b,abc_invalidinstruction) \
+	X(0x5c,abc_invalidinstruction) \
+	X(0x5d,abc_findpropstrict) \
+	X(0x5e,abc_findproperty) \
+	X(0x5f,abc_finddef) \
+	\
+	X(0x60,abc_getlex) \
+	X(0x61,abc_setproperty) \
+	X(0x62,abc_getlocal) \
+	X(0x63,abc_setlocal) \
+	X(0x64,abc_getglobalscope) \
+	X(0x65,abc_getscopeobject) \
+	X(0x66,abc_getProperty) \
+	X(0x67,abc_invalidinstruction) \
+	X(0x68,abc_initproperty) \
+	X(0x69,abc_invalidinstruction) \
+	X(0x6a,abc_deleteproperty) \
+	X(0x6b,abc_invalidinstruction) \
+	X(0x6c,abc_getslot) \
+	X(0x6d,abc_setslot) \
+	X(0x6e,abc_getglobalSlot) \
+	X(0x6f,abc_setglobalSlot) \
+	\
+	X(0x70,abc_convert_s) \
+	X(0x71,abc_esc_xelem) \
+	X(0x72,abc_esc_xattr) \
+	X(0x73,abc_convert_i) \
+	X(0x74,abc_convert_u) \
+	X(0x75,abc_convert_d) \
+	X(0x76,abc_convert_b) \
+	X(0x77,abc_convert_o) \
+	X(0x78,abc_checkfilter) \
+	X(0x79,abc_invalidinstruction) \
+	X(0x7a,abc_invalidinstruction) \
+	X(0x7b,abc_invalidinstruction) \
+	X(0x7c,abc_invalidinstruction) \
+	X(0x7d,abc_invalidinstruction) \
+	X(0x7e,abc_invalidinstruction) \
+	X(0x7f,abc_invalidinstruction) \
+	\
+	X(0x80,abc_coerce) \
+	X(0x81,abc_invalidinstruction) \
+	X(0x82,abc_coerce_a) \
+	X(0x83,abc_invalidinstruction) \
+	X(0x84,abc_invalidinstruction) \
+	X(0x85,abc_coerce_s) \
+	X(0x86,abc_astype) \
+	X(0x87,abc_astypelate) \
+	X(0x88,abc_invalidinstruction) \
+	X(0x89,abc_invalidinstruction) \
+	X(0x8a,abc_invalidinstruction) \
+	X(0x8b,abc_invalidinstruction) \
+	X(0x8c,abc_invalidinstruction) \
+	X(0x8d,abc_invalidinstruction) \
+	X(0x8e,abc_invalidinstruction) \
+	X(0x8f,abc_invalidinstruction) \
+	\
+	X(0x90,abc_negate) \
+	X(0x91,abc_increment) \
+	X(0x92,abc_inclocal) \
+	X(0x93,abc_decrement) \
+	X(0x94,abc_declocal) \
+	X(0x95,abc_typeof) \
+	X(0x96,abc_not) \
+	X(0x97,abc_bitnot) \
+	X(0x98,abc_invalidinstruction) \
+	X(0x99,abc_invalidinstruction) \
+	X(0x9a,abc_invalidinstruction) \
+	X(0x9b,abc_invalidinstruction) \
+	X(0x9c,abc_invalidinstruction) \
+	X(0x9d,abc_invalidinstruction) \
+	X(0x9e,abc_invalidinstruction) \
+	X(0x9f,abc_invalidinstruction) \
+	\
+	X(0xa0,abc_add) \
+	X(0xa1,abc_subtract) \
+	X(0xa2,abc_multiply) \
+	X(0xa3,abc_divide) \
+	X(0xa4,abc_modulo) \
+	X(0xa5,abc_lshift) \
+	X(0xa6,abc_rshift) \
+	X(0xa7,abc_urshift) \
+	X(0xa8,abc_bitand) \
+	X(0xa9,abc_bitor) \
+	X(0xaa,abc_bitxor) \
+	X(0xab,abc_equals) \
+	X(0xac,abc_strictequals) \
+	X(0xad,abc_lessthan) \
+	X(0xae,abc_lessequals) \
+	X(0xaf,abc_greaterthan) \
+	\
+	X(0xb0,abc_greaterequals) \
+	X(0xb1,abc_instanceof) \
+	X(0xb2,abc_istype) \
+	X(0xb3,abc_istypelate) \
+	X(0xb4,abc_in) \
+	X(0xb5,abc_invalidinstruction) \
+	X(0xb6,abc_invalidinstruction) \
+	X(0xb7,abc_invalidinstruction) \
+	X(0xb8,abc_invalidinstruction) \
+	X(0xb9,abc_invalidinstruction) \
+	X(0xba,abc_invalidinstruction) \
+	X(0xbb,abc_invalidinstruction) \
+	X(0xbc,abc_invalidinstruction) \
+	X(0xbd,abc_invalidinstruction) \
+	X(0xbe,abc_invalidinstruction) \
+	X(0xbf,abc_invalidinstruction) \
+	\
+	X(0xc0,abc_increment_i) \
+	X(0xc1,abc_decrement_i) \
+	X(0xc2,abc_inclocal_i) \
+	X(0xc3,abc_declocal_i) \
+	X(0xc4,abc_negate_i) \
+	X(0xc5,abc_add_i) \
+	X(0xc6,abc_subtract_i) \
+	X(0xc7,abc_multiply_i) \
+	X(0xc8,abc_invalidinstruction) \
+	X(0xc9,abc_invalidinstruction) \
+	X(0xca,abc_invalidinstruction) \
+	X(0xcb,abc_invalidinstruction) \
+	X(0xcc,abc_invalidinstruction) \
+	X(0xcd,abc_invalidinstruction) \
+	X(0xce,abc_invalidinstruction) \
+	X(0xcf,abc_invalidinstruction) \
+	\
+	X(0xd0,abc_getlocal_0) \
+	X(0xd1,abc_getlocal_1) \
+	X(0xd2,abc_getlocal_2) \
+	X(0xd3,abc_getlocal_3) \
+	X(0xd4,abc_setlocal_0) \
+	X(0xd5,abc_setlocal_1) \
+	X(0xd6,abc_setlocal_2) \
+	X(0xd7,abc_setlocal_3) \
+	X(0xd8,abc_invalidinstruction) \
+	X(0xd9,abc_invalidinstruction) \
+	X(0xda,abc_invalidinstruction) \
+	X(0xdb,abc_invalidinstruction) \
+	X(0xdc,abc_invalidinstruction) \
+	X(0xdd,abc_invalidinstruction) \
+	X(0xde,abc_invalidinstruction) \
+	X(0xdf,abc_invalidinstruction) \
+	\
+	X(0xe0,abc_invalidinstruction) \
+	X(0xe1,abc_invalidinstruction) \
+	X(0xe2,abc_invalidinstruction) \
+	X(0xe3,abc_invalidinstruction) \
+	X(0xe4,abc_invalidinstruction) \
+	X(0xe5,abc_invalidinstruction) \
+	X(0xe6,abc_invalidinstruction) \
+	X(0xe7,abc_invalidinstruction) \
+	X(0xe8,abc_invalidinstruction) \
+	X(0xe9,abc_invalidinstruction) \
+	X(0xea,abc_invalidinstruction) \
+	X(0xeb,abc_invalidinstruction) \
+	X(0xec,abc_invalidinstruction) \
+	X(0xed,abc_invalidinstruction) \
+	X(0xee,abc_invalidinstruction) \
+	X(0xef,abc_debug) \
+	\
+	X(0xf0,abc_debugline) \
+	X(0xf1,abc_debugfile) \
+	X(0xf2,abc_bkptline) \
+	X(0xf3,abc_timestamp) \
+	X(0xf4,abc_invalidinstruction) \
+	X(0xf5,abc_invalidinstruction) \
+	X(0xf6,abc_invalidinstruction) \
+	X(0xf7,abc_invalidinstruction) \
+	X(0xf8,abc_invalidinstruction) \
+	X(0xf9,abc_invalidinstruction) \
+	X(0xfa,abc_invalidinstruction) \
+	X(0xfb,abc_invalidinstruction) \
+	X(0xfc,abc_invalidinstruction) \
+	X(0xfd,abc_invalidinstruction) \
+	X(0xfe,abc_invalidinstruction) \
+	X(0xff,abc_invalidinstruction)
+
 uint64_t ABCVm::profilingCheckpoint(uint64_t& startTime)
 {
 	uint64_t cur=compat_get_thread_cputime_us();
@@ -46,6 +328,36 @@ void ABCVm::executeFunction(const SyntheticFunction* function, call_context* con
 	//This may be non-zero and point to the position of an exception handler
 	code.seekg(context->exec_pos);
 
+#ifdef ABC_THREADED_DISPATCH
+	/*
+	 * Direct threaded dispatch: each opcode jumps to the next one through its own
+	 * copy of the dispatch code, which is much easier on the branch predictor than
+	 * a single indirect call site. Handlers are called directly, so the compiler
+	 * is free to inline them. Operands have already been decoded into the code
+	 * cache by preloadFunction.
+	 */
+#define ABC_THREADED_LABEL(op,handler) &&label_##op,
+	static void* const dispatchTable[256]={
+		ABC_OPCODE_HANDLERS(ABC_THREADED_LABEL)
+	};
+#undef ABC_THREADED_LABEL
+#define ABC_DISPATCH() do { \
+		uint8_t opcode = code.readbyte(); \
+		context->exec_pos = code.tellg(); \
+		goto *dispatchTable[opcode]; \
+	} while(0)
+#define ABC_THREADED_BODY(op,handler) \
+	label_##op: \
+		handler(context,code); \
+		if (context->returning) \
+			return; \
+		ABC_DISPATCH();
+
+	ABC_DISPATCH();
+	ABC_OPCODE_HANDLERS(ABC_THREADED_BODY)
+#undef ABC_THREADED_BODY
+#undef ABC_DISPATCH
+#else
 #ifdef PROFILING_SUPPORT
 	if(mi->profTime.empty())
 		mi->profTime.resize(code_len,0);
@@ -82,282 +394,14 @@ void ABCVm::executeFunction(const SyntheticFunction* function, call_context* con
 	//We managed to execute all the function
 	context->returning = true;
 	RUNTIME_STACK_POP(context,context->returnvalue);
+#endif
 }
 
+#define ABC_HANDLER_ENTRY(op,handler) handler,
 ABCVm::abc_function ABCVm::abcfunctions[]={
-	abc_invalidinstruction, // 0x00
-	abc_bkpt,
-	abc_nop,
-	abc_throw,
-	abc_getSuper,
-	abc_setSuper,
-	abc_dxns,
-	abc_dxnslate,
-	abc_kill,
-	abc_label,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_ifnlt,
-	abc_ifnle,
-	abc_ifngt,
-	abc_ifnge,
-
-	abc_jump, // 0x10
-	abc_iftrue,
-	abc_iffalse,
-	abc_ifeq,
-	abc_ifne,
-	abc_iflt,
-	abc_ifle,
-	abc_ifgt,
-	abc_ifge,
-	abc_ifstricteq,
-	abc_ifstrictne,
-	abc_lookupswitch,
-	abc_pushwith,
-	abc_popscope,
-	abc_nextname,
-	abc_hasnext,
-
-	abc_pushnull,// 0x20
-	abc_pushundefined,
-	abc_invalidinstruction,
-	abc_nextvalue,
-	abc_pushbyte,
-	abc_pushshort,
-	abc_pushtrue,
-	abc_pushfalse,
-	abc_pushnan,
-	abc_pop,
-	abc_dup,
-	abc_swap,
-	abc_pushstring,
-	abc_pushint,
-	abc_pushuint,
-	abc_pushdouble,
-
-	abc_pushScope, // 0x30
-	abc_pushnamespace,
-	abc_hasnext2,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_li8,
-	abc_li16,
-	abc_li32,
-	abc_lf32,
-	abc_lf64,
-	abc_si8,
-	abc_si16,
-	abc_si32,
-	abc_sf32,
-	abc_sf64,
-	abc_invalidinstruction,
-
-	abc_newfunction,// 0x40
-	abc_call,
-	abc_construct,
-	abc_callMethod,
-	abc_callstatic,
-	abc_callsuper,
-	abc_callproperty,
-	abc_returnvoid,
-	abc_returnvalue,
-	abc_constructsuper,
-	abc_constructprop,
-	abc_invalidinstruction,
-	abc_callproplex,
-	abc_invalidinstruction,
-	abc_callsupervoid,
-	abc_callpropvoid,
-
-	abc_sxi1,// 0x50
-	abc_sxi8,
-	abc_sxi16,
-	abc_constructgenerictype,
-	abc_invalidinstruction,
-	abc_newobject,
-	abc_newarray,
-	abc_newactivation,
-	abc_newclass,
-	abc_getdescendants,
-	abc_newcatch,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_findpropstrict,
-	abc_findproperty,
-	abc_finddef,
-
-	abc_getlex,// 0x60
-	abc_setproperty,
-	abc_getlocal,
-	abc_setlocal,
-	abc_getglobalscope,
-	abc_getscopeobject,
-	abc_getProperty,
-	abc_invalidinstruction,
-	abc_initproperty,
-	abc_invalidinstruction,
-	abc_deleteproperty,
-	abc_invalidinstruction,
-	abc_getslot,
-	abc_setslot,
-	abc_getglobalSlot,
-	abc_setglobalSlot,
-
-	abc_convert_s,// 0x70
-	abc_esc_xelem,
-	abc_esc_xattr,
-	abc_convert_i,
-	abc_convert_u,
-	abc_convert_d,
-	abc_convert_b,
-	abc_convert_o,
-	abc_checkfilter,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-
-	abc_coerce, // 0x80
-	abc_invalidinstruction,
-	abc_coerce_a,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_coerce_s,
-	abc_astype,
-	abc_astypelate,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-
-	abc_negate, //0x90
-	abc_increment,
-	abc_inclocal,
-	abc_decrement,
-	abc_declocal,
-	abc_typeof,
-	abc_not,
-	abc_bitnot,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-
-	abc_add, //0xa0
-	abc_subtract,
-	abc_multiply,
-	abc_divide,
-	abc_modulo,
-	abc_lshift,
-	abc_rshift,
-	abc_urshift,
-	abc_bitand,
-	abc_bitor,
-	abc_bitxor,
-	abc_equals,
-	abc_strictequals,
-	abc_lessthan,
-	abc_lessequals,
-	abc_greaterthan,
-
-	abc_greaterequals,// 0xb0
-	abc_instanceof,
-	abc_istype,
-	abc_istypelate,
-	abc_in,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-
-	abc_increment_i, // 0xc0
-	abc_decrement_i,
-	abc_inclocal_i,
-	abc_declocal_i,
-	abc_negate_i,
-	abc_add_i,
-	abc_subtract_i,
-	abc_multiply_i,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-
-	abc_getlocal_0, // 0xd0
-	abc_getlocal_1,
-	abc_getlocal_2,
-	abc_getlocal_3,
-	abc_setlocal_0,
-	abc_setlocal_1,
-	abc_setlocal_2,
-	abc_setlocal_3,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-
-	abc_invalidinstruction, // 0xe0
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_debug,
-
-	abc_debugline,// 0xf0
-	abc_debugfile,
-	abc_bkptline,
-	abc_timestamp,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction,
-	abc_invalidinstruction
-
+	ABC_OPCODE_HANDLERS(ABC_HANDLER_ENTRY)
 };
+#undef ABC_HANDLER_ENTRY
 
 
 void ABCVm::abc_bkpt(call_context* context,memorystream& code)
@@ -1045,9 +1089,10 @@ void ABCVm::abc_callsuper(call_context* context,memorystream& code)
 void ABCVm::abc_callproperty(call_context* context,memorystream& code)
 {
 	//callproperty
+	method_body_info_cache* cachepos = code.tellcachepos();
 	uint32_t t = code.readu30();
 	uint32_t t2 = code.readu30();
-	callProperty(context,t,t2,NULL,true);
+	callProperty(context,t,t2,NULL,true,cachepos);
 }
 void ABCVm::abc_returnvoid(call_context* context,memorystream& code)
 {
@@ -1095,9 +1140,10 @@ void ABCVm::abc_callsupervoid(call_context* context,memorystream& code)
 void ABCVm::abc_callpropvoid(call_context* context,memorystream& code)
 {
 	//callpropvoid
+	method_body_info_cache* cachepos = code.tellcachepos();
 	uint32_t t = code.readu30();
 	uint32_t t2 = code.readu30();
-	callProperty(context,t,t2,NULL,false);
+	callProperty(context,t,t2,NULL,false,cachepos);
 }
 void ABCVm::abc_sxi1(call_context* context,memorystream& code)
 {
@@ -1221,6 +1267,7 @@ void ABCVm::abc_getlex(call_context* context,memorystream& code)
 void ABCVm::abc_setproperty(call_context* context,memorystream& code)
 {
 	//setproperty
+	method_body_info_cache* cachepos = code.tellcachepos();
 	uint32_t t = code.readu30();
 	RUNTIME_STACK_POP_CREATE(context,value);
 
@@ -1242,7 +1289,13 @@ void ABCVm::abc_setproperty(call_context* context,memorystream& code)
 	}
 	//Do not allow to set contant traits
 	ASObject* o = obj.toObject(context->context->root->getSystemState());
-	o->setVariableByMultiname(*name,value,ASObject::CONST_NOT_ALLOWED);
+	const inline_cache_entry* entry = cachepos->ic ? o->findInlineCache(cachepos->ic) : NULL;
+	if(entry==NULL || !o->setVariableByInlineCache(*entry,value))
+	{
+		o->setVariableByMultiname(*name,value,ASObject::CONST_NOT_ALLOWED);
+		if(entry==NULL)
+			updateInlineCache(cachepos,o,name,true);
+	}
 
 	name->resetNameIfObject();
 }
@@ -1289,6 +1342,7 @@ void ABCVm::abc_getscopeobject(call_context* context,memorystream& code)
 }
 void ABCVm::abc_getProperty(call_context* context,memorystream& code)
 {
+	method_body_info_cache* cachepos = code.tellcachepos();
 	uint32_t t = code.readu30();
 	multiname* name=context->context->getMultiname(t,context);
 
@@ -1298,8 +1352,16 @@ void ABCVm::abc_getProperty(call_context* context,memorystream& code)
 	LOG_CALL( _("getProperty ") << *name << ' ' << obj->toDebugString() << ' '<<obj->isInitialized());
 	checkDeclaredTraits(obj);
 
-
-	asAtom prop=obj->getVariableByMultiname(*name);
+	asAtom prop;
+	const inline_cache_entry* entry = cachepos->ic ? obj->findInlineCache(cachepos->ic) : NULL;
+	if(entry)
+		prop=obj->getVariableByInlineCache(*entry);
+	else
+	{
+		prop=obj->getVariableByMultiname(*name);
+		if(prop.type != T_INVALID)
+			updateInlineCache(cachepos,obj,name,false);
+	}
 	if(prop.type == T_INVALID)
 	{
 		if (obj->getClass() && obj->getClass()->isSealed)
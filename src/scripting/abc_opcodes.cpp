@@ -317,7 +317,20 @@ int32_t ABCVm::bitOr(ASObject* val2, ASObject* val1)
 	return i1|i2;
 }
 
-void ABCVm::callProperty(call_context* th, int n, int m, method_info** called_mi, bool keepReturn)
+void ABCVm::updateInlineCache(method_body_info_cache* cachepos, ASObject* obj, const multiname* name, bool forSetting)
+{
+	//Only names completely known at compile time can be cached
+	if(!name->isStatic || name->name_type!=multiname::NAME_STRING)
+		return;
+	inline_cache_entry entry;
+	if(!obj->fillInlineCache(*name,forSetting,entry))
+		return;
+	if(cachepos->ic==NULL)
+		cachepos->ic=new inline_cache();
+	cachepos->ic->add(entry);
+}
+
+void ABCVm::callProperty(call_context* th, int n, int m, method_info** called_mi, bool keepReturn, method_body_info_cache* cachepos)
 {
 	asAtom* args=g_newa(asAtom, m);
 	for(int i=0;i<m;i++)
@@ -340,8 +353,17 @@ void ABCVm::callProperty(call_context* th, int n, int m, method_info** called_mi
 	}
 	ASObject* pobj = obj.toObject(th->context->root->getSystemState());
 	checkDeclaredTraits(pobj);
-	//We should skip the special implementation of get
-	asAtom o=pobj->getVariableByMultiname(*name, ASObject::SKIP_IMPL);
+	asAtom o;
+	const inline_cache_entry* entry = (cachepos && cachepos->ic) ? pobj->findInlineCache(cachepos->ic) : NULL;
+	if(entry)
+		o=pobj->getVariableByInlineCache(*entry);
+	else
+	{
+		//We should skip the special implementation of get
+		o=pobj->getVariableByMultiname(*name, ASObject::SKIP_IMPL);
+		if(cachepos && o.type != T_INVALID)
+			updateInlineCache(cachepos,pobj,name,false);
+	}
 	name->resetNameIfObject();
 	if(o.type == T_INVALID && obj.is<Class_base>())
 	{
@@ -1117,10 +1139,10 @@ ASObject* ABCVm::add(ASObject* val2, ASObject* val1)
 	}
 	else if(val1->is<ASString>() || val2->is<ASString>())
 	{
-		tiny_string a = val1->toString();
-		tiny_string b = val2->toString();
-		LOG_CALL("add " << a << '+' << b);
-		res = abstract_s(val1->getSystemState(),a + b);
+		LOG_CALL("add " << val1->toString() << '+' << val2->toString());
+		asAtom a = asAtom::fromObject(val1);
+		asAtom b = asAtom::fromObject(val2);
+		res = ASString::concatenate(val1->getSystemState(),a,b);
 		val1->decRef();
 		val2->decRef();
 		return res;
@@ -18,6 +18,7 @@
 **************************************************************************/
 
 #include "abc.h"
+#include "abc_codecache.h"
 #include "compat.h"
 #include "abcutils.h"
 #include "toplevel/toplevel.h"
@@ -131,7 +132,8 @@ struct lightspark::BasicBlock
 };
 
 EARLY_BIND_STATUS ABCVm::earlyBindForScopeStack(ostream& out, const SyntheticFunction* f,
-		const std::vector<InferenceData>& scopeStack, const multiname* name, InferenceData& inferredData)
+		const std::vector<InferenceData>& scopeStack, const multiname* name, InferenceData& inferredData,
+		bool& hasPointers)
 {
 	//We try to find out the position on the scope stack where the name is found
 	uint32_t totalScopeStackLen = f->func_scope->scope.size() + scopeStack.size();
@@ -190,6 +192,9 @@ EARLY_BIND_STATUS ABCVm::earlyBindForScopeStack(ostream& out, const SyntheticFun
 	}
 	if(found)
 	{
+		//The index was found through the live function scope and classes that may
+		//come from other ABC blocks, the code is only valid for this run
+		hasPointers=true;
 		out << (uint8_t)GET_SCOPE_AT_INDEX;
 		writeInt32(out, totalScopeStackLen);
 		return BINDED;
@@ -198,10 +203,10 @@ EARLY_BIND_STATUS ABCVm::earlyBindForScopeStack(ostream& out, const SyntheticFun
 }
 
 InferenceData ABCVm::earlyBindFindPropStrict(ostream& out, const SyntheticFunction* f,
-		const std::vector<InferenceData>& scopeStack, const multiname* name)
+		const std::vector<InferenceData>& scopeStack, const multiname* name, bool& hasPointers)
 {
 	InferenceData ret;
-	EARLY_BIND_STATUS status=earlyBindForScopeStack(out, f, scopeStack, name, ret);
+	EARLY_BIND_STATUS status=earlyBindForScopeStack(out, f, scopeStack, name, ret, hasPointers);
 	if(status==BINDED || status==CANNOT_BIND)
 		return ret;
 	//Look on the application domain
@@ -212,7 +217,7 @@ InferenceData ABCVm::earlyBindFindPropStrict(ostream& out, const SyntheticFuncti
 		//If we found the property on the application domain we can safely use the target verbatim
 		std::cerr << "OPT EARLY" << *name << std::endl;
 		out << (uint8_t)PUSH_EARLY;
-		writePtr(out, target);
+		writePtr(out, target, hasPointers);
 		ret.obj=target;
 		return ret;
 	}
@@ -220,10 +225,10 @@ InferenceData ABCVm::earlyBindFindPropStrict(ostream& out, const SyntheticFuncti
 }
 
 InferenceData ABCVm::earlyBindGetLex(ostream& out, const SyntheticFunction* f, const std::vector<InferenceData>& scopeStack,
-		const multiname* name, uint32_t nameIndex)
+		const multiname* name, uint32_t nameIndex, bool& hasPointers)
 {
 	InferenceData ret;
-	EARLY_BIND_STATUS status=earlyBindForScopeStack(out, f, scopeStack, name, ret);
+	EARLY_BIND_STATUS status=earlyBindForScopeStack(out, f, scopeStack, name, ret, hasPointers);
 	if(status==BINDED)
 	{
 		//Synthetize a getProperty here
@@ -244,7 +249,7 @@ InferenceData ABCVm::earlyBindGetLex(ostream& out, const SyntheticFunction* f, c
 	{
 		//Output a special opcode
 		out << (uint8_t)PUSH_EARLY;
-		writePtr(out, o);
+		writePtr(out, o, hasPointers);
 		ret.obj=o;
 		return ret;
 	}
@@ -256,7 +261,7 @@ InferenceData ABCVm::earlyBindGetLex(ostream& out, const SyntheticFunction* f, c
 	{
 		out << (uint8_t)GET_LEX_ONCE;
 		//Write directly the multiname pointer
-		writePtr(out, name);
+		writePtr(out, name, hasPointers);
 		//We need to set the returned InferenceData to a valid state
 		ret.type=Type::anyType;
 		return ret;
@@ -284,8 +289,9 @@ void ABCVm::writeDouble(std::ostream& o, double val)
 	o.write((char*)&val, 8);
 }
 
-void ABCVm::writePtr(std::ostream& o, const void* val)
+void ABCVm::writePtr(std::ostream& o, const void* val, bool& hasPointers)
 {
+	hasPointers=true;
 	o.write((char*)&val, 8);
 }
 
@@ -335,7 +341,24 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 {
 	method_info* mi=function->mi;
 	SystemState* sys = function->getSystemState();
-	
+
+	const std::string& cacheKey=mi->context->codeCacheKey;
+	const uint32_t methodIndex=mi-&mi->context->methods[0];
+	if(!cacheKey.empty())
+	{
+		string cachedCode;
+		if(CodeCache::load(cacheKey, methodIndex, mi->body->code, cachedCode, mi->body->exceptions))
+		{
+			mi->body->originalCode.swap(mi->body->code);
+			mi->body->code.swap(cachedCode);
+			mi->body->codeStatus = method_body_info::OPTIMIZED;
+			return;
+		}
+	}
+	//Set when the optimized code references runtime objects, or was specialized using
+	//the state of this run, and can't be cached on disk
+	bool codeHasPointers=false;
+
 	ActivationType activationType(mi);
 
 	istringstream code(mi->body->code);
@@ -1139,7 +1162,7 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				{
 					//Attempt early binding
 					const multiname* name=mi->context->getMultiname(t,NULL);
-					inferredData=earlyBindFindPropStrict(out, function, curBlock->scopeStackTypes, name);
+					inferredData=earlyBindFindPropStrict(out, function, curBlock->scopeStackTypes, name, codeHasPointers);
 				}
 
 				curBlock->popStack(numRT);
@@ -1179,7 +1202,7 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				//Only methods can be early binded, anonymous functions do
 				//not have a fixed function scope stack
 				if(function->isMethod())
-					inferredData=earlyBindGetLex(out, function, curBlock->scopeStackTypes, name, t);
+					inferredData=earlyBindGetLex(out, function, curBlock->scopeStackTypes, name, t, codeHasPointers);
 				if(!inferredData.isValid())
 				{
 					//Early binding failed, use normal translation
@@ -1316,7 +1339,8 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 							if(valueData.isOfType(c))
 							{
 								//We know the value is already of the right type
-								//Let's skip coercion
+								//Let's skip coercion. The class may come from another ABC block
+								codeHasPointers=true;
 								out << (uint8_t)SET_SLOT_NO_COERCE;
 								writeInt32(out,t);
 								break;
@@ -1426,7 +1450,7 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				//Translate coerce to a rewriting opcode
 				//The pointer to the multiname will become the pointer to
 				//the type after the first execution
-				writePtr(out,name);
+				writePtr(out,name,codeHasPointers);
 				curBlock->popStack(1);
 				curBlock->pushStack(inferredData);
 				break;
@@ -1746,6 +1770,10 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 		}
 	}
 	//Overwrite the old code
+	mi->body->originalCode.swap(mi->body->code);
 	mi->body->code=out.str();
 	mi->body->codeStatus = method_body_info::OPTIMIZED;
+
+	if(!cacheKey.empty() && !codeHasPointers)
+		CodeCache::store(cacheKey, methodIndex, mi->body->originalCode, mi->body->code, mi->body->exceptions);
 }
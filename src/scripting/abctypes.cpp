@@ -160,6 +160,8 @@ istream& lightspark::operator>>(istream& in, method_info_simple& v)
 	return in;
 }
 
+ACQUIRE_RELEASE_VARIABLE(uint32_t, inline_cache::generation);
+
 istream& lightspark::operator>>(istream& in, method_body_info& v)
 {
 	u30 code_length;
@@ -167,6 +169,7 @@ istream& lightspark::operator>>(istream& in, method_body_info& v)
 	v.code.resize(code_length);
 	in.read(&v.code[0],code_length);
 	v.codecache = new method_body_info_cache[code_length];
+	v.codecache_len = code_length;
 	memset(v.codecache,0,code_length*sizeof(method_body_info_cache));
 	u30 exception_count;
 	in >> exception_count;
@@ -372,8 +375,21 @@ istream& lightspark::operator>>(istream& in, cpool_info& v)
 
 	in >> v.string_count;
 	v.strings.resize(v.string_count);
-	for(unsigned int i=1;i<v.string_count;i++)
-		in >> v.strings[i];
+	if(v.string_count>1)
+	{
+		//Read all the strings first, so that they are interned in one pass
+		vector<tiny_string> strings(v.string_count-1);
+		vector<uint32_t> ids(v.string_count-1);
+		for(unsigned int i=1;i<v.string_count;i++)
+		{
+			u30 size;
+			in >> size;
+			strings[i-1]=tiny_string(in,size);
+		}
+		getSys()->getUniqueStringIds(&strings[0],strings.size(),&ids[0]);
+		for(unsigned int i=1;i<v.string_count;i++)
+			v.strings[i].val=ids[i-1];
+	}
 
 	in >> v.namespace_count;
 	v.namespaces.resize(v.namespace_count);
@@ -92,9 +92,11 @@ public:
 	operator double(){return val;}
 };
 
+struct cpool_info;
 class string_info
 {
 friend std::istream& operator>>(std::istream& in, string_info& v);
+friend std::istream& operator>>(std::istream& in, cpool_info& v);
 private:
 	uint32_t val;
 public:
@@ -259,6 +261,67 @@ struct method_info_simple
 	std::vector<option_detail> options;
 	std::vector<u30> param_names;
 };
+
+class Class_base;
+class variables_shape;
+struct variable;
+
+#define INLINE_CACHE_SIZE 4
+
+struct inline_cache_entry
+{
+	const Class_base* cls;
+	const variables_shape* shape;
+	//The variable borrowed from the class, NULL if the property is stored inline
+	variable* var;
+	//Position of the property in the inline traits of the receiver
+	uint32_t pos;
+};
+
+/*
+ * Polymorphic inline cache for the property access opcodes, keyed on the class
+ * and the shape of the receiver. It is allocated on the first execution of the
+ * instruction. All caches are invalidated at once when the traits of a class change.
+ */
+struct inline_cache
+{
+	static ACQUIRE_RELEASE_VARIABLE(uint32_t, generation);
+	uint32_t cacheGeneration;
+	uint32_t count;
+	inline_cache_entry entries[INLINE_CACHE_SIZE];
+	inline_cache():cacheGeneration(generation),count(0){}
+	inline const inline_cache_entry* find(const Class_base* cls, const variables_shape* shape)
+	{
+		if(cacheGeneration!=generation)
+		{
+			cacheGeneration=generation;
+			count=0;
+			return NULL;
+		}
+		for(uint32_t i=0;i<count;i++)
+		{
+			if(entries[i].cls==cls && entries[i].shape==shape)
+				return &entries[i];
+		}
+		return NULL;
+	}
+	inline void add(const inline_cache_entry& e)
+	{
+		if(cacheGeneration!=generation)
+		{
+			cacheGeneration=generation;
+			count=0;
+		}
+		//Megamorphic sites keep the receivers they have seen first
+		if(count<INLINE_CACHE_SIZE)
+			entries[count++]=e;
+	}
+	static void invalidateAll()
+	{
+		++generation;
+	}
+};
+
 struct method_body_info_cache
 {
 	enum method_body_info_cache_type { CACHE_TYPE_NONE = 0,CACHE_TYPE_UINTEGER,CACHE_TYPE_INTEGER, CACHE_TYPE_OBJECT };
@@ -271,27 +334,38 @@ struct method_body_info_cache
 	ASObject* closure;
 	const char* nextcodepos;
 	struct method_body_info_cache* nextcachepos;
+	inline_cache* ic;
 };
 
 struct method_body_info
 {
-	method_body_info():hit_count(0),codeStatus(ORIGINAL){}
-	~method_body_info() { delete[] codecache; }
+	method_body_info():hit_count(0),codeStatus(ORIGINAL),codecache(NULL),codecache_len(0){}
+	~method_body_info()
+	{
+		for(unsigned int i=0;i<codecache_len;i++)
+			delete codecache[i].ic;
+		delete[] codecache;
+	}
 	u30 method;
 	u30 max_stack;
 	u30 local_count;
 	u30 init_scope_depth;
 	u30 max_scope_depth;
 	std::string code;
+	//The ABC bytecode, kept for the JIT after the optimizer replaces code
+	std::string originalCode;
+	const std::string& getABCCode() const { return originalCode.empty()?code:originalCode; }
 	std::vector<exception_info_abc> exceptions;
 	u30 trait_count;
 	std::vector<traits_info> traits;
 	//The hit_count belongs here, since it is used to manipulate the code
-	uint16_t hit_count;
+	uint32_t hit_count;
 	//The code status
 	enum CODE_STATUS { ORIGINAL = 0, USED, OPTIMIZED, JITTED, PRELOADED };
 	CODE_STATUS codeStatus;
 	method_body_info_cache* codecache;
+	//The optimizer replaces the code, so the size of the cache is kept separately
+	uint32_t codecache_len;
 };
 
 std::istream& operator>>(std::istream& in, u8& v);
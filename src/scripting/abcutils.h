@@ -31,6 +31,7 @@ class ABCContext;
 class ASObject;
 class Class_base;
 class asAtom;
+class ApplicationDomain;
 
 struct scope_entry
 {
@@ -74,6 +75,10 @@ struct call_context
 	 * Defaults to empty string according to ECMA-357 13.1.1.1
 	 */
 	uint32_t defaultNamespaceUri;
+	/* The application domain whose domain memory is used by the alchemy opcodes.
+	 * It is looked up on first use, see ABCVm::getDomainMemoryDomain
+	 */
+	ApplicationDomain* domainMemoryDomain;
 	asAtom returnvalue;
 	bool returning;
 	~call_context();
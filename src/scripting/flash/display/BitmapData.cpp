@@ -184,6 +184,12 @@ void BitmapData::drawDisplayObject(DisplayObject* d, const MATRIX& initialMatrix
 		surface.tex.height=drawable->getHeight();
 		surface.xOffset=drawable->getXOffset();
 		surface.yOffset=drawable->getYOffset();
+		//Only the alpha of the objects below d is applied, the alpha of
+		//d itself is up to whoever uses the result
+		float alpha=1.0;
+		for(DisplayObject* cur=target;cur && cur!=d;cur=cur->getParent().getPtr())
+			alpha*=cur->clippedAlpha();
+		surface.alpha=alpha;
 		delete drawable;
 	}
 	d->Render(ctxt);
@@ -670,12 +676,8 @@ ASFUNCTIONBODY(BitmapData,getVector)
 
 	Vector *result = Template<Vector>::getInstanceS(obj->getSystemState(),Class<UInteger>::getClass(obj->getSystemState()),NullRef).as<Vector>();
 	vector<uint32_t> pixelvec = th->pixels->getPixelVector(rect->getRect());
-	vector<uint32_t>::const_iterator it;
-	for (it=pixelvec.begin(); it!=pixelvec.end(); ++it)
-	{
-		asAtom v(*it);
-		result->append(v);
-	}
+	if (!pixelvec.empty())
+		result->appendUInts(&pixelvec[0],pixelvec.size());
 	return result;
 }
 
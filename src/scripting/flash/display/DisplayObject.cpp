@@ -93,11 +93,15 @@ void DisplayObject::Render(RenderContext& ctxt)
 	if(!isConstructed() || skipRender())
 		return;
 
-	renderImpl(ctxt);
+	//A subtree cached as bitmap is drawn at once from its retained surface
+	if(ctxt.contextType==RenderContext::GL && isRetainedSurfaceActive())
+		defaultRender(ctxt);
+	else
+		renderImpl(ctxt);
 }
 
 DisplayObject::DisplayObject(Class_base* c):EventDispatcher(c),matrix(Class<Matrix>::getInstanceS(c->getSystemState())),tx(0),ty(0),rotation(0),
-	sx(1),sy(1),alpha(1.0),isLoadedRoot(false),maskOf(),parent(),constructed(false),useLegacyMatrix(true),onStage(false),
+	sx(1),sy(1),alpha(1.0),isLoadedRoot(false),maskOf(),parent(),constructed(false),hitBoundsDirty(true),useLegacyMatrix(true),onStage(false),
 	visible(true),mask(),invalidateQueueNext(),loaderInfo(),filters(Class<Array>::getInstanceSNoArgs(c->getSystemState())),hasChanged(true),cacheAsBitmap(false)
 {
 	subtype=SUBTYPE_DISPLAYOBJECT;
@@ -181,8 +185,8 @@ void DisplayObject::sinit(Class_base* c)
 
 ASFUNCTIONBODY_GETTER_SETTER(DisplayObject,accessibilityProperties);
 //TODO: Use a callback for the cacheAsBitmap getter, since it should use computeCacheAsBitmap
-ASFUNCTIONBODY_GETTER_SETTER(DisplayObject,cacheAsBitmap);
-ASFUNCTIONBODY_GETTER_SETTER(DisplayObject,filters);
+ASFUNCTIONBODY_GETTER_SETTER_CB(DisplayObject,cacheAsBitmap,onCacheAsBitmap);
+ASFUNCTIONBODY_GETTER_SETTER_CB(DisplayObject,filters,onFilters);
 ASFUNCTIONBODY_GETTER_SETTER(DisplayObject,scrollRect);
 ASFUNCTIONBODY_GETTER_SETTER_NOT_IMPLEMENTED(DisplayObject, rotationX);
 ASFUNCTIONBODY_GETTER_SETTER_NOT_IMPLEMENTED(DisplayObject, rotationY);
@@ -192,6 +196,191 @@ bool DisplayObject::computeCacheAsBitmap() const
 	return cacheAsBitmap || (!filters.isNull() && filters->size()!=0);
 }
 
+bool DisplayObject::hasRetainedSurface() const
+{
+	//Masks are drawn in software by the object they mask and masked objects
+	//need the mask applied to every child
+	return computeCacheAsBitmap() && is<DisplayObjectContainer>() && !is<Stage>() &&
+		mask.isNull() && maskOf.isNull();
+}
+
+DisplayObject* DisplayObject::getRetainedSurfaceRoot()
+{
+	DisplayObject* ret=NULL;
+	for(DisplayObject* cur=this;cur;cur=cur->parent.getPtr())
+	{
+		if(cur->hasRetainedSurface())
+			ret=cur;
+	}
+	return ret;
+}
+
+DisplayObject* DisplayObject::markRetainedSurfaceDirty()
+{
+	DisplayObject* root=getRetainedSurfaceRoot();
+	if(root)
+	{
+		SpinlockLocker locker(root->spinlock);
+		root->retainedSurface.valid=false;
+	}
+	return root;
+}
+
+void DisplayObject::invalidateRetainedSurface()
+{
+	DisplayObject* root=markRetainedSurfaceDirty();
+	if(root==NULL)
+		return;
+	root->hasChanged=true;
+	if(root->onStage)
+		root->requestInvalidation(getSystemState());
+}
+
+void DisplayObject::invalidateHitBounds()
+{
+	getSystemState()->invalidateHitTests();
+	//Bounds of all the ancestors may change as well. The flags are cleared
+	//independently by the hit tests, so the whole chain must be marked
+	DisplayObject* cur=this;
+	while(true)
+	{
+		RELEASE_WRITE(cur->hitBoundsDirty,true);
+		DisplayObjectContainer* p=cur->parent.getPtr();
+		if(p==NULL)
+			break;
+		p->markHitTestIndexDirty();
+		cur=p;
+	}
+}
+
+void DisplayObject::resetRetainedSurface()
+{
+	{
+		SpinlockLocker locker(spinlock);
+		retainedSurface.active=false;
+		retainedSurface.valid=false;
+	}
+	//The subtree cached as bitmap containing this object must be drawn again as well
+	if(parent)
+		parent->invalidateRetainedSurface();
+	hasChanged=true;
+	if(onStage)
+		requestInvalidation(getSystemState());
+}
+
+void DisplayObject::onCacheAsBitmap(bool oldValue)
+{
+	if(oldValue!=cacheAsBitmap)
+		resetRetainedSurface();
+}
+
+void DisplayObject::onFilters(_NR<Array> oldValue)
+{
+	//Filters are not drawn yet, but they imply cacheAsBitmap
+	bool oldCache=cacheAsBitmap || (!oldValue.isNull() && oldValue->size()!=0);
+	if(oldCache!=computeCacheAsBitmap())
+		resetRetainedSurface();
+}
+
+bool DisplayObject::isRetainedSurfaceActive() const
+{
+	SpinlockLocker locker(spinlock);
+	return retainedSurface.active;
+}
+
+void DisplayObject::applyRetainedSurfacePosition(CachedSurface& surface) const
+{
+	SpinlockLocker locker(spinlock);
+	if(!retainedSurface.active)
+		return;
+	surface.xOffset=retainedSurface.xOffset;
+	surface.yOffset=retainedSurface.yOffset;
+	surface.alpha=retainedSurface.alpha;
+}
+
+IDrawable* DisplayObject::updateRetainedSurface(DisplayObject* target)
+{
+	MATRIX totalMatrix;
+	for(const DisplayObject* cur=this;cur && cur!=target;cur=cur->getParent().getPtr())
+		totalMatrix=cur->getMatrix().multiplyMatrix(totalMatrix);
+	float a=getConcatenatedAlpha();
+	bool moved=false;
+	{
+		SpinlockLocker locker(spinlock);
+		if(retainedSurface.active && retainedSurface.valid &&
+			totalMatrix.xx==retainedSurface.matrix.xx && totalMatrix.yx==retainedSurface.matrix.yx &&
+			totalMatrix.xy==retainedSurface.matrix.xy && totalMatrix.yy==retainedSurface.matrix.yy)
+		{
+			//Only translated, the pixels can be reused as they are
+			retainedSurface.xOffset=retainedSurface.rasterX+round(totalMatrix.x0-retainedSurface.matrix.x0);
+			retainedSurface.yOffset=retainedSurface.rasterY+round(totalMatrix.y0-retainedSurface.matrix.y0);
+			retainedSurface.alpha=a;
+			moved=true;
+		}
+	}
+	if(moved)
+	{
+		this->incRef();
+		getSystemState()->getRenderThread()->addUploadJob(new RetainedSurfaceMoveJob(_MR(this)));
+		return NULL;
+	}
+
+	number_t xmin,xmax,ymin,ymax;
+	int32_t x=0,y=0,width=0,height=0;
+	if(getBounds(xmin,xmax,ymin,ymax,totalMatrix))
+	{
+		x=floor(xmin);
+		y=floor(ymin);
+		width=ceil(xmax)-x;
+		height=ceil(ymax)-y;
+	}
+	bool clipped=false;
+	if(width>RETAINED_SURFACE_MAX_SIZE || height>RETAINED_SURFACE_MAX_SIZE)
+	{
+		//Only keep the visible part of huge subtrees, it can't be moved around
+		RenderThread* rt=getSystemState()->getRenderThread();
+		int32_t x2=imin(x+width,rt->windowWidth);
+		int32_t y2=imin(y+height,rt->windowHeight);
+		x=imax(x,0);
+		y=imax(y,0);
+		width=imin(x2-x,RETAINED_SURFACE_MAX_SIZE);
+		height=imin(y2-y,RETAINED_SURFACE_MAX_SIZE);
+		clipped=true;
+	}
+	if(width<=0 || height<=0)
+	{
+		//Nothing to show, stop drawing the previous surface
+		SpinlockLocker locker(spinlock);
+		retainedSurface.active=false;
+		return NULL;
+	}
+
+	//Rasterize the whole subtree, the translation only compensates for the offset
+	_R<BitmapData> data(Class<BitmapData>::getInstanceS(getSystemState(),width,height));
+	MATRIX rasterMatrix=totalMatrix;
+	rasterMatrix.x0-=x;
+	rasterMatrix.y0-=y;
+	data->drawDisplayObject(this, rasterMatrix);
+	_R<Bitmap> bmp(Class<Bitmap>::getInstanceS(getSystemState(),data));
+
+	//The masks of the parents are applied to the surface
+	MATRIX unused;
+	std::vector<IDrawable::MaskData> masks;
+	computeMasksAndMatrix(target,masks,unused);
+	{
+		SpinlockLocker locker(spinlock);
+		retainedSurface.matrix=totalMatrix;
+		retainedSurface.rasterX=retainedSurface.xOffset=x;
+		retainedSurface.rasterY=retainedSurface.yOffset=y;
+		retainedSurface.alpha=a;
+		retainedSurface.active=true;
+		//Pixels clipped by the window or by masks must be rasterized again when moved
+		retainedSurface.valid=!clipped && masks.empty();
+	}
+	return new CairoTokenRenderer(bmp->tokens, MATRIX(1,1,0,0,x,y), x, y, width, height,
+			bmp->scaling, a, masks);
+}
+
 ASFUNCTIONBODY(DisplayObject,_getTransform)
 {
 	DisplayObject* th=static_cast<DisplayObject*>(obj);
@@ -208,7 +397,7 @@ ASFUNCTIONBODY(DisplayObject,_setTransform)
 	if (!trans.isNull())
 	{
 		th->setMatrix(trans->owner->matrix);
-		th->colorTransform = trans->owner->colorTransform;
+		th->setColorTransform(trans->owner->colorTransform);
 	}
 	return NULL;
 }
@@ -268,14 +457,32 @@ void DisplayObject::setLegacyMatrix(const lightspark::MATRIX& m)
 	}
 }
 
+void DisplayObject::setColorTransform(_NR<ColorTransform> ct)
+{
+	colorTransform=ct;
+	//The alpha depends on the color transform, and so do the pixels of
+	//a subtree cached as bitmap containing this object
+	invalidateRetainedSurface();
+	if(onStage)
+	{
+		hasChanged=true;
+		requestInvalidation(getSystemState());
+	}
+}
+
 void DisplayObject::becomeMaskOf(_NR<DisplayObject> m)
 {
+	bool retained=hasRetainedSurface();
 	maskOf=m;
+	//Masks can't be retained, stop drawing the old surface
+	if(retained!=hasRetainedSurface())
+		resetRetainedSurface();
 }
 
 void DisplayObject::setMask(_NR<DisplayObject> m)
 {
 	bool mustInvalidate=(mask!=m) && onStage;
+	bool retained=hasRetainedSurface();
 
 	if(!mask.isNull())
 	{
@@ -291,6 +498,10 @@ void DisplayObject::setMask(_NR<DisplayObject> m)
 		mask->becomeMaskOf(_MR(this));
 	}
 
+	//Masked objects can't be retained, stop drawing the old surface
+	if(retained!=hasRetainedSurface())
+		resetRetainedSurface();
+
 	if(mustInvalidate && onStage)
 	{
 		hasChanged=true;
@@ -421,6 +632,8 @@ IDrawable* DisplayObject::invalidate(DisplayObject* target, const MATRIX& initia
 
 void DisplayObject::requestInvalidation(InvalidateQueue* q)
 {
+	if(q==getSystemState())
+		invalidateHitBounds();
 	//Let's invalidate also the mask
 	if(!mask.isNull())
 		mask->requestInvalidation(q);
@@ -448,6 +661,11 @@ void DisplayObject::setOnStage(bool staged)
 		onStage=staged;
 		if(staged==true)
 		{
+			//The subtree may have changed while it was not on the stage
+			{
+				SpinlockLocker locker(spinlock);
+				retainedSurface.valid=false;
+			}
 			hasChanged=true;
 			requestInvalidation(getSystemState());
 		}
@@ -949,7 +1167,15 @@ ASFUNCTIONBODY(DisplayObject,_setVisible)
 {
 	DisplayObject* th=static_cast<DisplayObject*>(obj);
 	assert_and_throw(argslen==1);
-	th->visible=Boolean_concrete(args[0]);
+	bool visible=Boolean_concrete(args[0]);
+	if(th->visible!=visible)
+	{
+		th->visible=visible;
+		//A subtree cached as bitmap containing this object must be drawn again
+		th->invalidateRetainedSurface();
+		//Cached mouse targets may have become hidden
+		obj->getSystemState()->invalidateHitTests();
+	}
 	return NULL;
 }
 
@@ -41,7 +41,9 @@ class DisplayObject: public EventDispatcher, public IBitmapDrawable
 friend class TokenContainer;
 friend class GLRenderContext;
 friend class AsyncDrawJob;
+friend class RetainedSurfaceMoveJob;
 friend class Transform;
+friend class DisplayObjectContainer;
 friend class ParseThread;
 friend class Loader;
 friend std::ostream& operator<<(std::ostream& s, const DisplayObject& r);
@@ -77,12 +79,24 @@ private:
 	 * It is the cached version of the object for fast draw on the Stage
 	 */
 	CachedSurface cachedSurface;
+	/* State of the retained surface when this is the root of a subtree cached as bitmap.
+	 * It is protected by spinlock, since the render thread reads the position
+	 */
+	RetainedSurface retainedSurface;
+	bool isRetainedSurfaceActive() const;
+	/* Called when the object starts or stops being cached as bitmap */
+	void resetRetainedSurface();
+	void applyRetainedSurfacePosition(CachedSurface& surface) const;
 	/*
 	 * Utility function to set internal MATRIX
 	 * Also used by Transform
 	 */
 	void setMatrix(_NR<Matrix> m);
 	ACQUIRE_RELEASE_FLAG(constructed);
+	/* Set when the bounds of this object in its parent may have changed, the parent
+	 * refreshes them in its hit test index and clears the flag from the input thread
+	 */
+	ACQUIRE_RELEASE_FLAG(hitBoundsDirty);
 	bool useLegacyMatrix;
 	void gatherMaskIDrawables(std::vector<IDrawable::MaskData>& masks) const;
 protected:
@@ -119,9 +133,16 @@ protected:
 	{
 		throw RunTimeException("DisplayObject::hitTestImpl: Derived class must implement this!");
 	}
+	/*
+	 * False if hitTestImpl may hit points outside of boundsRect, such objects
+	 * are always tested by the hit test index of the parent
+	 */
+	virtual bool boundsContainHitArea() const { return true; }
 
 public:
 	void constructionComplete();
+	void onCacheAsBitmap(bool oldValue);
+	void onFilters(_NR<Array> oldValue);
 	tiny_string name;
 	_NR<DisplayObject> invalidateQueueNext;
 	_NR<LoaderInfo> loaderInfo;
@@ -134,6 +155,35 @@ public:
 	 * cacheAsBitmap is true also if any filter is used
 	 */
 	bool computeCacheAsBitmap() const;
+	/**
+	 * True if this object and its whole subtree are drawn from a single retained surface
+	 */
+	bool hasRetainedSurface() const;
+	/**
+	 * The outermost object with a retained surface that contains this one, if any
+	 */
+	DisplayObject* getRetainedSurfaceRoot();
+	/**
+	 * Signals that the contents of the subtree cached as bitmap containing this object changed
+	 * and returns its root. It is safe to call while the invalidation queue is flushed, but
+	 * the root must be invalidated as well
+	 */
+	DisplayObject* markRetainedSurfaceDirty();
+	/**
+	 * Like markRetainedSurfaceDirty, but also requests the invalidation of the root
+	 */
+	void invalidateRetainedSurface();
+	/**
+	 * Used instead of invalidate for objects with a retained surface. If only the translation
+	 * changed the surface is moved and NULL is returned, otherwise an IDrawable for the
+	 * whole subtree is generated
+	 */
+	IDrawable* updateRetainedSurface(DisplayObject* target);
+	/**
+	 * Signals that the area hit by this object may have changed. The object and all its
+	 * ancestors are marked for an update of the hit test indexes. It does not lock
+	 */
+	void invalidateHitBounds();
 	void computeMasksAndMatrix(DisplayObject* target, std::vector<IDrawable::MaskData>& masks,MATRIX& totalMatrix) const;
 	ASPROPERTY_GETTER_SETTER(bool,cacheAsBitmap);
 	_NR<DisplayObjectContainer> getParent() const { return parent; }
@@ -173,6 +223,7 @@ public:
 	virtual _NR<RootMovieClip> getRoot();
 	virtual _NR<Stage> getStage();
 	void setLegacyMatrix(const MATRIX& m);
+	void setColorTransform(_NR<ColorTransform> ct);
 	virtual void advanceFrame() {}
 	virtual void initFrame();
 	Vector2f getLocalMousePos();
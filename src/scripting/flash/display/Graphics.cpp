@@ -69,7 +69,7 @@ void Graphics::checkAndSetScaling()
 	if(owner->scaling != 1.0f)
 	{
 		owner->scaling = 1.0f;
-		owner->tokens.clear();
+		owner->clearTokens();
 	}
 }
 
@@ -82,7 +82,7 @@ ASFUNCTIONBODY(Graphics,clear)
 {
 	Graphics* th=static_cast<Graphics*>(obj);
 	th->checkAndSetScaling();
-	th->owner->tokens.clear();
+	th->owner->clearTokens();
 	th->owner->owner->hasChanged=true;
 	th->owner->owner->requestInvalidation(obj->getSystemState());
 	return NULL;
@@ -97,7 +97,7 @@ ASFUNCTIONBODY(Graphics,moveTo)
 	int32_t x=args[0]->toInt();
 	int32_t y=args[1]->toInt();
 
-	th->owner->tokens.emplace_back(GeomToken(MOVE, Vector2(x, y)));
+	th->owner->getWritableTokens().emplace_back(GeomToken(MOVE, Vector2(x, y)));
 	return NULL;
 }
 
@@ -110,7 +110,7 @@ ASFUNCTIONBODY(Graphics,lineTo)
 	int x=args[0]->toInt();
 	int y=args[1]->toInt();
 
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, Vector2(x, y)));
+	th->owner->getWritableTokens().emplace_back(GeomToken(STRAIGHT, Vector2(x, y)));
 	th->owner->owner->hasChanged=true;
 	th->owner->owner->requestInvalidation(obj->getSystemState());
 
@@ -129,7 +129,7 @@ ASFUNCTIONBODY(Graphics,curveTo)
 	int anchorX=args[2]->toInt();
 	int anchorY=args[3]->toInt();
 
-	th->owner->tokens.emplace_back(GeomToken(CURVE_QUADRATIC,
+	th->owner->getWritableTokens().emplace_back(GeomToken(CURVE_QUADRATIC,
 	                        Vector2(controlX, controlY),
 	                        Vector2(anchorX, anchorY)));
 	th->owner->owner->hasChanged=true;
@@ -153,7 +153,7 @@ ASFUNCTIONBODY(Graphics,cubicCurveTo)
 	int anchorX=args[4]->toInt();
 	int anchorY=args[5]->toInt();
 
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	th->owner->getWritableTokens().emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(control1X, control1Y),
 	                        Vector2(control2X, control2Y),
 	                        Vector2(anchorX, anchorY)));
@@ -208,44 +208,46 @@ ASFUNCTIONBODY(Graphics,drawRoundRect)
 	 * Flash starts and stops the pen at 'D', so we will too.
 	 */
 
+	//Taken after converting the arguments, since valueOf may clear the graphics
+	tokensVector& t=th->owner->getWritableTokens();
 	// D
-	th->owner->tokens.emplace_back(GeomToken(MOVE, Vector2(x+width, y+height-ellipseHeight)));
+	t.emplace_back(GeomToken(MOVE, Vector2(x+width, y+height-ellipseHeight)));
 
 	// D -> E
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(x+width, y+height-ellipseHeight+kappaH),
 	                        Vector2(x+width-ellipseWidth+kappaW, y+height),
 	                        Vector2(x+width-ellipseWidth, y+height)));
 
 	// E -> F
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, Vector2(x+ellipseWidth, y+height)));
+	t.emplace_back(GeomToken(STRAIGHT, Vector2(x+ellipseWidth, y+height)));
 
 	// F -> G
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(x+ellipseWidth-kappaW, y+height),
 	                        Vector2(x, y+height-kappaH),
 	                        Vector2(x, y+height-ellipseHeight)));
 
 	// G -> H
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, Vector2(x, y+ellipseHeight)));
+	t.emplace_back(GeomToken(STRAIGHT, Vector2(x, y+ellipseHeight)));
 
 	// H -> A
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(x, y+ellipseHeight-kappaH),
 	                        Vector2(x+ellipseWidth-kappaW, y),
 	                        Vector2(x+ellipseWidth, y)));
 
 	// A -> B
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, Vector2(x+width-ellipseWidth, y)));
+	t.emplace_back(GeomToken(STRAIGHT, Vector2(x+width-ellipseWidth, y)));
 
 	// B -> C
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(x+width-ellipseWidth+kappaW, y),
 	                        Vector2(x+width, y+kappaH),
 	                        Vector2(x+width, y+ellipseHeight)));
 
 	// C -> D
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, Vector2(x+width, y+height-ellipseHeight)));
+	t.emplace_back(GeomToken(STRAIGHT, Vector2(x+width, y+height-ellipseHeight)));
 
 	th->owner->owner->hasChanged=true;
 	th->owner->owner->requestInvalidation(obj->getSystemState());
@@ -270,11 +272,12 @@ ASFUNCTIONBODY(Graphics,drawRoundRectComplex)
 	const Vector2 c(x+width,y+height);
 	const Vector2 d(x,y+height);
 
-	th->owner->tokens.emplace_back(GeomToken(MOVE, a));
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, b));
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, c));
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, d));
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, a));
+	tokensVector& t=th->owner->getWritableTokens();
+	t.emplace_back(GeomToken(MOVE, a));
+	t.emplace_back(GeomToken(STRAIGHT, b));
+	t.emplace_back(GeomToken(STRAIGHT, c));
+	t.emplace_back(GeomToken(STRAIGHT, d));
+	t.emplace_back(GeomToken(STRAIGHT, a));
 	th->owner->owner->hasChanged=true;
 	th->owner->owner->requestInvalidation(obj->getSystemState());
 	
@@ -293,29 +296,30 @@ ASFUNCTIONBODY(Graphics,drawCircle)
 
 	double kappa = KAPPA*radius;
 
+	tokensVector& t=th->owner->getWritableTokens();
 	// right
-	th->owner->tokens.emplace_back(GeomToken(MOVE, Vector2(x+radius, y)));
+	t.emplace_back(GeomToken(MOVE, Vector2(x+radius, y)));
 
 	// bottom
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(x+radius, y+kappa ),
 	                        Vector2(x+kappa , y+radius),
 	                        Vector2(x       , y+radius)));
 
 	// left
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(x-kappa , y+radius),
 	                        Vector2(x-radius, y+kappa ),
 	                        Vector2(x-radius, y       )));
 
 	// top
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(x-radius, y-kappa ),
 	                        Vector2(x-kappa , y-radius),
 	                        Vector2(x       , y-radius)));
 
 	// back to right
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(x+kappa , y-radius),
 	                        Vector2(x+radius, y-kappa ),
 	                        Vector2(x+radius, y       )));
@@ -340,29 +344,30 @@ ASFUNCTIONBODY(Graphics,drawEllipse)
 	double xkappa = KAPPA*width/2;
 	double ykappa = KAPPA*height/2;
 
+	tokensVector& t=th->owner->getWritableTokens();
 	// right
-	th->owner->tokens.emplace_back(GeomToken(MOVE, Vector2(left+width, top+height/2)));
+	t.emplace_back(GeomToken(MOVE, Vector2(left+width, top+height/2)));
 	
 	// bottom
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(left+width , top+height/2+ykappa),
 	                        Vector2(left+width/2+xkappa, top+height),
 	                        Vector2(left+width/2, top+height)));
 
 	// left
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(left+width/2-xkappa, top+height),
 	                        Vector2(left, top+height/2+ykappa),
 	                        Vector2(left, top+height/2)));
 
 	// top
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(left, top+height/2-ykappa),
 	                        Vector2(left+width/2-xkappa, top),
 	                        Vector2(left+width/2, top)));
 
 	// back to right
-	th->owner->tokens.emplace_back(GeomToken(CURVE_CUBIC,
+	t.emplace_back(GeomToken(CURVE_CUBIC,
 	                        Vector2(left+width/2+xkappa, top),
 	                        Vector2(left+width, top+height/2-ykappa),
 	                        Vector2(left+width, top+height/2)));
@@ -389,11 +394,12 @@ ASFUNCTIONBODY(Graphics,drawRect)
 	const Vector2 c(x+width,y+height);
 	const Vector2 d(x,y+height);
 
-	th->owner->tokens.emplace_back(GeomToken(MOVE, a));
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, b));
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, c));
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, d));
-	th->owner->tokens.emplace_back(GeomToken(STRAIGHT, a));
+	tokensVector& t=th->owner->getWritableTokens();
+	t.emplace_back(GeomToken(MOVE, a));
+	t.emplace_back(GeomToken(STRAIGHT, b));
+	t.emplace_back(GeomToken(STRAIGHT, c));
+	t.emplace_back(GeomToken(STRAIGHT, d));
+	t.emplace_back(GeomToken(STRAIGHT, a));
 	th->owner->owner->hasChanged=true;
 	th->owner->owner->requestInvalidation(obj->getSystemState());
 	
@@ -413,7 +419,7 @@ ASFUNCTIONBODY(Graphics,drawPath)
 	if (commands.isNull() || data.isNull())
 		throwError<ArgumentError>(kInvalidParamError);
 
-	pathToTokens(commands, data, winding, th->owner->tokens);
+	pathToTokens(commands, data, winding, th->owner->getWritableTokens());
 
 	th->owner->owner->hasChanged=true;
 	th->owner->owner->requestInvalidation(obj->getSystemState());
@@ -555,7 +561,7 @@ ASFUNCTIONBODY(Graphics,drawTriangles)
 	tiny_string culling;
 	ARG_UNPACK (vertices) (indices, NullRef) (uvtData, NullRef) (culling, "none");
 
-	drawTrianglesToTokens(vertices, indices, uvtData, culling, th->owner->tokens);
+	drawTrianglesToTokens(vertices, indices, uvtData, culling, th->owner->getWritableTokens());
 	th->owner->owner->hasChanged=true;
 	th->owner->owner->requestInvalidation(obj->getSystemState());
 
@@ -690,7 +696,7 @@ ASFUNCTIONBODY(Graphics,drawGraphicsData)
 			continue;
 		}
 
-		graphElement->appendToTokens(th->owner->tokens);
+		graphElement->appendToTokens(th->owner->getWritableTokens());
 	}
 
 	th->owner->owner->hasChanged=true;
@@ -706,7 +712,7 @@ ASFUNCTIONBODY(Graphics,lineStyle)
 
 	if (argslen == 0)
 	{
-		th->owner->tokens.emplace_back(CLEAR_STROKE);
+		th->owner->getWritableTokens().emplace_back(CLEAR_STROKE);
 		return NULL;
 	}
 	uint32_t color = 0;
@@ -722,7 +728,7 @@ ASFUNCTIONBODY(Graphics,lineStyle)
 	LINESTYLE2 style(0xff);
 	style.Color = RGBA(color, alpha);
 	style.Width = thickness;
-	th->owner->tokens.emplace_back(GeomToken(SET_STROKE, style));
+	th->owner->getWritableTokens().emplace_back(GeomToken(SET_STROKE, style));
 	return NULL;
 }
 
@@ -744,7 +750,7 @@ ASFUNCTIONBODY(Graphics,lineBitmapStyle)
 	style.HasFillFlag = true;
 	style.FillType = createBitmapFill(bitmap, matrix, repeat, smooth);
 	
-	th->owner->tokens.emplace_back(GeomToken(SET_STROKE, style));
+	th->owner->getWritableTokens().emplace_back(GeomToken(SET_STROKE, style));
 
 	return NULL;
 }
@@ -772,7 +778,7 @@ ASFUNCTIONBODY(Graphics,lineGradientStyle)
 					    spreadMethod, interpolationMethod,
 					    focalPointRatio);
 
-	th->owner->tokens.emplace_back(GeomToken(SET_STROKE, style));
+	th->owner->getWritableTokens().emplace_back(GeomToken(SET_STROKE, style));
 
 	return NULL;
 }
@@ -805,7 +811,7 @@ ASFUNCTIONBODY(Graphics,beginGradientFill)
 	FILLSTYLE style = createGradientFill(type, colors, alphas, ratios, matrix,
 					     spreadMethod, interpolationMethod,
 					     focalPointRatio);
-	th->owner->tokens.emplace_back(GeomToken(SET_FILL, style));
+	th->owner->getWritableTokens().emplace_back(GeomToken(SET_FILL, style));
 
 	return NULL;
 }
@@ -921,7 +927,7 @@ ASFUNCTIONBODY(Graphics,beginBitmapFill)
 	th->checkAndSetScaling();
 
 	FILLSTYLE style = createBitmapFill(bitmap, matrix, repeat, smooth);
-	th->owner->tokens.emplace_back(GeomToken(SET_FILL, style));
+	th->owner->getWritableTokens().emplace_back(GeomToken(SET_FILL, style));
 	return NULL;
 }
 
@@ -936,7 +942,7 @@ ASFUNCTIONBODY(Graphics,beginFill)
 	if(argslen>=2)
 		alpha=(uint8_t(args[1]->toNumber()*0xff));
 	FILLSTYLE style = Graphics::createSolidFill(color, alpha);
-	th->owner->tokens.emplace_back(GeomToken(SET_FILL, style));
+	th->owner->getWritableTokens().emplace_back(GeomToken(SET_FILL, style));
 	return NULL;
 }
 
@@ -944,7 +950,7 @@ ASFUNCTIONBODY(Graphics,endFill)
 {
 	Graphics* th=static_cast<Graphics*>(obj);
 	th->checkAndSetScaling();
-	th->owner->tokens.emplace_back(CLEAR_FILL);
+	th->owner->getWritableTokens().emplace_back(CLEAR_FILL);
 	return NULL;
 }
 
@@ -956,7 +962,8 @@ ASFUNCTIONBODY(Graphics,copyFrom)
 	if (source.isNull())
 		return NULL;
 
-	th->owner->tokens.assign(source->owner->tokens.begin(),
-				 source->owner->tokens.end());
+	//Share the tokens, they are copied when either side draws again
+	source->owner->tokens->shared=true;
+	th->owner->tokens=source->owner->tokens;
 	return NULL;
 }
@@ -25,16 +25,35 @@
 using namespace lightspark;
 using namespace std;
 
-TokenContainer::TokenContainer(DisplayObject* _o) : owner(_o),tokens(reporter_allocator<GeomToken>(_o->getSystemState()->unaccountedMemory)), scaling(1.0f)
+TokenContainer::TokenContainer(DisplayObject* _o) : owner(_o),tokens(_MR(new tokensVector(_o->getSystemState()->unaccountedMemory))), scaling(1.0f)
 {
 }
 
-TokenContainer::TokenContainer(DisplayObject* _o, const tokensVector& _tokens, float _scaling) :
-	owner(_o), tokens(_tokens.begin(),_tokens.end(),reporter_allocator<GeomToken>(_o->getSystemState()->unaccountedMemory)), scaling(_scaling)
+TokenContainer::TokenContainer(DisplayObject* _o, _R<tokensVector> _tokens, float _scaling) :
+	owner(_o), tokens(_tokens), scaling(_scaling)
 
 {
 }
 
+tokensVector& TokenContainer::getWritableTokens()
+{
+	owner->markRetainedSurfaceDirty();
+	owner->invalidateHitBounds();
+	if(!tokens->isLastRef())
+		tokens=_MR(new tokensVector(*tokens));
+	return *tokens;
+}
+
+void TokenContainer::clearTokens()
+{
+	owner->markRetainedSurfaceDirty();
+	owner->invalidateHitBounds();
+	if(tokens->isLastRef())
+		tokens->clear();
+	else
+		tokens=_MR(new tokensVector(owner->getSystemState()->unaccountedMemory));
+}
+
 void TokenContainer::renderImpl(RenderContext& ctxt) const
 {
 	owner->defaultRender(ctxt);
@@ -121,7 +140,7 @@ void TokenContainer::FromShaperecordListToShapeVector(const std::vector<SHAPEREC
 
 void TokenContainer::requestInvalidation(InvalidateQueue* q)
 {
-	if(tokens.empty())
+	if(tokens->empty())
 		return;
 	owner->incRef();
 	q->addToInvalidateQueue(_MR(owner));
@@ -155,7 +174,8 @@ _NR<DisplayObject> TokenContainer::hitTestImpl(_NR<DisplayObject> last, number_t
 {
 	//Masks have been already checked along the way
 
-	if(CairoTokenRenderer::hitTest(tokens, scaling, x, y))
+	//The coordinates are local, while tokens are not scaled yet
+	if(tokens->contains(x/scaling, y/scaling))
 		return last;
 	return NullRef;
 }
@@ -169,7 +189,7 @@ bool TokenContainer::boundsRect(number_t& xmin, number_t& xmax, number_t& ymin,
 		ymin=dmin(v.y-strokeWidth,ymin); \
 		ymax=dmax(v.y+strokeWidth,ymax);
 
-	if(tokens.size()==0)
+	if(tokens->empty())
 		return false;
 
 	xmin = numeric_limits<double>::infinity();
@@ -180,18 +200,19 @@ bool TokenContainer::boundsRect(number_t& xmin, number_t& xmax, number_t& ymin,
 	bool hasContent = false;
 	double strokeWidth = 0;
 
-	for(unsigned int i=0;i<tokens.size();i++)
+	const tokensVector& t=*tokens;
+	for(uint32_t i=0;i<t.end();i=t.next(i))
 	{
-		switch(tokens[i].type)
+		switch(t.type(i))
 		{
 			case CURVE_CUBIC:
 			{
-				VECTOR_BOUNDS(tokens[i].p3);
+				VECTOR_BOUNDS(t.point(i,2));
 			}
 			// falls through
 			case CURVE_QUADRATIC:
 			{
-				VECTOR_BOUNDS(tokens[i].p2);
+				VECTOR_BOUNDS(t.point(i,1));
 			}
 			// falls through
 			case STRAIGHT:
@@ -201,7 +222,7 @@ bool TokenContainer::boundsRect(number_t& xmin, number_t& xmax, number_t& ymin,
 			// falls through
 			case MOVE:
 			{
-				VECTOR_BOUNDS(tokens[i].p1);
+				VECTOR_BOUNDS(t.point(i,0));
 				break;
 			}
 			case CLEAR_FILL:
@@ -211,7 +232,7 @@ bool TokenContainer::boundsRect(number_t& xmin, number_t& xmax, number_t& ymin,
 			case FILL_TRANSFORM_TEXTURE:
 				break;
 			case SET_STROKE:
-				strokeWidth = (double)(tokens[i].lineStyle.Width / 20.0);
+				strokeWidth = (double)(t.lineStyle(i).Width / 20.0);
 				break;
 		}
 	}
@@ -235,41 +256,42 @@ bool TokenContainer::boundsRect(number_t& xmin, number_t& xmax, number_t& ymin,
 }
 
 /* Find the size of the active texture (bitmap set by the latest SET_FILL). */
-void TokenContainer::getTextureSize(tokensVector& tokens, int *width, int *height)
+void TokenContainer::getTextureSize(const tokensVector& tokens, int *width, int *height)
 {
 	*width=0;
 	*height=0;
 
-	for(int i=tokens.size()-1;i>=0;i--)
+	//Tokens can only be walked forward, remember the latest bitmap fill
+	const FILLSTYLE* bitmapFill=NULL;
+	for(uint32_t i=0;i<tokens.end();i=tokens.next(i))
 	{
-		const FILLSTYLE& style=tokens[i].fillStyle;
+		if(tokens.type(i)!=SET_FILL)
+			continue;
+		const FILLSTYLE& style=tokens.fillStyle(i);
 		const FILL_STYLE_TYPE& fstype=style.FillStyleType;
-		if(tokens[i].type==SET_FILL && 
-		   (fstype==REPEATING_BITMAP ||
-		    fstype==NON_SMOOTHED_REPEATING_BITMAP ||
-		    fstype==CLIPPED_BITMAP ||
-		    fstype==NON_SMOOTHED_CLIPPED_BITMAP))
-		{
-			if (style.bitmap.isNull())
-				return;
-
-			*width=style.bitmap->getWidth();
-			*height=style.bitmap->getHeight();
-			return;
-		}
+		if(fstype==REPEATING_BITMAP ||
+		   fstype==NON_SMOOTHED_REPEATING_BITMAP ||
+		   fstype==CLIPPED_BITMAP ||
+		   fstype==NON_SMOOTHED_CLIPPED_BITMAP)
+			bitmapFill=&style;
 	}
+	if (bitmapFill==NULL || bitmapFill->bitmap.isNull())
+		return;
+
+	*width=bitmapFill->bitmap->getWidth();
+	*height=bitmapFill->bitmap->getHeight();
 }
 
 /* Return the width of the latest SET_STROKE */
 uint16_t TokenContainer::getCurrentLineWidth() const
 {
-	for(int i=tokens.size()-1;i>=0;i--)
+	uint16_t width=0;
+	const tokensVector& t=*tokens;
+	for(uint32_t i=0;i<t.end();i=t.next(i))
 	{
-		if(tokens[i].type==SET_STROKE)
-		{
-			return tokens[i].lineStyle.Width;
-		}
+		if(t.type(i)==SET_STROKE)
+			width=t.lineStyle(i).Width;
 	}
 
-	return 0;
+	return width;
 }
@@ -45,23 +45,29 @@ public:
 	 * scaling is not 1.0f,
 	 * the tokens are cleared and scaling is set
 	 * to 1.0f.
+	 * The tokens may be shared with the defining tag, other
+	 * instances and pending renderers, modify them only through
+	 * getWritableTokens and clearTokens.
 	 */
-	tokensVector tokens;
+	_R<tokensVector> tokens;
 	static void FromShaperecordListToShapeVector(const std::vector<SHAPERECORD>& shapeRecords,
 					 tokensVector& tokens, const std::list<FILLSTYLE>& fillStyles,
 					 const MATRIX& matrix = MATRIX(), const std::list<LINESTYLE2>& lineStyles = std::list<LINESTYLE2>());
-	static void getTextureSize(tokensVector& tokens, int *width, int *height);
+	static void getTextureSize(const tokensVector& tokens, int *width, int *height);
+	/* Returns tokens that are not shared with anybody else, copying them if needed */
+	tokensVector& getWritableTokens();
+	void clearTokens();
 	uint16_t getCurrentLineWidth() const;
 	float scaling;
 protected:
 	TokenContainer(DisplayObject* _o);
-	TokenContainer(DisplayObject* _o, const tokensVector& _tokens, float _scaling);
+	TokenContainer(DisplayObject* _o, _R<tokensVector> _tokens, float _scaling);
 	IDrawable* invalidate(DisplayObject* target, const MATRIX& initialMatrix);
 	void requestInvalidation(InvalidateQueue* q);
 	bool boundsRect(number_t& xmin, number_t& xmax, number_t& ymin, number_t& ymax) const;
 	_NR<DisplayObject> hitTestImpl(_NR<DisplayObject> last, number_t x, number_t y, DisplayObject::HIT_TYPE type) const;
 	void renderImpl(RenderContext& ctxt) const;
-	bool tokensEmpty() const { return tokens.empty(); }
+	bool tokensEmpty() const { return tokens->empty(); }
 };
 
 };
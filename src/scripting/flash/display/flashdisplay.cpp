@@ -18,6 +18,8 @@
 **************************************************************************/
 
 #include <list>
+#include <algorithm>
+#include <functional>
 
 #include "backends/security.h"
 #include "scripting/abc.h"
@@ -39,6 +41,7 @@
 #include "scripting/toplevel/Vector.h"
 
 #define FRAME_NOT_FOUND 0xffffffff //Used by getFrameIdBy*
+#define FRAME_SNAPSHOT_INTERVAL 64 //Frames between two timeline snapshots
 
 using namespace std;
 using namespace lightspark;
@@ -676,6 +679,7 @@ void Loader::setContent(_R<DisplayObject> o)
 	{
 		Locker l(mutexDisplayList);
 		dynamicDisplayList.clear();
+		displayListChanged();
 	}
 
 	{
@@ -774,6 +778,7 @@ ASFUNCTIONBODY_ATOM(Sprite,_setter_hitArea)
 		th->incRef();
 		th->hitArea->hitTarget = _MNR(th);
 	}
+	th->getSystemState()->invalidateHitTests();
 
 	return asAtom::invalidAtom;
 }
@@ -794,10 +799,10 @@ bool DisplayObjectContainer::boundsRect(number_t& xmin, number_t& xmax, number_t
 		{
 			if(ret==true)
 			{
-				xmin = imin(xmin,txmin);
-				xmax = imax(xmax,txmax);
-				ymin = imin(ymin,tymin);
-				ymax = imax(ymax,tymax);
+				xmin = dmin(xmin,txmin);
+				xmax = dmax(xmax,txmax);
+				ymin = dmin(ymin,tymin);
+				ymax = dmax(ymax,tymax);
 			}
 			else
 			{
@@ -821,10 +826,10 @@ bool Sprite::boundsRect(number_t& xmin, number_t& xmax, number_t& ymin, number_t
 	{
 		if(ret==true)
 		{
-			xmin = imin(xmin,txmin);
-			xmax = imax(xmax,txmax);
-			ymin = imin(ymin,tymin);
-			ymax = imax(ymax,tymax);
+			xmin = dmin(xmin,txmin);
+			xmax = dmax(xmax,txmax);
+			ymin = dmin(ymin,tymin);
+			ymax = dmax(ymax,tymax);
 		}
 		else
 		{
@@ -867,6 +872,81 @@ void Sprite::renderImpl(RenderContext& ctxt) const
 	DisplayObjectContainer::renderImpl(ctxt);
 }
 
+void DisplayObjectContainer::refreshHitTestEntry(uint32_t i)
+{
+	DisplayObject* child=dynamicDisplayList[i].getPtr();
+	//Clear the flag first, changes that happen while the bounds are computed set it again
+	RELEASE_WRITE(child->hitBoundsDirty,false);
+	hitTestExact[i]=child->boundsContainHitArea();
+	number_t xmin,xmax,ymin,ymax;
+	hitTestHasBounds[i]=hitTestExact[i] && child->getBounds(xmin,xmax,ymin,ymax,child->getMatrix());
+	if(hitTestHasBounds[i])
+		hitTestBounds[i]=BoundsBox(xmin,xmax,ymin,ymax);
+}
+
+/*
+ * Bring the hit test index up to date, assumes mutexDisplayList is held.
+ * Only the children that have been marked are refreshed, the tree is built again
+ * when the display list changed or when children gained or lost their bounds
+ */
+void DisplayObjectContainer::updateHitTestIndex()
+{
+	bool rebuild=!hitTestIndexValid;
+	if(rebuild)
+	{
+		RELEASE_WRITE(hitTestIndexDirty,false);
+		uint32_t count=dynamicDisplayList.size();
+		hitTestBounds.resize(count);
+		hitTestHasBounds.assign(count,false);
+		hitTestExact.assign(count,true);
+		for(uint32_t i=0;i<count;i++)
+			refreshHitTestEntry(i);
+	}
+	else if(ACQUIRE_READ(hitTestIndexDirty))
+	{
+		RELEASE_WRITE(hitTestIndexDirty,false);
+		for(uint32_t i=0;i<dynamicDisplayList.size();i++)
+		{
+			if(!ACQUIRE_READ(dynamicDisplayList[i]->hitBoundsDirty))
+				continue;
+			bool hadBounds=hitTestHasBounds[i];
+			bool wasExact=hitTestExact[i];
+			refreshHitTestEntry(i);
+			if(hadBounds!=hitTestHasBounds[i] || wasExact!=hitTestExact[i])
+				rebuild=true;
+			else if(hitTestHasBounds[i] && !rebuild)
+				hitTestIndex.refit(i,hitTestBounds[i]);
+		}
+		rebuild|=hitTestIndex.needsRebuild();
+	}
+	if(rebuild)
+	{
+		hitTestIndex.build(hitTestBounds,hitTestHasBounds);
+		hitTestAlways.clear();
+		for(uint32_t i=0;i<hitTestExact.size();i++)
+		{
+			if(!hitTestExact[i])
+				hitTestAlways.push_back(i);
+		}
+		hitTestIndexValid=true;
+	}
+}
+
+_NR<DisplayObject> DisplayObjectContainer::hitTestChild(DisplayObject* child, number_t x, number_t y, DisplayObject::HIT_TYPE type)
+{
+	//Don't check masks
+	if(child->isMask())
+		return NullRef;
+
+	if(!child->getMatrix().isInvertible())
+		return NullRef; /* The object is shrunk to zero size */
+
+	number_t localX, localY;
+	child->getMatrix().getInverted().multiply2D(x,y,localX,localY);
+	this->incRef();
+	return child->hitTest(_MR(this), localX,localY, type);
+}
+
 /*
 Subclasses of DisplayObjectContainer must still check
 isHittable() to see if they should send out events.
@@ -874,24 +954,34 @@ isHittable() to see if they should send out events.
 _NR<DisplayObject> DisplayObjectContainer::hitTestImpl(_NR<DisplayObject> last, number_t x, number_t y, DisplayObject::HIT_TYPE type)
 {
 	_NR<DisplayObject> ret = NullRef;
-	//Test objects added at runtime, in reverse order
 	Locker l(mutexDisplayList);
-	std::vector<_R<DisplayObject>>::const_reverse_iterator j=dynamicDisplayList.rbegin();
-	for(;j!=dynamicDisplayList.rend();++j)
+	if(onStage)
 	{
-		//Don't check masks
-		if((*j)->isMask())
-			continue;
-
-		if(!(*j)->getMatrix().isInvertible())
-			continue; /* The object is shrunk to zero size */
-
-		number_t localX, localY;
-		(*j)->getMatrix().getInverted().multiply2D(x,y,localX,localY);
-		this->incRef();
-		ret=(*j)->hitTest(_MR(this), localX,localY, type);
-		if(!ret.isNull())
-			break;
+		updateHitTestIndex();
+		//Only test the children that may contain the point, topmost first
+		std::vector<uint32_t> candidates(hitTestAlways);
+		hitTestIndex.query(x,y,candidates);
+		std::sort(candidates.begin(),candidates.end(),std::greater<uint32_t>());
+		std::vector<uint32_t>::const_iterator j=candidates.begin();
+		for(;j!=candidates.end();++j)
+		{
+			ret=hitTestChild(dynamicDisplayList[*j].getPtr(), x, y, type);
+			if(!ret.isNull())
+				break;
+		}
+	}
+	else
+	{
+		//Changes are not tracked for objects that are not on the stage
+		hitTestIndexValid=false;
+		//Test objects added at runtime, in reverse order
+		std::vector<_R<DisplayObject>>::const_reverse_iterator j=dynamicDisplayList.rbegin();
+		for(;j!=dynamicDisplayList.rend();++j)
+		{
+			ret=hitTestChild(j->getPtr(), x, y, type);
+			if(!ret.isNull())
+				break;
+		}
 	}
 	/* When mouseChildren is false, we should get all events of our children */
 	if(ret && !mouseChildren)
@@ -902,6 +992,21 @@ _NR<DisplayObject> DisplayObjectContainer::hitTestImpl(_NR<DisplayObject> last,
 	return ret;
 }
 
+bool DisplayObjectContainer::boundsContainHitArea() const
+{
+	Locker l(mutexDisplayList);
+	//An up to date index already knows about all the descendants
+	if(onStage && hitTestIndexValid && !ACQUIRE_READ(hitTestIndexDirty))
+		return hitTestAlways.empty();
+	std::vector<_R<DisplayObject>>::const_iterator it=dynamicDisplayList.begin();
+	for(;it!=dynamicDisplayList.end();++it)
+	{
+		if(!(*it)->boundsContainHitArea())
+			return false;
+	}
+	return true;
+}
+
 _NR<DisplayObject> Sprite::hitTestImpl(_NR<DisplayObject>, number_t x, number_t y, DisplayObject::HIT_TYPE type)
 {
 	//Did we hit a children?
@@ -1066,6 +1171,13 @@ void Frame::execute(_R<DisplayObjectContainer> displayList)
 		(*it)->execute(displayList.getPtr());
 }
 
+void Frame::addToSnapshot(FrameSnapshot& snapshot) const
+{
+	auto it=blueprint.begin();
+	for(;it!=blueprint.end();++it)
+		(*it)->addToSnapshot(snapshot);
+}
+
 FrameContainer::FrameContainer():framesLoaded(0)
 {
 	frames.emplace_back(Frame());
@@ -1076,6 +1188,47 @@ FrameContainer::FrameContainer(const FrameContainer& f):frames(f.frames),scenes(
 {
 }
 
+Frame& FrameContainer::getFrame(uint32_t i)
+{
+	assert(i<getFramesLoaded());
+	//Extend the index up to the requested frame, the list is walked only once
+	while(frameIndex.size()<=i)
+	{
+		if(frameIndex.empty())
+			frameIndex.push_back(frames.begin());
+		else
+			frameIndex.push_back(std::next(frameIndex.back()));
+	}
+	return *frameIndex[i];
+}
+
+const FrameSnapshot& FrameContainer::getSnapshot(uint32_t frame, uint32_t& firstFrame)
+{
+	assert(frame<getFramesLoaded());
+	uint32_t n=frame/FRAME_SNAPSHOT_INTERVAL;
+	if(snapshots.empty())
+		snapshots.emplace_back(FrameSnapshot());
+	//Snapshots are computed from the tags, so they are not affected by
+	//changes made by scripts to the display list
+	while(snapshots.size()<=n)
+	{
+		FrameSnapshot next=snapshots.back();
+		uint32_t start=(snapshots.size()-1)*FRAME_SNAPSHOT_INTERVAL;
+		for(uint32_t i=start;i<start+FRAME_SNAPSHOT_INTERVAL;i++)
+			getFrame(i).addToSnapshot(next);
+		snapshots.push_back(next);
+	}
+	firstFrame=n*FRAME_SNAPSHOT_INTERVAL;
+	return snapshots[n];
+}
+
+void FrameContainer::clearFrames()
+{
+	frameIndex.clear();
+	snapshots.clear();
+	frames.clear();
+}
+
 /* This runs in parser thread context,
  * but no locking is needed here as it only accesses the last frame.
  * See comment on the 'frames' member. */
@@ -1144,7 +1297,7 @@ MovieClip::MovieClip(Class_base* c, const FrameContainer& f, bool defineSpriteTa
 
 bool MovieClip::destruct()
 {
-	frames.clear();
+	clearFrames();
 	auto it = frameScripts.begin();
 	while (it != frameScripts.end())
 	{
@@ -1515,7 +1668,8 @@ void DisplayObjectContainer::buildTraits(ASObject* o)
 {
 }
 
-DisplayObjectContainer::DisplayObjectContainer(Class_base* c):InteractiveObject(c),mouseChildren(true),tabChildren(true)
+DisplayObjectContainer::DisplayObjectContainer(Class_base* c):InteractiveObject(c),mouseChildren(true),hitTestIndexValid(false),
+	hitTestIndexDirty(true),tabChildren(true)
 {
 	subtype=SUBTYPE_DISPLAYOBJECTCONTAINER;
 }
@@ -1597,6 +1751,12 @@ bool DisplayObjectContainer::destruct()
 {
 	//Release every child
 	dynamicDisplayList.clear();
+	hitTestIndex.clear();
+	hitTestBounds.clear();
+	hitTestHasBounds.clear();
+	hitTestExact.clear();
+	hitTestAlways.clear();
+	hitTestIndexValid=false;
 	mouseChildren = true;
 	tabChildren = true;
 	return InteractiveObject::destruct();
@@ -1629,6 +1789,7 @@ ASFUNCTIONBODY(InteractiveObject,_setMouseEnabled)
 	InteractiveObject* th=static_cast<InteractiveObject*>(obj);
 	assert_and_throw(argslen==1);
 	th->mouseEnabled=Boolean_concrete(args[0]);
+	obj->getSystemState()->invalidateHitTests();
 	return NULL;
 }
 
@@ -1643,6 +1804,7 @@ ASFUNCTIONBODY(InteractiveObject,_setDoubleClickEnabled)
 	InteractiveObject* th=static_cast<InteractiveObject*>(obj);
 	assert_and_throw(argslen==1);
 	th->doubleClickEnabled=Boolean_concrete(args[0]);
+	obj->getSystemState()->invalidateHitTests();
 	return NULL;
 }
 
@@ -1723,6 +1885,8 @@ void DisplayObjectContainer::setOnStage(bool staged)
 			Locker l(mutexDisplayList);
 			displayListCopy.assign(dynamicDisplayList.begin(),
 					       dynamicDisplayList.end());
+			//Children changes are not tracked outside of the stage
+			displayListChanged();
 		}
 		std::vector<_R<DisplayObject>>::const_iterator it=displayListCopy.begin();
 		for(;it!=displayListCopy.end();++it)
@@ -1752,12 +1916,21 @@ ASFUNCTIONBODY(DisplayObjectContainer,_setMouseChildren)
 	DisplayObjectContainer* th=static_cast<DisplayObjectContainer*>(obj);
 	assert_and_throw(argslen==1);
 	th->mouseChildren=Boolean_concrete(args[0]);
+	obj->getSystemState()->invalidateHitTests();
 	return NULL;
 }
 
 void DisplayObjectContainer::requestInvalidation(InvalidateQueue* q)
 {
 	DisplayObject::requestInvalidation(q);
+	//A subtree cached as bitmap is drawn as a whole by its root. Software
+	//rendering (BitmapData.draw and masks) still needs every object
+	if(q==getSystemState() && hasRetainedSurface())
+	{
+		this->incRef();
+		q->addToInvalidateQueue(_MR(this));
+		return;
+	}
 	Locker l(mutexDisplayList);
 	std::vector<_R<DisplayObject>>::const_iterator it=dynamicDisplayList.begin();
 	for(;it!=dynamicDisplayList.end();++it)
@@ -1794,7 +1967,10 @@ void DisplayObjectContainer::_addChildAt(_R<DisplayObject> child, unsigned int i
 				++it;
 			dynamicDisplayList.insert(it,child);
 		}
+		displayListChanged();
 	}
+	invalidateRetainedSurface();
+	invalidateHitBounds();
 	child->setOnStage(onStage);
 }
 
@@ -1809,12 +1985,15 @@ bool DisplayObjectContainer::_removeChild(_R<DisplayObject> child)
 		if(it==dynamicDisplayList.end())
 			return false;
 		dynamicDisplayList.erase(it);
+		displayListChanged();
 
 		//Erase this from the legacy child map (if it is in there)
 		depthToLegacyChild.right.erase(child.getPtr());
 	}
 	child->setOnStage(false);
 	child->setParent(NullRef);
+	invalidateRetainedSurface();
+	invalidateHitBounds();
 	return true;
 }
 
@@ -1952,9 +2131,12 @@ ASFUNCTIONBODY(DisplayObjectContainer,removeChildAt)
 		//incRef before the refrence is destroyed
 		child->incRef();
 		th->dynamicDisplayList.erase(it);
+		th->displayListChanged();
 	}
 	child->setOnStage(false);
 	child->setParent(NullRef);
+	th->invalidateRetainedSurface();
+	th->invalidateHitBounds();
 
 	//As we return the child we don't decRef it
 	return child;
@@ -1971,7 +2153,10 @@ ASFUNCTIONBODY(DisplayObjectContainer,removeChildren)
 		if (endindex > th->dynamicDisplayList.size())
 			endindex = (uint32_t)th->dynamicDisplayList.size();
 		th->dynamicDisplayList.erase(th->dynamicDisplayList.begin()+beginindex,th->dynamicDisplayList.begin()+endindex);
+		th->displayListChanged();
 	}
+	th->invalidateRetainedSurface();
+	th->invalidateHitBounds();
 	return NULL;
 }
 ASFUNCTIONBODY(DisplayObjectContainer,_setChildIndex)
@@ -1991,7 +2176,10 @@ ASFUNCTIONBODY(DisplayObjectContainer,_setChildIndex)
 	if(curIndex == index)
 		return NULL;
 
+	th->invalidateRetainedSurface();
+	th->invalidateHitBounds();
 	Locker l(th->mutexDisplayList);
+	th->displayListChanged();
 
 	child->incRef();
 	th->dynamicDisplayList.erase(th->dynamicDisplayList.begin()+curIndex); //remove from old position
@@ -2043,7 +2231,10 @@ ASFUNCTIONBODY(DisplayObjectContainer,swapChildren)
 			throw Class<ArgumentError>::getInstanceS(obj->getSystemState(),"Argument is not child of this object", 2025);
 
 		std::iter_swap(it1, it2);
+		th->displayListChanged();
 	}
+	th->invalidateRetainedSurface();
+	th->invalidateHitBounds();
 	
 	return NULL;
 }
@@ -2066,7 +2257,10 @@ ASFUNCTIONBODY(DisplayObjectContainer,swapChildrenAt)
 	{
 		Locker l(th->mutexDisplayList);
 		std::iter_swap(th->dynamicDisplayList.begin() + index1, th->dynamicDisplayList.begin() + index2);
+		th->displayListChanged();
 	}
+	th->invalidateRetainedSurface();
+	th->invalidateHitBounds();
 
 	return NULL;
 }
@@ -2179,7 +2373,7 @@ Shape::Shape(Class_base* c):DisplayObject(c),TokenContainer(this),graphics(NullR
 {
 }
 
-Shape::Shape(Class_base* c, const tokensVector& tokens, float scaling):
+Shape::Shape(Class_base* c, _R<tokensVector> tokens, float scaling):
 	DisplayObject(c),TokenContainer(this, tokens, scaling),graphics(NullRef)
 {
 }
@@ -2733,7 +2927,7 @@ ASFUNCTIONBODY_GETTER_SETTER_CB(Bitmap,pixelSnapping,onPixelSnappingChanged);
 
 void Bitmap::updatedData()
 {
-	tokens.clear();
+	clearTokens();
 
 	if(bitmapData.isNull() || bitmapData->getBitmapContainer().isNull())
 		return;
@@ -2744,12 +2938,13 @@ void Bitmap::updatedData()
 	else
 		style.FillStyleType=NON_SMOOTHED_CLIPPED_BITMAP;
 	style.bitmap=bitmapData->getBitmapContainer();
-	tokens.emplace_back(GeomToken(SET_FILL, style));
-	tokens.emplace_back(GeomToken(MOVE, Vector2(0, 0)));
-	tokens.emplace_back(GeomToken(STRAIGHT, Vector2(0, style.bitmap->getHeight())));
-	tokens.emplace_back(GeomToken(STRAIGHT, Vector2(style.bitmap->getWidth(), style.bitmap->getHeight())));
-	tokens.emplace_back(GeomToken(STRAIGHT, Vector2(style.bitmap->getWidth(), 0)));
-	tokens.emplace_back(GeomToken(STRAIGHT, Vector2(0, 0)));
+	tokensVector& t=getWritableTokens();
+	t.emplace_back(GeomToken(SET_FILL, style));
+	t.emplace_back(GeomToken(MOVE, Vector2(0, 0)));
+	t.emplace_back(GeomToken(STRAIGHT, Vector2(0, style.bitmap->getHeight())));
+	t.emplace_back(GeomToken(STRAIGHT, Vector2(style.bitmap->getWidth(), style.bitmap->getHeight())));
+	t.emplace_back(GeomToken(STRAIGHT, Vector2(style.bitmap->getWidth(), 0)));
+	t.emplace_back(GeomToken(STRAIGHT, Vector2(0, 0)));
 	hasChanged=true;
 	if(onStage)
 		requestInvalidation(getSystemState());
@@ -2954,6 +3149,7 @@ ASFUNCTIONBODY(SimpleButton,_setHitTestState)
 	SimpleButton* th=static_cast<SimpleButton*>(obj);
 	th->hitTestState = _MNR(Class<DisplayObject>::cast(args[0]));
 	th->hitTestState->incRef();
+	obj->getSystemState()->invalidateHitTests();
 	return NULL;
 }
 
@@ -3117,6 +3313,21 @@ void DisplayObjectContainer::initFrame()
 	DisplayObject::initFrame();
 }
 
+uint32_t MovieClip::restoreSnapshot(uint32_t frame)
+{
+	uint32_t first;
+	const FrameSnapshot& snapshot=getSnapshot(frame,first);
+	//Depth order, so the objects are added below the ones of higher depths
+	auto it=snapshot.depths.begin();
+	for(;it!=snapshot.depths.end();++it)
+	{
+		it->second.placedBy->execute(this);
+		if(it->second.moved && hasLegacyChildAt(it->first))
+			transformLegacyChildAt(it->first,it->second.matrix);
+	}
+	return first;
+}
+
 /* Go through the hierarchy and add all
  * legacy objects which are new in the current
  * frame top-down. At the same time, call their
@@ -3129,16 +3340,18 @@ void MovieClip::initFrame()
 	 * we construct all frames from current
 	 * to next_FP.
 	 * If our next_FP is before our current,
-	 * we purge all objects on the 0th frame
-	 * and then construct all frames from
-	 * the 0th to the next_FP.
+	 * we purge all objects, recreate the objects
+	 * of the last snapshot at or before next_FP and
+	 * then construct all frames from the snapshot
+	 * to the next_FP.
 	 * TODO: do not purge legacy objects that were also there at state.FP,
 	 * we saw that their constructor is not run again.
 	 * We also will run the constructor on objects that got placed and deleted
-	 * before state.FP (which may get us an segfault).
+	 * between the snapshot and state.FP (which may get us an segfault).
 	 *
 	 */
-	if((int)state.FP < state.last_FP)
+	bool seekBack=(int)state.FP < state.last_FP;
+	if(seekBack)
 		purgeLegacyChildren();
 
 	//Declared traits must exists before legacy objects are added
@@ -3147,15 +3360,15 @@ void MovieClip::initFrame()
 
 	if(getFramesLoaded())
 	{
-		std::list<Frame>::iterator iter=frames.begin();
-		for(uint32_t i=0;i<=state.FP;i++)
+		//Only frames already handed over by the parser may be executed
+		uint32_t last=imin(state.FP,getFramesLoaded()-1);
+		uint32_t first=state.last_FP+1;
+		if(seekBack)
+			first=restoreSnapshot(last);
+		for(uint32_t i=first;i<=last;i++)
 		{
-			if((int)state.FP < state.last_FP || (int)i > state.last_FP)
-			{
-				this->incRef(); //TODO kill ref from execute's declaration
-				iter->execute(_MR(this));
-			}
-			++iter;
+			this->incRef(); //TODO kill ref from execute's declaration
+			getFrame(i).execute(_MR(this));
 		}
 	}
 
@@ -39,6 +39,7 @@ namespace lightspark
 
 class RootMovieClip;
 class DisplayListTag;
+class PlaceObject2Tag;
 class InteractiveObject;
 class Downloader;
 class RenderContext;
@@ -91,6 +92,24 @@ private:
 	boost::bimap<uint32_t,DisplayObject*> depthToLegacyChild;
 	bool _contains(_R<DisplayObject> child);
 	void getObjectsFromPoint(Point* point, Array* ar);
+	/*
+	 * Spatial index of the children used by hitTestImpl, protected by mutexDisplayList.
+	 * Element i of the vectors describes dynamicDisplayList[i]
+	 */
+	BoundsHierarchy hitTestIndex;
+	std::vector<BoundsBox> hitTestBounds;
+	std::vector<bool> hitTestHasBounds;
+	//False for children whose hit area is not contained in their bounds
+	std::vector<bool> hitTestExact;
+	//The children that are not exact, they are tested wherever the point is
+	std::vector<uint32_t> hitTestAlways;
+	//Cleared when the display list changes
+	bool hitTestIndexValid;
+	//Set when the bounds of some children may have changed
+	ACQUIRE_RELEASE_FLAG(hitTestIndexDirty);
+	void refreshHitTestEntry(uint32_t i);
+	void updateHitTestIndex();
+	_NR<DisplayObject> hitTestChild(DisplayObject* child, number_t x, number_t y, DisplayObject::HIT_TYPE type);
 protected:
 	void requestInvalidation(InvalidateQueue* q);
 	//This is shared between RenderThread and VM
@@ -98,12 +117,16 @@ protected:
 	//The lock should only be taken when doing write operations
 	//As the RenderThread only reads, it's safe to read without the lock
 	mutable Mutex mutexDisplayList;
+	//Must be called with mutexDisplayList held when dynamicDisplayList is modified
+	void displayListChanged() { hitTestIndexValid=false; }
 	void setOnStage(bool staged);
 	_NR<DisplayObject> hitTestImpl(_NR<DisplayObject> last, number_t x, number_t y, DisplayObject::HIT_TYPE type);
 	bool boundsRect(number_t& xmin, number_t& xmax, number_t& ymin, number_t& ymax) const;
+	bool boundsContainHitArea() const;
 	void renderImpl(RenderContext& ctxt) const;
 	ASPROPERTY_GETTER_SETTER(bool, tabChildren);
 public:
+	void markHitTestIndexDirty() { RELEASE_WRITE(hitTestIndexDirty,true); }
 	void _addChildAt(_R<DisplayObject> child, unsigned int index);
 	void dumpDisplayList(unsigned int level=0);
 	bool _removeChild(_R<DisplayObject> child);
@@ -162,6 +185,8 @@ private:
 	bool useHandCursor;
 	void reflectState();
 	_NR<DisplayObject> hitTestImpl(_NR<DisplayObject> last, number_t x, number_t y, DisplayObject::HIT_TYPE type);
+	//The hit area is hitTestState, which is not a child
+	bool boundsContainHitArea() const { return false; }
 	/* This is called by when an event is dispatched */
 	void defaultEventBehavior(_R<Event> e);
 public:
@@ -197,7 +222,7 @@ protected:
 		{ return TokenContainer::hitTestImpl(last,x,y, type); }
 public:
 	Shape(Class_base* c);
-	Shape(Class_base* c, const tokensVector& tokens, float scaling);
+	Shape(Class_base* c, _R<tokensVector> tokens, float scaling);
 	void finalize();
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
@@ -424,11 +449,32 @@ public:
 	ASFUNCTION(_getNumFrames);
 };
 
+/*
+ * The objects placed by the timeline at the start of a frame, by depth.
+ * Each object is described by the tag that placed it, which holds the
+ * character, color transform, ratio and name, and by the matrix that
+ * later tags may have moved it to.
+ */
+class FrameSnapshot
+{
+public:
+	class Entry
+	{
+	public:
+		const PlaceObject2Tag* placedBy;
+		MATRIX matrix;
+		bool moved;
+		Entry(const PlaceObject2Tag* p):placedBy(p),moved(false){}
+	};
+	std::map<uint32_t,Entry> depths;
+};
+
 class Frame
 {
 public:
 	std::list<const DisplayListTag*> blueprint;
 	void execute(_R<DisplayObjectContainer> displayList);
+	void addToSnapshot(FrameSnapshot& snapshot) const;
 	/**
 	 * destroyTags must be called only by the tag destructor, not by
 	 * the objects that are instance of tags
@@ -458,11 +504,23 @@ protected:
 	void addToFrame(const DisplayListTag* r);
 	uint32_t getFramesLoaded() { return framesLoaded; }
 	void setFramesLoaded(uint32_t fl) { framesLoaded = fl; }
+	/* Random access to the loaded frames, only from the vm thread */
+	Frame& getFrame(uint32_t i);
+	/* Returns the last snapshot taken at or before the given frame,
+	 * the frames from firstFrame on still have to be executed */
+	const FrameSnapshot& getSnapshot(uint32_t frame, uint32_t& firstFrame);
+	void clearFrames();
 	FrameContainer();
 	FrameContainer(const FrameContainer& f);
 private:
 	//No need for any lock, just make sure accesses are atomic
 	ATOMIC_INT32(framesLoaded);
+	/* Both are only used by the vm thread and only cover loaded frames,
+	 * so they are never touched by the parser. Iterators of a list stay
+	 * valid when the parser appends to it. Snapshot i describes the
+	 * display list at the start of frame i*FRAME_SNAPSHOT_INTERVAL */
+	std::vector<std::list<Frame>::iterator> frameIndex;
+	std::vector<FrameSnapshot> snapshots;
 public:
 	void addFrameLabel(uint32_t frame, const tiny_string& label);
 };
@@ -473,6 +531,9 @@ private:
 	uint32_t getCurrentScene() const;
 	const Scene_data *getScene(const tiny_string &sceneName) const;
 	uint32_t getFrameIdByNumber(uint32_t i, const tiny_string& sceneName) const;
+	/* Recreates the legacy children of the last snapshot at or before the given frame
+	 * and returns the first frame that must still be executed */
+	uint32_t restoreSnapshot(uint32_t frame);
 	uint32_t getFrameIdByLabel(const tiny_string& l, const tiny_string& sceneName) const;
 	std::map<uint32_t,asAtom > frameScripts;
 	bool fromDefineSpriteTag;
@@ -704,6 +765,9 @@ public:
 
 class AVM1Movie: public DisplayObject
 {
+protected:
+	//Bounds are not known, let hit tests go through hitTestImpl
+	bool boundsContainHitArea() const { return false; }
 public:
 	AVM1Movie(Class_base* c):DisplayObject(c){}
 	static void sinit(Class_base* c);
@@ -1012,7 +1012,7 @@ ASFUNCTIONBODY(Transform,_setColorTransform)
 		throwError<TypeError>(kNullPointerError, "colorTransform");
 
 	ct->incRef();
-	th->owner->colorTransform = ct;
+	th->owner->setColorTransform(ct);
 
 	return NULL;
 }
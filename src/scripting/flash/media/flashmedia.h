@@ -108,6 +108,7 @@ public:
 	//IThreadJob interface
 	void execute();
 	void jobFence();
+	THREAD_JOB_PRIORITY getPriority() const { return JOB_PRIORITY_DECODE; }
 	void threadAbort();
 };
 
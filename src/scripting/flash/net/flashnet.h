@@ -273,6 +273,7 @@ private:
 	void execute();
 	void threadAbort();
 	void jobFence();
+	THREAD_JOB_PRIORITY getPriority() const { return JOB_PRIORITY_DECODE; }
 	//ITickJob interface to frame advance
 	void tick();
 	void tickFence();
@@ -86,25 +86,32 @@ public:
 	ASFUNCTION_ATOM(getDefinition);
 	ASPROPERTY_GETTER_SETTER(_NR<ByteArray>, domainMemory);
 	ASPROPERTY_GETTER(_NR<ApplicationDomain>, parentDomain);
+	/*
+	 * These are used by the alchemy opcodes, so they access the buffer of the
+	 * ByteArray directly. The length is read on every access, as the ByteArray
+	 * may be resized by any code that holds a reference to it.
+	 */
 	template<class T>
 	T readFromDomainMemory(uint32_t addr)
 	{
-		checkDomainMemory();
-		uint32_t bufLen=domainMemory->getLength();
-		if(bufLen < (addr+sizeof(T)))
+		ByteArray* mem=getDomainMemory();
+		if(addr > mem->len || mem->len-addr < sizeof(T))
 			throwError<RangeError>(kInvalidRangeError);
-		uint8_t* buf=domainMemory->getBuffer(bufLen, false);
-		return *reinterpret_cast<T*>(buf+addr);
+		return *reinterpret_cast<T*>(mem->bytes+addr);
 	}
 	template<class T>
 	void writeToDomainMemory(uint32_t addr, T val)
 	{
-		checkDomainMemory();
-		uint32_t bufLen=domainMemory->getLength();
-		if(bufLen < (addr+sizeof(T)))
+		ByteArray* mem=getDomainMemory();
+		if(addr > mem->len || mem->len-addr < sizeof(T))
 			throwError<RangeError>(kInvalidRangeError);
-		uint8_t* buf=domainMemory->getBuffer(bufLen, false);
-		*reinterpret_cast<T*>(buf+addr)=val;
+		*reinterpret_cast<T*>(mem->bytes+addr)=val;
+	}
+	ByteArray* getDomainMemory()
+	{
+		if(domainMemory.isNull())
+			checkDomainMemory();
+		return domainMemory.getPtr();
 	}
 	void checkDomainMemory();
 };
@@ -1003,11 +1003,11 @@ IDrawable* TextField::invalidate(DisplayObject* target, const MATRIX& initialMat
 
 	RootMovieClip* currentRoot=getSys()->mainClip;
 	DefineFont3Tag* embeddedfont = currentRoot->getEmbeddedFont(font);
-	tokens.clear();
+	clearTokens();
 	if (embeddedfont)
 	{
 		scaling = 1.0f/1024.0f/20.0f;
-		embeddedfont->fillTextTokens(tokens,text,fontSize,textColor);
+		embeddedfont->fillTextTokens(getWritableTokens(),text,fontSize,textColor);
 	}
 	if (!tokensEmpty())
 		return TokenContainer::invalidate(target, initialMatrix);
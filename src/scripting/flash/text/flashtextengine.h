@@ -202,6 +202,8 @@ private:
 	// Much of the rendering/bounds checking/hit testing code is
 	// similar to TextField and should be shared
 	bool boundsRect(number_t& xmin, number_t& xmax, number_t& ymin, number_t& ymax) const;
+	//Children may be outside of width and height
+	bool boundsContainHitArea() const { return false; }
 	void requestInvalidation(InvalidateQueue* q);
 	IDrawable* invalidate(DisplayObject* target, const MATRIX& initialMatrix);
 	void renderImpl(RenderContext& ctxt) const;
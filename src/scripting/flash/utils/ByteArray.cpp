@@ -60,6 +60,7 @@ ByteArray::~ByteArray()
 void ByteArray::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_SEALED);
+	c->overridesPropertyAccess = true;
 	c->setDeclaredMethodByQName("length","",Class<IFunction>::getFunction(c->getSystemState(),_getLength),GETTER_METHOD,true);
 	c->setDeclaredMethodByQName("length","",Class<IFunction>::getFunction(c->getSystemState(),_setLength),SETTER_METHOD,true);
 	c->setDeclaredMethodByQName("bytesAvailable","",Class<IFunction>::getFunction(c->getSystemState(),_getBytesAvailable),GETTER_METHOD,true);
@@ -134,7 +135,8 @@ uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 	if (size > BA_MAX_SIZE) 
 		throwError<ASError>(kOutOfMemoryError);
 	// The first allocation is exactly the size we need,
-	// the subsequent reallocations happen in increments of BA_CHUNK_SIZE bytes
+	// the subsequent reallocations grow the buffer by half its size,
+	// and at least by BA_CHUNK_SIZE bytes
 	uint32_t prevLen = len;
 	if(bytes==NULL)
 	{
@@ -154,9 +156,16 @@ uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 #ifdef MEMORY_USAGE_PROFILING
 		uint32_t prev_real_len = real_len;
 #endif
-		while(real_len < size)
-			real_len += BA_CHUNK_SIZE;
-		// Reallocate the buffer, in chunks of BA_CHUNK_SIZE bytes
+		//Avoid copying the whole buffer again on every chunk when
+		//serializing large objects
+		uint32_t grow = real_len/2 > BA_CHUNK_SIZE ? real_len/2 : BA_CHUNK_SIZE;
+		if (BA_MAX_SIZE - real_len > grow)
+			real_len += grow;
+		else
+			real_len = BA_MAX_SIZE;
+		if (real_len < size)
+			real_len = size;
+		// Reallocate the buffer
 		uint8_t* bytes2 = (uint8_t*) realloc(bytes, real_len);
 #ifdef MEMORY_USAGE_PROFILING
 		getClass()->memoryAccount->addBytes(real_len-prev_real_len);
@@ -553,9 +562,9 @@ uint32_t ByteArray::writeObject(ASObject* obj)
 	//Return the length of the serialized object
 
 	//TODO: support custom serialization
-	map<tiny_string, uint32_t> stringMap;
-	map<const ASObject*, uint32_t> objMap;
-	map<const Class_base*, uint32_t> traitsMap;
+	unordered_map<tiny_string, uint32_t> stringMap;
+	unordered_map<const ASObject*, uint32_t> objMap;
+	unordered_map<const Class_base*, uint32_t> traitsMap;
 	uint32_t oldPosition=position;
 	obj->serialize(this, stringMap, objMap,traitsMap);
 	return position-oldPosition;
@@ -758,6 +767,26 @@ bool ByteArray::readByte(uint8_t& b)
 	return true;
 }
 
+bool ByteArray::readRawBytes(uint8_t* data, uint32_t count)
+{
+	if (getAvailableBytes() < count)
+		return false;
+
+	memcpy(data,bytes+position,count);
+	position+=count;
+	return true;
+}
+
+bool ByteArray::readRawString(tiny_string& ret, uint32_t count)
+{
+	if (getAvailableBytes() < count)
+		return false;
+
+	ret=std::string((const char*)bytes+position,count);
+	position+=count;
+	return true;
+}
+
 bool ByteArray::readU29(uint32_t& ret)
 {
 	//Be careful! This is different from u32 parsing.
@@ -1149,27 +1178,29 @@ void ByteArray::serializeDouble(number_t val)
 	
 }
 
-void ByteArray::writeStringVR(map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
+void ByteArray::writeStringVR(unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
 {
 	const uint32_t len=s.numBytes();
 	if(len >= 1<<28)
 		throwError<RangeError>(kParamRangeError);
 
-	//Check if the string is already in the map
-	auto it=stringMap.find(s);
-	if(it!=stringMap.end())
+	//The AMF3 spec says that the empty string is never sent by reference
+	//So add the string to the map only if it's not the empty string
+	if(len==0)
+	{
+		writeU29(1);
+		return;
+	}
+	//Add the string to the map, unless it's already there
+	auto it=stringMap.insert(make_pair(s, stringMap.size()));
+	if(!it.second)
 	{
 		//The first bit must be 0, the next 29 bits
 		//store the index of the string in the map
-		writeU29(it->second << 1);
+		writeU29(it.first->second << 1);
 	}
 	else
 	{
-		//The AMF3 spec says that the empty string is never sent by reference
-		//So add the string to the map only if it's not the empty string
-		if(len)
-			stringMap.insert(make_pair(s, stringMap.size()));
-
 		//The first bit must be 1, the next 29 bits
 		//store the number of bytes of the string
 		writeU29((len<<1) | 1);
@@ -1197,7 +1228,7 @@ void ByteArray::writeStringAMF0(const tiny_string& s)
 	}
 }
 
-void ByteArray::writeXMLString(std::map<const ASObject*, uint32_t>& objMap,
+void ByteArray::writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap,
 			       ASObject *xml,
 			       const tiny_string& xmlstr)
 {
@@ -1485,9 +1516,9 @@ ASFUNCTIONBODY(ByteArray,_toJSON)
 	return abstract_s(getSys(),"ByteArray");
 }
 
-void ByteArray::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void ByteArray::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
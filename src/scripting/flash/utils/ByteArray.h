@@ -56,15 +56,19 @@ public:
 	bool readUnsignedInt(uint32_t& ret);
 	bool readU29(uint32_t& ret);
 	bool readUTF(tiny_string& ret);
+	//Read count bytes at once, fail without moving if there are not enough
+	bool readRawBytes(uint8_t* data, uint32_t count);
+	bool readRawString(tiny_string& ret, uint32_t count);
+	uint32_t getAvailableBytes() const { return len>position ? len-position : 0; }
 	void writeByte(uint8_t b);
 	void writeBytes(uint8_t* data, int length);
 	void writeShort(uint16_t val);
 	void writeUnsignedInt(uint32_t val);
 	void writeUTF(const tiny_string& str);
 	uint32_t writeObject(ASObject* obj);
-	void writeStringVR(std::map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
+	void writeStringVR(std::unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
 	void writeStringAMF0(const tiny_string& s);
-	void writeXMLString(std::map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
+	void writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
 	void writeU29(uint32_t val);
 
 	void serializeDouble(number_t val);
@@ -165,9 +169,9 @@ public:
 	void setVariableByMultiname_i(const multiname& name, int32_t value);
 	bool hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype);
 
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 }
@@ -37,6 +37,7 @@ Dictionary::Dictionary(Class_base* c):ASObject(c),
 void Dictionary::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_DYNAMIC_NOT_FINAL);
+	c->overridesPropertyAccess = true;
 	c->prototype->setVariableByQName("toJSON",AS3,Class<IFunction>::getFunction(c->getSystemState(),_toJSON),DYNAMIC_TRAIT);
 }
 
@@ -365,9 +366,9 @@ tiny_string Dictionary::toString()
 }
 
 
-void Dictionary::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Dictionary::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -402,8 +403,8 @@ void Dictionary::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stri
 		tmp = 0;
 		while ((tmp = nextNameIndex(tmp)) != 0)
 		{
-			nextName(tmp).toObject(getSystemState())->serialize(out, stringMap, objMap, traitsMap);
-			nextValue(tmp).toObject(getSystemState())->serialize(out, stringMap, objMap, traitsMap);
+			nextName(tmp).serialize(out, stringMap, objMap, traitsMap);
+			nextValue(tmp).serialize(out, stringMap, objMap, traitsMap);
 		}
 	}
 }
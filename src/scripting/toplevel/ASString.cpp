@@ -57,6 +57,89 @@ ASString::ASString(Class_base* c,const char* s, uint32_t len) : ASObject(c,T_STR
 	datafilled=true;
 }
 
+ASString* ASString::concatenate(SystemState* sys, asAtom& l, asAtom& r)
+{
+	ASString* ls=(l.type==T_STRING && l.getObject()) ? l.getObject()->as<ASString>() : NULL;
+	ASString* rs=(r.type==T_STRING && r.getObject()) ? r.getObject()->as<ASString>() : NULL;
+	tiny_string lstr;
+	tiny_string rstr;
+	if(!ls)
+		lstr=l.toString();
+	if(!rs)
+		rstr=r.toString();
+	uint32_t lbytes=ls ? ls->numBytes() : lstr.numBytes();
+	uint32_t rbytes=rs ? rs->numBytes() : rstr.numBytes();
+	if(lbytes==0 || rbytes==0 || lbytes+rbytes<ROPE_MIN_BYTES)
+	{
+		if(ls)
+			lstr=ls->getData();
+		if(rs)
+			rstr=rs->getData();
+		return abstract_s(sys,lstr+rstr);
+	}
+	ASString* ret=Class<ASString>::getInstanceSNoArgs(sys);
+	ret->stringId=UINT32_MAX;
+	ret->hasId=false;
+	ret->datafilled=false;
+	if(ls)
+		ls->incRef();
+	else
+		ls=abstract_s(sys,lstr);
+	if(rs)
+		rs->incRef();
+	else
+		rs=abstract_s(sys,rstr);
+	ret->ropeNumBytes=lbytes+rbytes;
+	ret->ropeNumChars=ls->numChars()+rs->numChars();
+	ret->ropeLeft=_MNR(ls);
+	ret->ropeRight=_MNR(rs);
+	return ret;
+}
+
+void ASString::flatten()
+{
+	//Ropes built by appending in a loop are very deep, so don't recurse
+	tiny_string result;
+	std::vector<ASString*> stack;
+	stack.push_back(this);
+	while(!stack.empty())
+	{
+		ASString* s=stack.back();
+		stack.pop_back();
+		if(!s->datafilled && !s->ropeLeft.isNull())
+		{
+			stack.push_back(s->ropeRight.getPtr());
+			stack.push_back(s->ropeLeft.getPtr());
+		}
+		else
+			result+=s->getData();
+	}
+	data=result;
+	releaseRope();
+}
+
+void ASString::releaseRope()
+{
+	//Detach the children of the nodes released here before they are
+	//destroyed, a long rope would otherwise be freed recursively
+	std::vector<_NR<ASString> > pending;
+	pending.push_back(ropeLeft);
+	pending.push_back(ropeRight);
+	ropeLeft.reset();
+	ropeRight.reset();
+	while(!pending.empty())
+	{
+		_NR<ASString> s=pending.back();
+		pending.pop_back();
+		if(s.isNull() || !s->isLastRef() || s->ropeLeft.isNull())
+			continue;
+		pending.push_back(s->ropeLeft);
+		pending.push_back(s->ropeRight);
+		s->ropeLeft.reset();
+		s->ropeRight.reset();
+	}
+}
+
 ASFUNCTIONBODY_ATOM(ASString,_constructor)
 {
 	ASString* th=obj.as<ASString>();
@@ -76,7 +159,7 @@ ASFUNCTIONBODY_ATOM(ASString,_getLength)
 	if (obj.type == T_STRING)
 	{
 		ASString* th = obj.getObject()->as<ASString>();
-		return asAtom((int32_t)th->getData().numChars());
+		return asAtom((int32_t)th->numChars());
 	}
 	return asAtom((int32_t)obj.toString().numChars());
 }
@@ -163,36 +246,23 @@ ASFUNCTIONBODY_ATOM(ASString,search)
 		restr = args[0].toString();
 	}
 
-	const char* error;
-	int errorOffset;
-	pcre* pcreRE=pcre_compile(restr.raw_buf(), options, &error, &errorOffset,NULL);
-	if(error)
+	_NR<RegExpProgram> pcreRE=RegExpProgram::get(restr, options);
+	if(pcreRE.isNull())
 		return asAtom(ret);
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return asAtom(ret);
-	}
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+	int capturingGroups=pcreRE->capturingGroups;
 	int ovector[(capturingGroups+1)*3];
 	int offset=0;
 	//Global is not used in search
-	int rc=pcre_exec(pcreRE, &extra, data.raw_buf(), data.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+	int rc=pcreRE->exec(data, offset, ovector, (capturingGroups+1)*3);
 	if(rc<0)
 	{
 		//No matches or error
-		pcre_free(pcreRE);
 		return asAtom(ret);
 	}
 	ret=ovector[0];
 	// pcre_exec returns byte position, so we have to convert it to character position 
 	tiny_string tmp = data.substr_bytes(0, ret);
 	ret = tmp.numChars();
-	pcre_free(pcreRE);
 	return asAtom(ret);
 }
 
@@ -302,19 +372,10 @@ ASFUNCTIONBODY_ATOM(ASString,split)
 			return asAtom::fromObject(ret);
 		}
 
-		pcre* pcreRE = re->compile();
-		if (!pcreRE)
-			return ret;
-		int capturingGroups;
-		int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-		if(infoOk!=0)
-		{
-			pcre_free(pcreRE);
+		_NR<RegExpProgram> pcreRE = re->getProgram();
+		if (pcreRE.isNull())
 			return asAtom::fromObject(ret);
-		}
-		pcre_extra extra;
-		extra.match_limit_recursion=200;
-		extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+		int capturingGroups=pcreRE->capturingGroups;
 		int ovector[(capturingGroups+1)*3];
 		int offset=0;
 		unsigned int end;
@@ -322,7 +383,7 @@ ASFUNCTIONBODY_ATOM(ASString,split)
 		do
 		{
 			//offset is a byte offset that must point to the beginning of an utf8 character
-			int rc=pcre_exec(pcreRE, &extra, data.raw_buf(), data.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+			int rc=pcreRE->exec(data, offset, ovector, (capturingGroups+1)*3);
 			end=ovector[0];
 			if(rc<0)
 				break;
@@ -354,7 +415,6 @@ ASFUNCTIONBODY_ATOM(ASString,split)
 			ASString* s=abstract_s(sys,data.substr_bytes(lastMatch,data.numBytes()-lastMatch));
 			ret->push(asAtom::fromObject(s));
 		}
-		pcre_free(pcreRE);
 	}
 	else
 	{
@@ -589,9 +649,9 @@ TRISTATE ASString::isLess(ASObject* r)
 	return (a<b)?TTRUE:TFALSE;
 }
 
-void ASString::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void ASString::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -791,20 +851,11 @@ ASFUNCTIONBODY_ATOM(ASString,replace)
 	{
 		RegExp* re=args[0].as<RegExp>();
 
-		pcre* pcreRE = re->compile();
-		if (!pcreRE)
+		_NR<RegExpProgram> pcreRE = re->getProgram();
+		if (pcreRE.isNull())
 			return asAtom::fromObject(ret);
 
-		int capturingGroups;
-		int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-		if(infoOk!=0)
-		{
-			pcre_free(pcreRE);
-			return asAtom::fromObject(ret);
-		}
-		pcre_extra extra;
-		extra.match_limit_recursion=200;
-		extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+		int capturingGroups=pcreRE->capturingGroups;
 		int ovector[(capturingGroups+1)*3];
 		int offset=0;
 		int retDiff=0;
@@ -812,11 +863,10 @@ ASFUNCTIONBODY_ATOM(ASString,replace)
 		do
 		{
 			tiny_string replaceWithTmp = replaceWith;
-			int rc=pcre_exec(pcreRE, &extra, ret->getData().raw_buf(), ret->getData().numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+			int rc=pcreRE->exec(ret->getData(), offset, ovector, (capturingGroups+1)*3);
 			if(rc<0)
 			{
 				//No matches or error
-				pcre_free(pcreRE);
 				return asAtom::fromObject(ret);
 			}
 			prevsubstring += ret->getData().substr_bytes(offset,ovector[0]-offset);
@@ -885,8 +935,6 @@ ASFUNCTIONBODY_ATOM(ASString,replace)
 			retDiff+=replaceWithTmp.numBytes()-(ovector[1]-ovector[0]);
 		}
 		while(re->global);
-
-		pcre_free(pcreRE);
 	}
 	else
 	{
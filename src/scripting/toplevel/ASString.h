@@ -26,6 +26,9 @@ namespace Glib { class ustring; }
 
 namespace lightspark
 {
+//Concatenations shorter than this many bytes are done immediately
+#define ROPE_MIN_BYTES 256
+
 /*
  * The AS String class.
  * The 'data' is immutable -> it cannot be changed after creation of the object
@@ -41,6 +44,17 @@ private:
 	number_t parseStringInfinite(const char *s, char **end) const;
 	tiny_string data;
 	_NR<ASObject> strlength;
+	/*
+	 * Lazy concatenation built by concatenate(). While ropeLeft is set the
+	 * data is not filled: the value is ropeLeft followed by ropeRight and
+	 * is computed by getData() on first access.
+	 */
+	_NR<ASString> ropeLeft;
+	_NR<ASString> ropeRight;
+	uint32_t ropeNumBytes;
+	uint32_t ropeNumChars;
+	void flatten();
+	void releaseRope();
 public:
 	ASString(Class_base* c);
 	ASString(Class_base* c, const std::string& s);
@@ -54,17 +68,37 @@ public:
 	{
 		if (!datafilled)
 		{
-			data = getSystemState()->getStringFromUniqueId(stringId);
+			if (!ropeLeft.isNull())
+				flatten();
+			else
+				data = getSystemState()->getStringFromUniqueId(stringId);
 			datafilled = true;
 		}
 		return data;
 	}
+	//These don't flatten ropes
+	inline uint32_t numBytes()
+	{
+		return ropeLeft.isNull() ? getData().numBytes() : ropeNumBytes;
+	}
+	inline uint32_t numChars()
+	{
+		return ropeLeft.isNull() ? getData().numChars() : ropeNumChars;
+	}
 	inline bool isEmpty() const
 	{
 		if (hasId)
 			return stringId == BUILTIN_STRINGS::EMPTY || stringId == UINT32_MAX;
+		if (!ropeLeft.isNull())
+			return false;
 		return data.empty();
 	}
+	/*
+	 * Returns a new string with the value of l followed by the value of r.
+	 * Long results are built as a rope, so that repeated appends don't
+	 * copy the whole string every time.
+	 */
+	static ASString* concatenate(SystemState* sys, asAtom& l, asAtom& r);
 
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
@@ -97,9 +131,9 @@ public:
 	
 	ASFUNCTION_ATOM(generator);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	std::string toDebugString() { return std::string("\"") + std::string(getData()) + "\""; }
 	static bool isEcmaSpace(uint32_t c);
 	static bool isEcmaLineTerminator(uint32_t c);
@@ -107,6 +141,7 @@ public:
 	{ 
 		data.clear(); 
 		strlength.reset();
+		releaseRope();
 		hasId = false;
 		datafilled=false; 
 		if (!ASObject::destruct())
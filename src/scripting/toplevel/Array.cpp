@@ -24,14 +24,15 @@
 #include "scripting/toplevel/Vector.h"
 #include "scripting/toplevel/RegExp.h"
 #include "scripting/flash/utils/flashutils.h"
+#include <algorithm>
 
 using namespace std;
 using namespace lightspark;
 
-// maximum index stored in vector
+// maximum index stored in the vector of sparse arrays
 #define ARRAY_SIZE_THRESHOLD 65536
 
-Array::Array(Class_base* c):ASObject(c,T_ARRAY),currentsize(0)
+Array::Array(Class_base* c):ASObject(c,T_ARRAY),currentsize(0),dense_limit(UINT32_MAX)
 {
 }
 
@@ -39,6 +40,7 @@ void Array::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_DYNAMIC_NOT_FINAL);
 	c->isReusable = true;
+	c->overridesPropertyAccess = true;
 	c->setVariableByQName("CASEINSENSITIVE","",abstract_di(c->getSystemState(),CASEINSENSITIVE),CONSTANT_TRAIT);
 	c->setVariableByQName("DESCENDING","",abstract_di(c->getSystemState(),DESCENDING),CONSTANT_TRAIT);
 	c->setVariableByQName("NUMERIC","",abstract_di(c->getSystemState(),NUMERIC),CONSTANT_TRAIT);
@@ -143,6 +145,8 @@ ASFUNCTIONBODY_ATOM(Array,_concat)
 	
 	// copy values into new array
 	ret->resize(th->size());
+	ret->dense_limit=th->dense_limit;
+	ret->data_first.reserve(th->data_first.size());
 	auto it1=th->data_first.begin();
 	for(;it1 != th->data_first.end();++it1)
 	{
@@ -205,20 +209,10 @@ ASFUNCTIONBODY_ATOM(Array,filter)
 	while (index < th->currentsize)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom a =th->data_first[index-1];
-			if (a.type == T_INVALID)
-				continue;
-			params[0] = a;
-		}
-		else
-		{
-			auto it=th->data_second.find(index-1);
-			if (it == th->data_second.end())
-				continue;
-			params[0] = it->second;
-		}
+		asAtom a = th->getItem(index-1);
+		if (a.type == T_INVALID)
+			continue;
+		params[0] = a;
 
 		params[1] = asAtom(index-1);
 		params[2] = asAtom::fromObject(th);
@@ -263,20 +257,10 @@ ASFUNCTIONBODY_ATOM(Array, some)
 	while (index < th->currentsize)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom a =th->data_first[index-1];
-			if (a.type == T_INVALID)
-				continue;
-			params[0] = a;
-		}
-		else
-		{
-			auto it=th->data_second.find(index-1);
-			if (it == th->data_second.end())
-				continue;
-			params[0] = it->second;
-		}
+		asAtom a = th->getItem(index-1);
+		if (a.type == T_INVALID)
+			continue;
+		params[0] = a;
 		params[1] = asAtom(index-1);
 		params[2] = asAtom::fromObject(th);
 
@@ -315,20 +299,10 @@ ASFUNCTIONBODY_ATOM(Array, every)
 	while (index < th->currentsize)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom a =th->data_first[index-1];
-			if (a.type == T_INVALID)
-				continue;
-			params[0] = a;
-		}
-		else
-		{
-			auto it=th->data_second.find(index-1);
-			if (it == th->data_second.end())
-				continue;
-			params[0] = it->second;
-		}
+		asAtom a = th->getItem(index-1);
+		if (a.type == T_INVALID)
+			continue;
+		params[0] = a;
 		params[1] = asAtom(index-1);
 		params[2] = asAtom::fromObject(th);
 
@@ -386,22 +360,10 @@ ASFUNCTIONBODY_ATOM(Array,forEach)
 	while (index < s)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom a =th->data_first[index-1];
-			if (a.type == T_INVALID)
-				continue;
-			else
-				params[0] = a;
-		}
-		else
-		{
-			auto it=th->data_second.find(index-1);
-			if (it == th->data_second.end())
-				continue;
-			else
-				params[0]=it->second;
-		}
+		asAtom a = th->getItem(index-1);
+		if (a.type == T_INVALID)
+			continue;
+		params[0] = a;
 		params[1] = asAtom(index-1);
 		params[2] = asAtom::fromObject(th);
 
@@ -424,7 +386,7 @@ ASFUNCTIONBODY_ATOM(Array, _reverse)
 {
 	Array* th=obj.as<Array>();
 
-	if (th->data_second.empty())
+	if (th->data_second.empty() && th->data_first.size() == th->currentsize)
 		std::reverse(th->data_first.begin(),th->data_first.end());
 	else
 	{
@@ -479,20 +441,9 @@ ASFUNCTIONBODY_ATOM(Array,lastIndexOf)
 	}
 	do
 	{
-		asAtom a;
-		if ( i >= ARRAY_SIZE_THRESHOLD)
-		{
-			auto it = th->data_second.find(i);
-			if (it == th->data_second.end())
-				continue;
-			a = it->second;
-		}
-		else
-		{
-			a = th->data_first[i];
-			if (a.type == T_INVALID)
-				continue;
-		}
+		asAtom a = th->getItem(i);
+		if (a.type == T_INVALID)
+			continue;
 		if(a.isEqualStrict(th->getSystemState(),arg0))
 		{
 			ret=i;
@@ -538,20 +489,23 @@ ASFUNCTIONBODY_ATOM(Array,shift)
 	if (th->data_first.size() > 0)
 		th->data_first.erase(th->data_first.begin());
 
-	std::unordered_map<uint32_t,asAtom> tmp;
-	auto it=th->data_second.begin();
-	for (; it != th->data_second.end(); ++it )
+	if (!th->data_second.empty())
 	{
-		if(it->first)
+		std::unordered_map<uint32_t,asAtom> tmp;
+		auto it=th->data_second.begin();
+		for (; it != th->data_second.end(); ++it )
 		{
-			if (it->first == ARRAY_SIZE_THRESHOLD)
-				th->data_first[ARRAY_SIZE_THRESHOLD-1] = it->second;
+			if (it->first == th->dense_limit)
+			{
+				if (th->data_first.size() < th->dense_limit)
+					th->data_first.resize(th->dense_limit);
+				th->data_first[th->dense_limit-1] = it->second;
+			}
 			else
 				tmp[it->first-1]=it->second;
 		}
+		th->data_second.swap(tmp);
 	}
-	th->data_second.clear();
-	th->data_second.insert(tmp.begin(),tmp.end());
 	th->resize(th->size()-1);
 	return ret;
 }
@@ -611,9 +565,26 @@ ASFUNCTIONBODY_ATOM(Array,splice)
 
 	startIndex=th->capIndex(startIndex);
 
+	if(deleteCount<0)
+		deleteCount=0;
 	if((uint32_t)(startIndex+deleteCount)>totalSize)
 		deleteCount=totalSize-startIndex;
 
+	uint32_t insertCount = argslen > 2 ? argslen-2 : 0;
+	if (th->isDense() && th->data_first.size() >= (uint32_t)(startIndex+deleteCount))
+	{
+		// all affected elements are in the vector, so they can be moved in one go
+		auto first = th->data_first.begin()+startIndex;
+		ret->data_first.assign(first,first+deleteCount);
+		ret->resize(deleteCount);
+		th->data_first.erase(first,first+deleteCount);
+		for(uint32_t i=0;i<insertCount;i++)
+			ASATOM_INCREF(args[i+2]);
+		th->data_first.insert(th->data_first.begin()+startIndex,args+2,args+2+insertCount);
+		th->currentsize = totalSize-deleteCount+insertCount;
+		return asAtom::fromObject(ret);
+	}
+
 	ret->resize(deleteCount);
 	if(deleteCount)
 	{
@@ -627,7 +598,7 @@ ASFUNCTIONBODY_ATOM(Array,splice)
 		// delete items from current array
 		for (int i = 0; i < deleteCount; i++)
 		{
-			if (i+startIndex < ARRAY_SIZE_THRESHOLD)
+			if ((uint32_t)(i+startIndex) < th->dense_limit)
 			{
 				if ((uint32_t)startIndex <th->data_first.size())
 					th->data_first.erase(th->data_first.begin()+startIndex);
@@ -646,7 +617,7 @@ ASFUNCTIONBODY_ATOM(Array,splice)
 	vector<asAtom> tmp = vector<asAtom>(totalSize- (startIndex+deleteCount));
 	for (uint32_t i = (uint32_t)startIndex+deleteCount; i < totalSize ; i++)
 	{
-		if (i < ARRAY_SIZE_THRESHOLD)
+		if (i < th->dense_limit)
 		{
 			if ((uint32_t)startIndex < th->data_first.size())
 			{
@@ -674,11 +645,11 @@ ASFUNCTIONBODY_ATOM(Array,splice)
 		th->push(args[i]);
 	}
 	// move remembered items to new position
-	th->resize((totalSize-deleteCount)+(argslen > 2 ? argslen-2 : 0));
+	th->resize((totalSize-deleteCount)+insertCount);
 	for(uint32_t i=0;i<totalSize- (startIndex+deleteCount);i++)
 	{
 		if (tmp[i].type != T_INVALID)
-			th->set(startIndex+i+(argslen > 2 ? argslen-2 : 0),tmp[i],false);
+			th->set(startIndex+i+insertCount,tmp[i],false);
 	}
 	return asAtom::fromObject(ret);
 }
@@ -768,9 +739,10 @@ ASFUNCTIONBODY_ATOM(Array,_pop)
 		return asAtom::undefinedAtom;
 	asAtom ret = asAtom::undefinedAtom;
 	
-	if (size <= ARRAY_SIZE_THRESHOLD)
+	if (size-1 < th->dense_limit)
 	{
-		if (th->data_first.size() > 0)
+		// data_first never extends beyond the length, so the last element is either at its end or a hole
+		if (th->data_first.size() == size)
 		{
 			ret = *th->data_first.rbegin();
 			th->data_first.pop_back();
@@ -838,6 +810,17 @@ bool Array::sortComparatorDefault::operator()(const asAtom& d1, const asAtom& d2
 	}
 }
 
+bool Array::sortComparatorNumeric::operator()(const asAtom& d1, const asAtom& d2)
+{
+	asAtom o1 = d1;
+	asAtom o2 = d2;
+	if (o1.type == T_INTEGER && o2.type == T_INTEGER)
+		return isDescending ? o1.toInt() > o2.toInt() : o1.toInt() < o2.toInt();
+	number_t a=o1.toNumber();
+	number_t b=o2.toNumber();
+	return isDescending ? b<a : a<b;
+}
+
 bool Array::sortComparatorWrapper::operator()(const asAtom& d1, const asAtom& d2)
 {
 	asAtom objs[2];
@@ -850,6 +833,81 @@ bool Array::sortComparatorWrapper::operator()(const asAtom& d1, const asAtom& d2
 	return (ret.toNumber()<0); //Less
 }
 
+// compares the elements at two positions of the vector being sorted
+template<class T>
+class sortIndexComparator
+{
+private:
+	const std::vector<asAtom>& elements;
+	T& comparator;
+public:
+	sortIndexComparator(const std::vector<asAtom>& e, T& c):elements(e),comparator(c){}
+	bool operator()(uint32_t i1, uint32_t i2)
+	{
+		return comparator(elements[i1],elements[i2]);
+	}
+};
+
+/* Sorts the elements that prepareSort moved to the start of data_first.
+ * The comparators may run AS code that modifies this array, so the elements are
+ * moved to a local vector while they are sorted. Only their positions are sorted,
+ * so the elements stay intact if the comparator throws */
+template<class T>
+void Array::sortElements(T comparator)
+{
+	std::vector<asAtom> elements;
+	elements.swap(data_first);
+	uint64_t size=currentsize;
+	std::vector<uint32_t> order(elements.size());
+	for(uint32_t i=0;i<order.size();i++)
+		order[i]=i;
+	try
+	{
+		stable_sort(order.begin(),order.end(),sortIndexComparator<T>(elements,comparator));
+	}
+	catch(...)
+	{
+		restoreElements(elements,size);
+		throw;
+	}
+	//Move the elements to their sorted positions, one cycle of the permutation at a time
+	for(uint32_t i=0;i<order.size();i++)
+	{
+		if(order[i]==i)
+			continue;
+		asAtom first=elements[i];
+		uint32_t j=i;
+		while(order[j]!=i)
+		{
+			uint32_t k=order[j];
+			elements[j]=elements[k];
+			order[j]=j;
+			j=k;
+		}
+		elements[j]=first;
+		order[j]=j;
+	}
+	restoreElements(elements,size);
+}
+
+void Array::restoreElements(std::vector<asAtom>& elements, uint64_t size)
+{
+	//Anything the comparator stored in the array in the meantime is dropped
+	for (auto it=data_first.begin() ; it != data_first.end(); ++it)
+	{
+		ASATOM_DECREF_POINTER(it);
+	}
+	for (auto it=data_second.begin() ; it != data_second.end(); ++it)
+	{
+		ASATOM_DECREF(it->second);
+	}
+	data_first.clear();
+	data_second.clear();
+	data_first.swap(elements);
+	currentsize=size;
+	dense_limit=UINT32_MAX;
+}
+
 ASFUNCTIONBODY_ATOM(Array,_sort)
 {
 	Array* th=obj.as<Array>();
@@ -877,39 +935,13 @@ ASFUNCTIONBODY_ATOM(Array,_sort)
 				throw UnsupportedException("Array::sort not completely implemented");
 		}
 	}
-	std::vector<asAtom> tmp;
-	auto it1=th->data_first.begin();
-	for(;it1 != th->data_first.end();++it1)
-	{
-		if (it1->type==T_INVALID || it1->type==T_UNDEFINED)
-			continue;
-		// ensure ASObjects are created
-		it1->toObject(sys);
-		tmp.push_back(*it1);
-	}
-	auto it2=th->data_second.begin();
-	for(;it2 != th->data_second.end();++it2)
-	{
-		if (it2->second.type==T_INVALID || it2->second.type==T_UNDEFINED)
-			continue;
-		// ensure ASObjects are created
-		it2->second.toObject(sys);
-		tmp.push_back(it2->second);
-	}
-	
+	bool allNumeric = th->prepareSort();
 	if(comp.type != T_INVALID)
-		sort(tmp.begin(),tmp.end(),sortComparatorWrapper(comp));
+		th->sortElements(sortComparatorWrapper(comp));
+	else if(isNumeric && allNumeric)
+		th->sortElements(sortComparatorNumeric(isDescending));
 	else
-		sort(tmp.begin(),tmp.end(),sortComparatorDefault(isNumeric,isCaseInsensitive,isDescending));
-
-	th->data_first.clear();
-	th->data_second.clear();
-	std::vector<asAtom>::iterator ittmp=tmp.begin();
-	int i = 0;
-	for(;ittmp != tmp.end();++ittmp)
-	{
-		th->set(i++,*ittmp,false);
-	}
+		th->sortElements(sortComparatorDefault(isNumeric,isCaseInsensitive,isDescending));
 	ASATOM_INCREF(obj);
 	return obj;
 }
@@ -1028,36 +1060,13 @@ ASFUNCTIONBODY_ATOM(Array,sortOn)
 		sortfields.push_back(sf);
 	}
 	
-	std::vector<asAtom> tmp;
-	auto it1=th->data_first.begin();
-	for(;it1 != th->data_first.end();++it1)
+	if (th->prepareSort())
 	{
-		if (it1->type==T_INVALID || it1->type==T_UNDEFINED)
-			continue;
-		// ensure ASObjects are created
-		it1->toObject(sys);
-		tmp.push_back(*it1);
-	}
-	auto it2=th->data_second.begin();
-	for(;it2 != th->data_second.end();++it2)
-	{
-		if (it2->second.type==T_INVALID || it2->second.type==T_UNDEFINED)
-			continue;
-		// ensure ASObjects are created
-		it2->second.toObject(sys);
-		tmp.push_back(it2->second);
-	}
-	
-	sort(tmp.begin(),tmp.end(),sortOnComparator(sortfields));
-
-	th->data_first.clear();
-	th->data_second.clear();
-	std::vector<asAtom>::iterator ittmp=tmp.begin();
-	uint32_t i = 0;
-	for(;ittmp != tmp.end();++ittmp)
-	{
-		th->set(i++, *ittmp,false);
+		// the comparator reads properties, so numbers need objects as well
+		for(auto it=th->data_first.begin();it != th->data_first.end();++it)
+			it->toObject(sys);
 	}
+	th->sortElements(sortOnComparator(sortfields));
 	ASATOM_INCREF(obj);
 	return obj;
 }
@@ -1088,7 +1097,14 @@ ASFUNCTIONBODY_ATOM(Array,unshift)
 	// Derived classes may be sealed!
 	if (th->getClass() && th->getClass()->isSealed)
 		throwError<ReferenceError>(kWriteSealedError,"unshift",th->getClass()->getQualifiedClassName());
-	if (argslen > 0)
+	if (argslen > 0 && th->isDense() && th->size()+argslen < UINT32_MAX)
+	{
+		for(uint32_t i=0;i<argslen;i++)
+			ASATOM_INCREF(args[i]);
+		th->data_first.insert(th->data_first.begin(),args,args+argslen);
+		th->currentsize+=argslen;
+	}
+	else if (argslen > 0)
 	{
 		th->resize(th->size()+argslen);
 		std::map<uint32_t,asAtom> tmp;
@@ -1203,22 +1219,11 @@ ASFUNCTIONBODY_ATOM(Array,_map)
 	while (index < s)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom a = th->data_first[index-1];
-			if(a.type!=T_INVALID)
-				params[0] = a;
-			else
-				params[0]=asAtom::undefinedAtom;
-		}
+		asAtom a = th->getItem(index-1);
+		if(a.type!=T_INVALID)
+			params[0] = a;
 		else
-		{
-			auto it=th->data_second.find(index);
-			if(it->second.type!=T_INVALID)
-				params[0]=it->second;
-			else
-				params[0]=asAtom::undefinedAtom;
-		}
+			params[0]=asAtom::undefinedAtom;
 		params[1] = asAtom(index-1);
 		params[2] = asAtom::fromObject(th);
 		asAtom funcRet;
@@ -1280,32 +1285,46 @@ ASFUNCTIONBODY_ATOM(Array,insertAt)
 		th->currentsize++;
 		th->set(th->currentsize-1,o,false);
 	}
+	else if (th->isDense())
+	{
+		if ((uint32_t)index < th->data_first.size())
+		{
+			ASATOM_INCREF(o);
+			th->data_first.insert(th->data_first.begin()+index,o);
+			th->currentsize++;
+		}
+		else
+		{
+			// only holes are moved
+			th->currentsize++;
+			th->set(index,o,false);
+		}
+	}
 	else
 	{
 		std::map<uint32_t,asAtom> tmp;
-		if (index < ARRAY_SIZE_THRESHOLD)
+		if ((uint32_t)index < th->data_first.size())
 			th->data_first.insert(th->data_first.begin()+index,o);
 		auto it=th->data_second.begin();
 		for (; it != th->data_second.end(); ++it )
 		{
 			tmp[it->first+(it->first >= (uint32_t)index ? 1 : 0)]=it->second;
 		}
-		if (th->data_first.size() > ARRAY_SIZE_THRESHOLD)
+		if (th->data_first.size() > th->dense_limit)
 		{
-			tmp[ARRAY_SIZE_THRESHOLD] = th->data_first[ARRAY_SIZE_THRESHOLD];
+			tmp[th->dense_limit] = th->data_first[th->dense_limit];
 			th->data_first.pop_back();
 		}
 		th->data_second.clear();
+		th->currentsize++;
 		auto ittmp = tmp.begin();
 		while (ittmp != tmp.end())
 		{
 			th->set(ittmp->first,ittmp->second,false);
 			ittmp++;
 		}
-		th->currentsize++;
 		th->set(index,o,false);
 	}
-	LOG(LOG_ERROR,"insertat:"<<index<<" "<<th->toString_priv());
 	return asAtom::invalidAtom;
 }
 
@@ -1319,7 +1338,7 @@ ASFUNCTIONBODY_ATOM(Array,removeAt)
 	if (index < 0)
 		index = 0;
 	asAtom o;
-	if (index < ARRAY_SIZE_THRESHOLD)
+	if ((uint32_t)index < th->dense_limit)
 	{
 		if ((uint32_t)index < th->data_first.size())
 		{
@@ -1338,17 +1357,23 @@ ASFUNCTIONBODY_ATOM(Array,removeAt)
 	}
 	if ((uint32_t)index < th->currentsize)
 		th->currentsize--;
-	std::map<uint32_t,asAtom> tmp;
-	auto it=th->data_second.begin();
-	for (; it != th->data_second.end(); ++it )
+	if (!th->data_second.empty())
 	{
-		if (it->first == ARRAY_SIZE_THRESHOLD)
-			th->data_first[ARRAY_SIZE_THRESHOLD-1]=it->second;
-		else
-			tmp[it->first-(it->first > (uint32_t)index ? 1 : 0)]=it->second;
+		std::unordered_map<uint32_t,asAtom> tmp;
+		auto it=th->data_second.begin();
+		for (; it != th->data_second.end(); ++it )
+		{
+			if (it->first == th->dense_limit)
+			{
+				if (th->data_first.size() < th->dense_limit)
+					th->data_first.resize(th->dense_limit);
+				th->data_first[th->dense_limit-1]=it->second;
+			}
+			else
+				tmp[it->first-(it->first > (uint32_t)index ? 1 : 0)]=it->second;
+		}
+		th->data_second.swap(tmp);
 	}
-	th->data_second.clear();
-	th->data_second.insert(tmp.begin(),tmp.end());
 	return o;
 }
 int32_t Array::getVariableByMultiname_i(const multiname& name)
@@ -1360,7 +1385,7 @@ int32_t Array::getVariableByMultiname_i(const multiname& name)
 
 	if(index<size())
 	{
-		if (index < ARRAY_SIZE_THRESHOLD)
+		if (index < dense_limit)
 		{
 			return data_first.size() > index ? data_first[index].toInt() : 0;
 		}
@@ -1386,20 +1411,9 @@ asAtom Array::getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION
 	if(!isValidMultiname(getSystemState(),name,index))
 		return ASObject::getVariableByMultiname(name,opt);
 
-	if (index < ARRAY_SIZE_THRESHOLD)
-	{
-		if (data_first.size() > index)
-		{
-			asAtom a = data_first[index];
-			if (a.type != T_INVALID)
-				return a;
-		}
-	}
-	auto it = data_second.find(index);
-	if(it != data_second.end())
-	{
-		return it->second;
-	}
+	asAtom a = getItem(index);
+	if (a.type != T_INVALID)
+		return a;
 	if (name.hasEmptyNS)
 	{
 		asAtom ret;
@@ -1447,12 +1461,7 @@ bool Array::hasPropertyByMultiname(const multiname& name, bool considerDynamic,
 	if(!isValidMultiname(getSystemState(),name,index))
 		return ASObject::hasPropertyByMultiname(name, considerDynamic, considerPrototype);
 
-	if (index < ARRAY_SIZE_THRESHOLD)
-	{
-		return data_first.size() > index ? (data_first[index].type != T_INVALID) : false;
-	}
-	
-	return (data_second.find(index) != data_second.end());
+	return getItem(index).type != T_INVALID;
 }
 
 bool Array::isValidMultiname(SystemState* sys, const multiname& name, uint32_t& index)
@@ -1583,18 +1592,7 @@ tiny_string Array::toString_priv(bool localized)
 	string ret;
 	for(uint32_t i=0;i<size();i++)
 	{
-		asAtom sl;
-		if (i < ARRAY_SIZE_THRESHOLD)
-		{
-			if (i < data_first.size())
-				sl = data_first[i];
-		}
-		else
-		{
-			auto it = data_second.find(i);
-			if(it != data_second.end())
-				sl = it->second;
-		}
+		asAtom sl = getItem(i);
 		if(sl.type != T_UNDEFINED && sl.type != T_NULL && sl.type != T_INVALID)
 		{
 			if (localized)
@@ -1614,16 +1612,7 @@ asAtom Array::nextValue(uint32_t index)
 	if(index<=size())
 	{
 		--index;
-		asAtom sl;
-		if (index < ARRAY_SIZE_THRESHOLD)
-			sl = data_first[index];
-		else
-		{
-			auto it = data_second.find(index);
-			if(it == data_second.end() || it->first != index)
-				return asAtom::undefinedAtom;
-			sl = it->second;
-		}
+		asAtom sl = getItem(index);
 		if(sl.type == T_INVALID)
 			return asAtom::undefinedAtom;
 		else
@@ -1644,7 +1633,7 @@ uint32_t Array::nextNameIndex(uint32_t cur_index)
 	assert_and_throw(implEnable);
 	if(cur_index<size())
 	{
-		while (cur_index < ARRAY_SIZE_THRESHOLD && cur_index<size() && cur_index < data_first.size() && data_first[cur_index].type == T_INVALID)
+		while (cur_index < dense_limit && cur_index<size() && cur_index < data_first.size() && data_first[cur_index].type == T_INVALID)
 		{
 			cur_index++;
 		}
@@ -1684,18 +1673,7 @@ asAtom Array::at(unsigned int index)
 	if(size()<=index)
 		outofbounds(index);
 	
-	asAtom ret;
-	if (index < ARRAY_SIZE_THRESHOLD)
-	{
-		if (index < data_first.size())
-			ret = data_first[index];
-	}
-	else
-	{
-		auto it = data_second.find(index);
-		if (it != data_second.end())
-			ret = it->second;
-	}
+	asAtom ret = getItem(index);
 	if(ret.type != T_INVALID)
 	{
 		return ret;
@@ -1708,6 +1686,77 @@ void Array::outofbounds(unsigned int index) const
 	throwError<RangeError>(kInvalidArrayLengthError, Number::toString(index));
 }
 
+void Array::makeSparse()
+{
+	for (uint32_t i=ARRAY_SIZE_THRESHOLD; i < data_first.size(); i++)
+	{
+		if (data_first[i].type != T_INVALID)
+			data_second[i]=data_first[i];
+	}
+	if (data_first.size() > ARRAY_SIZE_THRESHOLD)
+		data_first.resize(ARRAY_SIZE_THRESHOLD);
+	dense_limit=ARRAY_SIZE_THRESHOLD;
+}
+
+void Array::makeDense()
+{
+	// all keys in the map are below currentsize
+	data_first.resize(currentsize);
+	for (auto it=data_second.begin(); it != data_second.end(); ++it)
+		data_first[it->first]=it->second;
+	data_second.clear();
+	dense_limit=UINT32_MAX;
+}
+
+// compares the original indexes of elements taken from data_second
+static bool lessIndex(const std::pair<uint32_t,asAtom>& a, const std::pair<uint32_t,asAtom>& b)
+{
+	return a.first < b.first;
+}
+static bool isHoleOrUndefined(const asAtom& a)
+{
+	return a.type==T_INVALID || a.type==T_UNDEFINED;
+}
+
+/*
+ * Moves all elements to the start of data_first, in index order and without holes and
+ * undefined values, so that sort and sortOn can work on them in place. Returns true if all
+ * remaining elements are numbers other than NaN, otherwise the ASObjects for all elements
+ * are created, so that the comparators don't create them again on every comparison.
+ */
+bool Array::prepareSort()
+{
+	if (!data_second.empty())
+	{
+		std::vector<std::pair<uint32_t,asAtom>> tmp(data_second.begin(),data_second.end());
+		std::sort(tmp.begin(),tmp.end(),lessIndex);
+		data_first.reserve(data_first.size()+tmp.size());
+		for (auto it=tmp.begin(); it != tmp.end(); ++it)
+			data_first.push_back(it->second);
+		data_second.clear();
+	}
+	// the sorted elements are at indexes 0..n-1, so the array is dense afterwards
+	dense_limit=UINT32_MAX;
+	data_first.erase(std::remove_if(data_first.begin(),data_first.end(),isHoleOrUndefined),data_first.end());
+
+	bool allNumeric=true;
+	for (auto it=data_first.begin(); it != data_first.end(); ++it)
+	{
+		if (it->type == T_INTEGER || it->type == T_UINTEGER)
+			continue;
+		if (it->type == T_NUMBER && !std::isnan(it->toNumber()))
+			continue;
+		allNumeric=false;
+		break;
+	}
+	if (!allNumeric)
+	{
+		for (auto it=data_first.begin(); it != data_first.end(); ++it)
+			it->toObject(getSystemState());
+	}
+	return allNumeric;
+}
+
 void Array::resize(uint64_t n)
 {
 	// Bug-for-bug compatible wrapping. See Tamarin test
@@ -1719,12 +1768,11 @@ void Array::resize(uint64_t n)
 	{
 		if (n < data_first.size())
 		{
-			auto it1 = data_first.begin()+n;
-			while (it1 != data_first.end())
+			for (auto it1 = data_first.begin()+n; it1 != data_first.end(); ++it1)
 			{
 				ASATOM_DECREF((*it1));
-				it1 = data_first.erase(it1);
 			}
+			data_first.erase(data_first.begin()+n,data_first.end());
 		}
 		auto it2=data_second.begin();
 		while (it2 != data_second.end())
@@ -1741,11 +1789,13 @@ void Array::resize(uint64_t n)
 		}
 	}
 	currentsize = n;
+	if (!isDense() && (data_first.size()+data_second.size())*2 >= currentsize)
+		makeDense();
 }
 
-void Array::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Array::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -1773,30 +1823,19 @@ void Array::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap
 		serializeDynamicProperties(out, stringMap, objMap, traitsMap);
 		for(uint32_t i=0;i<denseCount;i++)
 		{
-			if (i < ARRAY_SIZE_THRESHOLD)
-			{
-				if (data_first[i].type == T_INVALID)
-					out->writeByte(null_marker);
-				else
-					data_first[i].toObject(getSystemState())->serialize(out, stringMap, objMap, traitsMap);
-			}
+			asAtom a = getItem(i);
+			if (a.type == T_INVALID)
+				out->writeByte(null_marker);
 			else
-			{
-				if (data_second.find(i) == data_second.end())
-					out->writeByte(null_marker);
-				else
-					data_second.at(i).toObject(getSystemState())->serialize(out, stringMap, objMap, traitsMap);
-			}
+				a.serialize(out, stringMap, objMap, traitsMap);
 		}
 	}
 }
 
-tiny_string Array::toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string& spaces,const tiny_string& filter)
+void Array::appendJSON(std::string& res, std::vector<ASObject *> &path, asAtom replacer, const tiny_string& spaces,const tiny_string& filter)
 {
-	bool ok;
-	tiny_string res = call_toJSON(ok,path,replacer,spaces,filter);
-	if (ok)
-		return res;
+	if (call_toJSON(res,path,replacer,spaces,filter))
+		return;
 	// check for cylic reference
 	if (std::find(path.begin(),path.end(), this) != path.end())
 		throwError<TypeError>(kJSONCyclicStructure);
@@ -1804,20 +1843,18 @@ tiny_string Array::toJSON(std::vector<ASObject *> &path, asAtom replacer, const
 	path.push_back(this);
 	res += "[";
 	bool bfirst = true;
-	tiny_string newline = (spaces.empty() ? "" : "\n");
+	const char* newline = (spaces.empty() ? "" : "\n");
 	uint32_t denseCount = currentsize;
 	for (uint32_t i=0 ; i < denseCount; i++)
 	{
-		asAtom a;
-		if ( i < ARRAY_SIZE_THRESHOLD)
-			a = data_first[i];
-		else
-		{
-			auto it = data_second.find(i);
-			if (it != data_second.end())
-				a = it->second;
-		}
-		tiny_string subres;
+		asAtom a = getItem(i);
+		// the separator is written before the element and dropped again if the element is empty
+		size_t elementStart = res.size();
+		if (!bfirst)
+			res += ",";
+		res += newline;
+		res.append(spaces.raw_buf(),spaces.numBytes());
+		size_t valueStart = res.size();
 		if (replacer.type != T_INVALID && a.type != T_INVALID)
 		{
 			asAtom params[2];
@@ -1826,32 +1863,26 @@ tiny_string Array::toJSON(std::vector<ASObject *> &path, asAtom replacer, const
 			params[1] = a;
 			asAtom funcret=replacer.callFunction(asAtom::nullAtom, params, 2,false);
 			if (funcret.type != T_INVALID)
-				subres = funcret.toObject(getSystemState())->toJSON(path,asAtom::invalidAtom,spaces,filter);
+				funcret.toObject(getSystemState())->appendJSON(res,path,asAtom::invalidAtom,spaces,filter);
 		}
 		else
 		{
 			ASObject* o = a.type == T_INVALID ? getSystemState()->getNullRef() : a.toObject(getSystemState());
 			if (o)
-				subres = o->toJSON(path,replacer,spaces,filter);
-			else
-				continue;
+				o->appendJSON(res,path,replacer,spaces,filter);
 		}
-		if (!subres.empty())
-		{
-			if (!bfirst)
-				res += ",";
-			res += newline+spaces;
-			
+		if (res.size() == valueStart)
+			res.resize(elementStart);
+		else
 			bfirst = false;
-			res += subres;
-		}
 	}
 	if (!bfirst)
-		res += newline+spaces.substr_bytes(0,spaces.numBytes()/2);
+	{
+		res += newline;
+		res.append(spaces.raw_buf(),spaces.numBytes()/2);
+	}
 	res += "]";
 	path.pop_back();
-	return res;
-	
 }
 
 Array::~Array()
@@ -1862,7 +1893,10 @@ void Array::set(unsigned int index, asAtom& o, bool checkbounds)
 {
 	if(index<currentsize)
 	{
-		if (index < ARRAY_SIZE_THRESHOLD)
+		// less than a quarter of the vector would be filled, switch to the map for big indexes
+		if (index < dense_limit && index >= ARRAY_SIZE_THRESHOLD && index/4 > data_first.size())
+			makeSparse();
+		if (index < dense_limit)
 		{
 			if (index < data_first.size())
 				ASATOM_DECREF(data_first[index]);
@@ -1874,10 +1908,20 @@ void Array::set(unsigned int index, asAtom& o, bool checkbounds)
 		}
 		else
 		{
-			if(data_second.find(index) != data_second.end())
-				ASATOM_DECREF(data_second[index]);
-			ASATOM_INCREF(o);
-			data_second[index]=o;
+			auto it = data_second.find(index);
+			if(it != data_second.end())
+			{
+				ASATOM_DECREF(it->second);
+				ASATOM_INCREF(o);
+				it->second=o;
+			}
+			else
+			{
+				ASATOM_INCREF(o);
+				data_second[index]=o;
+				if ((data_first.size()+data_second.size())*2 >= currentsize)
+					makeDense();
+			}
 		}
 	}
 	else if (checkbounds)
@@ -40,11 +40,29 @@ class Array: public ASObject
 friend class ABCVm;
 protected:
 	uint64_t currentsize;
-	// data is split into a vector for the first ARRAY_SIZE_THRESHOLD indexes, and a map for bigger indexes
+	// data is split into a vector for all indexes below dense_limit, and a map for bigger indexes.
+	// Arrays start out dense (dense_limit is UINT32_MAX, the map is empty). Writing far beyond the
+	// filled part switches to the sparse representation, where dense_limit is ARRAY_SIZE_THRESHOLD.
+	// The array becomes dense again once the map is empty or the elements fill at least half of it
+	uint32_t dense_limit;
 	std::vector<asAtom> data_first;
 	std::unordered_map<uint32_t,asAtom> data_second;
 	
 	void outofbounds(unsigned int index) const;
+	// returns the element at index, or an invalid atom for holes
+	asAtom getItem(uint32_t index) const
+	{
+		if (index < dense_limit)
+			return index < data_first.size() ? data_first[index] : asAtom::invalidAtom;
+		auto it = data_second.find(index);
+		return it != data_second.end() ? it->second : asAtom::invalidAtom;
+	}
+	bool isDense() const { return dense_limit == UINT32_MAX; }
+	void makeSparse();
+	void makeDense();
+	bool prepareSort();
+	template<class T> void sortElements(T comparator);
+	void restoreElements(std::vector<asAtom>& elements, uint64_t size);
 	~Array();
 private:
 	class sortComparatorDefault
@@ -57,6 +75,15 @@ private:
 		sortComparatorDefault(bool n, bool ci, bool d):isNumeric(n),isCaseInsensitive(ci),isDescending(d){}
 		bool operator()(const asAtom& d1, const asAtom& d2);
 	};
+	// used by sort(Array.NUMERIC) when all elements are numbers that are not NaN
+	class sortComparatorNumeric
+	{
+	private:
+		bool isDescending;
+	public:
+		sortComparatorNumeric(bool d):isDescending(d){}
+		bool operator()(const asAtom& d1, const asAtom& d2);
+	};
 	class sortComparatorWrapper
 	{
 	private:
@@ -93,6 +120,7 @@ public:
 		data_first.clear();
 		data_second.clear();
 		currentsize=0;
+		dense_limit=UINT32_MAX;
 		return ASObject::destruct();
 	}
 	
@@ -135,6 +163,12 @@ public:
 	void set(unsigned int index, asAtom &o, bool checkbounds = true);
 	uint64_t size();
 	void push(asAtom o);
+	//Preallocates storage for n dense elements
+	void reserve(uint32_t n)
+	{
+		if (isDense())
+			data_first.reserve(n);
+	}
 	void resize(uint64_t n);
 	asAtom getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt);
 	int32_t getVariableByMultiname_i(const multiname& name);
@@ -147,10 +181,10 @@ public:
 	asAtom nextName(uint32_t index);
 	asAtom nextValue(uint32_t index);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
-	virtual tiny_string toJSON(std::vector<ASObject *> &path,asAtom replacer, const tiny_string &spaces,const tiny_string& filter);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
+	void appendJSON(std::string& res, std::vector<ASObject *> &path,asAtom replacer, const tiny_string &spaces,const tiny_string& filter);
 };
 
 
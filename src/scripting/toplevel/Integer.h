@@ -60,9 +60,9 @@ public:
 	ASFUNCTION_ATOM(_toPrecision);
 	std::string toDebugString() { return toString()+"i"; }
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	/*
 	 * This method skips trailing spaces and zeroes
 	 */
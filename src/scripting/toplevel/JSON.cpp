@@ -17,6 +17,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************/
 
+#include <cstring>
 #include "scripting/argconv.h"
 #include "scripting/toplevel/JSON.h"
 
@@ -135,35 +136,44 @@ ASFUNCTIONBODY_ATOM(JSON,_stringify)
 
 	return asAtom::fromObject(abstract_s(sys,res));
 }
+/*
+ * The parser works on byte offsets into the UTF-8 buffer of the input string.
+ * All the tokens that drive the parser are ASCII, so multi byte characters
+ * only need to be copied inside strings and the input is never copied or
+ * indexed by character.
+ */
+static inline uint32_t skipWhitespace(const char* buf, uint32_t pos)
+{
+	// the buffer is always terminated by \0, so this never reads past its end
+	while (buf[pos] == ' ' ||
+		   buf[pos] == '\t' ||
+		   buf[pos] == '\n' ||
+		   buf[pos] == '\r'
+		   )
+		pos++;
+	return pos;
+}
 void JSON::parseAll(const tiny_string &jsonstring, ASObject** parent , const multiname& key, asAtom reviver)
 {
-	int len = jsonstring.numChars();
-	int pos = 0;
+	const char* buf = jsonstring.raw_buf();
+	uint32_t len = jsonstring.numBytes();
+	uint32_t pos = 0;
 	while (pos < len)
 	{
 		if (*parent && (*parent)->isPrimitive())
 			throwError<SyntaxError>(kJSONInvalidParseInput);
 		pos = parse(jsonstring, pos, parent , key, reviver);
-		while (jsonstring.charAt(pos) == ' ' ||
-			   jsonstring.charAt(pos) == '\t' ||
-			   jsonstring.charAt(pos) == '\n' ||
-			   jsonstring.charAt(pos) == '\r'
-			   )
-			pos++;
+		pos = skipWhitespace(buf,pos);
 	}
 }
-int JSON::parse(const tiny_string &jsonstring, int pos, ASObject** parent , const multiname& key, asAtom reviver)
+uint32_t JSON::parse(const tiny_string &jsonstring, uint32_t pos, ASObject** parent , const multiname& key, asAtom reviver)
 {
-	while (jsonstring.charAt(pos) == ' ' ||
-		   jsonstring.charAt(pos) == '\t' ||
-		   jsonstring.charAt(pos) == '\n' ||
-		   jsonstring.charAt(pos) == '\r'
-		   )
-		   pos++;
-	int len = jsonstring.numChars();
+	const char* buf = jsonstring.raw_buf();
+	pos = skipWhitespace(buf,pos);
+	uint32_t len = jsonstring.numBytes();
 	if (pos < len)
 	{
-		char c = jsonstring.charAt(pos);
+		char c = buf[pos];
 		switch(c)
 		{
 			case '{':
@@ -245,184 +255,142 @@ int JSON::parse(const tiny_string &jsonstring, int pos, ASObject** parent , cons
 	}
 	return pos;
 }
-int JSON::parseTrue(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key)
+uint32_t JSON::parseTrue(const tiny_string &jsonstring, uint32_t pos,ASObject** parent,const multiname& key)
 {
-	int len = jsonstring.numChars();
-	if (len >= pos+4)
+	uint32_t len = jsonstring.numBytes();
+	if (len >= pos+4 && memcmp(jsonstring.raw_buf()+pos,"true",4) == 0)
 	{
-		if (jsonstring.charAt(pos) == 't' && 
-				jsonstring.charAt(pos + 1) == 'r' &&
-				jsonstring.charAt(pos + 2) == 'u' && 
-				jsonstring.charAt(pos + 3) == 'e')
+		pos += 4;
+		if (*parent == NULL)
+			*parent = abstract_b(getSys(),true);
+		else
 		{
-			pos += 4;
-			if (*parent == NULL)
-				*parent = abstract_b(getSys(),true);
-			else
-			{
-				asAtom v(true);
-				(*parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED);
-			}
+			asAtom v(true);
+			(*parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED);
 		}
-		else
-			throwError<SyntaxError>(kJSONInvalidParseInput);
 	}
 	else
 		throwError<SyntaxError>(kJSONInvalidParseInput);
 	return pos;
 }
-int JSON::parseFalse(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key)
+uint32_t JSON::parseFalse(const tiny_string &jsonstring, uint32_t pos,ASObject** parent,const multiname& key)
 {
-	int len = jsonstring.numChars();
-	if (len >= pos+5)
+	uint32_t len = jsonstring.numBytes();
+	if (len >= pos+5 && memcmp(jsonstring.raw_buf()+pos,"false",5) == 0)
 	{
-		if (jsonstring.charAt(pos) == 'f' && 
-				jsonstring.charAt(pos + 1) == 'a' &&
-				jsonstring.charAt(pos + 2) == 'l' && 
-				jsonstring.charAt(pos + 3) == 's' && 
-				jsonstring.charAt(pos + 4) == 'e')
+		pos += 5;
+		if (*parent == NULL)
+			*parent = abstract_b(getSys(),false);
+		else 
 		{
-			pos += 5;
-			if (*parent == NULL)
-				*parent = abstract_b(getSys(),false);
-			else 
-			{
-				asAtom v(false);
-				(*parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED);
-			}
+			asAtom v(false);
+			(*parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED);
 		}
-		else
-			throwError<SyntaxError>(kJSONInvalidParseInput);
 	}
 	else
 		throwError<SyntaxError>(kJSONInvalidParseInput);
 	return pos;
 }
-int JSON::parseNull(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key)
+uint32_t JSON::parseNull(const tiny_string &jsonstring, uint32_t pos,ASObject** parent,const multiname& key)
 {
-	int len = jsonstring.numChars();
-	if (len >= pos+4)
+	uint32_t len = jsonstring.numBytes();
+	if (len >= pos+4 && memcmp(jsonstring.raw_buf()+pos,"null",4) == 0)
 	{
-		if (jsonstring.charAt(pos) == 'n' && 
-				jsonstring.charAt(pos + 1) == 'u' &&
-				jsonstring.charAt(pos + 2) == 'l' && 
-				jsonstring.charAt(pos + 3) == 'l')
-		{
-			pos += 4;
-			if (*parent == NULL)
-				*parent = getSys()->getNullRef();
-			else 
-				(*parent)->setVariableByMultiname(key,asAtom::nullAtom,ASObject::CONST_NOT_ALLOWED);
-		}
-		else
-			throwError<SyntaxError>(kJSONInvalidParseInput);
+		pos += 4;
+		if (*parent == NULL)
+			*parent = getSys()->getNullRef();
+		else 
+			(*parent)->setVariableByMultiname(key,asAtom::nullAtom,ASObject::CONST_NOT_ALLOWED);
 	}
 	else
 		throwError<SyntaxError>(kJSONInvalidParseInput);
 	return pos;
 }
-int JSON::parseString(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key, tiny_string* result)
+static inline bool isHexDigit(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+uint32_t JSON::parseString(const tiny_string &jsonstring, uint32_t pos,ASObject** parent,const multiname& key, tiny_string* result)
 {
 	pos++; // ignore starting quotes
-	int len = jsonstring.numChars();
+	const char* buf = jsonstring.raw_buf();
+	uint32_t len = jsonstring.numBytes();
 	if (pos >= len)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
 
-	tiny_string sub = jsonstring.substr(pos,len-pos);
-	
-	tiny_string res;
+	// unescaped runs are copied in one go, most strings have no escapes at all
+	std::string res;
 	bool done = false;
-	for (CharIterator it=sub.begin(); it!=sub.end(); it++)
+	while (pos < len)
 	{
-		pos++;
-		if (*it == '\"')
+		uint32_t start = pos;
+		while (pos < len && buf[pos] != '\"' && buf[pos] != '\\' && (unsigned char)buf[pos] >= 0x20)
+			pos++;
+		res.append(buf+start,pos-start);
+		if (pos == len)
+			break;
+		char c = buf[pos++];
+		if (c == '\"')
 		{
 			done = true;
 			break;
 		}
-		else if(*it == '\\')
+		if (c != '\\')
+			throwError<SyntaxError>(kJSONInvalidParseInput);
+		if (pos == len)
+			break;
+		c = buf[pos++];
+		switch (c)
 		{
-			it++;
-			pos++;
-			if(it == sub.end())
-				break;
-			if(*it == '\"')
+			case '\"':
 				res += '\"';
-			else if(*it == '\\')
+				break;
+			case '\\':
 				res += '\\';
-			else if(*it == '/')
+				break;
+			case '/':
 				res += '/';
-			else if(*it == 'b')
+				break;
+			case 'b':
 				res += '\b';
-			else if(*it == 'f')
+				break;
+			case 'f':
 				res += '\f';
-			else if(*it == 'n')
+				break;
+			case 'n':
 				res += '\n';
-			else if(*it == 'r')
+				break;
+			case 'r':
 				res += '\r';
-			else if(*it == 't')
+				break;
+			case 't':
 				res += '\t';
-			else if(*it == 'u')
+				break;
+			case 'u':
 			{
-				tiny_string strhex;
+				if (pos+4 > len)
+					throwError<SyntaxError>(kJSONInvalidParseInput);
+				char strhex[5];
 				for (int i = 0; i < 4; i++)
 				{
-					it++; pos++; 
-					if (it==sub.end()) 
-						throwError<SyntaxError>(kJSONInvalidParseInput);
-					switch(*it)
-					{
-						case '0':
-						case '1':
-						case '2':
-						case '3':
-						case '4':
-						case '5':
-						case '6':
-						case '7':
-						case '8':
-						case '9':
-						case 'a':
-						case 'b':
-						case 'c':
-						case 'd':
-						case 'e':
-						case 'f':
-						case 'A':
-						case 'B':
-						case 'C':
-						case 'D':
-						case 'E':
-						case 'F':
-							strhex += *it;
-							break;
-						default:
-							throwError<SyntaxError>(kJSONInvalidParseInput);
-					}
-					if (it==sub.end()) 
+					if (!isHexDigit(buf[pos+i]))
 						throwError<SyntaxError>(kJSONInvalidParseInput);
+					strhex[i] = buf[pos+i];
 				}
+				strhex[4] = 0;
+				pos += 4;
 				int64_t hexnum;
-				if (Integer::fromStringFlashCompatible(strhex.raw_buf(),hexnum,16))
-				{
-					if (hexnum < 0x20 && hexnum != 0xf)
-						throwError<SyntaxError>(kJSONInvalidParseInput);
-					res += tiny_string::fromChar(hexnum);
-				}
-				else
-					break;
+				if (!Integer::fromStringFlashCompatible(strhex,hexnum,16))
+					throwError<SyntaxError>(kJSONInvalidParseInput);
+				if (hexnum < 0x20 && hexnum != 0xf)
+					throwError<SyntaxError>(kJSONInvalidParseInput);
+				tiny_string ch = tiny_string::fromChar(hexnum);
+				res.append(ch.raw_buf(),ch.numBytes());
+				break;
 			}
-			else
+			default:
 				throwError<SyntaxError>(kJSONInvalidParseInput);
 		}
-		else if (*it < 0x20)
-		{
-			throwError<SyntaxError>(kJSONInvalidParseInput);
-		}
-		else
-		{
-			res += *it;
-		}
 	}
 	if (!done)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
@@ -438,18 +406,18 @@ int JSON::parseString(const tiny_string &jsonstring, int pos,ASObject** parent,c
 		}
 	}
 	if (result)
-		*result =res;
+		*result = res;
 	return pos;
 }
-int JSON::parseNumber(const tiny_string &jsonstring, int pos, ASObject** parent, const multiname& key)
+uint32_t JSON::parseNumber(const tiny_string &jsonstring, uint32_t pos, ASObject** parent, const multiname& key)
 {
-	int len = jsonstring.numChars();
-	tiny_string res;
+	const char* buf = jsonstring.raw_buf();
+	uint32_t len = jsonstring.numBytes();
+	uint32_t start = pos;
 	bool done = false;
 	while (!done && pos < len)
 	{
-		char c = jsonstring.charAt(pos);
-		switch(c)
+		switch(buf[pos])
 		{
 			case '0':
 			case '1':
@@ -466,7 +434,6 @@ int JSON::parseNumber(const tiny_string &jsonstring, int pos, ASObject** parent,
 			case '.':
 			case 'E':
 			case 'e':
-				res += c;
 				pos++;
 				break;
 			default:
@@ -474,10 +441,11 @@ int JSON::parseNumber(const tiny_string &jsonstring, int pos, ASObject** parent,
 				break;
 		}
 	}
-	ASString* numstr = abstract_s(getSys(),res);
-	number_t num = numstr->toNumber();
-
-	if (std::isnan(num))
+	// strtod needs a terminated string, numbers are short so this copy is cheap
+	std::string numstr(buf+start,pos-start);
+	char* end = NULL;
+	number_t num = g_ascii_strtod(numstr.c_str(),&end);
+	if (end != numstr.c_str()+numstr.size())
 		throwError<SyntaxError>(kJSONInvalidParseInput);
 
 	if (*parent == NULL)
@@ -489,9 +457,10 @@ int JSON::parseNumber(const tiny_string &jsonstring, int pos, ASObject** parent,
 	}
 	return pos;
 }
-int JSON::parseObject(const tiny_string &jsonstring, int pos, ASObject** parent, const multiname& key, asAtom reviver)
+uint32_t JSON::parseObject(const tiny_string &jsonstring, uint32_t pos, ASObject** parent, const multiname& key, asAtom reviver)
 {
-	int len = jsonstring.numChars();
+	const char* buf = jsonstring.raw_buf();
+	uint32_t len = jsonstring.numBytes();
 	pos++; // ignore '{' or ','
 	ASObject* subobj = Class<ASObject>::getInstanceS(getSys());
 	if (*parent == NULL)
@@ -512,13 +481,8 @@ int JSON::parseObject(const tiny_string &jsonstring, int pos, ASObject** parent,
 
 	while (!done && pos < len)
 	{
-		while (jsonstring.charAt(pos) == ' ' ||
-			   jsonstring.charAt(pos) == '\t' ||
-			   jsonstring.charAt(pos) == '\n' ||
-			   jsonstring.charAt(pos) == '\r'
-			   )
-			pos++;
-		char c = jsonstring.charAt(pos);
+		pos = skipWhitespace(buf,pos);
+		char c = buf[pos];
 		switch(c)
 		{
 			case '}':
@@ -559,9 +523,10 @@ int JSON::parseObject(const tiny_string &jsonstring, int pos, ASObject** parent,
 	return pos;
 }
 
-int JSON::parseArray(const tiny_string &jsonstring, int pos, ASObject** parent, const multiname& key, asAtom reviver)
+uint32_t JSON::parseArray(const tiny_string &jsonstring, uint32_t pos, ASObject** parent, const multiname& key, asAtom reviver)
 {
-	int len = jsonstring.numChars();
+	const char* buf = jsonstring.raw_buf();
+	uint32_t len = jsonstring.numBytes();
 	pos++; // ignore '['
 	ASObject* subobj = Class<Array>::getInstanceSNoArgs(getSys());
 	if (*parent == NULL)
@@ -580,13 +545,8 @@ int JSON::parseArray(const tiny_string &jsonstring, int pos, ASObject** parent,
 	bool needdata = false;
 	while (!done && pos < len)
 	{
-		while (jsonstring.charAt(pos) == ' ' ||
-			   jsonstring.charAt(pos) == '\t' ||
-			   jsonstring.charAt(pos) == '\n' ||
-			   jsonstring.charAt(pos) == '\r'
-			   )
-			pos++;
-		char c = jsonstring.charAt(pos);
+		pos = skipWhitespace(buf,pos);
+		char c = buf[pos];
 		switch(c)
 		{
 			case ']':
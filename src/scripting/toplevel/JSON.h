@@ -38,14 +38,14 @@ public:
 	static ASObject* doParse(const tiny_string &jsonstring, asAtom reviver);
 private:
 	static void parseAll(const tiny_string &jsonstring, ASObject** parent , const multiname& key, asAtom reviver);
-	static int parse(const tiny_string &jsonstring, int pos, ASObject **parent, const multiname &key,asAtom reviver);
-	static int parseTrue(const tiny_string &jsonstring, int pos, ASObject **parent, const multiname &key);
-	static int parseFalse(const tiny_string &jsonstring, int pos, ASObject **parent, const multiname &key);
-	static int parseNull(const tiny_string &jsonstring, int pos, ASObject **parent, const multiname &key);
-	static int parseString(const tiny_string &jsonstring, int pos, ASObject **parent, const multiname &key, tiny_string *result = NULL);
-	static int parseNumber(const tiny_string &jsonstring, int pos, ASObject **parent, const multiname &key);
-	static int parseObject(const tiny_string &jsonstring, int pos, ASObject **parent, const multiname &key, asAtom reviver);
-	static int parseArray(const tiny_string &jsonstring, int pos, ASObject **parent, const multiname &key, asAtom reviver);
+	static uint32_t parse(const tiny_string &jsonstring, uint32_t pos, ASObject **parent, const multiname &key,asAtom reviver);
+	static uint32_t parseTrue(const tiny_string &jsonstring, uint32_t pos, ASObject **parent, const multiname &key);
+	static uint32_t parseFalse(const tiny_string &jsonstring, uint32_t pos, ASObject **parent, const multiname &key);
+	static uint32_t parseNull(const tiny_string &jsonstring, uint32_t pos, ASObject **parent, const multiname &key);
+	static uint32_t parseString(const tiny_string &jsonstring, uint32_t pos, ASObject **parent, const multiname &key, tiny_string *result = NULL);
+	static uint32_t parseNumber(const tiny_string &jsonstring, uint32_t pos, ASObject **parent, const multiname &key);
+	static uint32_t parseObject(const tiny_string &jsonstring, uint32_t pos, ASObject **parent, const multiname &key, asAtom reviver);
+	static uint32_t parseArray(const tiny_string &jsonstring, uint32_t pos, ASObject **parent, const multiname &key, asAtom reviver);
 };
 
 }
@@ -17,12 +17,118 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************/
 
+#include <list>
+#include <map>
 #include "scripting/argconv.h"
 #include "scripting/toplevel/RegExp.h"
 
 using namespace std;
 using namespace lightspark;
 
+//Number of compiled programs kept by RegExpProgram::get
+#define REGEXP_CACHE_SIZE 64
+
+RegExpProgram::RegExpProgram(pcre* r, pcre_extra* s):re(r),study(s),capturingGroups(0),namedGroups(0),
+	namedSize(0),nameTable(NULL)
+{
+	if(study)
+		limitedExtra=*study;
+	else
+		limitedExtra.flags=0;
+	limitedExtra.match_limit_recursion=200;
+	limitedExtra.flags|=PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+}
+
+RegExpProgram::~RegExpProgram()
+{
+#ifdef PCRE_STUDY_JIT_COMPILE
+	pcre_free_study(study);
+#else
+	pcre_free(study);
+#endif
+	pcre_free(re);
+}
+
+_NR<RegExpProgram> RegExpProgram::compile(const tiny_string& source, int options)
+{
+	const char * error;
+	int errorOffset;
+	int errorcode;
+	pcre* pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,NULL);
+	if(error)
+	{
+		if (errorcode == 64 && (options&PCRE_JAVASCRIPT_COMPAT)) // invalid pattern in javascript compatibility mode (we try again in normal mode to match flash behaviour)
+		{
+			options &= ~PCRE_JAVASCRIPT_COMPAT;
+			pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,NULL);
+		}
+		if (error)
+			return NullRef;
+	}
+
+	//Study the pattern once, this also generates the native code when PCRE has JIT support
+#ifdef PCRE_STUDY_JIT_COMPILE
+	pcre_extra* study=pcre_study(pcreRE, PCRE_STUDY_JIT_COMPILE, &error);
+#else
+	pcre_extra* study=pcre_study(pcreRE, 0, &error);
+#endif
+	RegExpProgram* ret=new RegExpProgram(pcreRE, study);
+	if(pcre_fullinfo(pcreRE, study, PCRE_INFO_CAPTURECOUNT, &ret->capturingGroups)!=0 ||
+	   pcre_fullinfo(pcreRE, study, PCRE_INFO_NAMECOUNT, &ret->namedGroups)!=0 ||
+	   pcre_fullinfo(pcreRE, study, PCRE_INFO_NAMEENTRYSIZE, &ret->namedSize)!=0 ||
+	   pcre_fullinfo(pcreRE, study, PCRE_INFO_NAMETABLE, &ret->nameTable)!=0)
+	{
+		ret->decRef();
+		return NullRef;
+	}
+	return _MNR(ret);
+}
+
+_NR<RegExpProgram> RegExpProgram::get(const tiny_string& source, int options)
+{
+	typedef pair<int, string> cacheKey;
+	typedef list<pair<cacheKey, _R<RegExpProgram>>> lruList;
+	static StaticMutex cacheMutex;
+	static lruList lru;
+	static map<cacheKey, lruList::iterator> index;
+
+	cacheKey key(options, string(source.raw_buf(), source.numBytes()));
+	{
+		Locker l(cacheMutex);
+		auto it=index.find(key);
+		if(it!=index.end())
+		{
+			//Move the entry to the front
+			lru.splice(lru.begin(), lru, it->second);
+			return it->second->second;
+		}
+	}
+
+	//Compile outside of the lock, patterns may be expensive
+	_NR<RegExpProgram> ret=compile(source, options);
+	if(ret.isNull())
+		return ret;
+
+	Locker l(cacheMutex);
+	if(index.find(key)==index.end())
+	{
+		lru.push_front(make_pair(key, ret));
+		index[key]=lru.begin();
+		if(lru.size()>REGEXP_CACHE_SIZE)
+		{
+			index.erase(lru.back().first);
+			lru.pop_back();
+		}
+	}
+	return ret;
+}
+
+int RegExpProgram::exec(const tiny_string& str, int offset, int* ovector, int ovectorSize, bool limitRecursion) const
+{
+	const pcre_extra* extra=limitRecursion ? &limitedExtra : study;
+	return pcre_exec(re, extra, str.raw_buf(), str.numBytes(), offset, 0, ovector, ovectorSize);
+}
+
 RegExp::RegExp(Class_base* c):ASObject(c,T_OBJECT,SUBTYPE_REGEXP),dotall(false),global(false),ignoreCase(false),
 	extended(false),multiline(false),lastIndex(0)
 {
@@ -67,6 +173,7 @@ ASFUNCTIONBODY(RegExp,_constructor)
 		if(argslen > 1 && !args[1]->is<Undefined>())
 			throwError<TypeError>(kRegExpFlagsArgumentError);
 		RegExp *src=args[0]->as<RegExp>();
+		th->program.reset();
 		th->source=src->source;
 		th->dotall=src->dotall;
 		th->global=src->global;
@@ -75,7 +182,8 @@ ASFUNCTIONBODY(RegExp,_constructor)
 		th->multiline=src->multiline;
 		return NULL;
 	}
-	else if(argslen > 0)
+	th->program.reset();
+	if(argslen > 0)
 		th->source=args[0]->toString().raw_buf();
 	if(argslen>1 && !args[1]->is<Undefined>())
 	{
@@ -147,55 +255,24 @@ ASFUNCTIONBODY_ATOM(RegExp,exec)
 
 ASObject *RegExp::match(const tiny_string& str)
 {
-	pcre* pcreRE = compile();
-	if (!pcreRE)
-		return getSystemState()->getNullRef();
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return getSystemState()->getNullRef();
-	}
-	//Get information about named capturing groups
-	int namedGroups;
-	infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMECOUNT, &namedGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return getSystemState()->getNullRef();
-	}
-	//Get information about the size of named entries
-	int namedSize;
-	infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMEENTRYSIZE, &namedSize);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
+	_NR<RegExpProgram> pcreRE = getProgram();
+	if (pcreRE.isNull())
 		return getSystemState()->getNullRef();
-	}
+	const int capturingGroups=pcreRE->capturingGroups;
+	const int namedGroups=pcreRE->namedGroups;
+	const int namedSize=pcreRE->namedSize;
 	struct nameEntry
 	{
 		uint16_t number;
 		char name[0];
 	};
-	char* entries;
-	infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMETABLE, &entries);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		lastIndex=0;
-		return getSystemState()->getNullRef();
-	}
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+	char* entries=pcreRE->nameTable;
 	int ovector[(capturingGroups+1)*3];
 	int offset=global?lastIndex:0;
-	int rc=pcre_exec(pcreRE,capturingGroups > 200 ? &extra : NULL, str.raw_buf(), str.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+	int rc=pcreRE->exec(str, offset, ovector, (capturingGroups+1)*3, capturingGroups > 200);
 	if(rc<0)
 	{
 		//No matches or error
-		pcre_free(pcreRE);
 		return getSystemState()->getNullRef();
 	}
 	Array* a=Class<Array>::getInstanceSNoArgs(getSystemState());
@@ -224,7 +301,6 @@ ASObject *RegExp::match(const tiny_string& str)
 		entries+=namedSize;
 	}
 	lastIndex=ovector[1];
-	pcre_free(pcreRE);
 	return a;
 }
 
@@ -235,26 +311,15 @@ ASFUNCTIONBODY(RegExp,test)
 	RegExp* th=static_cast<RegExp*>(obj);
 
 	const tiny_string& arg0 = args[0]->toString();
-	pcre* pcreRE = th->compile();
-	if (!pcreRE)
+	_NR<RegExpProgram> pcreRE = th->getProgram();
+	if (pcreRE.isNull())
 		return obj->getSystemState()->getNullRef();
 
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return obj->getSystemState()->getNullRef();
-	}
-	int ovector[(capturingGroups+1)*3];
+	int ovector[(pcreRE->capturingGroups+1)*3];
 	
 	int offset=(th->global)?th->lastIndex:0;
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
-	int rc = pcre_exec(pcreRE, &extra, arg0.raw_buf(), arg0.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+	int rc = pcreRE->exec(arg0, offset, ovector, (pcreRE->capturingGroups+1)*3);
 	bool ret = (rc >= 0);
-	pcre_free(pcreRE);
 
 	return abstract_b(obj->getSystemState(),ret);
 }
@@ -282,7 +347,7 @@ ASFUNCTIONBODY(RegExp,_toString)
 	return abstract_s(obj->getSystemState(),ret);
 }
 
-pcre* RegExp::compile()
+int RegExp::getPCREOptions() const
 {
 	int options = PCRE_UTF8|PCRE_NEWLINE_ANY|PCRE_JAVASCRIPT_COMPAT;
 	if(ignoreCase)
@@ -293,20 +358,12 @@ pcre* RegExp::compile()
 		options |= PCRE_MULTILINE;
 	if(dotall)
 		options|=PCRE_DOTALL;
+	return options;
+}
 
-	const char * error;
-	int errorOffset;
-	int errorcode;
-	pcre* pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,NULL);
-	if(error)
-	{
-		if (errorcode == 64) // invalid pattern in javascript compatibility mode (we try again in normal mode to match flash behaviour)
-		{
-			options &= ~PCRE_JAVASCRIPT_COMPAT;
-			pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,NULL);
-		}
-		if (error)
-			return NULL;
-	}
-	return pcreRE;
+_NR<RegExpProgram> RegExp::getProgram()
+{
+	if(program.isNull())
+		program=RegExpProgram::get(source, getPCREOptions());
+	return program;
 }
@@ -26,12 +26,46 @@
 namespace lightspark
 {
 
+/*
+ * A compiled, studied and (when PCRE supports it) JIT compiled pattern.
+ * Programs are immutable and may be shared between RegExp objects.
+ */
+class RegExpProgram: public RefCountable
+{
+private:
+	pcre* re;
+	pcre_extra* study;
+	//The study data, plus the recursion limit used by most callers
+	pcre_extra limitedExtra;
+	RegExpProgram(pcre* r, pcre_extra* s);
+	static _NR<RegExpProgram> compile(const tiny_string& source, int options);
+public:
+	~RegExpProgram();
+	int capturingGroups;
+	int namedGroups;
+	int namedSize;
+	char* nameTable;
+	/*
+	 * Returns the program for the given pattern and PCRE options. Programs are
+	 * kept in a process wide LRU cache, so patterns used over and over (like
+	 * string literals passed to String methods) are only compiled once.
+	 * If PCRE_JAVASCRIPT_COMPAT rejects the pattern it is compiled without it.
+	 * Returns NullRef if the pattern is invalid.
+	 */
+	static _NR<RegExpProgram> get(const tiny_string& source, int options);
+	int exec(const tiny_string& str, int offset, int* ovector, int ovectorSize, bool limitRecursion=true) const;
+};
+
 class RegExp: public ASObject
 {
+private:
+	_NR<RegExpProgram> program;
 public:
 	RegExp(Class_base* c);
 	RegExp(Class_base* c, const tiny_string& _re);
-	pcre* compile();
+	//Returns the compiled pattern, it is compiled only once per object
+	_NR<RegExpProgram> getProgram();
+	int getPCREOptions() const;
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
 	ASObject *match(const tiny_string& str);
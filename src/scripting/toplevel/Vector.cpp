@@ -24,6 +24,8 @@
 #include "scripting/argconv.h"
 #include "scripting/toplevel/XML.h"
 #include <3rdparty/pugixml/src/pugixml.hpp>
+#include <algorithm>
+#include <functional>
 
 using namespace std;
 using namespace lightspark;
@@ -32,6 +34,7 @@ void Vector::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_FINAL);
 	c->isReusable = true;
+	c->overridesPropertyAccess = true;
 	c->setDeclaredMethodByQName("length","",Class<IFunction>::getFunction(c->getSystemState(),getLength,0,Class<UInteger>::getRef(c->getSystemState()).getPtr()),GETTER_METHOD,true);
 	c->setDeclaredMethodByQName("length","",Class<IFunction>::getFunction(c->getSystemState(),setLength,0,Class<UInteger>::getRef(c->getSystemState()).getPtr()),SETTER_METHOD,true);
 	c->setDeclaredMethodByQName("toString","",Class<IFunction>::getFunction(c->getSystemState(),_toString),NORMAL_METHOD,true);
@@ -99,8 +102,9 @@ void Vector::sinit(Class_base* c)
 	c->prototype->setVariableByQName("unshift",AS3,Class<IFunction>::getFunction(c->getSystemState(),unshift),DYNAMIC_TRAIT);
 }
 
-Vector::Vector(Class_base* c, const Type *vtype):ASObject(c,T_OBJECT,SUBTYPE_VECTOR),vec_type(vtype),fixed(false),vec(reporter_allocator<asAtom>(c->memoryAccount))
+Vector::Vector(Class_base* c, const Type *vtype):ASObject(c,T_OBJECT,SUBTYPE_VECTOR),vec_type(vtype),numericType(NOT_NUMERIC),fixed(false),vec(reporter_allocator<asAtom>(c->memoryAccount))
 {
+	initNumericType();
 }
 
 Vector::~Vector()
@@ -112,7 +116,59 @@ void Vector::setTypes(const std::vector<const Type *> &types)
 	assert(vec_type == NULL);
 	if(types.size() == 1)
 		vec_type = types[0];
+	initNumericType();
 }
+
+void Vector::initNumericType()
+{
+	if (vec_type == NULL)
+		numericType = NOT_NUMERIC;
+	else if (vec_type == Class<Integer>::getClass(getSystemState()))
+		numericType = NUMERIC_INT;
+	else if (vec_type == Class<UInteger>::getClass(getSystemState()))
+		numericType = NUMERIC_UINT;
+	else if (vec_type == Class<Number>::getClass(getSystemState()))
+		numericType = NUMERIC_NUMBER;
+	else
+		numericType = NOT_NUMERIC;
+}
+
+asAtom Vector::coerceElement(asAtom& o) const
+{
+	switch (numericType)
+	{
+		case NUMERIC_INT:
+			if (o.type == T_INTEGER)
+				return o;
+			else
+			{
+				int32_t n = o.toInt();
+				ASATOM_DECREF(o);
+				return asAtom(n);
+			}
+		case NUMERIC_UINT:
+			if (o.type == T_UINTEGER)
+				return o;
+			else
+			{
+				uint32_t n = o.toUInt();
+				ASATOM_DECREF(o);
+				return asAtom(n);
+			}
+		case NUMERIC_NUMBER:
+			if (o.type == T_NUMBER)
+				return o;
+			else
+			{
+				number_t n = o.toNumber();
+				ASATOM_DECREF(o);
+				return asAtom(n);
+			}
+		default:
+			return vec_type->coerce(getSystemState(),o);
+	}
+}
+
 bool Vector::sameType(const Class_base *cls) const
 {
 	tiny_string clsname = this->getClass()->getQualifiedClassName();
@@ -125,8 +181,6 @@ asAtom Vector::generator(SystemState *sys, asAtom &o_class, asAtom* args, const
 	assert_and_throw(args[0].toObject(sys)->getClass());
 	assert_and_throw(o_class.as<TemplatedClass<Vector>>()->getTypes().size() == 1);
 
-	const Type* type = o_class.as<TemplatedClass<Vector>>()->getTypes()[0];
-
 	if(args[0].is<Array>())
 	{
 		//create object without calling _constructor
@@ -138,7 +192,7 @@ asAtom Vector::generator(SystemState *sys, asAtom &o_class, asAtom* args, const
 			asAtom obj = a->at(i);
 			ASATOM_INCREF(obj);
 			//Convert the elements of the array to the type of this vector
-			ret->vec.push_back( type->coerce(sys,obj) );
+			ret->vec.push_back( ret->coerceElement(obj) );
 		}
 		return asAtom::fromObject(ret);
 	}
@@ -148,10 +202,17 @@ asAtom Vector::generator(SystemState *sys, asAtom &o_class, asAtom* args, const
 
 		//create object without calling _constructor
 		Vector* ret = o_class.as<TemplatedClass<Vector>>()->getInstance(false,NULL,0).as<Vector>();
+		ret->vec.reserve(arg->vec.size());
 		for(auto i = arg->vec.begin(); i != arg->vec.end(); ++i)
 		{
-			ASATOM_INCREF((*i));
-			ret->vec.push_back( type->coerce(sys,*i) );
+			asAtom o = *i;
+			if (o.type == T_INVALID)
+			{
+				ret->vec.push_back(ret->defaultElement());
+				continue;
+			}
+			ASATOM_INCREF(o);
+			ret->vec.push_back( ret->coerceElement(o) );
 		}
 		return asAtom::fromObject(ret);
 	}
@@ -173,7 +234,7 @@ ASFUNCTIONBODY_ATOM(Vector,_constructor)
 	Vector* th=obj.as< Vector>();
 	assert(th->vec_type);
 	th->fixed = fixed;
-	th->vec.resize(len, asAtom::invalidAtom);
+	th->vec.resize(len, th->defaultElement());
 
 	return asAtom::invalidAtom;
 }
@@ -198,7 +259,14 @@ ASFUNCTIONBODY_ATOM(Vector,_concat)
 		if (args[i].is<Vector>())
 		{
 			Vector* arg=args[i].as<Vector>();
-			ret->vec.resize(index+arg->size(), asAtom::invalidAtom);
+			if (th->numericType != NOT_NUMERIC && arg->vec_type == th->vec_type)
+			{
+				// same numeric type, the elements need no coercion and no references
+				ret->vec.insert(ret->vec.end(),arg->vec.begin(),arg->vec.end());
+				index += arg->size();
+				continue;
+			}
+			ret->vec.resize(index+arg->size(), ret->defaultElement());
 			auto it=arg->vec.begin();
 			for(;it != arg->vec.end();++it)
 			{
@@ -206,16 +274,19 @@ ASFUNCTIONBODY_ATOM(Vector,_concat)
 				{
 					// force Class_base to ensure that a TypeError is thrown 
 					// if the object type does not match the base vector type
-					ret->vec[index]=((Class_base*)th->vec_type)->Class_base::coerce(th->getSystemState(),*it);
-					ASATOM_INCREF(ret->vec[index]);
+					asAtom o=((Class_base*)th->vec_type)->Class_base::coerce(th->getSystemState(),*it);
+					ASATOM_INCREF(o);
+					// numbers are passed through unchanged, convert them to the element type
+					ret->vec[index]=ret->coerceElement(o);
 				}
 				index++;
 			}
 		}
 		else
 		{
-			ret->vec[index] = th->vec_type->coerce(th->getSystemState(),args[i]);
-			ASATOM_INCREF(ret->vec[index]);
+			asAtom o=args[i];
+			ASATOM_INCREF(o);
+			ret->vec.push_back(ret->coerceElement(o));
 			index++;
 		}
 	}	
@@ -353,7 +424,17 @@ void Vector::append(asAtom &o)
 		throwError<RangeError>(kVectorFixedError);
 	}
 
-	vec.push_back(vec_type->coerce(getSystemState(),o));
+	vec.push_back(coerceElement(o));
+}
+
+void Vector::appendUInts(const uint32_t* values, uint32_t count)
+{
+	assert(numericType == NUMERIC_UINT);
+	if (fixed)
+		throwError<RangeError>(kVectorFixedError);
+	vec.reserve(vec.size()+count);
+	for(uint32_t i=0;i<count;i++)
+		vec.push_back(asAtom(values[i]));
 }
 
 ASObject *Vector::describeType() const
@@ -394,7 +475,7 @@ ASFUNCTIONBODY_ATOM(Vector,push)
 		ASATOM_INCREF(args[i]);
 		//The proprietary player violates the specification and allows elements of any type to be pushed;
 		//they are converted to the vec_type
-		th->vec.push_back( th->vec_type->coerce(th->getSystemState(),args[i]));
+		th->vec.push_back( th->coerceElement(args[i]));
 	}
 	return asAtom((uint32_t)th->vec.size());
 }
@@ -432,7 +513,7 @@ ASFUNCTIONBODY_ATOM(Vector,setLength)
 		for(size_t i=len; i< th->vec.size(); ++i)
 			ASATOM_DECREF(th->vec[i]);
 	}
-	th->vec.resize(len, asAtom::invalidAtom);
+	th->vec.resize(len, th->defaultElement());
 	return asAtom::invalidAtom;
 }
 
@@ -487,17 +568,7 @@ ASFUNCTIONBODY_ATOM(Vector, _reverse)
 {
 	Vector* th = obj.as<Vector>();
 
-	std::vector<asAtom> tmp = std::vector<asAtom>(th->vec.begin(),th->vec.end());
-	uint32_t size = th->size();
-	th->vec.clear();
-	th->vec.resize(size, asAtom::invalidAtom);
-	std::vector<asAtom>::iterator it=tmp.begin();
-	uint32_t index = size-1;
-	for(;it != tmp.end();++it)
- 	{
-		th->vec[index]=*it;
-		index--;
-	}
+	std::reverse(th->vec.begin(),th->vec.end());
 	th->incRef();
 	return asAtom::fromObject(th);
 }
@@ -535,6 +606,20 @@ ASFUNCTIONBODY_ATOM(Vector,lastIndexOf)
 				i = j;
 		}
 	}
+	if (th->numericType != NOT_NUMERIC && (arg0.type == T_INTEGER || arg0.type == T_UINTEGER || arg0.type == T_NUMBER))
+	{
+		number_t n = arg0.toNumber();
+		do
+		{
+			if (th->vec[i].toNumber() == n)
+			{
+				ret=i;
+				break;
+			}
+		}
+		while(i--);
+		return asAtom(ret);
+	}
 	do
 	{
 		if (th->vec[i].type == T_INVALID)
@@ -604,6 +689,11 @@ ASFUNCTIONBODY_ATOM(Vector,slice)
 	startIndex=th->capIndex(startIndex);
 	endIndex=th->capIndex(endIndex);
 	Vector* ret= th->getClass()->getInstance(true,NULL,0).as<Vector>();
+	if (th->numericType != NOT_NUMERIC)
+	{
+		ret->vec.assign(th->vec.begin()+startIndex,th->vec.begin()+endIndex);
+		return asAtom::fromObject(ret);
+	}
 	ret->vec.resize(endIndex-startIndex, asAtom::invalidAtom);
 	int j = 0;
 	for(int i=startIndex; i<endIndex; i++) 
@@ -611,7 +701,7 @@ ASFUNCTIONBODY_ATOM(Vector,slice)
 		if (th->vec[i].type != T_INVALID)
 		{
 			ASATOM_INCREF(th->vec[i]);
-			ret->vec[j] =th->vec_type->coerce(th->getSystemState(),th->vec[i]);
+			ret->vec[j] =th->coerceElement(th->vec[i]);
 		}
 		j++;
 	}
@@ -669,7 +759,7 @@ ASFUNCTIONBODY_ATOM(Vector,splice)
 	for(unsigned int i=2;i<argslen;i++)
 	{
 		ASATOM_INCREF(args[i]);
-		th->vec.push_back(args[i]);
+		th->vec.push_back(th->coerceElement(args[i]));
 	}
 	// move remembered items to new position
 	th->vec.resize((totalSize-deleteCount)+(argslen > 2 ? argslen-2 : 0), asAtom::invalidAtom);
@@ -711,6 +801,9 @@ ASFUNCTIONBODY_ATOM(Vector,indexOf)
 		i = args[1].toInt();
 	}
 
+	if (th->numericType != NOT_NUMERIC && (arg0.type == T_INTEGER || arg0.type == T_UINTEGER || arg0.type == T_NUMBER))
+		return asAtom(th->indexOfNumber(arg0.toNumber(),i));
+
 	for(;i<th->size();i++)
 	{
 		if (th->vec[i].type ==T_INVALID)
@@ -723,6 +816,62 @@ ASFUNCTIONBODY_ATOM(Vector,indexOf)
 	}
 	return asAtom(ret);
 }
+int32_t Vector::indexOfNumber(number_t n, uint32_t from)
+{
+	for(uint32_t i=from;i<vec.size();i++)
+	{
+		if (vec[i].toNumber() == n)
+			return i;
+	}
+	return -1;
+}
+
+template<class T> static inline T numericValue(asAtom& a);
+template<> inline int32_t numericValue<int32_t>(asAtom& a) { return a.toInt(); }
+template<> inline uint32_t numericValue<uint32_t>(asAtom& a) { return a.toUInt(); }
+template<> inline number_t numericValue<number_t>(asAtom& a) { return a.toNumber(); }
+static inline bool isNaNValue(int32_t) { return false; }
+static inline bool isNaNValue(uint32_t) { return false; }
+static inline bool isNaNValue(number_t v) { return std::isnan(v); }
+
+/*
+ * Sorts the unboxed values of a numeric Vector in a plain array,
+ * returns false if the values can not be sorted numerically
+ */
+template<class T, class V>
+static bool sortNumericValues(V& vec, bool isDescending)
+{
+	std::vector<T> values(vec.size());
+	for(uint32_t i=0;i<vec.size();i++)
+	{
+		values[i] = numericValue<T>(vec[i]);
+		if (isNaNValue(values[i]))
+			return false;
+	}
+	if(isDescending)
+		std::sort(values.begin(),values.end(),std::greater<T>());
+	else
+		std::sort(values.begin(),values.end());
+	for(uint32_t i=0;i<vec.size();i++)
+		vec[i] = asAtom(values[i]);
+	return true;
+}
+
+bool Vector::sortNumeric(bool isDescending)
+{
+	switch (numericType)
+	{
+		case NUMERIC_INT:
+			return sortNumericValues<int32_t>(vec,isDescending);
+		case NUMERIC_UINT:
+			return sortNumericValues<uint32_t>(vec,isDescending);
+		case NUMERIC_NUMBER:
+			return sortNumericValues<number_t>(vec,isDescending);
+		default:
+			return false;
+	}
+}
+
 bool Vector::sortComparatorDefault::operator()(const asAtom& d1, const asAtom& d2)
 {
 	asAtom o1 = d1;
@@ -808,6 +957,11 @@ ASFUNCTIONBODY_ATOM(Vector,_sort)
 		if(options&(~(Array::NUMERIC|Array::CASEINSENSITIVE|Array::DESCENDING)))
 			throw UnsupportedException("Vector::sort not completely implemented");
 	}
+	if(comp.type == T_INVALID && isNumeric && th->sortNumeric(isDescending))
+	{
+		ASATOM_INCREF(obj);
+		return obj;
+	}
 	std::vector<asAtom> tmp = vector<asAtom>(th->vec.size());
 	int i = 0;
 	for(auto it=th->vec.begin();it != th->vec.end();++it)
@@ -849,7 +1003,7 @@ ASFUNCTIONBODY_ATOM(Vector,unshift)
 		for(uint32_t i=0;i<argslen;i++)
 		{
 			ASATOM_INCREF(args[i]);
-			th->vec[i] = th->vec_type->coerce(th->getSystemState(),args[i]);
+			th->vec[i] = th->coerceElement(args[i]);
 		}
 	}
 	return asAtom((int32_t)th->size());
@@ -877,7 +1031,7 @@ ASFUNCTIONBODY_ATOM(Vector,_map)
 		asAtom funcRet=func.callFunction(thisObject, funcArgs, 3,false);
 		assert_and_throw(funcRet.type != T_INVALID);
 		ASATOM_INCREF(funcRet);
-		ret->vec.push_back(funcRet);
+		ret->vec.push_back(ret->coerceElement(funcRet));
 	}
 
 	return asAtom::fromObject(ret);
@@ -915,16 +1069,12 @@ ASFUNCTIONBODY_ATOM(Vector,insertAt)
 		index = th->vec.size()+(index);
 	if (index < 0)
 		index = 0;
+	ASATOM_INCREF(o);
+	asAtom o2 = th->coerceElement(o);
 	if ((uint32_t)index >= th->vec.size())
-	{
-		ASATOM_INCREF(o);
-		th->vec.push_back(o);
-	}
+		th->vec.push_back(o2);
 	else
-	{
-		ASATOM_INCREF(o);
-		th->vec.insert(th->vec.begin()+index,o);
-	}
+		th->vec.insert(th->vec.begin()+index,o2);
 	return asAtom::invalidAtom;
 }
 
@@ -1031,7 +1181,7 @@ void Vector::setVariableByMultiname(const multiname& name, asAtom& o, CONST_ALLO
 			throwError<ReferenceError>(kWriteSealedError, name.normalizedName(getSystemState()), this->getClass()->getQualifiedClassName());
 		return ASObject::setVariableByMultiname(name, o, allowConst);
 	}
-	asAtom o2 = this->vec_type->coerce(getSystemState(), o);
+	asAtom o2 = coerceElement(o);
 	  
 	if(index < vec.size())
 	{
@@ -1114,12 +1264,10 @@ bool Vector::isValidMultiname(SystemState* sys,const multiname& name, uint32_t&
 	return validIndex;
 }
 
-tiny_string Vector::toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces, const tiny_string &filter)
+void Vector::appendJSON(std::string& res, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces, const tiny_string &filter)
 {
-	bool ok;
-	tiny_string res = call_toJSON(ok,path,replacer,spaces,filter);
-	if (ok)
-		return res;
+	if (call_toJSON(res,path,replacer,spaces,filter))
+		return;
 	// check for cylic reference
 	if (std::find(path.begin(),path.end(), this) != path.end())
 		throwError<TypeError>(kJSONCyclicStructure);
@@ -1127,13 +1275,19 @@ tiny_string Vector::toJSON(std::vector<ASObject *> &path, asAtom replacer, const
 	path.push_back(this);
 	res += "[";
 	bool bfirst = true;
-	tiny_string newline = (spaces.empty() ? "" : "\n");
+	const char* newline = (spaces.empty() ? "" : "\n");
 	for (unsigned int i =0;  i < vec.size(); i++)
 	{
-		tiny_string subres;
 		asAtom o = vec[i];
 		if (o.type == T_INVALID)
 			o= asAtom::nullAtom;
+		// the separator is written before the element and dropped again if the element is empty
+		size_t elementStart = res.size();
+		if (!bfirst)
+			res += ",";
+		res += newline;
+		res.append(spaces.raw_buf(),spaces.numBytes());
+		size_t valueStart = res.size();
 		if (replacer.type != T_INVALID)
 		{
 			asAtom params[2];
@@ -1142,27 +1296,24 @@ tiny_string Vector::toJSON(std::vector<ASObject *> &path, asAtom replacer, const
 			params[1] = o;
 			asAtom funcret=replacer.callFunction(asAtom::nullAtom, params, 2,false);
 			if (funcret.type != T_INVALID)
-				subres = funcret.toObject(getSystemState())->toJSON(path,asAtom::invalidAtom,spaces,filter);
+				funcret.toObject(getSystemState())->appendJSON(res,path,asAtom::invalidAtom,spaces,filter);
 		}
 		else
 		{
-			subres = o.toObject(getSystemState())->toJSON(path,replacer,spaces,filter);
+			o.toObject(getSystemState())->appendJSON(res,path,replacer,spaces,filter);
 		}
-		if (!subres.empty())
-		{
-			if (!bfirst)
-				res += ",";
-			res += newline+spaces;
-			
+		if (res.size() == valueStart)
+			res.resize(elementStart);
+		else
 			bfirst = false;
-			res += subres;
-		}
 	}
 	if (!bfirst)
-		res += newline+spaces.substr_bytes(0,spaces.numBytes()/2);
+	{
+		res += newline;
+		res.append(spaces.raw_buf(),spaces.numBytes()/2);
+	}
 	res += "]";
 	path.pop_back();
-	return res;
 }
 
 asAtom Vector::at(unsigned int index, asAtom defaultValue) const
@@ -1173,9 +1324,9 @@ asAtom Vector::at(unsigned int index, asAtom defaultValue) const
 		return defaultValue;
 }
 
-void Vector::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Vector::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -1233,7 +1384,7 @@ void Vector::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMa
 					out->serializeDouble(vec[i].toNumber());
 					break;
 				case vector_object_marker:
-					vec[i].toObject(getSystemState())->serialize(out, stringMap, objMap, traitsMap);
+					vec[i].serialize(out, stringMap, objMap, traitsMap);
 					break;
 			}
 		}
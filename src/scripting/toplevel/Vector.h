@@ -28,10 +28,37 @@ namespace lightspark
 template<class T> class TemplatedClass;
 class Vector: public ASObject
 {
+	/*
+	 * Vector.<int>, Vector.<uint> and Vector.<Number> keep their elements as
+	 * unboxed atoms of exactly that type and never contain unset elements,
+	 * so their elements can be read and compared without coercion.
+	 */
+	enum NUMERIC_TYPE { NOT_NUMERIC=0, NUMERIC_INT, NUMERIC_UINT, NUMERIC_NUMBER };
 	const Type* vec_type;
+	NUMERIC_TYPE numericType;
 	bool fixed;
 	std::vector<asAtom, reporter_allocator<asAtom>> vec;
 	int capIndex(int i) const;
+	void initNumericType();
+	//Value of new elements, unset for non numeric Vectors
+	asAtom defaultElement() const
+	{
+		switch (numericType)
+		{
+			case NUMERIC_INT:
+				return asAtom((int32_t)0);
+			case NUMERIC_UINT:
+				return asAtom((uint32_t)0);
+			case NUMERIC_NUMBER:
+				return asAtom((number_t)0);
+			default:
+				return asAtom::invalidAtom;
+		}
+	}
+	//Coerces o to vec_type, takes ownership of o
+	asAtom coerceElement(asAtom& o) const;
+	bool sortNumeric(bool isDescending);
+	int32_t indexOfNumber(number_t n, uint32_t from);
 	class sortComparatorDefault
 	{
 	private:
@@ -79,7 +106,7 @@ public:
 	asAtom getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt);
 	static bool isValidMultiname(SystemState* sys,const multiname& name, uint32_t& index);
 
-	tiny_string toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter);
+	void appendJSON(std::string& res, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter);
 
 	uint32_t nextNameIndex(uint32_t cur_index);
 	asAtom nextName(uint32_t index);
@@ -100,7 +127,10 @@ public:
 	//Appends an object to the Vector. o is coerced to vec_type.
 	//Takes ownership of o.
 	void append(asAtom& o);
+	//Appends count values to a Vector.<uint> without coercing them one by one
+	void appendUInts(const uint32_t* values, uint32_t count);
 	void setFixed(bool v) { fixed = v; }
+	void reserve(uint32_t n) { vec.reserve(n); }
 
 	//TODO: do we need to implement generator?
 	ASFUNCTION_ATOM(_constructor);
@@ -134,9 +164,9 @@ public:
 
 	ASObject* describeType() const;
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 }
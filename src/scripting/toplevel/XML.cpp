@@ -67,6 +67,7 @@ XML::XML(Class_base* c, const pugi::xml_node& _n, XML* parent, bool fromXMLList)
 bool XML::destruct()
 {
 	xmldoc.reset();
+	lazychildren = pugi::xml_node();
 	parentNode.reset();
 	nodetype =(pugi::xml_node_type)0;
 	isAttribute = false;
@@ -87,6 +88,7 @@ void XML::sinit(Class_base* c)
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_FINAL);
 	setDefaultXMLSettings();
 	c->isReusable=true;
+	c->overridesPropertyAccess=true;
 
 	c->setDeclaredMethodByQName("ignoreComments","",Class<IFunction>::getFunction(c->getSystemState(),_getIgnoreComments),GETTER_METHOD,false);
 	c->setDeclaredMethodByQName("ignoreComments","",Class<IFunction>::getFunction(c->getSystemState(),_setIgnoreComments),SETTER_METHOD,false);
@@ -354,6 +356,7 @@ ASFUNCTIONBODY(XML,_appendChild)
 
 void XML::appendChild(_R<XML> newChild)
 {
+	materializeChildren();
 	if (newChild->constructed)
 	{
 		if (this == newChild.getPtr())
@@ -419,6 +422,7 @@ XMLList* XML::getAllAttributes()
 
 const tiny_string XML::toXMLString_internal(bool pretty, uint32_t defaultnsprefix, const char *indent,bool bfirst)
 {
+	materializeChildren();
 	tiny_string res;
 	set<uint32_t> seen_prefix;
 
@@ -694,6 +698,7 @@ ASFUNCTIONBODY(XML,toXMLString)
 
 void XML::childrenImpl(XMLVector& ret, const tiny_string& name)
 {
+	materializeChildren();
 	if (!childrenlist.isNull())
 	{
 		for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
@@ -709,6 +714,7 @@ void XML::childrenImpl(XMLVector& ret, const tiny_string& name)
 
 void XML::childrenImpl(XMLVector& ret, uint32_t index)
 {
+	materializeChildren();
 	if (constructed && !childrenlist.isNull() && index < childrenlist->nodes.size())
 	{
 		_R<XML> child= childrenlist->nodes[index];
@@ -787,6 +793,7 @@ ASFUNCTIONBODY(XML,valueOf)
 
 void XML::getText(XMLVector& ret)
 {
+	materializeChildren();
 	if (childrenlist.isNull())
 		return;
 	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
@@ -825,6 +832,7 @@ ASFUNCTIONBODY(XML,elements)
 
 void XML::getElementNodes(const tiny_string& name, XMLVector& foundElements)
 {
+	materializeChildren();
 	if (childrenlist.isNull())
 		return;
 	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
@@ -1112,6 +1120,7 @@ XML *XML::copy()
 ASFUNCTIONBODY(XML,_setChildren)
 {
 	XML* th=obj->as<XML>();
+	th->materializeChildren();
 	_NR<ASObject> newChildren;
 	ARG_UNPACK(newChildren);
 
@@ -1149,6 +1158,7 @@ ASFUNCTIONBODY(XML,_normalize)
 
 void XML::normalize()
 {
+	materializeChildren();
 	childrenlist->normalize();
 }
 
@@ -1174,6 +1184,7 @@ void XML::setTextContent(const tiny_string& content)
 
 bool XML::hasSimpleContent() const
 {
+	materializeChildren();
 	if (getNodeKind() == pugi::node_comment ||
 		getNodeKind() == pugi::node_pi)
 		return false;
@@ -1189,6 +1200,7 @@ bool XML::hasSimpleContent() const
 
 bool XML::hasComplexContent() const
 {
+	materializeChildren();
 	return !hasSimpleContent();
 }
 
@@ -1200,6 +1212,7 @@ pugi::xml_node_type XML::getNodeKind() const
 
 void XML::getDescendantsByQName(const tiny_string& name, uint32_t ns, bool bIsAttribute, XMLVector& ret) const
 {
+	materializeChildren();
 	if (!constructed)
 		return;
 	if (bIsAttribute && !attributelist.isNull())
@@ -1431,6 +1444,7 @@ XML::XMLVector XML::getValuesByMultiname(_NR<XMLList> nodelist, const multiname&
 
 asAtom XML::getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt)
 {
+	materializeChildren();
 	if((opt & SKIP_IMPL)!=0)
 	{
 		asAtom res=ASObject::getVariableByMultiname(name,opt);
@@ -1501,6 +1515,7 @@ asAtom XML::getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION op
 
 void XML::setVariableByMultiname(const multiname& name, asAtom& o, CONST_ALLOWED_FLAG allowConst)
 {
+	materializeChildren();
 	unsigned int index=0;
 	bool isAttr=name.isAttribute;
 	//Normalize the name to the string form
@@ -1614,6 +1629,7 @@ void XML::setVariableByMultiname(const multiname& name, asAtom& o, CONST_ALLOWED
 						tmp->nodenamespace_prefix = BUILTIN_STRINGS::EMPTY;
 						tmp->nodevalue = o.toString();
 						tmp->constructed = true;
+						tmpnode->materializeChildren();
 						tmpnode->childrenlist->clear();
 						tmpnode->childrenlist->append(tmp);
 						if (!found)
@@ -1631,6 +1647,7 @@ void XML::setVariableByMultiname(const multiname& name, asAtom& o, CONST_ALLOWED
 				}
 				else
 				{
+					tmpnode->materializeChildren();
 					if (tmpnode->childrenlist.isNull())
 						tmpnode->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(getSystemState()));
 					
@@ -1706,6 +1723,7 @@ void XML::setVariableByMultiname(const multiname& name, asAtom& o, CONST_ALLOWED
 
 bool XML::hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype)
 {
+	materializeChildren();
 	if(considerDynamic == false)
 		return ASObject::hasPropertyByMultiname(name, considerDynamic, considerPrototype);
 	if (!isConstructed())
@@ -1774,6 +1792,7 @@ bool XML::hasPropertyByMultiname(const multiname& name, bool considerDynamic, bo
 }
 bool XML::deleteVariableByMultiname(const multiname& name)
 {
+	materializeChildren();
 	unsigned int index=0;
 	if(name.isAttribute)
 	{
@@ -2076,7 +2095,7 @@ XML *XML::createFromString(SystemState* sys, const tiny_string &s)
 	return res;
 }
 
-XML *XML::createFromNode(const pugi::xml_node &_n, XML *parent, bool fromXMLList)
+XML *XML::createFromNode(const pugi::xml_node &_n, XML *parent, bool fromXMLList, _NR<XMLParsedDocument> doc)
 {
 	XML* res = Class<XML>::getInstanceSNoArgs(parent ? parent->getSystemState() : getSys());
 	if (parent)
@@ -2084,13 +2103,28 @@ XML *XML::createFromNode(const pugi::xml_node &_n, XML *parent, bool fromXMLList
 		parent->incRef();
 		res->parentNode = _NR<XML>(parent);
 	}
+	res->xmldoc = doc;
 	res->createTree(_n,fromXMLList);
 	return res;
 }
 
+void XML::createChildren()
+{
+	pugi::xml_node node = lazychildren;
+	lazychildren = pugi::xml_node();
+	pugi::xml_node_iterator it=node.begin();
+	while(it!=node.end())
+	{
+		_NR<XML> tmp = _MR<XML>(XML::createFromNode(*it,this,false,xmldoc));
+		this->childrenlist->append(_R<XML>(tmp));
+		it++;
+	}
+}
+
 ASFUNCTIONBODY(XML,insertChildAfter)
 {
 	XML* th=Class<XML>::cast(obj);
+	th->materializeChildren();
 	_NR<ASObject> child1;
 	_NR<ASObject> child2;
 	ARG_UNPACK(child1)(child2);
@@ -2169,6 +2203,7 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 ASFUNCTIONBODY(XML,insertChildBefore)
 {
 	XML* th=Class<XML>::cast(obj);
+	th->materializeChildren();
 	_NR<ASObject> child1;
 	_NR<ASObject> child2;
 	ARG_UNPACK(child1)(child2);
@@ -2276,6 +2311,7 @@ ASFUNCTIONBODY(XML,removeNamespace)
 }
 void XML::RemoveNamespace(Namespace *ns)
 {
+	materializeChildren();
 	if (this->nodenamespace_uri == ns->getURI())
 	{
 		this->nodenamespace_uri = BUILTIN_STRINGS::EMPTY;
@@ -2310,6 +2346,7 @@ ASFUNCTIONBODY(XML,comments)
 }
 void XML::getComments(XMLVector& ret)
 {
+	materializeChildren();
 	if (childrenlist)
 	{
 		for (auto it = childrenlist->nodes.begin(); it != childrenlist->nodes.end(); it++)
@@ -2334,6 +2371,7 @@ ASFUNCTIONBODY(XML,processingInstructions)
 }
 void XML::getprocessingInstructions(XMLVector& ret, tiny_string name)
 {
+	materializeChildren();
 	if (childrenlist)
 	{
 		for (auto it = childrenlist->nodes.begin(); it != childrenlist->nodes.end(); it++)
@@ -2373,6 +2411,7 @@ ASFUNCTIONBODY(XML,_hasOwnProperty)
 
 tiny_string XML::toString_priv()
 {
+	materializeChildren();
 	tiny_string ret;
 	if (getNodeKind() == pugi::node_pcdata ||
 		isAttribute ||
@@ -2455,6 +2494,8 @@ number_t XML::toNumber()
 
 bool XML::nodesEqual(XML *a, XML *b) const
 {
+	a->materializeChildren();
+	b->materializeChildren();
 	assert(a && b);
 
 	// type
@@ -2569,9 +2610,9 @@ bool XML::isEqual(ASObject* r)
 	return false;
 }
 
-void XML::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-		    std::map<const ASObject*, uint32_t>& objMap,
-		    std::map<const Class_base*, uint32_t>& traitsMap)
+void XML::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+		    std::unordered_map<const ASObject*, uint32_t>& objMap,
+		    std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -2589,6 +2630,13 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 	bool done = false;
 	this->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(getSystemState()));
 	this->childrenlist->incRef();
+	lazychildren = pugi::xml_node();
+	if (!xmldoc.isNull() && parentNode.isNull())
+	{
+		// nodes of this document may be filled later, so remember the settings used now
+		xmldoc->ignoreWhitespace = ignoreWhitespace;
+		xmldoc->defaultNamespace = getVm(getSystemState())->getDefaultXMLNamespaceID();
+	}
 	if (parentNode.isNull() && !fromXMLList)
 	{
 		while (true)
@@ -2628,14 +2676,9 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 				case pugi::node_element: // Element tag, i.e. '<node/>'
 				{
 					fillNode(this,node);
-					pugi::xml_node_iterator it=node.begin();
-					while(it!=node.end())
-					{
-						//LOG(LOG_INFO,"rootchildnode1:"<<it->name()<<" "<<it->value()<<" "<<it->type()<<" "<<parentNode.isNull());
-						_NR<XML> tmp = _MR<XML>(XML::createFromNode(*it,this));
-						this->childrenlist->append(_R<XML>(tmp));
-						it++;
-					}
+					lazychildren = node;
+					if (xmldoc.isNull())
+						createChildren();
 					done = true;
 					break;
 				}
@@ -2665,15 +2708,10 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 			case pugi::node_element: // Element tag, i.e. '<node/>'
 			{
 				fillNode(this,node);
-				pugi::xml_node_iterator it=node.begin();
-				{
-					while(it!=node.end())
-					{
-						_NR<XML> tmp = _MR<XML>(XML::createFromNode(*it,this));
-						this->childrenlist->append(_R<XML>(tmp));
-						it++;
-					}
-				}
+				lazychildren = node;
+				// without a shared document the pugixml tree may go away, so the children are created now
+				if (xmldoc.isNull())
+					createChildren();
 				break;
 			}
 			default:
@@ -2695,9 +2733,12 @@ void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
 	node->nodevalue = srcnode.value();
 	if (!node->parentNode.isNull() && node->parentNode->nodenamespace_prefix == BUILTIN_STRINGS::EMPTY)
 		node->nodenamespace_uri = node->parentNode->nodenamespace_uri;
+	else if (!node->xmldoc.isNull())
+		node->nodenamespace_uri = node->xmldoc->defaultNamespace;
 	else
 		node->nodenamespace_uri = getVm(node->getSystemState())->getDefaultXMLNamespaceID();
-	if (ignoreWhitespace && node->nodetype == pugi::node_pcdata)
+	bool ignorews = node->xmldoc.isNull() ? ignoreWhitespace : node->xmldoc->ignoreWhitespace;
+	if (ignorews && node->nodetype == pugi::node_pcdata)
 		node->nodevalue = node->removeWhitespace(node->nodevalue);
 	node->attributelist = _MR(Class<XMLList>::getInstanceSNoArgs(node->getSystemState()));
 	pugi::xml_attribute_iterator itattr;
@@ -2834,6 +2875,7 @@ ASFUNCTIONBODY(XML,_prependChild)
 }
 void XML::prependChild(_R<XML> newChild)
 {
+	materializeChildren();
 	if (newChild->constructed)
 	{
 		if (this == newChild.getPtr())
@@ -2856,6 +2898,7 @@ void XML::prependChild(_R<XML> newChild)
 ASFUNCTIONBODY(XML,_replace)
 {
 	XML* th=Class<XML>::cast(obj);
+	th->materializeChildren();
 	_NR<ASObject> propertyName;
 	_NR<ASObject> value;
 	ARG_UNPACK(propertyName) (value);
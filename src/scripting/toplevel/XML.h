@@ -44,6 +44,18 @@ private:
 	_NR<XMLList> attributelist;
 	_NR<XMLList> procinstlist;
 	NSVector namespacedefs;
+	/*
+	 * Element whose children have not been wrapped yet. The AS objects for
+	 * the children of a parsed element are only created when they are first
+	 * reached, xmldoc keeps the pugixml tree alive until then.
+	 */
+	pugi::xml_node lazychildren;
+	void createChildren();
+	inline void materializeChildren() const
+	{
+		if (lazychildren)
+			const_cast<XML*>(this)->createChildren();
+	}
 
 	void createTree(const pugi::xml_node &rootnode, bool fromXMLList);
 	static void fillNode(XML* node, const pugi::xml_node &srcnode);
@@ -146,11 +158,11 @@ public:
 	static bool getPrettyPrinting();
 	static unsigned int getParseMode();
 	static XML* createFromString(SystemState *sys, const tiny_string& s);
-	static XML* createFromNode(const pugi::xml_node& _n, XML* parent=NULL, bool fromXMLList=false);
+	static XML* createFromNode(const pugi::xml_node& _n, XML* parent=NULL, bool fromXMLList=false, _NR<XMLParsedDocument> doc=NullRef);
 
 	const tiny_string getName() const { return nodename;}
 	uint32_t getNamespaceURI() const { return nodenamespace_uri;}
-	XMLList* getChildrenlist() { return childrenlist ? childrenlist.getPtr() : NULL; }
+	XMLList* getChildrenlist() { materializeChildren(); return childrenlist ? childrenlist.getPtr() : NULL; }
 	
 	
 	void getDescendantsByQName(const tiny_string& name, uint32_t ns, bool bIsAttribute, XMLVector& ret) const;
@@ -178,9 +190,9 @@ public:
 	asAtom nextName(uint32_t index);
 	asAtom nextValue(uint32_t index);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 }
 #endif /* SCRIPTING_TOPLEVEL_XML_H */
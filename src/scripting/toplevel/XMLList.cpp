@@ -113,6 +113,7 @@ void XMLList::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_FINAL);
 	c->isReusable=true;
+	c->overridesPropertyAccess=true;
 	c->setDeclaredMethodByQName("length","",Class<IFunction>::getFunction(c->getSystemState(),_getLength),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("attribute",AS3,Class<IFunction>::getFunction(c->getSystemState(),attribute),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("attributes",AS3,Class<IFunction>::getFunction(c->getSystemState(),attributes),NORMAL_METHOD,true);
@@ -216,9 +217,10 @@ ASFUNCTIONBODY(XMLList,_constructor)
 
 void XMLList::buildFromString(const tiny_string &str)
 {
-	pugi::xml_document xmldoc;
+	// shared with the created nodes, their children are filled from it on demand
+	_R<XMLParsedDocument> xmldoc = _MR(new XMLParsedDocument());
 
-	pugi::xml_parse_result res = xmldoc.load_buffer((void*)str.raw_buf(),str.numBytes(),XML::getParseMode());
+	pugi::xml_parse_result res = xmldoc->doc.load_buffer((void*)str.raw_buf(),str.numBytes(),XML::getParseMode());
 	switch (res.status)
 	{
 		case pugi::status_ok:
@@ -249,10 +251,10 @@ void XMLList::buildFromString(const tiny_string &str)
 			break;
 	}
 	
-	pugi::xml_node_iterator it=xmldoc.begin();
-	for(;it!=xmldoc.end();++it)
+	pugi::xml_node_iterator it=xmldoc->doc.begin();
+	for(;it!=xmldoc->doc.end();++it)
 	{
-		_R<XML> tmp = _MR(XML::createFromNode(*it,(XML*)NULL,true));
+		_R<XML> tmp = _MR(XML::createFromNode(*it,(XML*)NULL,true,xmldoc));
 		if (tmp->constructed)
 			nodes.push_back(tmp);
 	}
@@ -675,6 +677,7 @@ void XMLList::getTargetVariables(const multiname& name,XML::XMLVector& retnodes)
 			{
 				retnodes.push_back(child);
 			}
+			child->materializeChildren();
 			if (child->childrenlist)
 				child->childrenlist->getTargetVariables(name,retnodes);
 		}
@@ -1047,6 +1050,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 		}
 		if (o->as<XML>()->getNodeKind() == pugi::node_pcdata)
 		{
+			nodes[idx]->materializeChildren();
 			nodes[idx]->childrenlist->clear();
 			_R<XML> tmp = _MR<XML>(Class<XML>::getInstanceSNoArgs(getSystemState()));
 			nodes[idx]->incRef();
@@ -1071,6 +1075,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 			nodes[idx]->nodevalue = o->toString();
 		else 
 		{
+			nodes[idx]->materializeChildren();
 			nodes[idx]->childrenlist->clear();
 			_R<XML> tmp = _MR<XML>(Class<XML>::getInstanceSNoArgs(getSystemState()));
 			nodes[idx]->incRef();
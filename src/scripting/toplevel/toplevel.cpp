@@ -117,9 +117,9 @@ ASObject *Undefined::describeType() const
 	return ASObject::describeType();
 }
 
-void Undefined::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Undefined::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 		out->writeByte(amf0_undefined_marker);
@@ -288,12 +288,10 @@ SyntheticFunction::SyntheticFunction(Class_base* c,method_info* m):IFunction(c,S
  */
 asAtom SyntheticFunction::call(asAtom& obj, asAtom *args, uint32_t numArgs)
 {
-	const uint32_t opt_hit_threshold=1;
-	const uint32_t jit_hit_threshold=20;
 	if (!mi->body)
 		return asAtom::undefinedAtom;;
 
-	const uint16_t hit_count = mi->body->hit_count;
+	const uint32_t hit_count = mi->body->hit_count;
 	const method_body_info::CODE_STATUS& codeStatus = mi->body->codeStatus;
 
 	uint32_t& cur_recursion = getVm(getSystemState())->cur_recursion;
@@ -339,18 +337,37 @@ asAtom SyntheticFunction::call(asAtom& obj, asAtom *args, uint32_t numArgs)
 						  Integer::toString(numArgs));
 	}
 
-	//For sufficiently hot methods, optimize them to the internal bytecode
-	if(hit_count>=opt_hit_threshold && codeStatus==method_body_info::ORIGINAL && getSystemState()->useFastInterpreter)
+	/*
+	 * Tiered execution: methods start in the interpreter, sufficiently hot
+	 * methods are optimized to the internal bytecode and the hottest ones are
+	 * compiled by the JIT on a background thread. Until the compiled code is
+	 * available the method keeps running in the interpreter.
+	 */
+	if(hit_count>=getSystemState()->optHitThreshold && codeStatus==method_body_info::ORIGINAL &&
+	   mi->jitStatus==method_info::JIT_NONE && getSystemState()->useFastInterpreter)
 	{
 		ABCVm::optimizeFunction(this);
 	}
 
-	//Temporarily disable JITting
-	if(mi->body->exceptions.size()==0 && getSystemState()->useJit && ((hit_count>=jit_hit_threshold && codeStatus==method_body_info::OPTIMIZED) || getSystemState()->useInterpreter==false))
+	if(val==NULL && mi->body->exceptions.size()==0 && getSystemState()->useJit)
 	{
-		//We passed the hot function threshold, synt the function
-		val=mi->synt_method(getSystemState());
-		assert(val);
+		if(getSystemState()->useInterpreter==false)
+		{
+			//There is nothing to fall back to, compile synchronously
+			val=mi->synt_method(getSystemState());
+			assert(val);
+			mi->jitStatus=method_info::JIT_DONE;
+			mi->body->codeStatus=method_body_info::JITTED;
+		}
+		else
+		{
+			if(mi->jitStatus==method_info::JIT_QUEUED)
+				getVm(getSystemState())->collectJitResults();
+			if(mi->jitStatus==method_info::JIT_DONE)
+				val=mi->f;
+			else if(hit_count>=getSystemState()->jitHitThreshold)
+				getVm(getSystemState())->requestJit(mi);
+		}
 	}
 	++mi->body->hit_count;
 
@@ -407,6 +424,7 @@ asAtom SyntheticFunction::call(asAtom& obj, asAtom *args, uint32_t numArgs)
 	
 	call_context* saved_cc = getVm(getSystemState())->currentCallContext;
 	cc.defaultNamespaceUri = saved_cc ? saved_cc->defaultNamespaceUri : (uint32_t)BUILTIN_STRINGS::EMPTY;
+	cc.domainMemoryDomain = NULL;
 
 	/* Set the current global object, each script in each DoABCTag has its own */
 	getVm(getSystemState())->currentCallContext = &cc;
@@ -702,9 +720,9 @@ int64_t Null::toInt64()
 	return 0;
 }
 
-void Null::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Null::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 		out->writeByte(amf0_null_marker);
@@ -801,14 +819,14 @@ const Type* Type::getTypeFromMultiname(const multiname* mn, ABCContext* context)
 
 Class_base::Class_base(const QName& name, MemoryAccount* m):ASObject(Class_object::getClass(getSys()),T_CLASS),protected_ns(getSys(),"",NAMESPACE),constructor(NULL),
 	borrowedVariables(m),
-	context(NULL),class_name(name),memoryAccount(m),length(1),class_index(-1),isFinal(false),isSealed(false),isInterface(false),isReusable(false),use_protected(false)
+	context(NULL),class_name(name),memoryAccount(m),length(1),class_index(-1),isFinal(false),isSealed(false),isInterface(false),isReusable(false),overridesPropertyAccess(false),use_protected(false)
 {
 	setConstant();
 }
 
 Class_base::Class_base(const Class_object*):ASObject((MemoryAccount*)NULL),protected_ns(getSys(),BUILTIN_STRINGS::EMPTY,NAMESPACE),constructor(NULL),
 	borrowedVariables(NULL),
-	context(NULL),class_name(BUILTIN_STRINGS::STRING_CLASS,BUILTIN_STRINGS::EMPTY),memoryAccount(NULL),length(1),class_index(-1),isFinal(false),isSealed(false),isInterface(false),isReusable(false),use_protected(false)
+	context(NULL),class_name(BUILTIN_STRINGS::STRING_CLASS,BUILTIN_STRINGS::EMPTY),memoryAccount(NULL),length(1),class_index(-1),isFinal(false),isSealed(false),isInterface(false),isReusable(false),overridesPropertyAccess(false),use_protected(false)
 {
 	setConstant();
 	type=T_CLASS;
@@ -841,6 +859,7 @@ void Class_base::copyBorrowedTraitsFromSuper()
 		ASATOM_INCREF(v.setter);
 		borrowedVariables.Variables.insert(make_pair(i->first,v));
 	}
+	inline_cache::invalidateAll();
 }
 
 void Class_base::initStandardProps()
@@ -904,6 +923,9 @@ void Class_base::setSuper(Ref<Class_base> super_)
 	assert(!super);
 	super = super_;
 	copyBorrowedTraitsFromSuper();
+	//Subclasses inherit the overridden property access
+	if(super->overridesPropertyAccess)
+		overridesPropertyAccess=true;
 }
 
 ASFUNCTIONBODY(Class_base,_toString)
@@ -1035,6 +1057,8 @@ void Class_base::destroy()
 void Class_base::finalize()
 {
 	borrowedVariables.destroyContents();
+	//Inline caches may still refer to this class and its traits
+	inline_cache::invalidateAll();
 	super.reset();
 	prototype.reset();
 	protected_ns = nsNameAndKind(getSystemState(),"",NAMESPACE);
@@ -2209,10 +2233,47 @@ Global::Global(Class_base* cb, ABCContext* c, int s):ASObject(cb,T_OBJECT,SUBTYP
 void Global::sinit(Class_base* c)
 {
 	c->setSuper(Class<ASObject>::getRef(c->getSystemState()));
+	c->overridesPropertyAccess=true;
+}
+
+void Global::registerLazyBuiltin(const char* name, const char* ns, builtinClassFactory f)
+{
+	uint32_t nameId=getSystemState()->getUniqueStringId(name);
+	lazyBuiltins.insert(make_pair(nameId,lazyBuiltin(nsNameAndKind(getSystemState(),ns,NAMESPACE),f)));
+}
+
+void Global::materializeBuiltins(const multiname& name)
+{
+	if(lazyBuiltins.empty())
+		return;
+	uint32_t nameId=name.normalizedNameId(getSystemState());
+	auto range=lazyBuiltins.equal_range(nameId);
+	if(range.first==range.second)
+		return;
+	//Build every class with this name, the regular lookup will then
+	//take care of matching the namespaces
+	std::vector<lazyBuiltin> toBuild;
+	for(auto it=range.first;it!=range.second;++it)
+		toBuild.push_back(it->second);
+	lazyBuiltins.erase(range.first,range.second);
+	for(auto it=toBuild.begin();it!=toBuild.end();++it)
+	{
+		LOG_CALL("Building builtin class " << name);
+		Class_base* c=it->factory(getSystemState());
+		c->incRef();
+		setVariableByQName(nameId,it->ns,c,CONSTANT_TRAIT);
+	}
+}
+
+bool Global::hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype)
+{
+	materializeBuiltins(name);
+	return ASObject::hasPropertyByMultiname(name, considerDynamic, considerPrototype);
 }
 
 asAtom Global::getVariableByMultinameOpportunistic(const multiname& name)
 {
+	materializeBuiltins(name);
 	asAtom ret = ASObject::getVariableByMultiname(name, NONE);
 	//Do not attempt to define the variable now in any case
 	return ret;
@@ -2220,6 +2281,7 @@ asAtom Global::getVariableByMultinameOpportunistic(const multiname& name)
 
 asAtom Global::getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt)
 {
+	materializeBuiltins(name);
 	asAtom ret = ASObject::getVariableByMultiname(name, opt);
 	/*
 	 * All properties are registered by now, even if the script init has
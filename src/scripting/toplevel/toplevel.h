@@ -218,6 +218,9 @@ public:
 	
 	// indicates if objects can be reused after they have lost their last reference
 	bool isReusable:1;
+	// set when the instances resolve some properties on their own (e.g. by overriding
+	// getVariableByMultiname), their properties are never looked up through the inline caches
+	bool overridesPropertyAccess:1;
 private:
 	//TODO: move in Class_inherit
 	bool use_protected:1;
@@ -285,7 +288,11 @@ class Class_object: public Class_base
 {
 private:
 	//Invoke the special constructor that will set the super to Object
-	Class_object():Class_base(this){}
+	Class_object():Class_base(this)
+	{
+		//Classes have static properties and prototypes
+		overridesPropertyAccess=true;
+	}
 	asAtom getInstance(bool construct, asAtom* args, const unsigned int argslen, Class_base* realClass)
 	{
 		throw RunTimeException("Class_object::getInstance");
@@ -593,9 +600,9 @@ public:
 	TRISTATE isLess(ASObject* r);
 	ASObject *describeType() const;
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	void setVariableByMultiname(const multiname& name, asAtom &o, CONST_ALLOWED_FLAG allowConst);
 };
 
@@ -612,9 +619,9 @@ public:
 	void setVariableByMultiname(const multiname& name, asAtom &o, CONST_ALLOWED_FLAG allowConst);
 
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 class ASQName: public ASObject
@@ -684,16 +691,49 @@ class Global : public ASObject
 private:
 	int scriptId;
 	ABCContext* context;
+	typedef Class_base* (*builtinClassFactory)(SystemState* sys);
+	struct lazyBuiltin
+	{
+		nsNameAndKind ns;
+		builtinClassFactory factory;
+		lazyBuiltin(const nsNameAndKind& _ns, builtinClassFactory _f):ns(_ns),factory(_f){}
+	};
+	/*
+	 * Builtin classes that have been registered but not yet built, indexed by name id.
+	 * They are created (and their sinit is run) the first time their name is looked up
+	 */
+	std::unordered_multimap<uint32_t,lazyBuiltin> lazyBuiltins;
+	template<class C>
+	static Class_base* buildBuiltinClass(SystemState* sys)
+	{
+		return C::getClass(sys);
+	}
+	void registerLazyBuiltin(const char* name, const char* ns, builtinClassFactory f);
+	void materializeBuiltins(const multiname& name);
 public:
 	Global(Class_base* cb, ABCContext* c, int s);
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o) {}
 	asAtom getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt=NONE);
 	asAtom getVariableByMultinameOpportunistic(const multiname& name);
+	bool hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype);
 	/*
 	 * Utility method to register builtin methods and classes
 	 */
 	void registerBuiltin(const char* name, const char* ns, _R<ASObject> o);
+	/*
+	 * Register a builtin class without building it, see lazyBuiltins
+	 */
+	template<class T>
+	void registerBuiltinClass(const char* name, const char* ns)
+	{
+		registerLazyBuiltin(name,ns,&buildBuiltinClass<Class<T>>);
+	}
+	template<class T>
+	void registerBuiltinInterface(const char* name, const char* ns)
+	{
+		registerLazyBuiltin(name,ns,&buildBuiltinClass<InterfaceClass<T>>);
+	}
 };
 
 ASObject* eval(ASObject* obj,ASObject* const* args, const unsigned int argslen);
@@ -163,6 +163,10 @@ public:
 	{
 		return m;
 	}
+	inline T& operator*() const
+	{
+		return *m;
+	}
 	inline T* getPtr() const 
 	{ 
 		return m; 
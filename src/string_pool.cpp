@@ -0,0 +1,100 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include <vector>
+#include "string_pool.h"
+#include "exceptions.h"
+
+using namespace lightspark;
+using namespace std;
+
+StringPool::StringPool():nextId(0)
+{
+	for(uint32_t i=0;i<STRING_POOL_MAX_CHUNKS;i++)
+		chunks[i].store(NULL,memory_order_relaxed);
+}
+
+StringPool::~StringPool()
+{
+	for(uint32_t i=0;i<STRING_POOL_MAX_CHUNKS;i++)
+		delete chunks[i].load(memory_order_relaxed);
+}
+
+StringPool::Entry& StringPool::getEntry(uint32_t id)
+{
+	uint32_t chunkIndex=id>>STRING_POOL_CHUNK_BITS;
+	if(chunkIndex>=STRING_POOL_MAX_CHUNKS)
+		throw RunTimeException("StringPool: too many strings");
+	Chunk* c=chunks[chunkIndex].load(memory_order_acquire);
+	if(c==NULL)
+	{
+		//Several shards may need the same chunk, only one allocation wins
+		Chunk* newChunk=new Chunk;
+		if(chunks[chunkIndex].compare_exchange_strong(c,newChunk,memory_order_acq_rel))
+			c=newChunk;
+		else
+			delete newChunk;
+	}
+	return c->entries[id&((1<<STRING_POOL_CHUNK_BITS)-1)];
+}
+
+uint32_t StringPool::addLocked(Shard& shard, const tiny_string& s, uint32_t h)
+{
+	auto it=shard.ids.find(Key(&s,h));
+	if(it!=shard.ids.end())
+		return it->second;
+	uint32_t id=nextId.fetch_add(1,memory_order_relaxed);
+	Entry& e=getEntry(id);
+	e.str=s;
+	e.hash=h;
+	//The key points to the pooled copy, which never moves
+	shard.ids.insert(make_pair(Key(&e.str,h),id));
+	return id;
+}
+
+uint32_t StringPool::getId(const tiny_string& s)
+{
+	uint32_t h=hash(s);
+	Shard& shard=shards[h&(STRING_POOL_SHARDS-1)];
+	Locker l(shard.mutex);
+	return addLocked(shard,s,h);
+}
+
+void StringPool::getIds(const tiny_string* strings, uint32_t count, uint32_t* ids)
+{
+	vector<uint32_t> hashes(count);
+	vector<uint32_t> byShard[STRING_POOL_SHARDS];
+	for(uint32_t i=0;i<count;i++)
+	{
+		hashes[i]=hash(strings[i]);
+		byShard[hashes[i]&(STRING_POOL_SHARDS-1)].push_back(i);
+	}
+	for(uint32_t i=0;i<STRING_POOL_SHARDS;i++)
+	{
+		if(byShard[i].empty())
+			continue;
+		Shard& shard=shards[i];
+		Locker l(shard.mutex);
+		for(uint32_t j=0;j<byShard[i].size();j++)
+		{
+			uint32_t index=byShard[i][j];
+			ids[index]=addLocked(shard,strings[index],hashes[index]);
+		}
+	}
+}
@@ -0,0 +1,105 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H 1
+
+#include "compat.h"
+#include <atomic>
+#include <cassert>
+#include <unordered_map>
+#include "tiny_string.h"
+#include "threading.h"
+
+namespace lightspark
+{
+
+//Strings are stored in chunks of 1<<STRING_POOL_CHUNK_BITS entries
+#define STRING_POOL_CHUNK_BITS 12
+#define STRING_POOL_MAX_CHUNKS 16384
+//Must be a power of two
+#define STRING_POOL_SHARDS 16
+
+/*
+ * Interns strings and assigns them a unique id.
+ * Ids are handed out sequentially, so the first strings added get ids 0,1,...
+ * Entries are never moved nor removed, so looking up a string by id does
+ * not need any lock: the chunk pointers are published with release semantics.
+ * The lookup by string goes through one of several independently locked
+ * shards, selected by the hash of the string that is stored with each entry.
+ */
+class StringPool
+{
+private:
+	struct Entry
+	{
+		tiny_string str;
+		uint32_t hash;
+	};
+	struct Chunk
+	{
+		Entry entries[1<<STRING_POOL_CHUNK_BITS];
+	};
+	struct Key
+	{
+		const tiny_string* str;
+		uint32_t hash;
+		Key(const tiny_string* s, uint32_t h):str(s),hash(h){}
+		bool operator==(const Key& r) const
+		{
+			return hash==r.hash && *str==*r.str;
+		}
+	};
+	struct KeyHash
+	{
+		size_t operator()(const Key& k) const { return k.hash; }
+	};
+	struct Shard
+	{
+		Mutex mutex;
+		std::unordered_map<Key,uint32_t,KeyHash> ids;
+	};
+	std::atomic<Chunk*> chunks[STRING_POOL_MAX_CHUNKS];
+	std::atomic<uint32_t> nextId;
+	Shard shards[STRING_POOL_SHARDS];
+	Entry& getEntry(uint32_t id);
+	//Must be called with the shard lock held
+	uint32_t addLocked(Shard& shard, const tiny_string& s, uint32_t hash);
+public:
+	StringPool();
+	~StringPool();
+	static uint32_t hash(const tiny_string& s) { return s.hash(); }
+	uint32_t getId(const tiny_string& s);
+	/*
+	 * Interns count strings at once, taking each shard lock only once.
+	 * The ids are written to ids[0..count-1]
+	 */
+	void getIds(const tiny_string* strings, uint32_t count, uint32_t* ids);
+	const tiny_string& getString(uint32_t id) const
+	{
+		const Chunk* c=chunks[id>>STRING_POOL_CHUNK_BITS].load(std::memory_order_acquire);
+		assert(c);
+		return c->entries[id&((1<<STRING_POOL_CHUNK_BITS)-1)].str;
+	}
+	uint32_t size() const { return nextId.load(std::memory_order_relaxed); }
+};
+
+};
+
+#endif /* STRING_POOL_H */
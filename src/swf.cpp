@@ -78,12 +78,22 @@ RootMovieClip::RootMovieClip(_NR<LoaderInfo> li, _NR<ApplicationDomain> appDomai
 {
 	subtype=SUBTYPE_ROOTMOVIECLIP;
 	loaderInfo=li;
+	for(uint32_t i=0;i<DICTIONARY_NUM_PAGES;i++)
+		RELEASE_WRITE(dictionaryIndex[i],NULL);
 }
 
 RootMovieClip::~RootMovieClip()
 {
 	for(auto it=dictionary.begin();it!=dictionary.end();++it)
 		delete *it;
+	for(uint32_t i=0;i<DICTIONARY_NUM_PAGES;i++)
+		delete ACQUIRE_READ(dictionaryIndex[i]);
+}
+
+RootMovieClip::DictionaryPage::DictionaryPage()
+{
+	for(uint32_t i=0;i<DICTIONARY_PAGE_SIZE;i++)
+		RELEASE_WRITE(tags[i],NULL);
 }
 
 void RootMovieClip::parsingFailed()
@@ -181,12 +191,12 @@ extern uint32_t asClassCount;
 
 SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode):
 	terminated(0),renderRate(0),error(false),shutdown(false),
-	renderThread(NULL),inputThread(NULL),engineData(NULL),mainThread(0),dumpedSWFPathAvailable(0),
+	renderThread(NULL),inputThread(NULL),engineData(NULL),mainThread(0),frameToRender(false),dumpedSWFPathAvailable(0),
 	vmVersion(VMNONE),childPid(0),
 	parameters(NullRef),
-	invalidateQueueHead(NullRef),invalidateQueueTail(NullRef),lastUsedStringId(0),lastUsedNamespaceId(0x7fffffff),
+	invalidateQueueHead(NullRef),invalidateQueueTail(NullRef),hitTestGeneration(0),lastUsedNamespaceId(0x7fffffff),
 	showProfilingData(false),flashMode(mode),
-	currentVm(NULL),builtinClasses(NULL),useInterpreter(true),useFastInterpreter(false),useJit(false),exitOnError(ERROR_NONE),
+	currentVm(NULL),builtinClasses(NULL),useInterpreter(true),useFastInterpreter(false),useJit(false),optHitThreshold(1),jitHitThreshold(20),useCodeCache(true),unthrottled(false),exitOnError(ERROR_NONE),
 	downloadManager(NULL),extScriptObject(NULL),scaleMode(SHOW_ALL),unaccountedMemory(NULL),tagsMemory(NULL),stringMemory(NULL)
 {
 	//Forge the builtin strings
@@ -266,6 +276,8 @@ SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode):
 	stage->_addChildAt(_MR(mainClip),0);
 	//Get starting time
 	startTime=compat_msectiming();
+	builtinsInitTime=0;
+	firstScriptTime=0;
 	
 	renderThread=new RenderThread(this);
 	inputThread=new InputThread(this);
@@ -708,7 +720,10 @@ void SystemState::startRenderTicks()
 	assert(renderThread);
 	assert(renderRate);
 	removeJob(renderThread);
-	addTick(1000/renderRate,renderThread);
+	//Frames are rendered by tick once they are complete
+	if(isFrameDriven())
+		return;
+	addTick(unthrottled ? 1 : 1000/renderRate,renderThread);
 }
 
 void SystemState::EngineCreator::execute()
@@ -1014,6 +1029,11 @@ void SystemState::addJob(IThreadJob* j)
 	threadPool->addJob(j);
 }
 
+ThreadPoolCounters SystemState::getThreadPoolCounters(THREAD_JOB_PRIORITY p) const
+{
+	return threadPool->getCounters(p);
+}
+
 void SystemState::addTick(uint32_t tickTime, ITickJob* job)
 {
 	timerThread->addTick(tickTime,job);
@@ -1044,6 +1064,14 @@ ThreadProfile* SystemState::allocateProfiler(const lightspark::RGB& color)
 
 void SystemState::addToInvalidateQueue(_R<DisplayObject> d)
 {
+	d->invalidateHitBounds();
+	//Objects inside a subtree cached as bitmap are drawn by the root of the subtree
+	DisplayObject* root=d->getRetainedSurfaceRoot();
+	if(root && root!=d.getPtr())
+	{
+		d->invalidateRetainedSurface();
+		return;
+	}
 	SpinlockLocker l(invalidateQueueLock);
 	//Check if the object is already in the queue
 	if(!d->invalidateQueueNext.isNull() || d==invalidateQueueTail)
@@ -1059,13 +1087,19 @@ void SystemState::addToInvalidateQueue(_R<DisplayObject> d)
 
 void SystemState::flushInvalidationQueue()
 {
+	//Cached mouse targets are only reused during a single frame
+	invalidateHitTests();
 	SpinlockLocker l(invalidateQueueLock);
 	_NR<DisplayObject> cur=invalidateQueueHead;
 	while(!cur.isNull())
 	{
 		if(cur->isOnStage() && cur->hasChanged)
 		{
-			IDrawable* d=cur->invalidate(stage, MATRIX());
+			IDrawable* d;
+			if(cur->hasRetainedSurface())
+				d=cur->updateRetainedSurface(stage);
+			else
+				d=cur->invalidate(stage, MATRIX());
 			//Check if the drawable is valid and forge a new job to
 			//render it and upload it to GPU
 			if(d)
@@ -1622,7 +1656,7 @@ void RootMovieClip::commitFrame(bool another)
 		if(this==sys->mainClip)
 		{
 			/* now the frameRate is available and all SymbolClass tags have created their classes */
-			sys->addTick(1000/frameRate,sys);
+			sys->addTick(sys->unthrottled ? 1 : 1000/frameRate,sys);
 		}
 		else
 		{
@@ -1654,24 +1688,36 @@ void RootMovieClip::addToDictionary(DictionaryTag* r)
 {
 	SpinlockLocker l(dictSpinlock);
 	dictionary.push_back(r);
+	int id=r->getId();
+	if(id<0 || id>0xffff)
+		return;
+	DictionaryPage* page=ACQUIRE_READ(dictionaryIndex[id>>DICTIONARY_PAGE_BITS]);
+	if(page==NULL)
+	{
+		page=new DictionaryPage;
+		RELEASE_WRITE(dictionaryIndex[id>>DICTIONARY_PAGE_BITS],page);
+	}
+	//Like the previous linear search, the first tag with a given id wins
+	if(ACQUIRE_READ(page->tags[id&(DICTIONARY_PAGE_SIZE-1)])==NULL)
+		RELEASE_WRITE(page->tags[id&(DICTIONARY_PAGE_SIZE-1)],r);
 }
 
 /* called in vm's thread context */
 DictionaryTag* RootMovieClip::dictionaryLookup(int id)
 {
-	SpinlockLocker l(dictSpinlock);
-	auto it = dictionary.begin();
-	for(;it!=dictionary.end();++it)
+	DictionaryTag* ret=NULL;
+	if(id>=0 && id<=0xffff)
 	{
-		if((*it)->getId()==id)
-			break;
+		DictionaryPage* page=ACQUIRE_READ(dictionaryIndex[id>>DICTIONARY_PAGE_BITS]);
+		if(page)
+			ret=ACQUIRE_READ(page->tags[id&(DICTIONARY_PAGE_SIZE-1)]);
 	}
-	if(it==dictionary.end())
+	if(ret==NULL)
 	{
 		LOG(LOG_ERROR,_("No such Id on dictionary ") << id << " for " << origin);
 		throw RunTimeException("Could not find an object on the dictionary");
 	}
-	return *it;
+	return ret;
 }
 
 _NR<RootMovieClip> RootMovieClip::getRoot()
@@ -1749,6 +1795,17 @@ void SystemState::tick()
 	}
 	if(currentVm==NULL)
 		return;
+	//When running unthrottled only start a new frame when the previous one has been handled
+	if(unthrottled && currentVm->getEventQueueSize()!=0)
+		return;
+	if(isFrameDriven() && frameToRender)
+	{
+		//Wait until all the drawings of the frame have been uploaded
+		if(renderThread->hasPendingDrawJobs())
+			return;
+		renderThread->renderFrame();
+		frameToRender=false;
+	}
 	/* See http://www.senocular.com/flash/tutorials/orderofoperations/
 	 * for the description of steps.
 	 */
@@ -1799,7 +1856,10 @@ void SystemState::tick()
 	/* Step 0: Set current frame number to the next frame */
 	_R<AdvanceFrameEvent> advFrame = _MR(new (unaccountedMemory) AdvanceFrameEvent());
 	if(currentVm->addEvent(NullRef, advFrame))
+	{
 		advFrame->wait();
+		frameToRender=true;
+	}
 }
 
 void SystemState::tickFence()
@@ -1818,28 +1878,6 @@ void SystemState::resizeCompleted()
 	}
 }
 
-const tiny_string& SystemState::getStringFromUniqueId(uint32_t id) const
-{
-	Locker l(poolMutex);
-	auto it=uniqueStringMap.right.find(id);
-	assert(it!=uniqueStringMap.right.end());
-	return it->second;
-}
-
-uint32_t SystemState::getUniqueStringId(const tiny_string& s)
-{
-	Locker l(poolMutex);
-	auto it=uniqueStringMap.left.find(s);
-	if(it==uniqueStringMap.left.end())
-	{
-		auto ret=uniqueStringMap.left.insert(make_pair(s,lastUsedStringId));
-		assert(ret.second);
-		it=ret.first;
-		lastUsedStringId++;
-	}
-	return it->second;
-}
-
 const nsNameAndKindImpl& SystemState::getNamespaceFromUniqueId(uint32_t id) const
 {
 	Locker l(poolMutex);
@@ -33,6 +33,7 @@
 #include "scripting/flash/utils/IntervalManager.h"
 #include "timer.h"
 #include "memory_support.h"
+#include "string_pool.h"
 #include "platforms/engineutils.h"
 
 class uncompressing_filter;
@@ -59,16 +60,35 @@ class SecurityDomain;
 class Class_inherit;
 class DefineFont3Tag;
 
+/*
+ * Character ids are 16 bit, the id index is split in pages of
+ * DICTIONARY_PAGE_SIZE entries that are allocated on demand
+ */
+#define DICTIONARY_PAGE_BITS 8
+#define DICTIONARY_PAGE_SIZE (1<<DICTIONARY_PAGE_BITS)
+#define DICTIONARY_NUM_PAGES (0x10000>>DICTIONARY_PAGE_BITS)
+
 class RootMovieClip: public MovieClip
 {
 friend class ParseThread;
 protected:
 	URLInfo origin;
 private:
+	struct DictionaryPage
+	{
+		ACQUIRE_RELEASE_VARIABLE(DictionaryTag*, tags[DICTIONARY_PAGE_SIZE]);
+		DictionaryPage();
+	};
 	bool parsingIsFailed;
 	RGB Background;
+	/*
+	 * dictSpinlock only serializes the writers, the owning list and the
+	 * pages for ids not yet seen. Readers go through dictionaryIndex
+	 * without taking any lock
+	 */
 	Spinlock dictSpinlock;
 	std::list < DictionaryTag* > dictionary;
+	ACQUIRE_RELEASE_VARIABLE(DictionaryPage*, dictionaryIndex[DICTIONARY_NUM_PAGES]);
 	std::list< std::pair<tiny_string, DictionaryTag*> > classesToBeBound;
 	std::map < tiny_string,DefineFont3Tag* > embeddedfonts;
 
@@ -164,6 +184,7 @@ private:
 		void execute();
 		void threadAbort();
 		void jobFence() { delete this; }
+		THREAD_JOB_PRIORITY getPriority() const { return JOB_PRIORITY_RENDER; }
 	};
 	friend class SystemState::EngineCreator;
 	ThreadPool* threadPool;
@@ -178,6 +199,13 @@ private:
 	EngineData* engineData;
 	Thread* mainThread;
 	void startRenderTicks();
+	/*
+		Headless unthrottled movies render each frame once from tick instead of
+		using render ticks
+	*/
+	bool isFrameDriven() const { return unthrottled && engineData && engineData->headless; }
+	//The last advanced frame still has to be rendered by tick
+	bool frameToRender;
 	Mutex rootMutex;
 	/**
 		Create the rendering and input engines
@@ -244,6 +272,11 @@ private:
 	   The lock for the invalidate queue
 	*/
 	Spinlock invalidateQueueLock;
+	/*
+	   Changes every time the result of a hit test may change, it is
+	   also incremented once per frame
+	*/
+	ATOMIC_INT32(hitTestGeneration);
 #ifdef PROFILING_SUPPORT
 	/*
 	   Output file for the profiling data
@@ -257,9 +290,9 @@ private:
 	/*
 	 * Pooling support
 	 */
+	//Strings have their own pool, which does not need poolMutex
+	StringPool stringPool;
 	mutable Mutex poolMutex;
-	boost::bimap<tiny_string, uint32_t> uniqueStringMap;
-	uint32_t lastUsedStringId;
 	boost::bimap<nsNameAndKindImpl, uint32_t> uniqueNamespaceMap;
 	//This needs to be atomic because it's decremented without the mutex held
 	ATOMIC_INT32(lastUsedNamespaceId);
@@ -351,6 +384,10 @@ public:
 
 	//Application starting time in milliseconds
 	uint64_t startTime;
+	//Startup metrics: CPU time (in microseconds) spent by the VM to register
+	//the builtins, and time (in milliseconds) from startTime to the first ABC block
+	uint32_t builtinsInitTime;
+	uint64_t firstScriptTime;
 
 	//Classes set. They own one reference to each class/template
 	std::set<Class_base*> customClasses;
@@ -362,6 +399,13 @@ public:
 	bool useInterpreter;
 	bool useFastInterpreter;
 	bool useJit;
+	//Number of calls before a method is optimized or queued for the JIT
+	uint32_t optHitThreshold;
+	uint32_t jitHitThreshold;
+	//Reuse the optimized code of previous runs, see CodeCache
+	bool useCodeCache;
+	//Advance frames as fast as the VM can process them instead of following the frame rate
+	bool unthrottled;
 	ERROR_TYPE exitOnError;
 
 	//Parameters/FlashVars
@@ -377,6 +421,8 @@ public:
 
 	//Interfaces to the internal thread pool and timer thread
 	void addJob(IThreadJob* j) DLL_PUBLIC;
+	//Queue depth and latency of each class of jobs in the thread pool
+	ThreadPoolCounters getThreadPoolCounters(THREAD_JOB_PRIORITY p) const DLL_PUBLIC;
 	void addTick(uint32_t tickTime, ITickJob* job);
 	void addFrameTick(uint32_t tickTime, ITickJob* job);
 	void addWait(uint32_t waitTime, ITickJob* job);
@@ -422,6 +468,10 @@ public:
 	void addToInvalidateQueue(_R<DisplayObject> d);
 	void flushInvalidationQueue();
 
+	//Hit test results caching support
+	void invalidateHitTests() { ++hitTestGeneration; }
+	int32_t getHitTestGeneration() const { return hitTestGeneration; }
+
 	//Resize support
 	void resizeCompleted();
 
@@ -445,8 +495,14 @@ public:
 	/*
 	 * Pooling support
 	 */
-	uint32_t getUniqueStringId(const tiny_string& s);
-	const tiny_string& getStringFromUniqueId(uint32_t id) const;
+	uint32_t getUniqueStringId(const tiny_string& s) { return stringPool.getId(s); }
+	//Interns count strings in one pass, the ids are written to ids[0..count-1]
+	void getUniqueStringIds(const tiny_string* strings, uint32_t count, uint32_t* ids)
+	{
+		stringPool.getIds(strings,count,ids);
+	}
+	//Lock free, the id must have been returned by getUniqueStringId(s)
+	const tiny_string& getStringFromUniqueId(uint32_t id) const { return stringPool.getString(id); }
 	/*
 	 * Looks for the given nsNameAndKindImpl in the map.
 	 * If not present it will be created with hintedId as it's id.
@@ -506,6 +562,7 @@ private:
 	FILE_TYPE fileType;
 	void threadAbort();
 	void jobFence() {};
+	THREAD_JOB_PRIORITY getPriority() const { return JOB_PRIORITY_PARSE; }
 	void parseSWFHeader(RootMovieClip *root, UI8 ver);
 	void parseSWF(UI8 ver);
 	void parseBitmap();
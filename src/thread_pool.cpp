@@ -26,52 +26,87 @@
 
 using namespace lightspark;
 
-ThreadPool::ThreadPool(SystemState* s):num_jobs(0),stopFlag(false)
+//The worker running on the current thread, if any
+DEFINE_AND_INITIALIZE_TLS(currentWorker);
+
+ThreadPool::ThreadPool(SystemState* s):numWorkers(0),idleWorkers(0),pendingJobs(0),num_jobs(0),stopFlag(false)
 {
 	m_sys=s;
-	for(uint32_t i=0;i<NUM_THREADS;i++)
-	{
-		curJobs[i]=NULL;
+	uint32_t initialWorkers=g_get_num_processors();
+	if(initialWorkers<2)
+		initialWorkers=2;
+	if(initialWorkers>MAX_THREADS)
+		initialWorkers=MAX_THREADS;
+	Locker l(mutex);
+	for(uint32_t i=0;i<initialWorkers;i++)
+		addWorker();
+}
+
+//Must be called with the mutex held
+void ThreadPool::addWorker()
+{
+	uint32_t index=numWorkers;
+	assert(index<MAX_THREADS);
+	Worker* w=new Worker(this,index);
+	workers[index]=w;
+	idleWorkers++;
+	numWorkers++;
 #ifdef HAVE_NEW_GLIBMM_THREAD_API
-		threads[i] = Thread::create(sigc::bind(&job_worker,this,i));
+	w->thread = Thread::create(sigc::bind(&job_worker,w));
 #else
-		threads[i] = Thread::create(sigc::bind(&job_worker,this,i),true);
+	w->thread = Thread::create(sigc::bind(&job_worker,w),true);
 #endif
-		
-	}
 }
 
 void ThreadPool::forceStop()
 {
 	if(!stopFlag)
 	{
-		stopFlag=true;
+		uint32_t stoppedWorkers;
+		{
+			Locker l(mutex);
+			stopFlag=true;
+			stoppedWorkers=numWorkers;
+		}
 		//Signal an event for all the threads
-		for(int i=0;i<NUM_THREADS;i++)
+		for(uint32_t i=0;i<stoppedWorkers;i++)
 			num_jobs.signal();
 
 		{
 			Locker l(mutex);
 			//Now abort any job that is still executing
-			for(int i=0;i<NUM_THREADS;i++)
+			for(uint32_t i=0;i<stoppedWorkers;i++)
 			{
-				if(curJobs[i])
+				if(workers[i]->curJob)
 				{
-					curJobs[i]->threadAborting = true;
-					curJobs[i]->threadAbort();
+					workers[i]->curJob->threadAborting = true;
+					workers[i]->curJob->threadAbort();
 				}
 			}
 			//Fence all the non executed jobs
-			std::deque<IThreadJob*>::iterator it=jobs.begin();
-			for(;it!=jobs.end();++it)
-				(*it)->jobFence();
-			jobs.clear();
+			for(uint32_t p=0;p<JOB_PRIORITY_COUNT;p++)
+			{
+				for(auto it=jobs[p].begin();it!=jobs[p].end();++it)
+					it->job->jobFence();
+				jobs[p].clear();
+				for(uint32_t i=0;i<stoppedWorkers;i++)
+				{
+					Locker wl(workers[i]->mutex);
+					for(auto it=workers[i]->jobs[p].begin();it!=workers[i]->jobs[p].end();++it)
+						it->job->jobFence();
+					workers[i]->jobs[p].clear();
+				}
+				counters[p].queueDepth=0;
+			}
+			pendingJobs=0;
 		}
 
-		for(int i=0;i<NUM_THREADS;i++)
-		{
-			threads[i]->join();
-		}
+		//Workers that are still running may steal from the queues of the
+		//others, so no worker can be deleted before all of them are joined
+		for(uint32_t i=0;i<stoppedWorkers;i++)
+			workers[i]->thread->join();
+		for(uint32_t i=0;i<stoppedWorkers;i++)
+			delete workers[i];
 	}
 }
 
@@ -80,13 +115,75 @@ ThreadPool::~ThreadPool()
 	forceStop();
 }
 
-void ThreadPool::job_worker(ThreadPool* th, uint32_t index)
+bool ThreadPool::popJob(JobQueues& queues, THREAD_JOB_PRIORITY p, QueuedJob& ret)
+{
+	std::deque<QueuedJob>& q=queues[p];
+	if(q.empty())
+		return false;
+	ret=q.front();
+	q.pop_front();
+	return true;
+}
+
+/*
+ * Looks for the most urgent job in the worker's own queues, then in the shared
+ * ones and last in the queues of the other workers. Every queue is consumed in
+ * the order the jobs were added, also by thieves.
+ * Returns NULL if another worker took the job we were woken up for first.
+ */
+IThreadJob* ThreadPool::takeJob(Worker* w)
+{
+	QueuedJob found(NULL,0);
+	THREAD_JOB_PRIORITY p;
+	for(p=JOB_PRIORITY_RENDER;p<JOB_PRIORITY_COUNT;p=(THREAD_JOB_PRIORITY)(p+1))
+	{
+		{
+			Locker l(w->mutex);
+			if(popJob(w->jobs, p, found))
+				break;
+		}
+		{
+			Locker l(mutex);
+			if(popJob(jobs, p, found))
+				break;
+		}
+		bool stolen=false;
+		//Steal the oldest job of the first worker that has one
+		for(uint32_t i=1;i<(uint32_t)numWorkers && !stolen;i++)
+		{
+			Worker* victim=workers[(w->index+i)%numWorkers];
+			Locker l(victim->mutex);
+			stolen=popJob(victim->jobs, p, found);
+		}
+		if(stolen)
+			break;
+	}
+	if(found.job==NULL)
+		return NULL;
+
+	gint64 latency=g_get_monotonic_time()-found.enqueueTime;
+	Locker l(mutex);
+	ThreadPoolCounters& c=counters[p];
+	c.queueDepth--;
+	c.started++;
+	c.totalLatency+=latency;
+	if((uint64_t)latency>c.maxLatency)
+		c.maxLatency=latency;
+	pendingJobs--;
+	idleWorkers--;
+	w->curJob=found.job;
+	return found.job;
+}
+
+void ThreadPool::job_worker(Worker* w)
 {
+	ThreadPool* th=w->pool;
 	setTLSSys(th->m_sys);
+	tls_set(&currentWorker, w);
 
 	ThreadProfile* profile=th->m_sys->allocateProfiler(RGB(200,200,0));
 	char buf[16];
-	snprintf(buf,16,"Thread %u",index);
+	snprintf(buf,16,"Thread %u",w->index);
 	profile->setTag(buf);
 
 	Chronometer chronometer;
@@ -95,11 +192,15 @@ void ThreadPool::job_worker(ThreadPool* th, uint32_t index)
 		th->num_jobs.wait();
 		if(th->stopFlag)
 			return;
-		Locker l(th->mutex);
-		IThreadJob* myJob=th->jobs.front();
-		th->jobs.pop_front();
-		th->curJobs[index]=myJob;
-		l.release();
+		IThreadJob* myJob;
+		//The semaphore guarantees that a job is queued, but we may race with other
+		//workers scanning the queues in a different order
+		while((myJob=th->takeJob(w))==NULL)
+		{
+			if(th->stopFlag)
+				return;
+			Thread::yield();
+		}
 
 		chronometer.checkpoint();
 		try
@@ -120,8 +221,9 @@ void ThreadPool::job_worker(ThreadPool* th, uint32_t index)
 		}
 		profile->accountTime(chronometer.checkpoint());
 
-		l.acquire();
-		th->curJobs[index]=NULL;
+		Locker l(th->mutex);
+		w->curJob=NULL;
+		th->idleWorkers++;
 		l.release();
 
 		//jobFencing is allowed to happen outside the mutex
@@ -131,14 +233,36 @@ void ThreadPool::job_worker(ThreadPool* th, uint32_t index)
 
 void ThreadPool::addJob(IThreadJob* j)
 {
+	assert(j);
+	THREAD_JOB_PRIORITY p=j->getPriority();
+	assert(p<JOB_PRIORITY_COUNT);
+	QueuedJob queued(j,g_get_monotonic_time());
 	Locker l(mutex);
 	if(stopFlag)
 	{
+		l.release();
 		j->jobFence();
 		return;
 	}
-	assert(j);
-	jobs.push_back(j);
+	//Jobs spawned by a worker go to its own queue, where they can be stolen
+	Worker* w=(Worker*)tls_get(&currentWorker);
+	if(w && w->pool==this)
+	{
+		Locker wl(w->mutex);
+		w->jobs[p].push_back(queued);
+	}
+	else
+		jobs[p].push_back(queued);
+	counters[p].queueDepth++;
+	pendingJobs++;
+	//Many jobs block for a long time, make sure this one does not wait for them
+	if(pendingJobs>idleWorkers && numWorkers<MAX_THREADS)
+		addWorker();
 	num_jobs.signal();
 }
 
+ThreadPoolCounters ThreadPool::getCounters(THREAD_JOB_PRIORITY p)
+{
+	Locker l(mutex);
+	return counters[p];
+}
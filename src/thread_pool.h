@@ -28,19 +28,63 @@
 namespace lightspark
 {
 
-#define NUM_THREADS 20
+//Upper bound on the number of workers, jobs like downloads may block for a long time
+#define MAX_THREADS 20
 
 class SystemState;
 
+struct ThreadPoolCounters
+{
+	//Jobs waiting to be executed
+	uint32_t queueDepth;
+	//Jobs that have been started
+	uint64_t started;
+	//Time spent by the started jobs in the queue, in microseconds
+	uint64_t totalLatency;
+	uint64_t maxLatency;
+	ThreadPoolCounters():queueDepth(0),started(0),totalLatency(0),maxLatency(0){}
+};
+
+/*
+ * The pool starts with one worker per core and grows up to MAX_THREADS
+ * when all workers are busy, since many jobs block for a long time.
+ * Each worker has its own deques for the jobs it spawns, jobs from other
+ * threads go to the shared deques. Idle workers steal from the others.
+ */
 class ThreadPool
 {
 private:
+	struct QueuedJob
+	{
+		IThreadJob* job;
+		gint64 enqueueTime;
+		QueuedJob(IThreadJob* j, gint64 t):job(j),enqueueTime(t){}
+	};
+	typedef std::deque<QueuedJob> JobQueues[JOB_PRIORITY_COUNT];
+	struct Worker
+	{
+		ThreadPool* pool;
+		uint32_t index;
+		Thread* thread;
+		IThreadJob* volatile curJob;
+		//Protects the local queues
+		Mutex mutex;
+		JobQueues jobs;
+		Worker(ThreadPool* p, uint32_t i):pool(p),index(i),thread(NULL),curJob(NULL){}
+	};
+	//Protects the shared queues, the workers array and the counters
 	Mutex mutex;
-	Thread* threads[NUM_THREADS];
-	IThreadJob* volatile curJobs[NUM_THREADS];
-	std::deque<IThreadJob*> jobs;
+	Worker* workers[MAX_THREADS];
+	ATOMIC_INT32(numWorkers);
+	uint32_t idleWorkers;
+	uint32_t pendingJobs;
+	JobQueues jobs;
+	ThreadPoolCounters counters[JOB_PRIORITY_COUNT];
 	Semaphore num_jobs;
-	static void job_worker(ThreadPool* th, uint32_t threadIndex);
+	static void job_worker(Worker* w);
+	void addWorker();
+	IThreadJob* takeJob(Worker* w);
+	static bool popJob(JobQueues& queues, THREAD_JOB_PRIORITY p, QueuedJob& ret);
 	SystemState* m_sys;
 	volatile bool stopFlag;
 public:
@@ -48,8 +92,8 @@ public:
 	~ThreadPool();
 	void addJob(IThreadJob* j);
 	void forceStop();
-};
-
+	ThreadPoolCounters getCounters(THREAD_JOB_PRIORITY p);
+	uint32_t getNumWorkers() const { return numWorkers; }
 };
 
 #endif /* THREAD_POOL_H */
@@ -100,6 +100,13 @@ public:
 	}
 };
 
+/*
+ * Priority classes of the ThreadPool jobs, from the most urgent one.
+ * Jobs of a more urgent class are always picked first.
+ */
+enum THREAD_JOB_PRIORITY { JOB_PRIORITY_RENDER=0, JOB_PRIORITY_DECODE, JOB_PRIORITY_PARSE, JOB_PRIORITY_NETWORK,
+	JOB_PRIORITY_COUNT };
+
 class IThreadJob
 {
 friend class ThreadPool;
@@ -133,6 +140,10 @@ public:
 	 * 'delete this'.
 	 */
 	virtual void jobFence()=0;
+	/*
+	 * The class used by the ThreadPool to schedule this job
+	 */
+	virtual THREAD_JOB_PRIORITY getPriority() const { return JOB_PRIORITY_NETWORK; }
 	IThreadJob() : threadAborting(false) {}
 	virtual ~IThreadJob() {}
 };
@@ -17,6 +17,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************/
 
+#include <algorithm>
+#include <new>
 #include "tiny_string.h"
 #include "exceptions.h"
 #include "swf.h"
@@ -26,7 +28,7 @@ using namespace lightspark;
 /* Implementation of Glib::ustring conversion for libxml++.
  * We implement them in the source file to not pollute the header with glib.h
  */
-tiny_string::tiny_string(const Glib::ustring& r):buf(_buf_static),stringSize(r.bytes()+1),type(STATIC)
+tiny_string::tiny_string(const Glib::ustring& r):buf(_buf_static),shared(NULL),stringSize(r.bytes()+1),type(STATIC)
 {
 	if(stringSize > STATIC_SIZE)
 		createBuffer(stringSize);
@@ -34,7 +36,7 @@ tiny_string::tiny_string(const Glib::ustring& r):buf(_buf_static),stringSize(r.b
 	init();
 }
 
-tiny_string::tiny_string(std::istream& in, int len):buf(_buf_static),stringSize(len+1),type(STATIC)
+tiny_string::tiny_string(std::istream& in, int len):buf(_buf_static),shared(NULL),stringSize(len+1),type(STATIC)
 {
 	if(stringSize > STATIC_SIZE)
 		createBuffer(stringSize);
@@ -43,7 +45,7 @@ tiny_string::tiny_string(std::istream& in, int len):buf(_buf_static),stringSize(
 	init();
 }
 
-tiny_string::tiny_string(const char* s,bool copy):_buf_static(),buf(_buf_static),type(READONLY)
+tiny_string::tiny_string(const char* s,bool copy):_buf_static(),buf(_buf_static),shared(NULL),type(READONLY)
 {
 	if(copy)
 		makePrivateCopy(s);
@@ -56,7 +58,7 @@ tiny_string::tiny_string(const char* s,bool copy):_buf_static(),buf(_buf_static)
 }
 
 tiny_string::tiny_string(const tiny_string& r):
-	_buf_static(),buf(_buf_static),stringSize(r.stringSize),numchars(r.numchars),type(STATIC),isASCII(r.isASCII),hasNull(r.hasNull)
+	_buf_static(),buf(_buf_static),shared(NULL),stringSize(r.stringSize),numchars(r.numchars),type(STATIC),isASCII(r.isASCII),hasNull(r.hasNull)
 {
 	//Fast path for static read-only strings
 	if(r.type==READONLY)
@@ -65,12 +67,21 @@ tiny_string::tiny_string(const tiny_string& r):
 		buf=r.buf;
 		return;
 	}
+	//Heap buffers are shared, they are copied on the first modification
+	if(r.type==DYNAMIC)
+	{
+		type=DYNAMIC;
+		shared=r.shared;
+		buf=r.buf;
+		ATOMIC_INCREMENT(shared->refCount);
+		return;
+	}
 	if(stringSize > STATIC_SIZE)
 		createBuffer(stringSize);
 	memcpy(buf,r.buf,stringSize);
 }
 
-tiny_string::tiny_string(const std::string& r):_buf_static(),buf(_buf_static),stringSize(r.size()+1),type(STATIC)
+tiny_string::tiny_string(const std::string& r):_buf_static(),buf(_buf_static),shared(NULL),stringSize(r.size()+1),type(STATIC)
 {
 	if(stringSize > STATIC_SIZE)
 		createBuffer(stringSize);
@@ -85,6 +96,10 @@ tiny_string::~tiny_string()
 
 tiny_string& tiny_string::operator=(const tiny_string& s)
 {
+	if(this==&s)
+		return *this;
+	if(s.type==DYNAMIC)
+		ATOMIC_INCREMENT(s.shared->refCount);
 	resetToStatic();
 	stringSize=s.stringSize;
 	//Fast path for static read-only strings
@@ -93,6 +108,12 @@ tiny_string& tiny_string::operator=(const tiny_string& s)
 		type=READONLY;
 		buf=s.buf;
 	}
+	else if(s.type==DYNAMIC)
+	{
+		type=DYNAMIC;
+		shared=s.shared;
+		buf=s.buf;
+	}
 	else
 	{
 		if(stringSize > STATIC_SIZE)
@@ -162,21 +183,11 @@ tiny_string& tiny_string::operator+=(const Glib::ustring& s)
 
 tiny_string& tiny_string::operator+=(const char* s)
 {	//deprecated, cannot handle '\0' inside string
-	if(type==READONLY)
-	{
-		char* tmp=buf;
-		makePrivateCopy(tmp);
-	}
 	uint32_t addedLen=strlen(s);
+	if(addedLen==0)
+		return *this;
 	uint32_t newStringSize=stringSize + addedLen;
-	if(type==STATIC && newStringSize > STATIC_SIZE)
-	{
-		createBuffer(newStringSize);
-		//don't copy trailing \0
-		memcpy(buf,_buf_static,stringSize-1);
-	}
-	else if(type==DYNAMIC && addedLen!=0)
-		resizeBuffer(newStringSize);
+	reserveBuffer(newStringSize);
 	//also copy \0 at the end
 	memcpy(buf+stringSize-1,s,addedLen+1);
 	stringSize=newStringSize;
@@ -186,22 +197,12 @@ tiny_string& tiny_string::operator+=(const char* s)
 
 tiny_string& tiny_string::operator+=(const tiny_string& r)
 {
-	if(type==READONLY)
-	{
-		char* tmp=buf;
-		makePrivateCopy(tmp);
-	}
+	if(r.stringSize==1)
+		return *this;
 	uint32_t newStringSize=stringSize + r.stringSize-1;
-	if(type==STATIC && newStringSize > STATIC_SIZE)
-	{
-		createBuffer(newStringSize);
-		//don't copy trailing \0
-		memcpy(buf,_buf_static,stringSize-1);
-	}
-	else if(type==DYNAMIC && r.stringSize>1)
-		resizeBuffer(newStringSize);
-	//start position is where the \0 was
-	memcpy(buf+stringSize-1,r.buf,r.stringSize);
+	reserveBuffer(newStringSize);
+	//start position is where the \0 was, r may be this string
+	memmove(buf+stringSize-1,r.buf,r.stringSize);
 	stringSize=newStringSize;
 	if (this->isASCII)
 		this->isASCII = r.isASCII;
@@ -338,29 +339,50 @@ bool tiny_string::endsWith(const char* o) const
  * returns index of character */
 uint32_t tiny_string::find(const tiny_string& needle, uint32_t start) const
 {
-	//TODO: omit copy into std::string
-	size_t bytestart = g_utf8_offset_to_pointer(buf,start) - buf;
-	size_t bytepos = std::string(*this).find(needle.raw_buf(),bytestart,needle.numBytes());
-	if(bytepos == std::string::npos)
+	if(start>numchars)
 		return npos;
-	else
-		return g_utf8_pointer_to_offset(buf,buf+bytepos);
+	uint32_t bytestart = charPointer(start) - buf;
+	uint32_t needleLen = needle.numBytes();
+	if(needleLen==0)
+		return start;
+	if(needleLen > numBytes() || bytestart > numBytes()-needleLen)
+		return npos;
+	const char* last = buf+numBytes()-needleLen;
+	const char* p = buf+bytestart;
+	while(p<=last)
+	{
+		p = (const char*)memchr(p,needle.buf[0],last-p+1);
+		if(p==NULL)
+			return npos;
+		if(memcmp(p,needle.buf,needleLen)==0)
+			return bytePosToIndex(p-buf);
+		p++;
+	}
+	return npos;
 }
 
 uint32_t tiny_string::rfind(const tiny_string& needle, uint32_t start) const
 {
-	//TODO: omit copy into std::string
-	size_t bytestart;
-	if(start == npos)
-		bytestart = std::string::npos;
+	uint32_t bytestart;
+	if(start >= numchars)
+		bytestart = numBytes();
 	else
-		bytestart = g_utf8_offset_to_pointer(buf,start) - buf;
-
-	size_t bytepos = std::string(*this).rfind(needle.raw_buf(),bytestart,needle.numBytes());
-	if(bytepos == std::string::npos)
+		bytestart = charPointer(start) - buf;
+	uint32_t needleLen = needle.numBytes();
+	if(needleLen==0)
+		return bytePosToIndex(bytestart);
+	if(needleLen > numBytes())
 		return npos;
-	else
-		return g_utf8_pointer_to_offset(buf,buf+bytepos);
+	//Candidate matches start at or before bytestart
+	uint32_t pos = std::min(bytestart, numBytes()-needleLen);
+	while(true)
+	{
+		if(buf[pos]==needle.buf[0] && memcmp(buf+pos,needle.buf,needleLen)==0)
+			return bytePosToIndex(pos);
+		if(pos==0)
+			return npos;
+		pos--;
+	}
 }
 
 void tiny_string::makePrivateCopy(const char* s)
@@ -374,28 +396,66 @@ void tiny_string::makePrivateCopy(const char* s)
 
 void tiny_string::createBuffer(uint32_t s)
 {
+	void* mem=malloc(sizeof(SharedBuffer)+s);
+	if(mem==NULL)
+		throw std::bad_alloc();
 	type=DYNAMIC;
 	reportMemoryChange(s);
-	buf=new char[s];
+	shared=new (mem) SharedBuffer(s);
+	buf=shared->data;
 }
 
-void tiny_string::resizeBuffer(uint32_t s)
+void tiny_string::releaseBuffer(SharedBuffer* b) const
+{
+	if(ATOMIC_DECREMENT(b->refCount)!=0)
+		return;
+	reportMemoryChange(-b->capacity);
+	delete[] b->charIndex.load(std::memory_order_relaxed);
+	b->~SharedBuffer();
+	free(b);
+}
+
+void tiny_string::reserveBuffer(uint32_t s)
 {
-	assert(type==DYNAMIC);
-	char* oldBuf=buf;
-	reportMemoryChange(s-stringSize);
-	buf=new char[s];
 	assert(s >= stringSize);
+	if(type!=DYNAMIC && s <= STATIC_SIZE)
+	{
+		if(type==READONLY)
+		{
+			memcpy(_buf_static,buf,stringSize);
+			buf=_buf_static;
+			type=STATIC;
+		}
+		return;
+	}
+	if(type==DYNAMIC && shared->refCount==1 && shared->capacity >= s)
+	{
+		//The contents are going to change
+		delete[] shared->charIndex.exchange(NULL);
+		return;
+	}
+	const char* oldBuf=buf;
+	SharedBuffer* oldShared=NULL;
+	uint32_t capacity=s;
+	if(type==DYNAMIC)
+	{
+		oldShared=shared;
+		//Growing an already long string, leave room for more appends
+		if(oldShared->refCount==1)
+			capacity+=s/2;
+	}
+	createBuffer(capacity);
 	memcpy(buf,oldBuf,stringSize);
-	delete[] oldBuf;
+	if(oldShared)
+		releaseBuffer(oldShared);
 }
 
 void tiny_string::resetToStatic()
 {
 	if(type==DYNAMIC)
 	{
-		reportMemoryChange(-stringSize);
-		delete[] buf;
+		releaseBuffer(shared);
+		shared=NULL;
 	}
 	stringSize=1;
 	_buf_static[0] = '\0';
@@ -403,6 +463,28 @@ void tiny_string::resetToStatic()
 	type=STATIC;
 }
 
+const uint32_t* tiny_string::getCharIndex() const
+{
+	assert(type==DYNAMIC);
+	uint32_t* index=shared->charIndex.load(std::memory_order_acquire);
+	if(index)
+		return index;
+	uint32_t count=(numchars>>CHAR_INDEX_STRIDE_BITS)+1;
+	uint32_t* newIndex=new uint32_t[count];
+	const char* p=buf;
+	newIndex[0]=0;
+	for(uint32_t i=1;i<count;i++)
+	{
+		p=g_utf8_offset_to_pointer(p,1<<CHAR_INDEX_STRIDE_BITS);
+		newIndex[i]=p-buf;
+	}
+	//Other copies of this string may be building the index too
+	if(shared->charIndex.compare_exchange_strong(index,newIndex,std::memory_order_acq_rel))
+		return newIndex;
+	delete[] newIndex;
+	return index;
+}
+
 void tiny_string::init()
 {
 	numchars = 0;
@@ -460,8 +542,8 @@ tiny_string& tiny_string::replace(uint32_t pos1, uint32_t n1, const tiny_string&
 		n1 = numChars()-pos1;
 	if (isASCII)
 		return replace_bytes(pos1, n1, o);
-	uint32_t bytestart = g_utf8_offset_to_pointer(buf,pos1)-buf;
-	uint32_t byteend = g_utf8_offset_to_pointer(buf,pos1+n1)-buf;
+	uint32_t bytestart = charPointer(pos1)-buf;
+	uint32_t byteend = charPointer(pos1+n1)-buf;
 	return replace_bytes(bytestart, byteend-bytestart, o);
 }
 
@@ -475,8 +557,10 @@ tiny_string& tiny_string::replace_bytes(uint32_t bytestart, uint32_t bytenum, co
 
 tiny_string tiny_string::substr_bytes(uint32_t start, uint32_t len) const
 {
-	tiny_string ret;
 	assert(start+len < stringSize);
+	if(start==0 && len==numBytes())
+		return *this;
+	tiny_string ret;
 	if(len+1 > STATIC_SIZE)
 		ret.createBuffer(len+1);
 	memcpy(ret.buf,buf+start,len);
@@ -496,8 +580,8 @@ tiny_string tiny_string::substr(uint32_t start, uint32_t len) const
 		len = numChars()-start;
 	if (isASCII)
 		return substr_bytes(start, len);
-	uint32_t bytestart = g_utf8_offset_to_pointer(buf,start) - buf;
-	uint32_t byteend = g_utf8_offset_to_pointer(buf,start+len) - buf;
+	uint32_t bytestart = charPointer(start) - buf;
+	uint32_t byteend = charPointer(start+len) - buf;
 	return substr_bytes(bytestart, byteend-bytestart);
 }
 
@@ -506,7 +590,7 @@ tiny_string tiny_string::substr(uint32_t start, const CharIterator& end) const
 	if (isASCII)
 		return substr_bytes(start, (end.buf_ptr - buf)-start);
 	assert_and_throw(start < numChars());
-	uint32_t bytestart = g_utf8_offset_to_pointer(buf,start) - buf;
+	uint32_t bytestart = charPointer(start) - buf;
 	uint32_t byteend = end.buf_ptr - buf;
 	return substr_bytes(bytestart, byteend-bytestart);
 }
@@ -606,7 +690,14 @@ uint32_t tiny_string::bytePosToIndex(uint32_t bytepos) const
 		return numChars();
 	if (isASCII)
 		return bytepos;
-
+	if (type==DYNAMIC && numchars>=CHAR_INDEX_MIN_CHARS)
+	{
+		const uint32_t* index=getCharIndex();
+		uint32_t count=(numchars>>CHAR_INDEX_STRIDE_BITS)+1;
+		//Last indexed character at or before bytepos
+		uint32_t i=std::upper_bound(index,index+count,bytepos)-index-1;
+		return (i<<CHAR_INDEX_STRIDE_BITS)+g_utf8_pointer_to_offset(buf+index[i], buf+bytepos);
+	}
 	return g_utf8_pointer_to_offset(raw_buf(), raw_buf() + bytepos);
 }
 
@@ -649,6 +740,18 @@ int tiny_string::compare(const tiny_string& r) const
 	return res;
 }
 
+uint32_t tiny_string::hash() const
+{
+	const unsigned char* p=(const unsigned char*)buf;
+	uint32_t h=2166136261u;
+	for(uint32_t i=0;i<stringSize-1;i++)
+	{
+		h^=p[i];
+		h*=16777619u;
+	}
+	return h;
+}
+
 #ifdef MEMORY_USAGE_PROFILING
 void tiny_string::reportMemoryChange(int32_t change) const
 {
@@ -24,6 +24,7 @@
 #include <cstdint>
 #include <ostream>
 #include <list>
+#include <functional>
 /* for utf8 handling */
 #include <glib.h>
 #include <glibmm/ustring.h>
@@ -89,10 +90,29 @@ class DLL_PUBLIC tiny_string
 friend std::ostream& operator<<(std::ostream& s, const tiny_string& r);
 private:
 	enum TYPE { READONLY=0, STATIC, DYNAMIC };
-	/*must be at least 6 bytes for tiny_string(uint32_t c) constructor */
-	#define STATIC_SIZE 64
+	/*must be at least 7 bytes for fromChar(uint32_t c) */
+	#define STATIC_SIZE 32
+	/* non-ASCII DYNAMIC strings with at least this many characters get a character index */
+	#define CHAR_INDEX_MIN_CHARS 128
+	/* the character index stores the byte offset of every 1<<CHAR_INDEX_STRIDE_BITS-th character */
+	#define CHAR_INDEX_STRIDE_BITS 5
+	/*
+	 * Heap storage of DYNAMIC strings. Copies of a string share it, it is
+	 * only modified in place when a single string references it.
+	 */
+	struct SharedBuffer
+	{
+		ATOMIC_INT32(refCount);
+		uint32_t capacity;
+		//Built on first use by getCharIndex
+		ACQUIRE_RELEASE_VARIABLE(uint32_t*, charIndex);
+		char data[1];
+		SharedBuffer(uint32_t c):refCount(1),capacity(c),charIndex(NULL){}
+	};
 	char _buf_static[STATIC_SIZE];
 	char* buf;
+	//Only valid if type==DYNAMIC, buf then points to shared->data
+	SharedBuffer* shared;
 	/*
 	   stringSize includes the trailing \0
 	*/
@@ -109,15 +129,30 @@ private:
 	//TODO: use static buffer again if reassigning to short string
 	void makePrivateCopy(const char* s);
 	void createBuffer(uint32_t s);
-	void resizeBuffer(uint32_t s);
+	void releaseBuffer(SharedBuffer* b) const;
+	/* makes buf writable and at least s bytes long, the contents are preserved */
+	void reserveBuffer(uint32_t s);
 	void resetToStatic();
 	void init();
+	const uint32_t* getCharIndex() const;
+	/* returns a pointer to the character at index idx, idx may be numChars() */
+	const char* charPointer(uint32_t idx) const
+	{
+		if (isASCII)
+			return buf+idx;
+		if (type==DYNAMIC && numchars>=CHAR_INDEX_MIN_CHARS)
+		{
+			const char* p=buf+getCharIndex()[idx>>CHAR_INDEX_STRIDE_BITS];
+			return g_utf8_offset_to_pointer(p,idx&((1<<CHAR_INDEX_STRIDE_BITS)-1));
+		}
+		return g_utf8_offset_to_pointer(buf,idx);
+	}
 	bool isASCII:1;
 	bool hasNull:1;
 public:
 	static const uint32_t npos = (uint32_t)(-1);
 
-	tiny_string():_buf_static(),buf(_buf_static),stringSize(1),numchars(0),type(STATIC),isASCII(true),hasNull(false){buf[0]=0;}
+	tiny_string():_buf_static(),buf(_buf_static),shared(NULL),stringSize(1),numchars(0),type(STATIC),isASCII(true),hasNull(false){buf[0]=0;}
 	/* construct from utf character */
 	static tiny_string fromChar(uint32_t c);
 	tiny_string(const char* s,bool copy=false);
@@ -195,7 +230,7 @@ public:
 	{
 		if (isASCII)
 			return buf[idx];
-		return g_utf8_get_char(g_utf8_offset_to_pointer(buf,idx));
+		return g_utf8_get_char(charPointer(idx));
 	}
 	/* start is an index of characters.
 	 * returns index of character */
@@ -217,7 +252,18 @@ public:
 	CharIterator end();
 	CharIterator end() const;
 	int compare(const tiny_string& r) const;
+	/* FNV-1a hash of the bytes, including any '\0's */
+	uint32_t hash() const;
+};
+
 };
 
+namespace std
+{
+template<>
+struct hash<lightspark::tiny_string>
+{
+	size_t operator()(const lightspark::tiny_string& s) const { return s.hash(); }
 };
+}
 #endif /* TINY_STRING_H */
@@ -0,0 +1,17 @@
+package
+{
+public class Point3
+{
+	public var x:Number;
+	public var y:Number;
+	public var z:Number;
+	public var name:String;
+	public const weight:int = 1;
+	function Point3(_x:Number = 0, _y:Number = 0, _z:Number = 0)
+	{
+		x=_x;
+		y=_y;
+		z=_z;
+	}
+}
+}